@@ -0,0 +1,23 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 VirtualCoord;
+
+// The page and level each pixel of virtual.frag would want, for VirtualTexture
+// to read back: page x, page y and level in the first three channels
+uniform int virtualPages;
+uniform int virtualLevels;
+uniform float feedbackBias;             // -log2(VirtualTexture::FEEDBACK_SCALE)
+
+const float PAGE_SIZE = 128.0;          // VirtualTexture::PAGE_SIZE
+
+void main() {
+    // Derivatives here are FEEDBACK_SCALE times those at full resolution
+    vec2 texel = VirtualCoord * float(virtualPages) * PAGE_SIZE;
+    float lod = log2(max(length(dFdx(texel)), length(dFdy(texel)))) + feedbackBias;
+    int level = clamp(int(floor(lod)), 0, virtualLevels - 1);
+    
+    int levelPages = virtualPages >> level;
+    ivec2 page = clamp(ivec2(VirtualCoord * float(levelPages)), ivec2(0), ivec2(levelPages - 1));
+    FragColor = vec4(vec2(page), float(level), 255.0) / 255.0;
+}
@@ -0,0 +1,37 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in float ViewDepth;
+flat in float Layer;
+flat in float Light;        // Sector light, 0 to 1
+
+uniform sampler2DArray textureSampler;
+
+// Paletted textures hold palette indices. The colormap row for the light
+// level picks a darker index, which the palette turns into a color.
+uniform bool paletted;
+uniform sampler2D paletteSampler;       // 256 x 1 colors
+uniform sampler2D colormapSampler;      // 256 x LIGHT_LEVELS indices, row 0 full bright
+uniform vec4 paletteTint;               // rgb = color, a = amount
+
+const float LIGHT_LEVELS = 32.0;        // Palette::LIGHT_LEVELS
+
+// Colormap rows added per unit of distance, so far surfaces fade as in Doom
+const float DISTANCE_FADE = 0.25;
+
+void main() {
+    float row = clamp((1.0 - Light) * LIGHT_LEVELS + ViewDepth * DISTANCE_FADE, 0.0, LIGHT_LEVELS - 1.0);
+    
+    vec4 color;
+    if (paletted) {
+        int index = int(texture(textureSampler, vec3(TexCoord, Layer)).r * 255.0 + 0.5);
+        int shaded = int(texelFetch(colormapSampler, ivec2(index, int(row)), 0).r * 255.0 + 0.5);
+        color = vec4(texelFetch(paletteSampler, ivec2(shaded, 0), 0).rgb, 1.0);
+    } else {
+        color = texture(textureSampler, vec3(TexCoord, Layer));
+        color.rgb *= 1.0 - row / LIGHT_LEVELS;
+    }
+    
+    FragColor = vec4(mix(color.rgb, paletteTint.rgb, paletteTint.a), color.a);
+}
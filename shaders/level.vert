@@ -0,0 +1,30 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in float aLayer;
+layout (location = 3) in float aLight;
+
+out vec2 TexCoord;
+out float ViewDepth;
+flat out float Layer;
+flat out float Light;
+
+// Updated once per frame, shared by all programs (see UniformBlocks.h)
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 time;
+};
+
+uniform mat4 model;
+
+void main() {
+    vec4 worldPosition = model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * worldPosition;
+    TexCoord = aTexCoord;
+    ViewDepth = -(view * worldPosition).z;
+    Layer = aLayer;
+    Light = aLight;
+}
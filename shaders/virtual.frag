@@ -0,0 +1,42 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 VirtualCoord;
+in float ViewDepth;
+flat in float Light;        // Sector light, 0 to 1
+
+// Resident pages, and for every page at every level the atlas slot and level
+// of its finest resident ancestor (see VirtualTexture)
+uniform sampler2D atlasSampler;
+uniform sampler2D indirectionSampler;
+uniform int virtualPages;               // Pages across the finest level
+uniform int virtualLevels;
+uniform vec4 paletteTint;               // rgb = color, a = amount
+
+const float PAGE_SIZE = 128.0;          // VirtualTexture::PAGE_SIZE
+const float PAGE_BORDER = 1.0;          // VirtualTexture::PAGE_BORDER
+const float ATLAS_SIZE = 2080.0;        // VirtualTexture::ATLAS_SIZE
+
+// Shading as in level.frag
+const float LIGHT_LEVELS = 32.0;
+const float DISTANCE_FADE = 0.25;
+
+void main() {
+    // The level whose texels are about one pixel, as the feedback pass asks for
+    vec2 texel = VirtualCoord * float(virtualPages) * PAGE_SIZE;
+    float lod = log2(max(length(dFdx(texel)), length(dFdy(texel))));
+    int level = clamp(int(floor(lod)), 0, virtualLevels - 1);
+    
+    int levelPages = virtualPages >> level;
+    ivec2 page = clamp(ivec2(VirtualCoord * float(levelPages)), ivec2(0), ivec2(levelPages - 1));
+    ivec3 entry = ivec3(texelFetch(indirectionSampler, page, level).rgb * 255.0 + 0.5);
+    
+    // Position inside the resident page, which may be coarser than the one asked for
+    vec2 inPage = fract(VirtualCoord * float(virtualPages >> entry.z));
+    vec2 atlasTexel = vec2(entry.xy) * (PAGE_SIZE + 2.0 * PAGE_BORDER) + PAGE_BORDER + inPage * PAGE_SIZE;
+    vec4 color = textureLod(atlasSampler, atlasTexel / ATLAS_SIZE, 0.0);
+    
+    float row = clamp((1.0 - Light) * LIGHT_LEVELS + ViewDepth * DISTANCE_FADE, 0.0, LIGHT_LEVELS - 1.0);
+    color.rgb *= 1.0 - row / LIGHT_LEVELS;
+    FragColor = vec4(mix(color.rgb, paletteTint.rgb, paletteTint.a), color.a);
+}
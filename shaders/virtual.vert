@@ -0,0 +1,28 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in float aLight;
+
+out vec2 VirtualCoord;
+out float ViewDepth;
+flat out float Light;
+
+// Updated once per frame, shared by all programs (see UniformBlocks.h)
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 time;
+};
+
+// Where the surface lies in the virtual texture, from its world (x, z); see FlatBaker
+uniform vec2 virtualOrigin;
+uniform float virtualScale;
+uniform vec2 virtualOffset;
+
+void main() {
+    gl_Position = viewProjection * vec4(aPos, 1.0);
+    VirtualCoord = (aPos.xz - virtualOrigin) * virtualScale + virtualOffset;
+    ViewDepth = -(view * vec4(aPos, 1.0)).z;
+    Light = aLight;
+}
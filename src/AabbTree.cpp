@@ -0,0 +1,182 @@
+#include "AabbTree.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+    // Check the subtree at nodeIndex, whose items must start at first. Returns the end of its
+    // items, or -1 if a child is out of range or not after its parent, a leaf runs past the
+    // items, the subtree is more than depthLeft levels deep or more nodes are visited than exist.
+    int CheckSubtree(ArrayView<AabbTree::Node> nodes, int itemCount, int nodeIndex, int first, int depthLeft, size_t& visited) {
+        const AabbTree::Node& node = nodes[nodeIndex];
+        if (node.first != first || ++visited > nodes.size()) {
+            return -1;
+        }
+        if (node.count > 0) {
+            return node.count <= itemCount - first ? first + node.count : -1;
+        }
+        
+        int nodeCount = static_cast<int>(nodes.size());
+        if (node.count < 0 || depthLeft == 0 || nodeIndex + 1 >= nodeCount ||
+            node.secondChild <= nodeIndex + 1 || node.secondChild >= nodeCount) {
+            return -1;
+        }
+        int middle = CheckSubtree(nodes, itemCount, nodeIndex + 1, first, depthLeft - 1, visited);
+        return middle < 0 ? -1 : CheckSubtree(nodes, itemCount, node.secondChild, middle, depthLeft - 1, visited);
+    }
+}
+
+void AabbTree::Build(const std::vector<Aabb>& boxes) {
+    Clear();
+    if (boxes.empty()) {
+        return;
+    }
+    
+    // Items are sorted in place while splitting, so leaves end up contiguous
+    m_ItemStorage.resize(boxes.size());
+    std::vector<glm::vec3> centers(boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        m_ItemStorage[i] = static_cast<int>(i);
+        centers[i] = boxes[i].GetCenter();
+    }
+    
+    m_NodeStorage.reserve(boxes.size() * 2 / MAX_LEAF_ITEMS + 1);
+    BuildNode(boxes, centers, 0, static_cast<int>(boxes.size()));
+    
+    // Keep item boxes in leaf order for the per-item tests at partially visible leaves
+    m_ItemBoundStorage.resize(m_ItemStorage.size());
+    for (size_t i = 0; i < m_ItemStorage.size(); ++i) {
+        m_ItemBoundStorage[i] = boxes[m_ItemStorage[i]];
+    }
+    
+    m_Nodes = m_NodeStorage;
+    m_Items = m_ItemStorage;
+    m_ItemBounds = m_ItemBoundStorage;
+}
+
+void AabbTree::Clear() {
+    m_Nodes = ArrayView<Node>();
+    m_Items = ArrayView<int>();
+    m_ItemBounds = ArrayView<Aabb>();
+    m_NodeStorage.clear();
+    m_ItemStorage.clear();
+    m_ItemBoundStorage.clear();
+}
+
+bool AabbTree::Assign(ArrayView<Node> nodes, ArrayView<int> items, ArrayView<Aabb> itemBounds, size_t itemCount) {
+    Clear();
+    if (items.size() != itemBounds.size() || items.size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        return false;
+    }
+    for (int item : items) {
+        if (item < 0 || static_cast<size_t>(item) >= itemCount) {
+            return false;
+        }
+    }
+    if (!nodes.empty()) {
+        size_t visited = 0;
+        int end = CheckSubtree(nodes, static_cast<int>(items.size()), 0, 0, MAX_DEPTH, visited);
+        if (end != static_cast<int>(items.size()) || visited != nodes.size()) {
+            return false;
+        }
+    } else if (!items.empty()) {
+        return false;
+    }
+    
+    m_Nodes = nodes;
+    m_Items = items;
+    m_ItemBounds = itemBounds;
+    return true;
+}
+
+int AabbTree::BuildNode(const std::vector<Aabb>& boxes, const std::vector<glm::vec3>& centers, int first, int count) {
+    int nodeIndex = static_cast<int>(m_NodeStorage.size());
+    m_NodeStorage.push_back(Node());
+    
+    // Bounds of the boxes and of their centers
+    Aabb bounds;
+    Aabb centerBounds;
+    for (int i = first; i < first + count; ++i) {
+        bounds.Expand(boxes[m_ItemStorage[i]]);
+        centerBounds.Expand(centers[m_ItemStorage[i]]);
+    }
+    m_NodeStorage[nodeIndex].bounds = bounds;
+    
+    if (count <= MAX_LEAF_ITEMS) {
+        m_NodeStorage[nodeIndex].first = first;
+        m_NodeStorage[nodeIndex].count = count;
+        m_NodeStorage[nodeIndex].secondChild = -1;
+        return nodeIndex;
+    }
+    
+    // Split at the median along the widest axis of the centers
+    glm::vec3 extent = centerBounds.GetSize();
+    int axis = 0;
+    if (extent.y > extent[axis]) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+    
+    int half = count / 2;
+    std::nth_element(m_ItemStorage.begin() + first, m_ItemStorage.begin() + first + half, m_ItemStorage.begin() + first + count,
+                     [&centers, axis](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+    
+    // First child directly follows its parent
+    BuildNode(boxes, centers, first, half);
+    int secondChild = BuildNode(boxes, centers, first + half, count - half);
+    
+    m_NodeStorage[nodeIndex].first = first;
+    m_NodeStorage[nodeIndex].count = 0;
+    m_NodeStorage[nodeIndex].secondChild = secondChild;
+    return nodeIndex;
+}
+
+size_t AabbTree::Query(const Frustum& frustum, std::vector<int>& result) const {
+    if (m_Nodes.empty()) {
+        return 0;
+    }
+    
+    size_t startSize = result.size();
+    
+    int stack[MAX_DEPTH + 1];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    
+    while (stackSize > 0) {
+        int nodeIndex = stack[--stackSize];
+        const Node& node = m_Nodes[nodeIndex];
+        
+        Frustum::Result test = frustum.Test(node.bounds);
+        if (test == Frustum::OUTSIDE) {
+            continue;
+        }
+        
+        // Fully visible subtrees need no further plane tests
+        if (test == Frustum::INSIDE) {
+            AppendSubtree(nodeIndex, result);
+            continue;
+        }
+        
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                if (frustum.Test(m_ItemBounds[i]) != Frustum::OUTSIDE) {
+                    result.push_back(m_Items[i]);
+                }
+            }
+        } else {
+            stack[stackSize++] = nodeIndex + 1;
+            stack[stackSize++] = node.secondChild;
+        }
+    }
+    
+    return result.size() - startSize;
+}
+
+void AabbTree::AppendSubtree(int nodeIndex, std::vector<int>& result) const {
+    // Every subtree covers a contiguous run of items; find its end from the last leaf
+    int lastNode = nodeIndex;
+    while (m_Nodes[lastNode].count == 0) {
+        lastNode = m_Nodes[lastNode].secondChild;
+    }
+    
+    int first = m_Nodes[nodeIndex].first;
+    int end = m_Nodes[lastNode].first + m_Nodes[lastNode].count;
+    result.insert(result.end(), m_Items.begin() + first, m_Items.begin() + end);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include "ArrayView.h"
+#include "Bounds.h"
+#include "Frustum.h"
+
+// Bounding-volume hierarchy over a fixed set of boxes, built once and queried per frame.
+// Items are identified by the index of their box in the array passed to Build().
+class AabbTree {
+public:
+    // Leaves reference items [first, first + count); inner nodes have count == 0
+    // and their children at index + 1 and secondChild
+    struct Node {
+        Aabb bounds;
+        int first;
+        int count;
+        int secondChild;
+    };
+    
+    void Build(const std::vector<Aabb>& boxes);
+    void Clear();
+    
+    // Use a tree owned elsewhere, such as a mapped level file, without copying it.
+    // itemBounds are the items' boxes in leaf order, parallel to items. Returns false
+    // and stays empty unless the nodes form one tree over all the items, no deeper than
+    // MAX_DEPTH, and every item is below itemCount.
+    bool Assign(ArrayView<Node> nodes, ArrayView<int> items, ArrayView<Aabb> itemBounds, size_t itemCount);
+    
+    // Append the items whose boxes touch the frustum; returns how many were appended
+    size_t Query(const Frustum& frustum, std::vector<int>& result) const;
+    
+    size_t GetItemCount() const { return m_Items.size(); }
+    bool IsEmpty() const { return m_Nodes.empty(); }
+    
+    // The built tree, for storing in a compiled level
+    ArrayView<Node> GetNodes() const { return m_Nodes; }
+    ArrayView<int> GetItems() const { return m_Items; }
+    ArrayView<Aabb> GetItemBounds() const { return m_ItemBounds; }
+    
+    // Levels below the root; Query keeps its pending nodes in a fixed stack this deep
+    static constexpr int MAX_DEPTH = 63;
+
+private:
+    static constexpr int MAX_LEAF_ITEMS = 4;
+    
+    ArrayView<Node> m_Nodes;
+    ArrayView<int> m_Items;
+    ArrayView<Aabb> m_ItemBounds;
+    
+    // Tree built here; empty when the tree is assigned
+    std::vector<Node> m_NodeStorage;
+    std::vector<int> m_ItemStorage;
+    std::vector<Aabb> m_ItemBoundStorage;
+    
+    int BuildNode(const std::vector<Aabb>& boxes, const std::vector<glm::vec3>& centers, int first, int count);
+    void AppendSubtree(int nodeIndex, std::vector<int>& result) const;
+};
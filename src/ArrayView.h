@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Read-only view of a contiguous run of elements owned elsewhere
+template<typename T>
+class ArrayView {
+public:
+    ArrayView() : m_Data(nullptr), m_Size(0) {}
+    ArrayView(const T* data, size_t size) : m_Data(data), m_Size(size) {}
+    ArrayView(const std::vector<T>& vector) : m_Data(vector.data()), m_Size(vector.size()) {}
+    
+    const T* begin() const { return m_Data; }
+    const T* end() const { return m_Data + m_Size; }
+    const T* data() const { return m_Data; }
+    size_t size() const { return m_Size; }
+    bool empty() const { return m_Size == 0; }
+    
+    const T& operator[](size_t index) const { return m_Data[index]; }
+    const T& front() const { return m_Data[0]; }
+    const T& back() const { return m_Data[m_Size - 1]; }
+    
+    // Elements [offset, offset + count)
+    ArrayView Slice(size_t offset, size_t count) const { return ArrayView(m_Data + offset, count); }
+
+private:
+    const T* m_Data;
+    size_t m_Size;
+};
@@ -0,0 +1,113 @@
+#include "Blockmap.h"
+#include <algorithm>
+
+void Blockmap::Build(const std::vector<BlockmapLine>& lines, float cellSize) {
+    Clear();
+    if (lines.empty()) {
+        return;
+    }
+    
+    // Cover every end point, with cell boundaries on whole multiples of the cell size
+    glm::vec2 minimum = lines[0].start;
+    glm::vec2 maximum = lines[0].start;
+    for (const auto& line : lines) {
+        minimum = glm::min(minimum, glm::min(line.start, line.end));
+        maximum = glm::max(maximum, glm::max(line.start, line.end));
+    }
+    glm::vec2 firstCell = glm::floor(minimum / cellSize);
+    glm::vec2 lastCell = glm::floor(maximum / cellSize);
+    m_Grid.origin = firstCell * cellSize;
+    m_Grid.cellSize = cellSize;
+    m_Grid.width = static_cast<int>(lastCell.x - firstCell.x) + 1;
+    m_Grid.height = static_cast<int>(lastCell.y - firstCell.y) + 1;
+    size_t cellCount = static_cast<size_t>(m_Grid.width) * m_Grid.height;
+    
+    // Count each cell's lines, turn the counts into offsets, then fill the cells in line order
+    auto forEachCell = [&](const BlockmapLine& line, auto&& visit) {
+        WalkGridCells(ToCells(line.start), ToCells(line.end), [&](int x, int z) {
+            if (x >= 0 && x < m_Grid.width && z >= 0 && z < m_Grid.height) {
+                visit(static_cast<size_t>(z) * m_Grid.width + x);
+            }
+            return true;
+        });
+    };
+    m_CellOffsetStorage.assign(cellCount + 1, 0);
+    for (const auto& line : lines) {
+        forEachCell(line, [&](size_t cell) { m_CellOffsetStorage[cell + 1]++; });
+    }
+    for (size_t i = 0; i < cellCount; ++i) {
+        m_CellOffsetStorage[i + 1] += m_CellOffsetStorage[i];
+    }
+    
+    m_CellLineStorage.resize(m_CellOffsetStorage.back());
+    std::vector<uint32_t> next(m_CellOffsetStorage.begin(), m_CellOffsetStorage.end() - 1);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        forEachCell(lines[i], [&](size_t cell) { m_CellLineStorage[next[cell]++] = static_cast<int>(i); });
+    }
+    
+    m_CellOffsets = m_CellOffsetStorage;
+    m_CellLines = m_CellLineStorage;
+}
+
+void Blockmap::Clear() {
+    m_Grid = BlockmapGrid();
+    m_CellOffsets = ArrayView<uint32_t>();
+    m_CellLines = ArrayView<int>();
+    m_CellOffsetStorage.clear();
+    m_CellLineStorage.clear();
+}
+
+bool Blockmap::Assign(const BlockmapGrid& grid, ArrayView<uint32_t> cellOffsets, ArrayView<int> cellLines,
+                      size_t lineCount) {
+    Clear();
+    if (cellOffsets.empty() && cellLines.empty()) {
+        return true;
+    }
+    if (grid.width <= 0 || grid.height <= 0 || !(grid.cellSize > 0.0f) ||
+        cellOffsets.size() != static_cast<size_t>(grid.width) * grid.height + 1 ||
+        cellOffsets.front() != 0 || cellOffsets.back() != cellLines.size() ||
+        !std::is_sorted(cellOffsets.begin(), cellOffsets.end())) {
+        return false;
+    }
+    for (int line : cellLines) {
+        if (line < 0 || static_cast<size_t>(line) >= lineCount) {
+            return false;
+        }
+    }
+    
+    m_Grid = grid;
+    m_CellOffsets = cellOffsets;
+    m_CellLines = cellLines;
+    return true;
+}
+
+size_t Blockmap::QueryBox(const glm::vec2& minimum, const glm::vec2& maximum, std::vector<int>& result) const {
+    // Lines span several cells, so drop the repeats afterwards
+    size_t first = result.size();
+    ForEachCellInBox(minimum, maximum, [&](int x, int z) {
+        ArrayView<int> lines = GetCellLines(x, z);
+        result.insert(result.end(), lines.begin(), lines.end());
+        return true;
+    });
+    std::sort(result.begin() + first, result.end());
+    result.erase(std::unique(result.begin() + first, result.end()), result.end());
+    return result.size() - first;
+}
+
+size_t Blockmap::QueryRadius(const glm::vec2& center, float radius, std::vector<int>& result) const {
+    return QueryBox(center - glm::vec2(radius), center + glm::vec2(radius), result);
+}
+
+size_t Blockmap::QueryRay(const glm::vec2& start, const glm::vec2& end, std::vector<int>& result) const {
+    // A ray crosses few cells, so a linear search for repeats is cheap
+    size_t first = result.size();
+    ForEachCellOnRay(start, end, [&](int x, int z) {
+        for (int line : GetCellLines(x, z)) {
+            if (std::find(result.begin() + first, result.end(), line) == result.end()) {
+                result.push_back(line);
+            }
+        }
+        return true;
+    });
+    return result.size() - first;
+}
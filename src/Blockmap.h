@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+
+#include "ArrayView.h"
+#include "GridWalk.h"
+
+// Line given to Blockmap::Build; lines are identified by their index
+struct BlockmapLine {
+    glm::vec2 start;
+    glm::vec2 end;
+};
+
+// Placement of the cells: cell (x, z) covers origin + [x, x + 1) * cellSize
+// by origin + [z, z + 1) * cellSize
+struct BlockmapGrid {
+    glm::vec2 origin;
+    float cellSize;
+    int width;
+    int height;
+};
+
+// Uniform grid over the map where each cell lists the lines passing through
+// it, as in Doom. Cells are stored row by row; cell i's lines are
+// cellLines[cellOffsets[i], cellOffsets[i + 1]).
+//
+// Queries only narrow the search to nearby lines: a line is listed in every
+// cell it touches, so callers test the lines they get exactly themselves.
+class Blockmap {
+public:
+    void Build(const std::vector<BlockmapLine>& lines, float cellSize);
+    void Clear();
+    
+    // Use a blockmap owned elsewhere, such as a mapped level file. Returns false,
+    // leaving the blockmap empty, if the arrays do not fit together or refer to
+    // lines at or past lineCount.
+    bool Assign(const BlockmapGrid& grid, ArrayView<uint32_t> cellOffsets, ArrayView<int> cellLines, size_t lineCount);
+    
+    bool IsEmpty() const { return m_CellOffsets.empty(); }
+    const BlockmapGrid& GetGrid() const { return m_Grid; }
+    
+    ArrayView<int> GetCellLines(int x, int z) const {
+        size_t cell = static_cast<size_t>(z) * m_Grid.width + x;
+        return m_CellLines.Slice(m_CellOffsets[cell], m_CellOffsets[cell + 1] - m_CellOffsets[cell]);
+    }
+    
+    // Append the lines in cells overlapping the box, each once, in ascending order.
+    // Returns how many were appended.
+    size_t QueryBox(const glm::vec2& minimum, const glm::vec2& maximum, std::vector<int>& result) const;
+    
+    // Lines in cells within radius of center's box, as QueryBox
+    size_t QueryRadius(const glm::vec2& center, float radius, std::vector<int>& result) const;
+    
+    // Lines in the cells a segment passes through, each once, in the order the
+    // segment reaches their first cell
+    size_t QueryRay(const glm::vec2& start, const glm::vec2& end, std::vector<int>& result) const;
+    
+    // Visit the cells overlapping a box as visit(int x, int z), which returns false to stop.
+    // Returns false if stopped early.
+    template<typename Visit>
+    bool ForEachCellInBox(const glm::vec2& minimum, const glm::vec2& maximum, Visit&& visit) const;
+    
+    // Visit the grid cells a segment passes through, nearest first, as ForEachCellInBox
+    template<typename Visit>
+    bool ForEachCellOnRay(const glm::vec2& start, const glm::vec2& end, Visit&& visit) const;
+    
+    // The built blockmap, for storing in a compiled level
+    ArrayView<uint32_t> GetCellOffsets() const { return m_CellOffsets; }
+    ArrayView<int> GetCellLines() const { return m_CellLines; }
+
+private:
+    BlockmapGrid m_Grid = {};
+    ArrayView<uint32_t> m_CellOffsets;
+    ArrayView<int> m_CellLines;
+    
+    // Blockmap built here; empty when it is assigned
+    std::vector<uint32_t> m_CellOffsetStorage;
+    std::vector<int> m_CellLineStorage;
+    
+    glm::vec2 ToCells(const glm::vec2& point) const { return (point - m_Grid.origin) / m_Grid.cellSize; }
+};
+
+template<typename Visit>
+bool Blockmap::ForEachCellInBox(const glm::vec2& minimum, const glm::vec2& maximum, Visit&& visit) const {
+    if (IsEmpty()) {
+        return true;
+    }
+    glm::vec2 first = glm::floor(ToCells(minimum));
+    glm::vec2 last = glm::floor(ToCells(maximum));
+    int firstX = static_cast<int>(glm::max(first.x, 0.0f));
+    int firstZ = static_cast<int>(glm::max(first.y, 0.0f));
+    int lastX = static_cast<int>(glm::min(last.x, static_cast<float>(m_Grid.width - 1)));
+    int lastZ = static_cast<int>(glm::min(last.y, static_cast<float>(m_Grid.height - 1)));
+    for (int z = firstZ; z <= lastZ; ++z) {
+        for (int x = firstX; x <= lastX; ++x) {
+            if (!visit(x, z)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template<typename Visit>
+bool Blockmap::ForEachCellOnRay(const glm::vec2& start, const glm::vec2& end, Visit&& visit) const {
+    if (IsEmpty()) {
+        return true;
+    }
+    bool finished = true;
+    WalkGridCells(ToCells(start), ToCells(end), [&](int x, int z) {
+        if (x < 0 || x >= m_Grid.width || z < 0 || z >= m_Grid.height) {
+            return true;
+        }
+        finished = visit(x, z);
+        return finished;
+    });
+    return finished;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+#include <limits>
+
+// Axis-aligned bounding box in world space
+struct Aabb {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+    
+    bool IsEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+    glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+    glm::vec3 GetSize() const { return max - min; }
+    
+    // Distance from a point to the nearest point of the box; 0 inside it
+    float DistanceTo(const glm::vec3& point) const {
+        return glm::length(glm::max(glm::max(min - point, point - max), glm::vec3(0.0f)));
+    }
+    
+    void Expand(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    
+    void Expand(const Aabb& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+};
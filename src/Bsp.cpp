@@ -0,0 +1,267 @@
+#include "Bsp.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+    // Points closer than this to a partition line count as on it
+    const float ON_LINE_EPSILON = 1e-3f;
+    
+    // A split costs this many units of front/back imbalance when scoring partitions
+    const int SPLIT_COST = 8;
+    
+    // Larger seg sets only try an evenly spaced sample of candidate partitions
+    const size_t MAX_PARTITION_CANDIDATES = 128;
+    
+    enum SegSide {
+        FRONT,
+        BACK,
+        SPANNING
+    };
+    
+    SegSide ClassifySeg(const BspNode& partition, const BspSeg& seg, float& startSide, float& endSide) {
+        startSide = BspTree::PointSide(partition, seg.start);
+        endSide = BspTree::PointSide(partition, seg.end);
+        
+        bool startOn = std::fabs(startSide) < ON_LINE_EPSILON;
+        bool endOn = std::fabs(endSide) < ON_LINE_EPSILON;
+        
+        // Collinear segs go to the side they face
+        if (startOn && endOn) {
+            return glm::dot(seg.end - seg.start, partition.direction) > 0.0f ? FRONT : BACK;
+        }
+        if (startSide > -ON_LINE_EPSILON && endSide > -ON_LINE_EPSILON) {
+            return FRONT;
+        }
+        if (startSide < ON_LINE_EPSILON && endSide < ON_LINE_EPSILON) {
+            return BACK;
+        }
+        return SPANNING;
+    }
+    
+    BspNode MakePartition(const BspSeg& seg) {
+        BspNode node;
+        node.origin = seg.start;
+        node.direction = glm::normalize(seg.end - seg.start);
+        return node;
+    }
+    
+    bool IsDegenerate(const BspSeg& seg) {
+        return glm::length(seg.end - seg.start) < ON_LINE_EPSILON;
+    }
+}
+
+void BspTree::Build(const std::vector<BspSeg>& segs) {
+    Clear();
+    
+    std::vector<BspSeg> work;
+    work.reserve(segs.size());
+    for (const auto& seg : segs) {
+        if (!IsDegenerate(seg)) {
+            work.push_back(seg);
+        }
+    }
+    if (work.empty()) {
+        return;
+    }
+    
+    m_SegStorage.reserve(work.size() * 2);
+    BspBounds bounds;
+    m_Root = BuildNode(work, bounds);
+    m_Nodes = m_NodeStorage;
+    m_Segs = m_SegStorage;
+    m_Subsectors = m_SubsectorStorage;
+}
+
+void BspTree::Clear() {
+    m_Nodes = ArrayView<BspNode>();
+    m_Segs = ArrayView<BspSeg>();
+    m_Subsectors = ArrayView<BspSubsector>();
+    m_NodeStorage.clear();
+    m_SegStorage.clear();
+    m_SubsectorStorage.clear();
+    m_Root = 0;
+}
+
+bool BspTree::Assign(ArrayView<BspNode> nodes, ArrayView<BspSeg> segs, ArrayView<BspSubsector> subsectors, uint32_t root,
+                     size_t wallCount, size_t sectorCount) {
+    Clear();
+    if (subsectors.empty()) {
+        return nodes.empty() && segs.empty();
+    }
+    
+    for (const BspSeg& seg : segs) {
+        if (seg.wall < 0 || static_cast<size_t>(seg.wall) >= wallCount ||
+            seg.sector < 0 || static_cast<size_t>(seg.sector) >= sectorCount) {
+            return false;
+        }
+    }
+    for (const BspSubsector& subsector : subsectors) {
+        if (subsector.firstSeg < 0 || subsector.segCount < 0 ||
+            static_cast<size_t>(subsector.firstSeg) + subsector.segCount > segs.size() ||
+            subsector.sector < 0 || static_cast<size_t>(subsector.sector) >= sectorCount) {
+            return false;
+        }
+    }
+    
+    // A child is a subsector or a node stored after its parent; the root may be any of them
+    auto isChild = [&](uint32_t child, size_t parent) {
+        return (child & SUBSECTOR_FLAG) ? (child & ~SUBSECTOR_FLAG) < subsectors.size()
+                                        : child > parent && child < nodes.size();
+    };
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!isChild(nodes[i].children[0], i) || !isChild(nodes[i].children[1], i)) {
+            return false;
+        }
+    }
+    if (!((root & SUBSECTOR_FLAG) ? (root & ~SUBSECTOR_FLAG) < subsectors.size() : root < nodes.size())) {
+        return false;
+    }
+    
+    m_Nodes = nodes;
+    m_Segs = segs;
+    m_Subsectors = subsectors;
+    m_Root = root;
+    return true;
+}
+
+uint32_t BspTree::BuildNode(std::vector<BspSeg>& segs, BspBounds& bounds) {
+    bounds.min = glm::vec2(segs[0].start);
+    bounds.max = bounds.min;
+    for (const auto& seg : segs) {
+        bounds.min = glm::min(bounds.min, glm::min(seg.start, seg.end));
+        bounds.max = glm::max(bounds.max, glm::max(seg.start, seg.end));
+    }
+    
+    int partitionSeg = IsConvex(segs) ? -1 : ChoosePartition(segs);
+    
+    // Convex sets (or sets nothing can split further) become subsectors
+    if (partitionSeg < 0) {
+        BspSubsector subsector;
+        subsector.firstSeg = static_cast<int>(m_SegStorage.size());
+        subsector.segCount = static_cast<int>(segs.size());
+        subsector.sector = segs[0].sector;
+        m_SegStorage.insert(m_SegStorage.end(), segs.begin(), segs.end());
+        m_SubsectorStorage.push_back(subsector);
+        return static_cast<uint32_t>(m_SubsectorStorage.size() - 1) | SUBSECTOR_FLAG;
+    }
+    
+    BspNode node = MakePartition(segs[partitionSeg]);
+    
+    // Sort segs to each side, cutting the ones that cross the partition
+    std::vector<BspSeg> front;
+    std::vector<BspSeg> back;
+    for (const auto& seg : segs) {
+        float startSide, endSide;
+        switch (ClassifySeg(node, seg, startSide, endSide)) {
+            case FRONT:
+                front.push_back(seg);
+                break;
+            case BACK:
+                back.push_back(seg);
+                break;
+            case SPANNING: {
+                float t = startSide / (startSide - endSide);
+                glm::vec2 cut = seg.start + (seg.end - seg.start) * t;
+                
+                BspSeg first = seg;
+                first.end = cut;
+                BspSeg second = seg;
+                second.start = cut;
+                
+                (startSide > 0.0f ? front : back).push_back(first);
+                (startSide > 0.0f ? back : front).push_back(second);
+                break;
+            }
+        }
+    }
+    
+    // Free the parent's list before recursing to keep peak memory down
+    segs.clear();
+    segs.shrink_to_fit();
+    
+    uint32_t nodeIndex = static_cast<uint32_t>(m_NodeStorage.size());
+    m_NodeStorage.push_back(node);
+    
+    BspBounds frontBounds, backBounds;
+    uint32_t frontChild = BuildNode(front, frontBounds);
+    uint32_t backChild = BuildNode(back, backBounds);
+    
+    m_NodeStorage[nodeIndex].bounds[0] = frontBounds;
+    m_NodeStorage[nodeIndex].bounds[1] = backBounds;
+    m_NodeStorage[nodeIndex].children[0] = frontChild;
+    m_NodeStorage[nodeIndex].children[1] = backChild;
+    return nodeIndex;
+}
+
+bool BspTree::IsConvex(const std::vector<BspSeg>& segs) const {
+    // Convex when every seg sees all the others on its front side
+    for (const auto& seg : segs) {
+        BspNode line = MakePartition(seg);
+        for (const auto& other : segs) {
+            float startSide, endSide;
+            if (ClassifySeg(line, other, startSide, endSide) != FRONT) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int BspTree::ChoosePartition(const std::vector<BspSeg>& segs) const {
+    size_t step = std::max<size_t>(1, segs.size() / MAX_PARTITION_CANDIDATES);
+    
+    int bestSeg = -1;
+    int bestScore = 0;
+    
+    // Sample first; fall back to every seg if no sampled candidate makes progress
+    for (size_t pass = 0; pass < 2 && bestSeg < 0; ++pass) {
+        size_t passStep = pass == 0 ? step : 1;
+        
+        for (size_t candidate = 0; candidate < segs.size(); candidate += passStep) {
+            BspNode partition = MakePartition(segs[candidate]);
+            
+            int frontCount = 0;
+            int backCount = 0;
+            int splits = 0;
+            for (const auto& seg : segs) {
+                float startSide, endSide;
+                switch (ClassifySeg(partition, seg, startSide, endSide)) {
+                    case FRONT: frontCount++; break;
+                    case BACK: backCount++; break;
+                    case SPANNING: splits++; break;
+                }
+            }
+            
+            // A partition with nothing behind it doesn't divide the set
+            if (backCount == 0 && splits == 0) {
+                continue;
+            }
+            
+            int score = splits * SPLIT_COST + std::abs(frontCount - backCount);
+            if (bestSeg < 0 || score < bestScore) {
+                bestSeg = static_cast<int>(candidate);
+                bestScore = score;
+            }
+        }
+        
+        if (passStep == 1) {
+            break;
+        }
+    }
+    
+    return bestSeg;
+}
+
+int BspTree::FindSubsector(const glm::vec2& point) const {
+    if (m_Subsectors.empty()) {
+        return -1;
+    }
+    
+    uint32_t child = m_Root;
+    while (!(child & SUBSECTOR_FLAG)) {
+        const BspNode& node = m_Nodes[child];
+        child = node.children[PointSide(node, point) >= 0.0f ? 0 : 1];
+    }
+    return static_cast<int>(child & ~SUBSECTOR_FLAG);
+}
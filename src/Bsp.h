@@ -0,0 +1,124 @@
+#pragma once
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "ArrayView.h"
+
+// A piece of a wall after BSP splitting. The wall's sector is on the left
+// (front) side when walking from start to end.
+struct BspSeg {
+    glm::vec2 start;
+    glm::vec2 end;
+    int wall;           // Index of the wall this seg was cut from
+    int sector;         // Sector on the front side
+};
+
+// Convex leaf of the tree: a run of segs that all face into the same region
+struct BspSubsector {
+    int firstSeg;
+    int segCount;
+    int sector;
+};
+
+// 2D bounding box in the (x, z) plane
+struct BspBounds {
+    glm::vec2 min;
+    glm::vec2 max;
+};
+
+// Partition line with a child on each side. Front is the left side of the
+// line's direction, matching the seg convention.
+struct BspNode {
+    glm::vec2 origin;
+    glm::vec2 direction;
+    BspBounds bounds[2];    // [front, back]
+    uint32_t children[2];   // Node index, or subsector index | SUBSECTOR_FLAG
+};
+
+class BspTree {
+public:
+    static constexpr uint32_t SUBSECTOR_FLAG = 0x80000000u;
+    
+    // Build the tree from unsplit wall segments
+    void Build(const std::vector<BspSeg>& segs);
+    void Clear();
+    
+    // Use a tree owned elsewhere, such as a mapped level file, without copying it. Returns
+    // false and stays empty unless every index is in range and each node's child nodes come
+    // after it, as Build() lays them out, so no walk down the tree can loop.
+    bool Assign(ArrayView<BspNode> nodes, ArrayView<BspSeg> segs, ArrayView<BspSubsector> subsectors, uint32_t root,
+                size_t wallCount, size_t sectorCount);
+    
+    bool IsEmpty() const { return m_Subsectors.empty(); }
+    
+    // Leaf containing a point (always succeeds on a non-empty tree)
+    int FindSubsector(const glm::vec2& point) const;
+    
+    // Visit subsectors nearest-first as seen from viewpoint. boxVisible(const BspBounds&)
+    // can reject whole subtrees; visit(int subsector) returns false to stop early.
+    // stack is scratch space the caller keeps between calls so traversal does not allocate.
+    template<typename BoxTest, typename Visit>
+    void TraverseFrontToBack(const glm::vec2& viewpoint, std::vector<uint32_t>& stack, BoxTest&& boxVisible, Visit&& visit) const;
+    
+    ArrayView<BspNode> GetNodes() const { return m_Nodes; }
+    ArrayView<BspSeg> GetSegs() const { return m_Segs; }
+    ArrayView<BspSubsector> GetSubsectors() const { return m_Subsectors; }
+    uint32_t GetRoot() const { return m_Root; }
+    
+    // Signed distance of a point from a node's partition; positive is the front side
+    static float PointSide(const BspNode& node, const glm::vec2& point) {
+        glm::vec2 offset = point - node.origin;
+        return node.direction.x * offset.y - node.direction.y * offset.x;
+    }
+
+private:
+    ArrayView<BspNode> m_Nodes;
+    ArrayView<BspSeg> m_Segs;
+    ArrayView<BspSubsector> m_Subsectors;
+    uint32_t m_Root = 0;
+    
+    // Tree built here; empty when the tree is assigned
+    std::vector<BspNode> m_NodeStorage;
+    std::vector<BspSeg> m_SegStorage;
+    std::vector<BspSubsector> m_SubsectorStorage;
+    
+    uint32_t BuildNode(std::vector<BspSeg>& segs, BspBounds& bounds);
+    bool IsConvex(const std::vector<BspSeg>& segs) const;
+    int ChoosePartition(const std::vector<BspSeg>& segs) const;
+};
+
+template<typename BoxTest, typename Visit>
+void BspTree::TraverseFrontToBack(const glm::vec2& viewpoint, std::vector<uint32_t>& stack, BoxTest&& boxVisible, Visit&& visit) const {
+    if (m_Subsectors.empty()) {
+        return;
+    }
+    
+    // Explicit stack of children still to visit; the near child is always pushed last
+    stack.clear();
+    stack.push_back(m_Root);
+    
+    while (!stack.empty()) {
+        uint32_t child = stack.back();
+        stack.pop_back();
+        
+        if (child & SUBSECTOR_FLAG) {
+            if (!visit(static_cast<int>(child & ~SUBSECTOR_FLAG))) {
+                return;
+            }
+            continue;
+        }
+        
+        const BspNode& node = m_Nodes[child];
+        int nearSide = PointSide(node, viewpoint) >= 0.0f ? 0 : 1;
+        int farSide = nearSide ^ 1;
+        
+        if (boxVisible(node.bounds[farSide])) {
+            stack.push_back(node.children[farSide]);
+        }
+        if (boxVisible(node.bounds[nearSide])) {
+            stack.push_back(node.children[nearSide]);
+        }
+    }
+}
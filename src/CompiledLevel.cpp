@@ -0,0 +1,160 @@
+#include "CompiledLevel.h"
+#include "Hash.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    const uint32_t LEVEL_MAGIC = 0x4c564c44;   // "DLVL"
+    const size_t SECTION_ALIGNMENT = 16;
+    
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t sectionCount;
+        uint32_t reserved;
+        uint64_t sourceHash;
+        uint64_t dataHash;      // Everything after the header
+    };
+    
+    // Records are stored as they are in memory, which matches the file only on little-endian machines
+    bool IsLittleEndian() {
+        const uint16_t probe = 1;
+        unsigned char firstByte;
+        std::memcpy(&firstByte, &probe, 1);
+        return firstByte == 1;
+    }
+    
+    size_t AlignUp(size_t value) {
+        return (value + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+    }
+}
+
+void CompiledLevelWriter::AddSection(LevelSection id, const void* data, size_t elementSize, size_t count) {
+    m_Sections.push_back({ id, data, elementSize, count });
+}
+
+bool CompiledLevelWriter::Write(const std::string& path, uint64_t sourceHash) const {
+    if (!IsLittleEndian()) {
+        std::cerr << "Compiled levels are little-endian; not writing " << path << std::endl;
+        return false;
+    }
+    
+    // Lay the whole file out in memory so the hash can go in the header
+    size_t tableSize = m_Sections.size() * sizeof(CompiledLevel::SectionEntry);
+    size_t size = AlignUp(sizeof(FileHeader) + tableSize);
+    std::vector<CompiledLevel::SectionEntry> table;
+    table.reserve(m_Sections.size());
+    for (const auto& section : m_Sections) {
+        table.push_back({ static_cast<uint32_t>(section.id), static_cast<uint32_t>(section.elementSize),
+                          size, section.count });
+        size = AlignUp(size + section.elementSize * section.count);
+    }
+    
+    std::vector<unsigned char> buffer(size, 0);
+    if (!table.empty()) {
+        std::memcpy(&buffer[sizeof(FileHeader)], table.data(), tableSize);
+    }
+    for (size_t i = 0; i < m_Sections.size(); ++i) {
+        size_t bytes = m_Sections[i].elementSize * m_Sections[i].count;
+        if (bytes > 0) {
+            std::memcpy(&buffer[table[i].offset], m_Sections[i].data, bytes);
+        }
+    }
+    
+    FileHeader header;
+    header.magic = LEVEL_MAGIC;
+    header.version = CompiledLevel::VERSION;
+    header.sectionCount = static_cast<uint32_t>(m_Sections.size());
+    header.reserved = 0;
+    header.sourceHash = sourceHash;
+    header.dataHash = HashBytes(HASH_SEED, buffer.data() + sizeof(FileHeader), buffer.size() - sizeof(FileHeader));
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() || !file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size())) {
+            std::cerr << "Could not write compiled level " << path << std::endl;
+            return false;
+        }
+    }
+    
+    // Renaming leaves any existing mapping of the old file intact
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        std::cerr << "Could not write compiled level " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CompiledLevel::Open(const std::string& path) {
+    Close();
+    if (!m_File.Open(path)) {
+        return false;
+    }
+    
+    FileHeader header;
+    if (m_File.GetSize() < sizeof(header)) {
+        Close();
+        return false;
+    }
+    std::memcpy(&header, m_File.GetData(), sizeof(header));
+    if (header.magic != LEVEL_MAGIC) {
+        Close();
+        return false;
+    }
+    if (header.version != VERSION || !IsLittleEndian()) {
+        std::cerr << "Compiled level " << path << " has an unsupported format" << std::endl;
+        Close();
+        return false;
+    }
+    
+    // The table and every section must lie inside the file and keep their alignment
+    size_t size = m_File.GetSize();
+    size_t tableEnd = sizeof(header) + static_cast<size_t>(header.sectionCount) * sizeof(SectionEntry);
+    bool valid = header.sectionCount <= (size - sizeof(header)) / sizeof(SectionEntry);
+    if (valid) {
+        m_Sections = ArrayView<SectionEntry>(reinterpret_cast<const SectionEntry*>(m_File.GetData() + sizeof(header)),
+                                             header.sectionCount);
+        for (const auto& section : m_Sections) {
+            if (section.offset < tableEnd || section.offset > size || section.offset % SECTION_ALIGNMENT != 0 ||
+                section.elementSize == 0 || section.count > (size - section.offset) / section.elementSize) {
+                valid = false;
+                break;
+            }
+        }
+    }
+    if (!valid || HashBytes(HASH_SEED, m_File.GetData() + sizeof(header), size - sizeof(header)) != header.dataHash) {
+        std::cerr << "Compiled level " << path << " is corrupt" << std::endl;
+        Close();
+        return false;
+    }
+    
+    m_SourceHash = header.sourceHash;
+    return true;
+}
+
+void CompiledLevel::Close() {
+    m_File.Close();
+    m_SourceHash = 0;
+    m_Sections = ArrayView<SectionEntry>();
+}
+
+const void* CompiledLevel::FindSection(LevelSection id, size_t elementSize, size_t& count) const {
+    for (const auto& section : m_Sections) {
+        if (section.id == static_cast<uint32_t>(id)) {
+            if (section.elementSize != elementSize) {
+                return nullptr;
+            }
+            count = static_cast<size_t>(section.count);
+            return m_File.GetData() + section.offset;
+        }
+    }
+    return nullptr;
+}
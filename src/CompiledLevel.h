@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ArrayView.h"
+#include "MappedFile.h"
+
+// Binary form of a processed level, loaded by mapping the file and viewing its
+// arrays in place. The file is a header, a table of sections and the section
+// data. Each section is a 16-byte aligned array of fixed-size records, stored
+// little-endian exactly as they are laid out in memory.
+//
+// The header carries a hash of the text level the file was built from, so a
+// stale file can be recognised, and a hash of everything after the header so
+// a damaged one is rejected.
+enum class LevelSection : uint32_t {
+    Textures,               // char: texture paths, each ending in '\0'
+    Sectors,                // CompiledSector
+    Vertices,               // glm::vec2
+    Linedefs,               // Linedef
+    Sidedefs,               // Sidedef, one per wall
+    SectorPortals,          // int: wall indices local to their sector
+    SectorTriangles,        // int: vertex index triples
+    SectorFirstWalls,       // int
+    WallBounds,             // Aabb
+    SectorBounds,           // Aabb
+    WallTreeNodes,          // AabbTree::Node
+    WallTreeItems,          // int
+    WallTreeItemBounds,     // Aabb
+    SectorTreeNodes,        // AabbTree::Node
+    SectorTreeItems,        // int
+    SectorTreeItemBounds,   // Aabb
+    BspNodes,               // BspNode
+    BspSegs,                // BspSeg
+    BspSubsectors,          // BspSubsector
+    BspRoot,                // uint32_t, one element
+    PvsRowOffsets,          // uint32_t
+    PvsData,                // uint8_t
+    Start,                  // LevelStart, one element or none
+    BlockmapGrid,           // BlockmapGrid, one element or none
+    BlockmapCellOffsets,    // uint32_t
+    BlockmapCellLines,      // int: linedef indices
+    RejectBits              // uint64_t: one row per sector, or none without a PVS
+};
+
+// Sector record; walls, portals and triangles are runs of the Sidedefs,
+// SectorPortals and SectorTriangles sections
+struct CompiledSector {
+    float floorHeight;
+    float ceilingHeight;
+    int floorTextureId;
+    int ceilingTextureId;
+    int firstWall;
+    int wallCount;
+    int firstPortal;
+    int portalCount;
+    int firstTriangle;      // In triangles, three indices each
+    int triangleCount;
+    int lightLevel;
+};
+
+// Collects sections and writes them out in one go. The data added must stay
+// alive until Write returns.
+class CompiledLevelWriter {
+public:
+    template<typename T>
+    void AddSection(LevelSection id, ArrayView<T> items) {
+        AddSection(id, items.data(), sizeof(T), items.size());
+    }
+    void AddSection(LevelSection id, const void* data, size_t elementSize, size_t count);
+    
+    // Written to a temporary file first, so a mapped older copy is never truncated
+    bool Write(const std::string& path, uint64_t sourceHash) const;
+
+private:
+    struct Section {
+        LevelSection id;
+        const void* data;
+        size_t elementSize;
+        size_t count;
+    };
+    std::vector<Section> m_Sections;
+};
+
+class CompiledLevel {
+public:
+    static constexpr uint32_t VERSION = 7;
+    
+    // Map the file and check its header, section table and hash. Returns false
+    // quietly for files that are not compiled levels, and with a message for
+    // damaged or outdated ones.
+    bool Open(const std::string& path);
+    void Close();
+    
+    bool IsOpen() const { return m_File.IsOpen(); }
+    uint64_t GetSourceHash() const { return m_SourceHash; }
+    size_t GetSize() const { return m_File.GetSize(); }
+    
+    // View a section in place. Returns false if it is missing or its records
+    // are not the size of T, which means the file was written by another build.
+    template<typename T>
+    bool GetSection(LevelSection id, ArrayView<T>& items) const {
+        size_t count = 0;
+        const void* data = FindSection(id, sizeof(T), count);
+        if (!data) {
+            return false;
+        }
+        items = ArrayView<T>(static_cast<const T*>(data), count);
+        return true;
+    }
+
+private:
+    struct SectionEntry {
+        uint32_t id;
+        uint32_t elementSize;
+        uint64_t offset;
+        uint64_t count;
+    };
+    
+    MappedFile m_File;
+    uint64_t m_SourceHash = 0;
+    ArrayView<SectionEntry> m_Sections;
+    
+    const void* FindSection(LevelSection id, size_t elementSize, size_t& count) const;
+    
+    friend class CompiledLevelWriter;
+};
@@ -0,0 +1,167 @@
+#include "CookedTexture.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    // Like KTX2's, the identifier catches text-mode transfers and truncation to 7 bits
+    const unsigned char TEXTURE_IDENTIFIER[12] = { 0xAB, 'D', 'T', 'X', ' ', '1', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    const size_t LEVEL_ALIGNMENT = 16;
+    
+    struct FileHeader {
+        unsigned char identifier[12];
+        uint32_t version;
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint64_t sourceHash;
+    };
+    
+    size_t AlignUp(size_t value) {
+        return (value + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1);
+    }
+    
+    // Data is stored as it is in memory, which matches the file only on little-endian machines
+    bool IsLittleEndian() {
+        const uint16_t probe = 1;
+        unsigned char firstByte;
+        std::memcpy(&firstByte, &probe, 1);
+        return firstByte == 1;
+    }
+}
+
+size_t GetCookedLevelSize(CookedFormat format, int width, int height) {
+    size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+    switch (format) {
+        case CookedFormat::Bc1:
+            return blocks * 8;
+        case CookedFormat::Bc3:
+            return blocks * 16;
+        case CookedFormat::Index8:
+            return static_cast<size_t>(width) * height;
+        default:
+            return static_cast<size_t>(width) * height * 4;
+    }
+}
+
+bool CookedTexture::Open(const std::string& path) {
+    Close();
+    if (!m_File.Open(path)) {
+        return false;
+    }
+    
+    FileHeader header;
+    if (m_File.GetSize() < sizeof(header)) {
+        Close();
+        return false;
+    }
+    std::memcpy(&header, m_File.GetData(), sizeof(header));
+    if (std::memcmp(header.identifier, TEXTURE_IDENTIFIER, sizeof(TEXTURE_IDENTIFIER)) != 0) {
+        Close();
+        return false;
+    }
+    if (header.version != VERSION || header.format > static_cast<uint32_t>(CookedFormat::Bc3) || !IsLittleEndian()) {
+        std::cerr << "Cooked texture " << path << " has an unsupported format" << std::endl;
+        Close();
+        return false;
+    }
+    
+    // Every level must lie inside the file, aligned, and be the size its dimensions call for
+    CookedFormat format = static_cast<CookedFormat>(header.format);
+    size_t size = m_File.GetSize();
+    size_t indexEnd = sizeof(header) + static_cast<size_t>(header.levelCount) * sizeof(LevelEntry);
+    bool valid = header.width > 0 && header.height > 0 && header.width <= 65536 && header.height <= 65536 &&
+                 header.levelCount > 0 && header.levelCount <= 17 && indexEnd <= size;
+    if (valid) {
+        m_Levels = ArrayView<LevelEntry>(reinterpret_cast<const LevelEntry*>(m_File.GetData() + sizeof(header)),
+                                         header.levelCount);
+        for (size_t i = 0; i < m_Levels.size(); ++i) {
+            const LevelEntry& level = m_Levels[i];
+            int width = std::max(static_cast<int>(header.width >> i), 1);
+            int height = std::max(static_cast<int>(header.height >> i), 1);
+            if (level.offset < indexEnd || level.offset % LEVEL_ALIGNMENT != 0 || level.offset > size ||
+                level.size != GetCookedLevelSize(format, width, height) || level.size > size - level.offset) {
+                valid = false;
+                break;
+            }
+        }
+    }
+    if (!valid) {
+        std::cerr << "Cooked texture " << path << " is corrupt" << std::endl;
+        Close();
+        return false;
+    }
+    
+    m_Format = format;
+    m_Width = static_cast<int>(header.width);
+    m_Height = static_cast<int>(header.height);
+    m_SourceHash = header.sourceHash;
+    return true;
+}
+
+void CookedTexture::Close() {
+    m_File.Close();
+    m_Format = CookedFormat::Rgba8;
+    m_Width = 0;
+    m_Height = 0;
+    m_SourceHash = 0;
+    m_Levels = ArrayView<LevelEntry>();
+}
+
+bool CookedTexture::Write(const std::string& path, CookedFormat format, int width, int height, uint64_t sourceHash,
+                          const std::vector<std::vector<unsigned char>>& levels) {
+    if (!IsLittleEndian()) {
+        std::cerr << "Cooked textures are little-endian; not writing " << path << std::endl;
+        return false;
+    }
+    
+    // Lay the whole file out in memory, then write it in one go
+    size_t indexSize = levels.size() * sizeof(LevelEntry);
+    size_t size = AlignUp(sizeof(FileHeader) + indexSize);
+    std::vector<LevelEntry> index;
+    index.reserve(levels.size());
+    for (const auto& level : levels) {
+        index.push_back({ size, level.size() });
+        size = AlignUp(size + level.size());
+    }
+    
+    std::vector<unsigned char> buffer(size, 0);
+    FileHeader header;
+    std::memcpy(header.identifier, TEXTURE_IDENTIFIER, sizeof(TEXTURE_IDENTIFIER));
+    header.version = VERSION;
+    header.format = static_cast<uint32_t>(format);
+    header.width = static_cast<uint32_t>(width);
+    header.height = static_cast<uint32_t>(height);
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    header.sourceHash = sourceHash;
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    if (!index.empty()) {
+        std::memcpy(&buffer[sizeof(header)], index.data(), indexSize);
+    }
+    for (size_t i = 0; i < levels.size(); ++i) {
+        std::copy(levels[i].begin(), levels[i].end(), buffer.begin() + index[i].offset);
+    }
+    
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() || !file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size())) {
+            std::cerr << "Could not write cooked texture " << path << std::endl;
+            return false;
+        }
+    }
+    
+    // Renaming leaves any existing mapping of the old file intact
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        std::cerr << "Could not write cooked texture " << path << std::endl;
+        return false;
+    }
+    return true;
+}
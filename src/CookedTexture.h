@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ArrayView.h"
+#include "MappedFile.h"
+
+// Pixel formats of cooked textures and texture arrays. Colors are sRGB-encoded.
+enum class CookedFormat : uint32_t {
+    Rgba8,      // 4 bytes per pixel
+    Bc1,        // 8 bytes per 4x4 block, opaque (DXT1)
+    Bc3,        // 16 bytes per 4x4 block, with alpha (DXT5)
+    Index8      // 1 byte per pixel, an index into the level's Palette; never cooked
+};
+
+// Bytes one mip level of this size takes in the format
+size_t GetCookedLevelSize(CookedFormat format, int width, int height);
+
+// A texture ready for upload, laid out like a KTX2 file: a header, an index of
+// mip levels, then each level's data, 16-byte aligned. Level 0 is the full
+// image and level i is max(1, width >> i) by max(1, height >> i).
+//
+// Opening maps the file, and levels are handed to GL straight from the
+// mapping. The header carries a hash of the source image the texture was
+// cooked from.
+class CookedTexture {
+public:
+    static constexpr uint32_t VERSION = 1;
+    
+    // Map the file and check its header and level index. Returns false quietly
+    // for missing files, and with a message for damaged or outdated ones.
+    bool Open(const std::string& path);
+    void Close();
+    
+    bool IsOpen() const { return m_File.IsOpen(); }
+    CookedFormat GetFormat() const { return m_Format; }
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+    int GetLevelCount() const { return static_cast<int>(m_Levels.size()); }
+    uint64_t GetSourceHash() const { return m_SourceHash; }
+    
+    ArrayView<unsigned char> GetLevel(int level) const {
+        return ArrayView<unsigned char>(m_File.GetData() + m_Levels[level].offset,
+                                        static_cast<size_t>(m_Levels[level].size));
+    }
+    
+    // Write levels, largest first, each GetCookedLevelSize bytes. Like compiled
+    // levels it goes to a temporary file first, so a mapped older copy survives.
+    static bool Write(const std::string& path, CookedFormat format, int width, int height, uint64_t sourceHash,
+                      const std::vector<std::vector<unsigned char>>& levels);
+
+private:
+    struct LevelEntry {
+        uint64_t offset;
+        uint64_t size;
+    };
+    
+    MappedFile m_File;
+    CookedFormat m_Format = CookedFormat::Rgba8;
+    int m_Width = 0;
+    int m_Height = 0;
+    uint64_t m_SourceHash = 0;
+    ArrayView<LevelEntry> m_Levels;
+};
@@ -0,0 +1,164 @@
+#include "FlatBaker.h"
+#include "Map.h"
+#include "VirtualTexture.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace {
+    float DistanceToSegment(const glm::vec2& point, const glm::vec2& start, const glm::vec2& end) {
+        glm::vec2 direction = end - start;
+        float lengthSquared = glm::dot(direction, direction);
+        float t = lengthSquared > 0.0f ? std::clamp(glm::dot(point - start, direction) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+        return glm::length(point - (start + direction * t));
+    }
+    
+    // Value noise in 0..1, smooth between lattice points
+    float Lattice(int x, int y) {
+        uint32_t hash = static_cast<uint32_t>(x) * 0x8DA6B343u ^ static_cast<uint32_t>(y) * 0xD8163841u;
+        hash = (hash ^ (hash >> 15)) * 0x2C1B3C6Du;
+        hash ^= hash >> 12;
+        return static_cast<float>(hash & 0xFFFF) / 65535.0f;
+    }
+    
+    float ValueNoise(const glm::vec2& point) {
+        glm::vec2 cell = glm::floor(point);
+        glm::vec2 t = point - cell;
+        t = t * t * (3.0f - 2.0f * t);
+        int x = static_cast<int>(cell.x);
+        int y = static_cast<int>(cell.y);
+        float bottom = glm::mix(Lattice(x, y), Lattice(x + 1, y), t.x);
+        float top = glm::mix(Lattice(x, y + 1), Lattice(x + 1, y + 1), t.x);
+        return glm::mix(bottom, top, t.y);
+    }
+}
+
+FlatBaker::FlatBaker(const Map& map, std::vector<Flat> flats, float textureScale)
+    : m_Map(map), m_Flats(std::move(flats)), m_TextureScale(textureScale), m_Pages(1),
+      m_TexelsPerUnit(TEXELS_PER_UNIT), m_Origin(0.0f), m_Scale(1.0f) {
+    Aabb bounds;
+    for (size_t sector = 0; sector < map.GetSectors().size(); ++sector) {
+        bounds.Expand(map.GetSectorBounds(static_cast<int>(sector)));
+    }
+    if (bounds.IsEmpty()) {
+        return;
+    }
+    
+    // Floors and ceilings side by side in a square of power-of-two pages, at a
+    // lower density if the finest level would need more pages than feedback can name
+    m_Origin = glm::vec2(bounds.min.x, bounds.min.z);
+    float span = std::max(std::max(bounds.GetSize().x * 2.0f, bounds.GetSize().z), 1.0f);
+    float maxTexels = static_cast<float>(VirtualTexture::MAX_PAGES * VirtualTexture::PAGE_SIZE);
+    m_TexelsPerUnit = std::min(TEXELS_PER_UNIT, maxTexels / span);
+    while (m_Pages * VirtualTexture::PAGE_SIZE < span * m_TexelsPerUnit) {
+        m_Pages *= 2;
+    }
+    m_Scale = m_TexelsPerUnit / (m_Pages * VirtualTexture::PAGE_SIZE);
+}
+
+void FlatBaker::Paint(int level, int pageX, int pageY, unsigned char* pixels) const {
+    const int size = VirtualTexture::PADDED_PAGE_SIZE;
+    float levelScale = static_cast<float>(1 << level);
+    float unitsPerTexel = levelScale / m_TexelsPerUnit;
+    float halfWidth = m_Pages * VirtualTexture::PAGE_SIZE * 0.5f;
+    
+    // World point at the center of every texel, and whether it is on the ceiling half
+    std::vector<glm::vec2> points(static_cast<size_t>(size) * size);
+    std::vector<uint8_t> ceilings(points.size());
+    glm::vec2 minimum(std::numeric_limits<float>::max());
+    glm::vec2 maximum(-std::numeric_limits<float>::max());
+    for (int j = 0; j < size; ++j) {
+        for (int i = 0; i < size; ++i) {
+            glm::vec2 texel((pageX * VirtualTexture::PAGE_SIZE + i - VirtualTexture::PAGE_BORDER + 0.5f) * levelScale,
+                            (pageY * VirtualTexture::PAGE_SIZE + j - VirtualTexture::PAGE_BORDER + 0.5f) * levelScale);
+            bool ceiling = texel.x >= halfWidth;
+            if (ceiling) {
+                texel.x -= halfWidth;
+            }
+            glm::vec2 point = m_Origin + texel / m_TexelsPerUnit;
+            points[j * size + i] = point;
+            ceilings[j * size + i] = ceiling ? 1 : 0;
+            minimum = glm::min(minimum, point);
+            maximum = glm::max(maximum, point);
+        }
+    }
+    std::vector<int> sectors(points.size());
+    m_Map.FindSectors(ArrayView<glm::vec2>(points), sectors.data());
+    
+    // Occlusion only shows once its falloff spans a few texels, which also keeps the walls searched nearby
+    std::vector<int> walls;
+    bool occlusion = unitsPerTexel * 4.0f <= OCCLUSION_RADIUS;
+    if (occlusion) {
+        std::vector<int> lines;
+        m_Map.FindLinesInBox(minimum - glm::vec2(OCCLUSION_RADIUS), maximum + glm::vec2(OCCLUSION_RADIUS), lines);
+        for (int line : lines) {
+            if (m_Map.GetLinedefs()[line].backSide < 0) {
+                walls.push_back(line);
+            }
+        }
+    }
+    
+    // Grime fades out as texels grow past its cells, rather than aliasing
+    float grime = GRIME_STRENGTH * std::clamp(1.0f - unitsPerTexel * 2.0f / GRIME_CELL_SIZE, 0.0f, 1.0f);
+    
+    const std::vector<Sector>& sectorList = m_Map.GetSectors();
+    ArrayView<glm::vec2> vertices = m_Map.GetVertices();
+    for (size_t texel = 0; texel < points.size(); ++texel) {
+        unsigned char* out = pixels + texel * 4;
+        out[3] = 255;
+        if (sectors[texel] < 0) {
+            out[0] = out[1] = out[2] = 0;
+            continue;
+        }
+        
+        // The flat level whose texels are about as large as this level's
+        const Sector& sector = sectorList[sectors[texel]];
+        int textureId = ceilings[texel] ? sector.ceilingTextureId : sector.floorTextureId;
+        glm::vec3 color(0.5f);
+        if (textureId >= 0 && textureId < static_cast<int>(m_Flats.size()) && !m_Flats[textureId].levels.empty()) {
+            const Flat& flat = m_Flats[textureId];
+            float ratio = unitsPerTexel * m_TextureScale * std::max(flat.width, flat.height);
+            int flatLevel = ratio > 1.0f ? static_cast<int>(std::log2(ratio)) : 0;
+            flatLevel = std::min(flatLevel, static_cast<int>(flat.levels.size()) - 1);
+            color = SampleFlat(flat, flatLevel, points[texel] * m_TextureScale);
+        }
+        
+        const glm::vec2& point = points[texel];
+        float brightness = 1.0f;
+        if (occlusion) {
+            float distance = OCCLUSION_RADIUS;
+            for (int wall : walls) {
+                const Linedef& line = m_Map.GetLinedefs()[wall];
+                distance = std::min(distance, DistanceToSegment(point, vertices[line.startVertex], vertices[line.endVertex]));
+            }
+            float falloff = 1.0f - distance / OCCLUSION_RADIUS;
+            brightness -= OCCLUSION_STRENGTH * falloff * falloff;
+        }
+        brightness *= 1.0f - grime * ValueNoise(point / GRIME_CELL_SIZE + (ceilings[texel] ? 17.0f : 0.0f));
+        
+        for (int channel = 0; channel < 3; ++channel) {
+            out[channel] = static_cast<unsigned char>(std::clamp(color[channel] * brightness, 0.0f, 255.0f) + 0.5f);
+        }
+    }
+}
+
+glm::vec3 FlatBaker::SampleFlat(const Flat& flat, int level, glm::vec2 coord) const {
+    int width = std::max(flat.width >> level, 1);
+    int height = std::max(flat.height >> level, 1);
+    const unsigned char* pixels = flat.levels[level].data();
+    
+    // Texel centers sit at half-texel offsets, and every coordinate wraps
+    glm::vec2 position = (coord - glm::floor(coord)) * glm::vec2(width, height) - 0.5f;
+    glm::vec2 cell = glm::floor(position);
+    glm::vec2 t = position - cell;
+    int x0 = (static_cast<int>(cell.x) % width + width) % width;
+    int y0 = (static_cast<int>(cell.y) % height + height) % height;
+    int x1 = (x0 + 1) % width;
+    int y1 = (y0 + 1) % height;
+    auto fetch = [&](int x, int y) {
+        const unsigned char* texel = pixels + (static_cast<size_t>(y) * width + x) * 4;
+        return glm::vec3(texel[0], texel[1], texel[2]);
+    };
+    return glm::mix(glm::mix(fetch(x0, y0), fetch(x1, y0), t.x), glm::mix(fetch(x0, y1), fetch(x1, y1), t.x), t.y);
+}
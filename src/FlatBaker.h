@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+#include <vector>
+
+class Map;
+
+// Paints the pages of one virtual texture that covers every floor of a level
+// in its left half and every ceiling in its right half, seen from above. Each
+// texel is the sector's flat texture where it lies, darkened near solid walls
+// and by a little large-scale grime, so no two places on the floor look the
+// same even though the flats repeat. The map must outlive the baker.
+class FlatBaker {
+public:
+    // Texels per world unit at the finest level, unless the level is too large for that
+    static constexpr float TEXELS_PER_UNIT = 128.0f;
+    
+    // Walls darken the floor and ceiling within this distance, by up to this much
+    static constexpr float OCCLUSION_RADIUS = 0.75f;
+    static constexpr float OCCLUSION_STRENGTH = 0.5f;
+    
+    // Grime varies brightness by up to this much, over cells this many units across
+    static constexpr float GRIME_STRENGTH = 0.2f;
+    static constexpr float GRIME_CELL_SIZE = 3.0f;
+    
+    // A flat texture's RGBA mip chain, largest level first; empty for textures no sector uses
+    struct Flat {
+        int width = 0;
+        int height = 0;
+        std::vector<std::vector<unsigned char>> levels;
+    };
+    
+    // flats is indexed by texture id. Flats repeat every 1 / textureScale world units.
+    FlatBaker(const Map& map, std::vector<Flat> flats, float textureScale);
+    
+    // Pages across the finest level of the virtual texture
+    int GetPages() const { return m_Pages; }
+    
+    // A floor point (x, z) is at virtual coordinates ((x, z) - origin) * scale; ceilings are 0.5 further in u
+    const glm::vec2& GetOrigin() const { return m_Origin; }
+    float GetScale() const { return m_Scale; }
+    
+    // A VirtualTexture::PageSource; safe to call from several threads at once
+    void Paint(int level, int pageX, int pageY, unsigned char* pixels) const;
+
+private:
+    const Map& m_Map;
+    std::vector<Flat> m_Flats;
+    float m_TextureScale;
+    int m_Pages;
+    float m_TexelsPerUnit;
+    glm::vec2 m_Origin;
+    float m_Scale;
+    
+    // Bilinear sample of a flat at texture coordinates that wrap every 1
+    glm::vec3 SampleFlat(const Flat& flat, int level, glm::vec2 coord) const;
+};
@@ -0,0 +1,46 @@
+#include "Frustum.h"
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    // Gribb/Hartmann plane extraction from the rows of the matrix (glm is column-major)
+    glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    
+    m_Planes[0] = row3 + row0; // Left
+    m_Planes[1] = row3 - row0; // Right
+    m_Planes[2] = row3 + row1; // Bottom
+    m_Planes[3] = row3 - row1; // Top
+    m_Planes[4] = row3 + row2; // Near
+    m_Planes[5] = row3 - row2; // Far
+    
+    for (auto& plane : m_Planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+Frustum::Result Frustum::Test(const Aabb& box) const {
+    Result result = INSIDE;
+    
+    for (const auto& plane : m_Planes) {
+        glm::vec3 normal(plane);
+        
+        // Corner furthest along the plane normal; if it's outside, the whole box is
+        glm::vec3 positive(normal.x >= 0.0f ? box.max.x : box.min.x,
+                           normal.y >= 0.0f ? box.max.y : box.min.y,
+                           normal.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(normal, positive) + plane.w < 0.0f) {
+            return OUTSIDE;
+        }
+        
+        // Opposite corner decides whether the box straddles this plane
+        glm::vec3 negative(normal.x >= 0.0f ? box.min.x : box.max.x,
+                           normal.y >= 0.0f ? box.min.y : box.max.y,
+                           normal.z >= 0.0f ? box.min.z : box.max.z);
+        if (glm::dot(normal, negative) + plane.w < 0.0f) {
+            result = INTERSECTS;
+        }
+    }
+    
+    return result;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+
+#include "Bounds.h"
+
+// View frustum as six inward-facing planes, extracted from a view-projection matrix
+class Frustum {
+public:
+    enum Result {
+        OUTSIDE,
+        INTERSECTS,
+        INSIDE
+    };
+    
+    Frustum() = default;
+    explicit Frustum(const glm::mat4& viewProjection);
+    
+    Result Test(const Aabb& box) const;
+    
+private:
+    // xyz = normal, w = distance; a point p is inside when dot(n, p) + w >= 0
+    glm::vec4 m_Planes[6];
+};
@@ -1,5 +1,6 @@
 #include "Game.h"
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 
 // Static member initialization for callbacks
@@ -7,9 +8,11 @@ namespace {
     Game* currentGameInstance = nullptr;
 }
 
-Game::Game(int width, int height, const std::string& title)
-    : m_Width(width), m_Height(height), m_Title(title),
-      m_DeltaTime(0.0f), m_LastFrame(0.0f) {
+Game::Game(int width, int height, const std::string& title, const std::string& mapPath)
+    : m_Width(width), m_Height(height), m_Title(title), m_MapPath(mapPath),
+      m_DeltaTime(0.0f), m_LastFrame(0.0f),
+      m_FrameCount(0), m_LastTitleUpdate(0.0f), m_PvsKeyHeld(false), m_PortalKeyHeld(false), m_OcclusionKeyHeld(false), m_HiZKeyHeld(false),
+      m_PaletteKeyHeld(false), m_VirtualKeyHeld(false) {
     
     currentGameInstance = this;
     
@@ -60,11 +63,17 @@ void Game::InitWindow() {
 }
 
 void Game::InitGame() {
-    // Create player
-    m_Player = std::make_unique<Player>(glm::vec3(2.0f, 0.0f, 2.0f));
-    
     // Create map
-    m_Map = std::make_unique<Map>("maps/level1.txt");
+    m_Map = std::make_unique<Map>(m_MapPath);
+    
+    // Create player at the level's start, if it has one, standing on the floor there
+    LevelStart start = { glm::vec2(2.0f, 2.0f), -90.0f };
+    if (m_Map->HasStart()) {
+        start = m_Map->GetStart();
+    }
+    int sector = m_Map->FindSector(start.position.x, start.position.y);
+    float floorHeight = sector >= 0 ? m_Map->GetSectors()[sector].floorHeight : 0.0f;
+    m_Player = std::make_unique<Player>(glm::vec3(start.position.x, floorHeight, start.position.y), start.yaw);
     
     // Create renderer
     m_Renderer = std::make_unique<Renderer>(m_Width, m_Height);
@@ -88,7 +97,10 @@ void Game::Run() {
         m_Player->Update(m_DeltaTime, *m_Map);
         
         // Render the scene
-        m_Renderer->Render(*m_Player, *m_Map);
+        m_Renderer->Render(*m_Player, *m_Map, currentFrame);
+        
+        // Show frame statistics in the title bar once per second
+        UpdateWindowTitle(currentFrame);
         
         // Swap buffers and poll events
         glfwSwapBuffers(m_Window);
@@ -96,6 +108,36 @@ void Game::Run() {
     }
 }
 
+void Game::UpdateWindowTitle(float currentFrame) {
+    m_FrameCount++;
+    if (currentFrame - m_LastTitleUpdate < 1.0f) {
+        return;
+    }
+    
+    const RenderStats& stats = m_Renderer->GetStats();
+    std::ostringstream title;
+    title << m_Title
+          << " | " << m_FrameCount << " fps"
+          << " | draws " << stats.drawCalls
+          << " | binds " << stats.textureBinds
+          << " | walls " << stats.wallsSubmitted
+          << " (culled " << stats.wallsCulled
+          << ", pvs " << stats.wallsPvsCulled
+          << ", portals " << stats.wallsPortalCulled
+          << ", occluded " << stats.wallsOccluded
+          << ", hi-z " << stats.wallsHiZCulled << ")"
+          << " | flats " << stats.flatsSubmitted
+          << " | tex " << stats.textureBytesResident / (1024 * 1024) << " MB"
+          << " (pending " << stats.texturePendingUploads << ")";
+    if (m_Renderer->GetVirtualTexturing()) {
+        title << " | vt " << stats.virtualPagesResident << " pages (pending " << stats.virtualPagesPending << ")";
+    }
+    glfwSetWindowTitle(m_Window, title.str().c_str());
+    
+    m_FrameCount = 0;
+    m_LastTitleUpdate = currentFrame;
+}
+
 void Game::ProcessInput() {
     // Close window on ESC
     if (glfwGetKey(m_Window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
@@ -115,6 +157,45 @@ void Game::ProcessInput() {
     if (glfwGetKey(m_Window, GLFW_KEY_D) == GLFW_PRESS) {
         m_Player->Move(Player::RIGHT, m_DeltaTime, *m_Map);
     }
+    
+    // Toggle culling stages on key press (not while held)
+    bool pvsKey = glfwGetKey(m_Window, GLFW_KEY_P) == GLFW_PRESS;
+    if (pvsKey && !m_PvsKeyHeld) {
+        m_Renderer->SetPvsCulling(!m_Renderer->GetPvsCulling());
+    }
+    m_PvsKeyHeld = pvsKey;
+    
+    bool portalKey = glfwGetKey(m_Window, GLFW_KEY_K) == GLFW_PRESS;
+    if (portalKey && !m_PortalKeyHeld) {
+        m_Renderer->SetPortalCulling(!m_Renderer->GetPortalCulling());
+    }
+    m_PortalKeyHeld = portalKey;
+    
+    bool occlusionKey = glfwGetKey(m_Window, GLFW_KEY_O) == GLFW_PRESS;
+    if (occlusionKey && !m_OcclusionKeyHeld) {
+        m_Renderer->SetOcclusionCulling(!m_Renderer->GetOcclusionCulling());
+    }
+    m_OcclusionKeyHeld = occlusionKey;
+    
+    bool hiZKey = glfwGetKey(m_Window, GLFW_KEY_H) == GLFW_PRESS;
+    if (hiZKey && !m_HiZKeyHeld) {
+        m_Renderer->SetHiZCulling(!m_Renderer->GetHiZCulling());
+    }
+    m_HiZKeyHeld = hiZKey;
+    
+    // Switch between true-color and paletted textures
+    bool paletteKey = glfwGetKey(m_Window, GLFW_KEY_I) == GLFW_PRESS;
+    if (paletteKey && !m_PaletteKeyHeld) {
+        m_Renderer->SetPaletted(!m_Renderer->GetPaletted());
+    }
+    m_PaletteKeyHeld = paletteKey;
+    
+    // Switch floors and ceilings between repeating flats and the virtual texture
+    bool virtualKey = glfwGetKey(m_Window, GLFW_KEY_V) == GLFW_PRESS;
+    if (virtualKey && !m_VirtualKeyHeld) {
+        m_Renderer->SetVirtualTexturing(!m_Renderer->GetVirtualTexturing());
+    }
+    m_VirtualKeyHeld = virtualKey;
 }
 
 void Game::FramebufferSizeCallback(GLFWwindow* window, int width, int height) {
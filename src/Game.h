@@ -11,9 +11,10 @@
 
 class Game {
 public:
-    Game(int width, int height, const std::string& title);
+    // mapPath is anything Map loads, including "gen:" paths for generated levels
+    Game(int width, int height, const std::string& title, const std::string& mapPath);
     ~Game();
-
+    
     void Run();
 
 private:
@@ -22,17 +23,29 @@ private:
     int m_Width;
     int m_Height;
     std::string m_Title;
-
+    std::string m_MapPath;
+    
     // Game components
     std::unique_ptr<Player> m_Player;
     std::unique_ptr<Map> m_Map;
     std::unique_ptr<Renderer> m_Renderer;
-
+    
     // Time tracking
     float m_DeltaTime;
     float m_LastFrame;
-
+    
+    // Frame statistics shown in the title bar
+    int m_FrameCount;
+    float m_LastTitleUpdate;
+    void UpdateWindowTitle(float currentFrame);
+    
     // Input handling
+    bool m_PvsKeyHeld;
+    bool m_PortalKeyHeld;
+    bool m_OcclusionKeyHeld;
+    bool m_HiZKeyHeld;
+    bool m_PaletteKeyHeld;
+    bool m_VirtualKeyHeld;
     void ProcessInput();
     
     // Callbacks
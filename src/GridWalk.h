@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+
+// Visit the unit cells a segment passes through, in order from start to end.
+// Positions are in cell units; cell (x, z) covers [x, x + 1) x [z, z + 1).
+// Where the segment crosses a corner exactly, both cells beside the corner
+// are visited before the diagonal one, so the walk is a supercover.
+// visit(int x, int z) returns false to stop the walk early.
+template<typename Visit>
+void WalkGridCells(const glm::vec2& from, const glm::vec2& to, Visit&& visit) {
+    int cellX = static_cast<int>(std::floor(from.x));
+    int cellZ = static_cast<int>(std::floor(from.y));
+    int endX = static_cast<int>(std::floor(to.x));
+    int endZ = static_cast<int>(std::floor(to.y));
+    
+    glm::vec2 delta = to - from;
+    int stepX = delta.x > 0.0f ? 1 : -1;
+    int stepZ = delta.y > 0.0f ? 1 : -1;
+    
+    // Fraction of the segment at which it crosses the next boundary on each axis.
+    // Worked out from the boundary each time rather than accumulated, so a
+    // segment through a lattice corner crosses both at the same fraction.
+    auto nextCrossing = [](int cell, int step, float position, float length) {
+        if (length == 0.0f) {
+            return std::numeric_limits<float>::infinity();
+        }
+        return ((step > 0 ? cell + 1 : cell) - position) / length;
+    };
+    
+    if (!visit(cellX, cellZ)) {
+        return;
+    }
+    int remainingX = std::abs(endX - cellX);
+    int remainingZ = std::abs(endZ - cellZ);
+    const float tieEpsilon = 1e-6f;
+    while (remainingX > 0 || remainingZ > 0) {
+        float nextX = nextCrossing(cellX, stepX, from.x, delta.x);
+        float nextZ = nextCrossing(cellZ, stepZ, from.y, delta.y);
+        bool crossX = remainingX > 0 && (remainingZ == 0 || nextX < nextZ + tieEpsilon);
+        bool crossZ = remainingZ > 0 && (remainingX == 0 || nextZ < nextX + tieEpsilon);
+        if (crossX && crossZ) {
+            if (!visit(cellX + stepX, cellZ) || !visit(cellX, cellZ + stepZ)) {
+                return;
+            }
+        }
+        if (crossX) {
+            cellX += stepX;
+            remainingX--;
+        }
+        if (crossZ) {
+            cellZ += stepZ;
+            remainingZ--;
+        }
+        if (!visit(cellX, cellZ)) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#include "Image.h"
+#include <iostream>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb-master/stb-master/stb_image.h>
+
+Image::Image(const std::string& path, int desiredChannels) {
+    // Load image; the flip setting is per thread, so decoders do not race on it
+    stbi_set_flip_vertically_on_load_thread(true);
+    unsigned char* data = stbi_load(path.c_str(), &m_Width, &m_Height, &m_Channels, desiredChannels);
+    
+    if (data) {
+        if (desiredChannels != 0) {
+            m_Channels = desiredChannels;
+        }
+        m_Pixels.assign(data, data + static_cast<size_t>(m_Width) * m_Height * m_Channels);
+        stbi_image_free(data);
+    } else {
+        std::cerr << "Failed to load texture: " << path << std::endl;
+        CreateCheckerboard(FALLBACK_SIZE, FALLBACK_SIZE, desiredChannels != 0 ? desiredChannels : 3);
+    }
+}
+
+Image::Image(int width, int height, int channels) {
+    CreateCheckerboard(width, height, channels);
+}
+
+void Image::ReadSize(const std::string& path, int& width, int& height) {
+    int channels;
+    if (!stbi_info(path.c_str(), &width, &height, &channels)) {
+        width = FALLBACK_SIZE;
+        height = FALLBACK_SIZE;
+    }
+}
+
+void Image::CreateCheckerboard(int width, int height, int channels) {
+    // Create a default checkerboard pattern as a fallback
+    const int checkerSize = 16;
+    
+    m_Width = width;
+    m_Height = height;
+    m_Channels = channels;
+    m_Fallback = true;
+    m_Pixels.assign(static_cast<size_t>(width) * height * channels, 255);
+    
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            bool isEvenRow = (y / checkerSize) % 2 == 0;
+            bool isEvenCol = (x / checkerSize) % 2 == 0;
+            
+            // White squares keep the default, magenta squares drop green
+            // (to make it obvious it's a missing texture)
+            if (isEvenRow != isEvenCol && channels >= 2) {
+                m_Pixels[(static_cast<size_t>(y) * width + x) * channels + 1] = 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Decoded image pixels in CPU memory, ready to be uploaded to a texture
+class Image {
+public:
+    Image() = default;
+    
+    // Decodes the file, or produces a checkerboard if it cannot be loaded.
+    // desiredChannels forces the channel count (0 keeps the file's own).
+    // Safe to call from several threads at once.
+    explicit Image(const std::string& path, int desiredChannels = 0);
+    
+    // Missing-texture checkerboard of a given size
+    Image(int width, int height, int channels);
+    
+    // Read only the file's header. Gives the checkerboard's size if the file cannot be read,
+    // so the result always matches what the constructor would produce.
+    static void ReadSize(const std::string& path, int& width, int& height);
+    
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+    int GetChannels() const { return m_Channels; }
+    const unsigned char* GetPixels() const { return m_Pixels.data(); }
+    
+    // True if this is the missing-texture checkerboard instead of the file's contents
+    bool IsFallback() const { return m_Fallback; }
+
+private:
+    int m_Width = 0;
+    int m_Height = 0;
+    int m_Channels = 0;
+    bool m_Fallback = false;
+    std::vector<unsigned char> m_Pixels;
+    
+    // Side of the checkerboard used when a file cannot be read
+    static constexpr int FALLBACK_SIZE = 128;
+    
+    void CreateCheckerboard(int width, int height, int channels);
+};
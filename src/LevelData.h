@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Wall as stored in a level file: two shared vertices and what is behind it
+struct LevelWall {
+    int startVertex;
+    int endVertex;
+    float height;
+    int textureId;
+    int backSector;     // -1 for one-sided walls
+};
+
+// Sector as stored in a level file; its walls are walls[firstWall, firstWall + wallCount)
+struct LevelSector {
+    float floorHeight;
+    float ceilingHeight;
+    int floorTextureId;
+    int ceilingTextureId;
+    int firstWall;
+    int wallCount;
+    int lightLevel = 255;   // 0 (black) to 255 (full bright), as in Doom
+};
+
+// Where the player begins; yaw is in degrees, with 0 facing +x and -90 facing -z
+struct LevelStart {
+    glm::vec2 position;
+    float yaw;
+};
+
+// Everything a level file describes, before the map derives its runtime data.
+// Texture ids index into textures; vertices are (x, z).
+struct LevelData {
+    std::vector<std::string> textures;
+    std::vector<glm::vec2> vertices;
+    std::vector<LevelSector> sectors;
+    std::vector<LevelWall> walls;
+    
+    // Levels without a start record leave the player where the game puts them
+    bool hasStart = false;
+    LevelStart start = {};
+};
@@ -0,0 +1,340 @@
+#include "LevelGenerator.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    // SplitMix64, written out so levels do not depend on the standard library's distributions
+    class Random {
+    public:
+        explicit Random(uint64_t seed) : m_State(seed) {}
+        
+        uint64_t Next() {
+            uint64_t z = (m_State += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+        
+        // In [minimum, maximum)
+        float Uniform(float minimum, float maximum) {
+            return minimum + (maximum - minimum) * static_cast<float>(Next() >> 40) * (1.0f / 16777216.0f);
+        }
+        
+        // In [0, count)
+        int Below(int count) { return static_cast<int>(Next() % static_cast<uint64_t>(count)); }
+        
+        bool Chance(float share) { return Uniform(0.0f, 1.0f) < share; }
+    
+    private:
+        uint64_t m_State;
+    };
+    
+    // Rooms sit in square cells; corridors bridge the gap between neighbouring rooms
+    const float CELL_SIZE = 24.0f;
+    const float HEIGHT_STEP = 0.125f;   // Floors and ceilings are multiples of 4 Doom units
+    
+    const char* const STOCK_TEXTURES[] = { "resources/wall1.jpg", "resources/wall2.png", "resources/floor.jpg" };
+    
+    struct Room {
+        glm::vec2 minimum;
+        glm::vec2 maximum;
+        float floorHeight;
+        float ceilingHeight;
+        bool open;
+        int pillars;
+        
+        // Corridor on each side, or -1: below (-z), right (+x), above (+z), left (-x)
+        std::array<int, 4> corridors;
+    };
+    
+    // Joins rooms a and b, with b to the right of a (along x) or above it (along z)
+    struct Corridor {
+        int a;
+        int b;
+        bool alongX;
+        float low;          // Extent across the corridor
+        float high;
+        std::array<int, 4> corners;     // Vertices: a side low and high, then b side low and high
+    };
+    
+    float Quantize(float height) {
+        return std::round(height / HEIGHT_STEP) * HEIGHT_STEP;
+    }
+}
+
+LevelData LevelGenerator::Generate(const LevelGeneratorSettings& settings) {
+    auto start = std::chrono::steady_clock::now();
+    Random random(settings.seed);
+    LevelData level;
+    
+    int textureCount = std::max(settings.textureCount, 1);
+    for (int i = 0; i < textureCount; ++i) {
+        level.textures.push_back(STOCK_TEXTURES[i % 3]);
+    }
+    
+    // A maze over a grid has about one corridor per room
+    int sectorCount = settings.sectorCount > 0 ? settings.sectorCount : std::max(settings.wallCount / 16, 1);
+    int roomCount = std::max(sectorCount / 2, 1);
+    int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(roomCount))));
+    
+    // Ordinary rooms keep clear of a band through the middle of their cell so
+    // corridors can always meet them; halls fill nearly the whole cell
+    std::vector<Room> rooms(roomCount);
+    for (int i = 0; i < roomCount; ++i) {
+        Room& room = rooms[i];
+        glm::vec2 center = (glm::vec2(i % columns, i / columns) + 0.5f) * CELL_SIZE;
+        room.open = i > 0 && random.Chance(settings.openShare);
+        if (room.open) {
+            room.minimum = center - glm::vec2(11.0f);
+            room.maximum = center + glm::vec2(11.0f);
+        } else {
+            room.minimum = center - glm::vec2(random.Uniform(3.0f, 8.0f), random.Uniform(3.0f, 8.0f));
+            room.maximum = center + glm::vec2(random.Uniform(3.0f, 8.0f), random.Uniform(3.0f, 8.0f));
+        }
+        room.floorHeight = 0.0f;
+        room.ceilingHeight = 0.0f;
+        room.pillars = 0;
+        room.corridors = { -1, -1, -1, -1 };
+    }
+    
+    // Depth-first maze from the first room, so every room is reachable; floors
+    // change by at most a step from the room they are reached from
+    std::vector<Corridor> corridors;
+    auto connect = [&](int a, int b) {
+        bool alongX = b == a + 1;
+        float center = ((alongX ? a / columns : a % columns) + 0.5f) * CELL_SIZE + random.Uniform(-1.5f, 1.5f);
+        float halfWidth = random.Uniform(1.0f, 1.5f);
+        rooms[a].corridors[alongX ? 1 : 2] = static_cast<int>(corridors.size());
+        rooms[b].corridors[alongX ? 3 : 0] = static_cast<int>(corridors.size());
+        corridors.push_back({ a, b, alongX, center - halfWidth, center + halfWidth, {} });
+    };
+    auto neighbours = [&](int room) {
+        std::array<int, 4> result = { -1, -1, -1, -1 };
+        int x = room % columns;
+        if (room >= columns) result[0] = room - columns;
+        if (x + 1 < columns && room + 1 < roomCount) result[1] = room + 1;
+        if (room + columns < roomCount) result[2] = room + columns;
+        if (x > 0) result[3] = room - 1;
+        return result;
+    };
+    std::vector<bool> visited(roomCount, false);
+    std::vector<int> stack = { 0 };
+    visited[0] = true;
+    while (!stack.empty()) {
+        int room = stack.back();
+        std::array<int, 4> around = neighbours(room);
+        int choices[4];
+        int choiceCount = 0;
+        for (int next : around) {
+            if (next >= 0 && !visited[next]) {
+                choices[choiceCount++] = next;
+            }
+        }
+        if (choiceCount == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int next = choices[random.Below(choiceCount)];
+        connect(std::min(room, next), std::max(room, next));
+        rooms[next].floorHeight = Quantize(rooms[room].floorHeight + random.Uniform(-0.5f, 0.5f));
+        visited[next] = true;
+        stack.push_back(next);
+    }
+    
+    // A few extra corridors make loops, so there is more than one way around
+    for (int room = 0; room < roomCount; ++room) {
+        for (int side = 1; side <= 2; ++side) {
+            int next = neighbours(room)[side];
+            if (next >= 0 && rooms[room].corridors[side] < 0 && random.Chance(0.1f)) {
+                connect(room, next);
+            }
+        }
+    }
+    for (auto& room : rooms) {
+        room.ceilingHeight = room.floorHeight + Quantize(room.open ? random.Uniform(5.0f, 7.0f) : random.Uniform(3.0f, 4.0f));
+    }
+    
+    // Make up the wall count with pillars, four walls each; halls take a larger share.
+    // Rooms have four walls plus two per corridor, corridors four.
+    int baseWalls = 4 * roomCount + 8 * static_cast<int>(corridors.size());
+    int pillarCount = std::max(settings.wallCount - baseWalls, 0) / 4;
+    std::vector<int> weights(roomCount, 0);
+    int totalWeight = 0;
+    for (int i = 1; i < roomCount; ++i) {
+        weights[i] = rooms[i].open ? 8 : (random.Chance(settings.pillarShare) ? 1 : 0);
+        totalWeight += weights[i];
+    }
+    if (totalWeight > 0) {
+        int placed = 0;
+        for (int i = 0; i < roomCount; ++i) {
+            rooms[i].pillars = static_cast<int>(static_cast<int64_t>(pillarCount) * weights[i] / totalWeight);
+            placed += rooms[i].pillars;
+        }
+        for (int i = 0; placed < pillarCount; i = (i + 1) % roomCount) {
+            if (weights[i] > 0) {
+                rooms[i].pillars++;
+                placed++;
+            }
+        }
+    }
+    
+    auto addVertex = [&](float x, float z) {
+        level.vertices.emplace_back(x, z);
+        return static_cast<int>(level.vertices.size()) - 1;
+    };
+    auto wallTexture = [&]() { return random.Below(textureCount); };
+    
+    // Corridor ends are shared by the corridor and the rooms at either end
+    for (auto& corridor : corridors) {
+        const Room& a = rooms[corridor.a];
+        const Room& b = rooms[corridor.b];
+        if (corridor.alongX) {
+            corridor.corners = { addVertex(a.maximum.x, corridor.low), addVertex(a.maximum.x, corridor.high),
+                                 addVertex(b.minimum.x, corridor.low), addVertex(b.minimum.x, corridor.high) };
+        } else {
+            corridor.corners = { addVertex(corridor.low, a.maximum.y), addVertex(corridor.high, a.maximum.y),
+                                 addVertex(corridor.low, b.minimum.y), addVertex(corridor.high, b.minimum.y) };
+        }
+    }
+    
+    // Rooms come first, so corridor i is sector roomCount + i
+    for (int i = 0; i < roomCount; ++i) {
+        const Room& room = rooms[i];
+        int firstWall = static_cast<int>(level.walls.size());
+        float height = room.ceilingHeight - room.floorHeight;
+        int floorTexture = wallTexture();
+        level.sectors.push_back({ room.floorHeight, room.ceilingHeight, floorTexture, wallTexture(), firstWall, 0 });
+        
+        // Counterclockwise from the lowest corner; each side may open onto a corridor part way along.
+        // Going up or right a side meets the opening's low end first, going down or left its high end.
+        int corners[4] = { addVertex(room.minimum.x, room.minimum.y), addVertex(room.maximum.x, room.minimum.y),
+                           addVertex(room.maximum.x, room.maximum.y), addVertex(room.minimum.x, room.maximum.y) };
+        for (int side = 0; side < 4; ++side) {
+            int from = corners[side];
+            int to = corners[(side + 1) % 4];
+            int corridorIndex = room.corridors[side];
+            if (corridorIndex < 0) {
+                level.walls.push_back({ from, to, height, wallTexture(), -1 });
+                continue;
+            }
+            const Corridor& corridor = corridors[corridorIndex];
+            int end = corridor.a == i ? 0 : 2;
+            int low = corridor.corners[end];
+            int high = corridor.corners[end + 1];
+            if (side >= 2) {
+                std::swap(low, high);
+            }
+            int texture = wallTexture();
+            level.walls.push_back({ from, low, height, texture, -1 });
+            level.walls.push_back({ low, high, height, texture, roomCount + corridorIndex });
+            level.walls.push_back({ high, to, height, texture, -1 });
+        }
+        
+        // Pillars on a grid inside the room, clear of the walls and of each other; holes run clockwise
+        if (room.pillars > 0) {
+            const float margin = 1.5f;
+            int perRow = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(room.pillars))));
+            glm::vec2 spacing = (room.maximum - room.minimum - 2.0f * margin) / static_cast<float>(perRow);
+            float size = std::min(std::min(spacing.x, spacing.y) * 0.5f, 1.0f);
+            glm::vec2 slack = spacing - size;
+            int texture = wallTexture();
+            for (int p = 0; p < room.pillars; ++p) {
+                glm::vec2 low = room.minimum + margin + glm::vec2(p % perRow, p / perRow) * spacing +
+                                glm::vec2(random.Uniform(0.1f, 0.9f) * slack.x, random.Uniform(0.1f, 0.9f) * slack.y);
+                glm::vec2 high = low + size;
+                int pillar[4] = { addVertex(low.x, low.y), addVertex(low.x, high.y), addVertex(high.x, high.y),
+                                  addVertex(high.x, low.y) };
+                for (int k = 0; k < 4; ++k) {
+                    level.walls.push_back({ pillar[k], pillar[(k + 1) % 4], height, texture, -1 });
+                }
+            }
+        }
+        level.sectors.back().wallCount = static_cast<int>(level.walls.size()) - firstWall;
+    }
+    
+    // Corridors take the higher floor and lower ceiling of their two rooms
+    for (size_t i = 0; i < corridors.size(); ++i) {
+        const Corridor& corridor = corridors[i];
+        const Room& a = rooms[corridor.a];
+        const Room& b = rooms[corridor.b];
+        float floorHeight = std::max(a.floorHeight, b.floorHeight);
+        float ceilingHeight = std::max(std::min(a.ceilingHeight, b.ceilingHeight) - 0.5f, floorHeight + 2.5f);
+        float height = ceilingHeight - floorHeight;
+        int firstWall = static_cast<int>(level.walls.size());
+        int floorTexture = wallTexture();
+        level.sectors.push_back({ floorHeight, ceilingHeight, floorTexture, wallTexture(), firstWall, 4 });
+        
+        // Counterclockwise: a's low end, b's low end, b's high end, a's high end
+        const std::array<int, 4>& c = corridor.corners;
+        int texture = wallTexture();
+        if (corridor.alongX) {
+            level.walls.push_back({ c[0], c[2], height, texture, -1 });
+            level.walls.push_back({ c[2], c[3], height, texture, corridor.b });
+            level.walls.push_back({ c[3], c[1], height, texture, -1 });
+            level.walls.push_back({ c[1], c[0], height, texture, corridor.a });
+        } else {
+            level.walls.push_back({ c[0], c[1], height, texture, corridor.a });
+            level.walls.push_back({ c[1], c[3], height, texture, -1 });
+            level.walls.push_back({ c[3], c[2], height, texture, corridor.b });
+            level.walls.push_back({ c[2], c[0], height, texture, -1 });
+        }
+    }
+    
+    // Start in a corner of the first room, which never has pillars
+    level.hasStart = true;
+    level.start = { rooms[0].minimum + glm::vec2(1.0f), 45.0f };
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Generated level (seed " << settings.seed << "): " << level.sectors.size() << " sectors, "
+              << level.walls.size() << " walls in " << elapsed.count() << " ms" << std::endl;
+    return level;
+}
+
+bool LevelGenerator::ParsePath(const std::string& path, LevelGeneratorSettings& settings) {
+    std::string prefix = PATH_PREFIX;
+    if (path.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    
+    settings = LevelGeneratorSettings();
+    std::istringstream stream(path.substr(prefix.size()));
+    std::string entry;
+    while (std::getline(stream, entry, ',')) {
+        if (entry.empty()) {
+            continue;
+        }
+        size_t equals = entry.find('=');
+        std::string key = entry.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : entry.substr(equals + 1);
+        try {
+            size_t used = 0;
+            if (key == "seed") {
+                settings.seed = static_cast<uint32_t>(std::stoul(value, &used));
+            } else if (key == "walls") {
+                settings.wallCount = std::stoi(value, &used);
+            } else if (key == "sectors") {
+                settings.sectorCount = std::stoi(value, &used);
+            } else if (key == "textures") {
+                settings.textureCount = std::stoi(value, &used);
+            } else if (key == "pillars") {
+                settings.pillarShare = std::stof(value, &used);
+            } else if (key == "open") {
+                settings.openShare = std::stof(value, &used);
+            } else {
+                throw std::runtime_error("Unknown level generator setting '" + key + "' in " + path);
+            }
+            if (used != value.size()) {
+                throw std::invalid_argument(value);
+            }
+        }
+        catch (const std::logic_error&) {
+            throw std::runtime_error("Bad value for level generator setting '" + key + "' in " + path);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "LevelData.h"
+
+// What to generate. Counts are targets: the layout is a grid of rooms, so the
+// result lands near them rather than on them.
+struct LevelGeneratorSettings {
+    uint32_t seed = 1;
+    int wallCount = 1000;       // Pillars are added until the level has about this many walls
+    int sectorCount = 0;        // Rooms and the corridors between them; 0 picks one per 16 walls
+    int textureCount = 3;       // Distinct texture ids, cycling through the stock images
+    float pillarShare = 0.5f;   // Share of ordinary rooms that get pillars
+    float openShare = 0.1f;     // Share of rooms that are large, tall halls, which get more pillars
+};
+
+// Seeded stress levels: rooms on a grid joined by corridors into a maze with
+// a few loops, with stepped floors and square pillars. The same settings
+// always give the same level, whatever the standard library. Builds that fuse
+// multiply-adds (such as -march=native) may round some vertices differently.
+//
+// Levels are requested through a map path, so anything that loads a map can
+// load one:
+//
+//     gen:seed=7,walls=100000,sectors=5000,textures=8,pillars=0.5,open=0.1
+//
+// Every key is optional.
+class LevelGenerator {
+public:
+    static LevelData Generate(const LevelGeneratorSettings& settings);
+    
+    // Returns false if path is not a generator path. Throws std::runtime_error
+    // for unknown keys or bad values.
+    static bool ParsePath(const std::string& path, LevelGeneratorSettings& settings);
+    
+    static constexpr const char* PATH_PREFIX = "gen:";
+};
@@ -0,0 +1,239 @@
+#include "LevelParser.h"
+#include <charconv>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+    // Position in the buffer with line tracking for error messages
+    class Cursor {
+    public:
+        Cursor(const char* begin, const char* end, const std::string& sourceName)
+            : m_Position(begin), m_End(end), m_LineStart(begin), m_TokenStart(begin),
+              m_Line(1), m_SourceName(sourceName) {
+        }
+        
+        bool AtEnd() const { return m_Position >= m_End; }
+        bool AtLineEnd() const { return AtEnd() || *m_Position == '\n'; }
+        
+        // Skip spaces and a trailing comment, stopping at the end of the line
+        void SkipBlanks() {
+            while (!AtEnd() && (*m_Position == ' ' || *m_Position == '\t' || *m_Position == '\r')) {
+                ++m_Position;
+            }
+            if (!AtEnd() && *m_Position == '#') {
+                while (!AtEnd() && *m_Position != '\n') {
+                    ++m_Position;
+                }
+            }
+            m_TokenStart = m_Position;
+        }
+        
+        // Finish a record; anything left on the line is an error
+        void EndLine() {
+            SkipBlanks();
+            if (!AtLineEnd()) {
+                Error("unexpected '" + std::string(Word()) + "' at end of line");
+            }
+            if (!AtEnd()) {
+                ++m_Position;
+                ++m_Line;
+                m_LineStart = m_Position;
+            }
+        }
+        
+        // Next run of non-blank characters on this line
+        std::string_view Word() {
+            SkipBlanks();
+            const char* start = m_Position;
+            while (!AtEnd() && *m_Position != ' ' && *m_Position != '\t' &&
+                   *m_Position != '\r' && *m_Position != '\n' && *m_Position != '#') {
+                ++m_Position;
+            }
+            return std::string_view(start, static_cast<size_t>(m_Position - start));
+        }
+        
+        // Read a required word, naming it in the error if it is missing
+        std::string_view RequireWord(const char* what) {
+            std::string_view word = Word();
+            if (word.empty()) {
+                Error(std::string("expected ") + what);
+            }
+            return word;
+        }
+        
+        template<typename T>
+        T Number(const char* what) {
+            std::string_view word = RequireWord(what);
+            T value{};
+            auto result = std::from_chars(word.data(), word.data() + word.size(), value);
+            if (result.ec != std::errc() || result.ptr != word.data() + word.size()) {
+                Error(std::string("expected ") + what + ", found '" + std::string(word) + "'");
+            }
+            return value;
+        }
+        
+        // Same as Number, and checks first <= value < end
+        int Index(const char* what, int first, int end) {
+            int value = Number<int>(what);
+            if (value < first || value >= end) {
+                Error(std::string(what) + " " + std::to_string(value) + " is out of range");
+            }
+            return value;
+        }
+        
+        [[noreturn]] void Error(const std::string& message) const {
+            throw std::runtime_error(m_SourceName + ":" + std::to_string(m_Line) + ":" +
+                                     std::to_string(m_TokenStart - m_LineStart + 1) + ": " + message);
+        }
+    
+    private:
+        const char* m_Position;
+        const char* m_End;
+        const char* m_LineStart;
+        const char* m_TokenStart;
+        int m_Line;
+        const std::string& m_SourceName;
+    };
+}
+
+LevelData LevelParser::ParseFile(const std::string& path) {
+    std::unique_ptr<FILE, int (*)(FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if (!file) {
+        throw std::runtime_error("Could not open map file: " + path);
+    }
+    
+    // Read the whole file at once; parsing then never touches the stream
+    std::string buffer;
+    if (std::fseek(file.get(), 0, SEEK_END) == 0) {
+        long size = std::ftell(file.get());
+        if (size > 0) {
+            buffer.resize(static_cast<size_t>(size));
+        }
+        std::fseek(file.get(), 0, SEEK_SET);
+    }
+    if (!buffer.empty() && std::fread(&buffer[0], 1, buffer.size(), file.get()) != buffer.size()) {
+        throw std::runtime_error("Could not read map file: " + path);
+    }
+    
+    return Parse(buffer.data(), buffer.data() + buffer.size(), path);
+}
+
+LevelData LevelParser::Parse(const char* begin, const char* end, const std::string& sourceName) {
+    Cursor cursor(begin, end, sourceName);
+    LevelData level;
+    
+    bool haveHeader = false;
+    bool haveCounts = false;
+    size_t textureCount = 0;
+    size_t vertexCount = 0;
+    size_t sectorCount = 0;
+    size_t wallCount = 0;
+    
+    while (!cursor.AtEnd()) {
+        std::string_view keyword = cursor.Word();
+        if (keyword.empty()) {
+            cursor.EndLine();
+            continue;
+        }
+        
+        if (!haveHeader) {
+            if (keyword != "doomlevel") {
+                cursor.Error("expected 'doomlevel' header");
+            }
+            if (cursor.Number<int>("format version") != FORMAT_VERSION) {
+                cursor.Error("unsupported format version");
+            }
+            haveHeader = true;
+        }
+        else if (!haveCounts) {
+            if (keyword != "counts") {
+                cursor.Error("expected 'counts' before any records");
+            }
+            textureCount = cursor.Number<size_t>("texture count");
+            vertexCount = cursor.Number<size_t>("vertex count");
+            sectorCount = cursor.Number<size_t>("sector count");
+            wallCount = cursor.Number<size_t>("wall count");
+            level.textures.reserve(textureCount);
+            level.vertices.reserve(vertexCount);
+            level.sectors.reserve(sectorCount);
+            level.walls.reserve(wallCount);
+            haveCounts = true;
+        }
+        else if (keyword == "texture") {
+            if (level.textures.size() == textureCount) {
+                cursor.Error("more textures than the " + std::to_string(textureCount) + " declared");
+            }
+            level.textures.emplace_back(cursor.RequireWord("texture path"));
+        }
+        else if (keyword == "vertex") {
+            if (level.vertices.size() == vertexCount) {
+                cursor.Error("more vertices than the " + std::to_string(vertexCount) + " declared");
+            }
+            float x = cursor.Number<float>("x coordinate");
+            float z = cursor.Number<float>("z coordinate");
+            level.vertices.emplace_back(x, z);
+        }
+        else if (keyword == "sector") {
+            if (level.sectors.size() == sectorCount) {
+                cursor.Error("more sectors than the " + std::to_string(sectorCount) + " declared");
+            }
+            if (!level.sectors.empty() && level.sectors.back().wallCount !=
+                static_cast<int>(level.walls.size()) - level.sectors.back().firstWall) {
+                cursor.Error("previous sector is missing walls");
+            }
+            LevelSector sector;
+            sector.floorHeight = cursor.Number<float>("floor height");
+            sector.ceilingHeight = cursor.Number<float>("ceiling height");
+            sector.floorTextureId = cursor.Index("floor texture", 0, static_cast<int>(textureCount));
+            sector.ceilingTextureId = cursor.Index("ceiling texture", 0, static_cast<int>(textureCount));
+            sector.firstWall = static_cast<int>(level.walls.size());
+            sector.wallCount = cursor.Number<int>("wall count");
+            if (sector.wallCount < 0 || static_cast<size_t>(sector.firstWall + sector.wallCount) > wallCount) {
+                cursor.Error("sector has more walls than the level declares");
+            }
+            cursor.SkipBlanks();
+            sector.lightLevel = cursor.AtLineEnd() ? 255 : cursor.Index("light level", 0, 256);
+            level.sectors.push_back(sector);
+        }
+        else if (keyword == "wall") {
+            if (level.sectors.empty() || level.sectors.back().firstWall + level.sectors.back().wallCount ==
+                static_cast<int>(level.walls.size())) {
+                cursor.Error("wall does not belong to any sector");
+            }
+            LevelWall wall;
+            wall.startVertex = cursor.Index("start vertex", 0, static_cast<int>(vertexCount));
+            wall.endVertex = cursor.Index("end vertex", 0, static_cast<int>(vertexCount));
+            wall.height = cursor.Number<float>("wall height");
+            wall.textureId = cursor.Index("wall texture", 0, static_cast<int>(textureCount));
+            cursor.SkipBlanks();
+            wall.backSector = cursor.AtLineEnd() ? -1 : cursor.Index("back sector", -1, static_cast<int>(sectorCount));
+            level.walls.push_back(wall);
+        }
+        else if (keyword == "start") {
+            if (level.hasStart) {
+                cursor.Error("more than one start");
+            }
+            level.start.position.x = cursor.Number<float>("x coordinate");
+            level.start.position.y = cursor.Number<float>("z coordinate");
+            level.start.yaw = cursor.Number<float>("yaw");
+            level.hasStart = true;
+        }
+        else {
+            cursor.Error("unknown record '" + std::string(keyword) + "'");
+        }
+        
+        cursor.EndLine();
+    }
+    
+    // Everything the header promised must have been read
+    if (!haveCounts) {
+        cursor.Error("missing 'doomlevel' header or 'counts' line");
+    }
+    if (level.textures.size() != textureCount || level.vertices.size() != vertexCount ||
+        level.sectors.size() != sectorCount || level.walls.size() != wallCount) {
+        cursor.Error("file ends before every declared texture, vertex, sector and wall was read");
+    }
+    return level;
+}
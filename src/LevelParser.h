@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+#include "LevelData.h"
+
+// Reads the text level format in a single pass over the file in memory.
+//
+//     doomlevel 1
+//     counts <textures> <vertices> <sectors> <walls>
+//     texture <path>
+//     vertex <x> <z>
+//     sector <floor> <ceiling> <floorTexture> <ceilingTexture> <wallCount> [<light>]
+//     wall <startVertex> <endVertex> <height> <texture> [<backSector>]
+//     start <x> <z> <yaw>
+//
+// One record per line, '#' starts a comment. The counts line comes first and
+// sizes every array; wall lines belong to the sector line before them. Sector
+// light runs from 0 to 255 and defaults to full bright. The optional start
+// line places the player.
+// Errors are thrown as std::runtime_error with "file:line:column: message".
+class LevelParser {
+public:
+    static LevelData ParseFile(const std::string& path);
+    static LevelData Parse(const char* begin, const char* end, const std::string& sourceName);
+    
+    static constexpr int FORMAT_VERSION = 1;
+};
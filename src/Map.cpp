@@ -1,144 +1,842 @@
 #include "Map.h"
-#include <fstream>
+#include "Hash.h"
+#include "LevelGenerator.h"
+#include "LevelParser.h"
+#include "ThreadPool.h"
+#include "Triangulate.h"
 #include <iostream>
-#include <sstream>
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <type_traits>
+#include <stdexcept>
 
-Map::Map(const std::string& filename) {
+namespace {
+    // Revisions are unique across all maps so a new map never matches a stale one
+    unsigned int nextMapRevision = 1;
+    
+    // Compiled levels store these records byte for byte
+    static_assert(std::is_trivially_copyable<Linedef>::value && std::is_trivially_copyable<Sidedef>::value &&
+                  std::is_trivially_copyable<Aabb>::value &&
+                  std::is_trivially_copyable<BspNode>::value && std::is_trivially_copyable<AabbTree::Node>::value &&
+                  std::is_trivially_copyable<LevelStart>::value && std::is_trivially_copyable<BlockmapGrid>::value,
+                  "compiled level records must be plain data");
+    
+    float Cross(const glm::vec2& a, const glm::vec2& b) {
+        return a.x * b.y - a.y * b.x;
+    }
+    
+    float SegmentDistanceSquared(const glm::vec2& point, const glm::vec2& start, const glm::vec2& end) {
+        glm::vec2 direction = end - start;
+        float lengthSquared = glm::dot(direction, direction);
+        float t = lengthSquared > 0.0f ? glm::clamp(glm::dot(point - start, direction) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+        glm::vec2 offset = point - (start + direction * t);
+        return glm::dot(offset, offset);
+    }
+    
+    // Clip the segment to the box one axis at a time; true if anything is left
+    bool SegmentTouchesBox(const glm::vec2& start, const glm::vec2& end, const glm::vec2& minimum, const glm::vec2& maximum) {
+        glm::vec2 direction = end - start;
+        float enter = 0.0f;
+        float exit = 1.0f;
+        for (int axis = 0; axis < 2; ++axis) {
+            if (direction[axis] == 0.0f) {
+                if (start[axis] < minimum[axis] || start[axis] > maximum[axis]) {
+                    return false;
+                }
+                continue;
+            }
+            float near = (minimum[axis] - start[axis]) / direction[axis];
+            float far = (maximum[axis] - start[axis]) / direction[axis];
+            if (near > far) {
+                std::swap(near, far);
+            }
+            enter = std::max(enter, near);
+            exit = std::min(exit, far);
+            if (enter > exit) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Fraction along start..end at which it crosses the line, if it does. Parallel lines never cross.
+    bool SegmentCrossesLine(const glm::vec2& start, const glm::vec2& end, const glm::vec2& lineStart,
+                            const glm::vec2& lineEnd, float& fraction) {
+        glm::vec2 direction = end - start;
+        glm::vec2 lineDirection = lineEnd - lineStart;
+        float denominator = Cross(direction, lineDirection);
+        if (denominator == 0.0f) {
+            return false;
+        }
+        glm::vec2 offset = lineStart - start;
+        float t = Cross(offset, lineDirection) / denominator;
+        float u = Cross(offset, direction) / denominator;
+        if (t < 0.0f || t > 1.0f || u < 0.0f || u > 1.0f) {
+            return false;
+        }
+        fraction = t;
+        return true;
+    }
+}
+
+Map::Map(const std::string& filename)
+    : m_HasStart(false), m_Start(), m_Revision(nextMapRevision++), m_WallCount(0) {
+    // Generated levels are made afresh from their settings, and nothing is cached for them
+    LevelGeneratorSettings settings;
+    if (LevelGenerator::ParsePath(filename, settings)) {
+        Build(LevelGenerator::Generate(settings), "");
+        return;
+    }
+    
+    // A compiled level can be given directly
+    if (m_Compiled.Open(filename) && LoadCompiled()) {
+        return;
+    }
+    
+    LevelData level;
+    bool parsed = false;
+    uint64_t sourceHash = 0;
+    std::string compiledPath = filename + ".lvl";
     try {
-        LoadMap(filename);
+        MappedFile source;
+        if (!source.Open(filename)) {
+            throw std::runtime_error("Could not open map file: " + filename);
+        }
+        
+        // Use the compiled copy if it was built from this exact text
+        sourceHash = HashBytes(HASH_SEED, source.GetData(), source.GetSize());
+        if (m_Compiled.Open(compiledPath) && m_Compiled.GetSourceHash() == sourceHash && LoadCompiled()) {
+            return;
+        }
+        m_Compiled.Close();
+        
+        auto start = std::chrono::steady_clock::now();
+        const char* text = reinterpret_cast<const char*>(source.GetData());
+        level = LevelParser::Parse(text, text + source.GetSize(), filename);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << "Parsed " << filename << ": " << level.sectors.size() << " sectors, "
+                  << level.walls.size() << " walls in " << elapsed.count() << " ms" << std::endl;
+        parsed = true;
     }
     catch (const std::exception& e) {
         std::cerr << "Error loading map: " << e.what() << std::endl;
         std::cerr << "Falling back to test map." << std::endl;
-        CreateTestMap();
+        level = CreateTestMap();
+    }
+    
+    Build(level, filename + ".pvs");
+    if (parsed) {
+        SaveCompiled(compiledPath, sourceHash);
     }
 }
 
-void Map::LoadMap(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open map file: " + filename);
-    }
-    
-    // For our prototype, we'll just create a simple map
-    // In a real game, we would parse the level data from the file
-    CreateTestMap();
+Map::Map(const LevelData& level)
+    : m_HasStart(false), m_Start(), m_Revision(nextMapRevision++), m_WallCount(0) {
+    Build(level, "");
+}
+
+void Map::Build(const LevelData& level, const std::string& pvsCachePath) {
+    LoadLevel(level);
+    OrientWalls();
+    LinkSectors();
+    TriangulateSectors();
+    BuildSectorGrid();
+    BuildBlockmap();
+    BuildSpatialIndex();
+    BuildVisibility(pvsCachePath);
+}
+
+void Map::LoadLevel(const LevelData& level) {
+    m_Textures = level.textures;
+    m_HasStart = level.hasStart;
+    m_Start = level.start;
+    m_VertexStorage = level.vertices;
     
-    // Initialize collision grid
-    m_Width = 20;
-    m_Height = 20;
-    m_CollisionGrid.resize(m_Width, std::vector<bool>(m_Height, false));
+    // Walls are numbered in sector order, so each sector's walls must follow the previous sector's
+    int sectorCount = static_cast<int>(level.sectors.size());
+    m_SidedefStorage.clear();
+    m_SidedefStorage.reserve(level.walls.size());
+    m_LinedefStorage.clear();
+    m_LinedefStorage.reserve(level.walls.size());
+    m_SectorFirstWallStorage.resize(level.sectors.size());
     
-    // Set collision for walls
-    for (const auto& sector : m_Sectors) {
-        for (const auto& wall : sector.walls) {
-            // Simplified collision grid - mark the grid cells occupied by walls
-            int startX = static_cast<int>(wall.start.x);
-            int startZ = static_cast<int>(wall.start.y);
-            int endX = static_cast<int>(wall.end.x);
-            int endZ = static_cast<int>(wall.end.y);
-            
-            // Ensure within grid bounds
-            startX = std::max(0, std::min(startX, m_Width - 1));
-            startZ = std::max(0, std::min(startZ, m_Height - 1));
-            endX = std::max(0, std::min(endX, m_Width - 1));
-            endZ = std::max(0, std::min(endZ, m_Height - 1));
+    // Portal walls waiting for the wall facing them from the other sector, keyed by
+    // their corners and both sectors in ascending order
+    std::map<std::array<int, 4>, int> unmatched;
+    for (int i = 0; i < sectorCount; ++i) {
+        const LevelSector& sector = level.sectors[i];
+        if (sector.firstWall != static_cast<int>(m_SidedefStorage.size()) ||
+            sector.firstWall + sector.wallCount > static_cast<int>(level.walls.size())) {
+            throw std::runtime_error("Sector " + std::to_string(i) + " walls are not contiguous");
+        }
+        
+        m_SectorFirstWallStorage[i] = sector.firstWall;
+        for (int w = sector.firstWall; w < sector.firstWall + sector.wallCount; ++w) {
+            const LevelWall& wall = level.walls[w];
+            int backSector = wall.backSector;
+            if (backSector >= sectorCount || backSector == i) {
+                std::cerr << "Sector " << i << " wall " << w - sector.firstWall << " has invalid back sector "
+                          << backSector << ", treating it as solid" << std::endl;
+                backSector = -1;
+            }
             
-            // Mark wall cells
-            for (int x = startX; x <= endX; ++x) {
-                for (int z = startZ; z <= endZ; ++z) {
-                    if (x < m_Width && z < m_Height) {
-                        m_CollisionGrid[x][z] = true;
-                    }
+            int linedef = -1;
+            if (backSector >= 0) {
+                std::array<int, 4> key = { std::min(wall.startVertex, wall.endVertex),
+                                           std::max(wall.startVertex, wall.endVertex),
+                                           std::min(i, backSector), std::max(i, backSector) };
+                auto partner = unmatched.find(key);
+                if (partner != unmatched.end() && m_SidedefStorage[partner->second].sector == backSector) {
+                    linedef = m_SidedefStorage[partner->second].linedef;
+                    m_LinedefStorage[linedef].backSide = w;
+                    unmatched.erase(partner);
+                } else {
+                    unmatched.emplace(key, w);
                 }
             }
+            if (linedef < 0) {
+                linedef = static_cast<int>(m_LinedefStorage.size());
+                m_LinedefStorage.push_back({ wall.startVertex, wall.endVertex, w, -1 });
+            }
+            m_SidedefStorage.push_back({ linedef, i, wall.height, wall.textureId });
         }
     }
+    
+    // A portal needs a wall on both sides; without one the opening cannot be entered from behind
+    for (const auto& entry : unmatched) {
+        const Sidedef& side = m_SidedefStorage[entry.second];
+        std::cerr << "Sector " << side.sector << " wall " << entry.second - m_SectorFirstWallStorage[side.sector]
+                  << " has no matching wall in sector " << (entry.first[2] == side.sector ? entry.first[3] : entry.first[2])
+                  << ", treating it as solid" << std::endl;
+    }
+    
+    m_Vertices = m_VertexStorage;
+    m_Linedefs = m_LinedefStorage;
+    m_Sidedefs = m_SidedefStorage;
+    m_SectorFirstWall = m_SectorFirstWallStorage;
+    m_WallCount = static_cast<int>(m_Sidedefs.size());
+    
+    // Storage no longer grows, so sectors can point into it
+    m_Sectors.clear();
+    m_Sectors.reserve(level.sectors.size());
+    for (const auto& sector : level.sectors) {
+        m_Sectors.push_back({ WallView(m_Vertices.data(), m_Linedefs.data(), m_Sidedefs.data(),
+                                       sector.firstWall, sector.wallCount),
+                              sector.floorHeight, sector.ceilingHeight,
+                              sector.floorTextureId, sector.ceilingTextureId, sector.lightLevel,
+                              ArrayView<int>(), ArrayView<int>() });
+    }
 }
 
-void Map::CreateTestMap() {
-    // Create a simple test map: a room with 4 walls
-    Sector room;
-    room.floorHeight = 0.0f;
-    room.ceilingHeight = 3.0f;
-    room.floorTextureId = 0;
-    room.ceilingTextureId = 0;
+bool Map::LoadCompiled() {
+    auto start = std::chrono::steady_clock::now();
+    ArrayView<char> textures;
+    ArrayView<CompiledSector> sectors;
+    ArrayView<uint32_t> bspRoot;
+    ArrayView<AabbTree::Node> wallTreeNodes, sectorTreeNodes;
+    ArrayView<int> wallTreeItems, sectorTreeItems;
+    ArrayView<Aabb> wallTreeItemBounds, sectorTreeItemBounds;
+    ArrayView<BspNode> bspNodes;
+    ArrayView<BspSeg> bspSegs;
+    ArrayView<BspSubsector> bspSubsectors;
+    ArrayView<uint32_t> pvsRowOffsets;
+    ArrayView<uint8_t> pvsData;
+    ArrayView<LevelStart> levelStart;
+    ArrayView<BlockmapGrid> blockmapGrid;
+    ArrayView<uint32_t> blockmapCellOffsets;
+    ArrayView<int> blockmapCellLines;
+    ArrayView<uint64_t> rejectBits;
+    const CompiledLevel& file = m_Compiled;
+    bool found = file.GetSection(LevelSection::Textures, textures) &&
+                 file.GetSection(LevelSection::Start, levelStart) &&
+                 file.GetSection(LevelSection::Sectors, sectors) &&
+                 file.GetSection(LevelSection::Vertices, m_Vertices) &&
+                 file.GetSection(LevelSection::Linedefs, m_Linedefs) &&
+                 file.GetSection(LevelSection::Sidedefs, m_Sidedefs) &&
+                 file.GetSection(LevelSection::SectorPortals, m_SectorPortals) &&
+                 file.GetSection(LevelSection::SectorTriangles, m_SectorTriangles) &&
+                 file.GetSection(LevelSection::SectorFirstWalls, m_SectorFirstWall) &&
+                 file.GetSection(LevelSection::WallBounds, m_WallBounds) &&
+                 file.GetSection(LevelSection::SectorBounds, m_SectorBounds) &&
+                 file.GetSection(LevelSection::WallTreeNodes, wallTreeNodes) &&
+                 file.GetSection(LevelSection::WallTreeItems, wallTreeItems) &&
+                 file.GetSection(LevelSection::WallTreeItemBounds, wallTreeItemBounds) &&
+                 file.GetSection(LevelSection::SectorTreeNodes, sectorTreeNodes) &&
+                 file.GetSection(LevelSection::SectorTreeItems, sectorTreeItems) &&
+                 file.GetSection(LevelSection::SectorTreeItemBounds, sectorTreeItemBounds) &&
+                 file.GetSection(LevelSection::BspNodes, bspNodes) &&
+                 file.GetSection(LevelSection::BspSegs, bspSegs) &&
+                 file.GetSection(LevelSection::BspSubsectors, bspSubsectors) &&
+                 file.GetSection(LevelSection::BspRoot, bspRoot) &&
+                 file.GetSection(LevelSection::PvsRowOffsets, pvsRowOffsets) &&
+                 file.GetSection(LevelSection::PvsData, pvsData) &&
+                 file.GetSection(LevelSection::BlockmapGrid, blockmapGrid) &&
+                 file.GetSection(LevelSection::BlockmapCellOffsets, blockmapCellOffsets) &&
+                 file.GetSection(LevelSection::BlockmapCellLines, blockmapCellLines) &&
+                 file.GetSection(LevelSection::RejectBits, rejectBits);
     
-    // Add walls (rectangle)
-    // Wall 1: bottom
-    room.walls.push_back({
-        glm::vec2(0.0f, 0.0f),     // start (x, z)
-        glm::vec2(10.0f, 0.0f),    // end (x, z)
-        3.0f,                       // height
-        0                           // textureId
-    });
+    // Texture names are needed before the checks, to bound the texture ids
+    std::vector<std::string> textureNames;
+    for (const char* name = textures.begin(); name < textures.end(); name += textureNames.back().size() + 1) {
+        textureNames.emplace_back(name, strnlen(name, static_cast<size_t>(textures.end() - name)));
+    }
+    int textureCount = static_cast<int>(textureNames.size());
     
-    // Wall 2: right
-    room.walls.push_back({
-        glm::vec2(10.0f, 0.0f),    // start (x, z)
-        glm::vec2(10.0f, 10.0f),   // end (x, z)
-        3.0f,                       // height
-        1                           // textureId
-    });
+    // The hash already rules out damage, so only check that the arrays agree with each other
+    size_t wallCount = m_Sidedefs.size();
+    bool consistent = found && bspRoot.size() == 1 && levelStart.size() <= 1 &&
+                      m_WallBounds.size() == wallCount && m_SectorFirstWall.size() == sectors.size() &&
+                      m_SectorBounds.size() == sectors.size() &&
+                      (pvsRowOffsets.empty() || m_Pvs.Assign(static_cast<int>(sectors.size()), pvsRowOffsets, pvsData)) &&
+                      blockmapGrid.size() <= 1 &&
+                      m_Blockmap.Assign(blockmapGrid.empty() ? BlockmapGrid() : blockmapGrid[0],
+                                        blockmapCellOffsets, blockmapCellLines, m_Linedefs.size()) &&
+                      (rejectBits.empty() || m_Reject.Assign(static_cast<int>(sectors.size()), rejectBits));
+    for (size_t i = 0; consistent && i < sectors.size(); ++i) {
+        const CompiledSector& sector = sectors[i];
+        consistent = sector.firstWall >= 0 && sector.wallCount >= 0 &&
+                     static_cast<size_t>(sector.firstWall) + sector.wallCount <= wallCount &&
+                     sector.firstPortal >= 0 && sector.portalCount >= 0 &&
+                     static_cast<size_t>(sector.firstPortal) + sector.portalCount <= m_SectorPortals.size() &&
+                     sector.firstTriangle >= 0 && sector.triangleCount >= 0 &&
+                     (static_cast<size_t>(sector.firstTriangle) + sector.triangleCount) * 3 <= m_SectorTriangles.size() &&
+                     sector.floorTextureId >= 0 && sector.floorTextureId < textureCount &&
+                     sector.ceilingTextureId >= 0 && sector.ceilingTextureId < textureCount;
+        
+        // Portals are wall numbers within the sector
+        for (int p = 0; consistent && p < sector.portalCount; ++p) {
+            int wall = m_SectorPortals[sector.firstPortal + p];
+            consistent = wall >= 0 && wall < sector.wallCount;
+        }
+    }
+    for (size_t i = 0; consistent && i < m_Linedefs.size(); ++i) {
+        const Linedef& line = m_Linedefs[i];
+        consistent = line.startVertex >= 0 && static_cast<size_t>(line.startVertex) < m_Vertices.size() &&
+                     line.endVertex >= 0 && static_cast<size_t>(line.endVertex) < m_Vertices.size() &&
+                     line.frontSide >= 0 && static_cast<size_t>(line.frontSide) < wallCount &&
+                     line.backSide >= -1 && line.backSide < static_cast<int>(wallCount);
+    }
+    for (size_t i = 0; consistent && i < m_SectorTriangles.size(); ++i) {
+        consistent = m_SectorTriangles[i] >= 0 && static_cast<size_t>(m_SectorTriangles[i]) < m_Vertices.size();
+    }
+    for (size_t i = 0; consistent && i < wallCount; ++i) {
+        const Sidedef& side = m_Sidedefs[i];
+        consistent = side.linedef >= 0 && static_cast<size_t>(side.linedef) < m_Linedefs.size() &&
+                     side.sector >= 0 && static_cast<size_t>(side.sector) < sectors.size() &&
+                     side.textureId >= 0 && side.textureId < textureCount;
+    }
     
-    // Wall 3: top
-    room.walls.push_back({
-        glm::vec2(10.0f, 10.0f),   // start (x, z)
-        glm::vec2(0.0f, 10.0f),    // end (x, z)
-        3.0f,                       // height
-        0                           // textureId
-    });
+    // The trees are walked without bounds checks, so their child links are checked as they are assigned
+    consistent = consistent &&
+                 m_WallTree.Assign(wallTreeNodes, wallTreeItems, wallTreeItemBounds, wallCount) &&
+                 m_SectorTree.Assign(sectorTreeNodes, sectorTreeItems, sectorTreeItemBounds, sectors.size()) &&
+                 m_Bsp.Assign(bspNodes, bspSegs, bspSubsectors, bspRoot[0], wallCount, sectors.size());
+    if (!consistent) {
+        std::cerr << "Compiled level does not match this build, reloading from text" << std::endl;
+        m_Compiled.Close();
+        m_Vertices = ArrayView<glm::vec2>();
+        m_Linedefs = ArrayView<Linedef>();
+        m_Sidedefs = ArrayView<Sidedef>();
+        m_SectorPortals = ArrayView<int>();
+        m_SectorTriangles = ArrayView<int>();
+        m_SectorFirstWall = ArrayView<int>();
+        m_WallBounds = ArrayView<Aabb>();
+        m_SectorBounds = ArrayView<Aabb>();
+        m_Pvs.Clear();
+        m_Blockmap.Clear();
+        m_Reject.Clear();
+        m_WallTree.Clear();
+        m_SectorTree.Clear();
+        m_Bsp.Clear();
+        return false;
+    }
     
-    // Wall 4: left
-    room.walls.push_back({
-        glm::vec2(0.0f, 10.0f),    // start (x, z)
-        glm::vec2(0.0f, 0.0f),     // end (x, z)
-        3.0f,                       // height
-        1                           // textureId
-    });
+    m_WallCount = static_cast<int>(wallCount);
+    m_HasStart = !levelStart.empty();
+    m_Start = m_HasStart ? levelStart[0] : LevelStart();
+    m_Textures = std::move(textureNames);
+    
+    m_Sectors.clear();
+    m_Sectors.reserve(sectors.size());
+    for (const auto& sector : sectors) {
+        m_Sectors.push_back({ WallView(m_Vertices.data(), m_Linedefs.data(), m_Sidedefs.data(),
+                                       sector.firstWall, sector.wallCount),
+                              sector.floorHeight, sector.ceilingHeight,
+                              sector.floorTextureId, sector.ceilingTextureId, sector.lightLevel,
+                              m_SectorPortals.Slice(sector.firstPortal, sector.portalCount),
+                              m_SectorTriangles.Slice(sector.firstTriangle * 3, sector.triangleCount * 3) });
+    }
+    
+    BuildSectorGrid();
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Loaded compiled level: " << m_Sectors.size() << " sectors, " << m_WallCount << " walls, "
+              << m_Compiled.GetSize() << " bytes in " << elapsed.count() / 1000.0 << " ms" << std::endl;
+    return true;
+}
+
+bool Map::SaveCompiled(const std::string& path, uint64_t sourceHash) const {
+    std::vector<CompiledSector> sectors;
+    sectors.reserve(m_Sectors.size());
+    for (size_t i = 0; i < m_Sectors.size(); ++i) {
+        const Sector& sector = m_Sectors[i];
+        sectors.push_back({ sector.floorHeight, sector.ceilingHeight, sector.floorTextureId, sector.ceilingTextureId,
+                            m_SectorFirstWall[i], static_cast<int>(sector.walls.size()),
+                            static_cast<int>(sector.portals.data() - m_SectorPortals.data()),
+                            static_cast<int>(sector.portals.size()),
+                            static_cast<int>(sector.triangles.data() - m_SectorTriangles.data()) / 3,
+                            static_cast<int>(sector.triangles.size() / 3), sector.lightLevel });
+    }
+    
+    std::vector<char> textures;
+    for (const auto& texture : m_Textures) {
+        textures.insert(textures.end(), texture.begin(), texture.end());
+        textures.push_back('\0');
+    }
+    uint32_t bspRoot = m_Bsp.GetRoot();
+    
+    CompiledLevelWriter writer;
+    writer.AddSection(LevelSection::Textures, ArrayView<char>(textures));
+    writer.AddSection(LevelSection::Start, ArrayView<LevelStart>(&m_Start, m_HasStart ? 1 : 0));
+    writer.AddSection(LevelSection::Sectors, ArrayView<CompiledSector>(sectors));
+    writer.AddSection(LevelSection::Vertices, m_Vertices);
+    writer.AddSection(LevelSection::Linedefs, m_Linedefs);
+    writer.AddSection(LevelSection::Sidedefs, m_Sidedefs);
+    writer.AddSection(LevelSection::SectorPortals, m_SectorPortals);
+    writer.AddSection(LevelSection::SectorTriangles, m_SectorTriangles);
+    writer.AddSection(LevelSection::SectorFirstWalls, m_SectorFirstWall);
+    writer.AddSection(LevelSection::WallBounds, m_WallBounds);
+    writer.AddSection(LevelSection::SectorBounds, m_SectorBounds);
+    writer.AddSection(LevelSection::WallTreeNodes, m_WallTree.GetNodes());
+    writer.AddSection(LevelSection::WallTreeItems, m_WallTree.GetItems());
+    writer.AddSection(LevelSection::WallTreeItemBounds, m_WallTree.GetItemBounds());
+    writer.AddSection(LevelSection::SectorTreeNodes, m_SectorTree.GetNodes());
+    writer.AddSection(LevelSection::SectorTreeItems, m_SectorTree.GetItems());
+    writer.AddSection(LevelSection::SectorTreeItemBounds, m_SectorTree.GetItemBounds());
+    writer.AddSection(LevelSection::BspNodes, m_Bsp.GetNodes());
+    writer.AddSection(LevelSection::BspSegs, m_Bsp.GetSegs());
+    writer.AddSection(LevelSection::BspSubsectors, m_Bsp.GetSubsectors());
+    writer.AddSection(LevelSection::BspRoot, ArrayView<uint32_t>(&bspRoot, 1));
+    writer.AddSection(LevelSection::PvsRowOffsets, m_Pvs.GetRowOffsets());
+    writer.AddSection(LevelSection::PvsData, m_Pvs.GetData());
+    BlockmapGrid blockmapGrid = m_Blockmap.GetGrid();
+    writer.AddSection(LevelSection::BlockmapGrid, ArrayView<BlockmapGrid>(&blockmapGrid, m_Blockmap.IsEmpty() ? 0 : 1));
+    writer.AddSection(LevelSection::BlockmapCellOffsets, m_Blockmap.GetCellOffsets());
+    writer.AddSection(LevelSection::BlockmapCellLines, m_Blockmap.GetCellLines());
+    writer.AddSection(LevelSection::RejectBits, m_Reject.GetBits());
+    return writer.Write(path, sourceHash);
+}
+
+void Map::BuildBlockmap() {
+    std::vector<BlockmapLine> lines;
+    lines.reserve(m_Linedefs.size());
+    for (const auto& line : m_Linedefs) {
+        lines.push_back({ m_Vertices[line.startVertex], m_Vertices[line.endVertex] });
+    }
+    m_Blockmap.Build(lines, BLOCKMAP_CELL_SIZE);
+}
+
+void Map::BuildSectorGrid() {
+    std::vector<SectorTriangle> triangles;
+    triangles.reserve(m_SectorTriangles.size() / 3);
+    for (size_t i = 0; i < m_Sectors.size(); ++i) {
+        ArrayView<int> corners = m_Sectors[i].triangles;
+        for (size_t j = 0; j + 2 < corners.size(); j += 3) {
+            triangles.push_back({ m_Vertices[corners[j]], m_Vertices[corners[j + 1]], m_Vertices[corners[j + 2]],
+                                  static_cast<int>(i) });
+        }
+    }
+    m_SectorGrid.Build(triangles, SECTOR_GRID_CELL_SIZE);
+}
+
+LevelData Map::CreateTestMap() {
+    // Create a simple test map: a room with a pillar, and a doorway on its
+    // right side leading into a second, raised room
+    LevelData level;
+    level.textures = {
+        // Wall textures
+        "resources/wall1.jpg",
+        "resources/wall2.png",
+        
+        // Floor texture
+        "resources/floor.jpg"
+    };
+    
+    level.vertices = {
+        // Room corners, with the doorway at x = 10 between z = 4 and z = 6
+        glm::vec2(0.0f, 0.0f), glm::vec2(10.0f, 0.0f), glm::vec2(10.0f, 4.0f),
+        glm::vec2(10.0f, 6.0f), glm::vec2(10.0f, 10.0f), glm::vec2(0.0f, 10.0f),
+        
+        // Pillar in the middle of the room
+        glm::vec2(4.0f, 4.0f), glm::vec2(6.0f, 4.0f), glm::vec2(6.0f, 6.0f), glm::vec2(4.0f, 6.0f),
+        
+        // Far end of the doorway
+        glm::vec2(12.0f, 4.0f), glm::vec2(12.0f, 6.0f),
+        
+        // Second room
+        glm::vec2(12.0f, 2.0f), glm::vec2(19.0f, 2.0f), glm::vec2(19.0f, 8.0f), glm::vec2(12.0f, 8.0f)
+    };
+    
+    auto addSector = [&level](float floorHeight, float ceilingHeight, std::initializer_list<LevelWall> walls) {
+        level.sectors.push_back({ floorHeight, ceilingHeight, 2, 2,
+                                  static_cast<int>(level.walls.size()), static_cast<int>(walls.size()) });
+        level.walls.insert(level.walls.end(), walls);
+    };
     
-    // Add a pillar in the middle
-    room.walls.push_back({
-        glm::vec2(4.0f, 4.0f),     // start (x, z)
-        glm::vec2(6.0f, 4.0f),     // end (x, z)
-        3.0f,                       // height
-        2                           // textureId
+    // Room: start vertex, end vertex, height, texture, back sector
+    addSector(0.0f, 3.0f, {
+        { 0, 1, 3.0f, 0, -1 }, { 1, 2, 3.0f, 1, -1 }, { 2, 3, 3.0f, 1, 1 }, { 3, 4, 3.0f, 1, -1 },
+        { 4, 5, 3.0f, 0, -1 }, { 5, 0, 3.0f, 1, -1 },
+        { 6, 7, 3.0f, 2, -1 }, { 7, 8, 3.0f, 2, -1 }, { 8, 9, 3.0f, 2, -1 }, { 9, 6, 3.0f, 2, -1 }
     });
     
-    room.walls.push_back({
-        glm::vec2(6.0f, 4.0f),     // start (x, z)
-        glm::vec2(6.0f, 6.0f),     // end (x, z)
-        3.0f,                       // height
-        2                           // textureId
+    // Doorway: a short, low passage between the two rooms
+    addSector(0.0f, 2.2f, {
+        { 2, 10, 2.2f, 0, -1 }, { 10, 11, 2.2f, 1, 2 }, { 11, 3, 2.2f, 0, -1 }, { 3, 2, 2.2f, 1, 0 }
     });
     
-    room.walls.push_back({
-        glm::vec2(6.0f, 6.0f),     // start (x, z)
-        glm::vec2(4.0f, 6.0f),     // end (x, z)
-        3.0f,                       // height
-        2                           // textureId
+    // Second room, one step up from the doorway
+    addSector(0.4f, 3.6f, {
+        { 12, 13, 3.2f, 0, -1 }, { 13, 14, 3.2f, 1, -1 }, { 14, 15, 3.2f, 0, -1 },
+        { 15, 11, 3.2f, 1, -1 }, { 11, 10, 3.2f, 1, 1 }, { 10, 12, 3.2f, 1, -1 }
     });
     
-    room.walls.push_back({
-        glm::vec2(4.0f, 6.0f),     // start (x, z)
-        glm::vec2(4.0f, 4.0f),     // end (x, z)
-        3.0f,                       // height
-        2                           // textureId
+    // Start in the first room, facing -z
+    level.hasStart = true;
+    level.start = { glm::vec2(2.0f, 2.0f), -90.0f };
+    
+    return level;
+}
+
+void Map::OrientWalls() {
+    // Flipping a line turns both of its sides, so only the front side needs checking
+    for (auto& line : m_LinedefStorage) {
+        glm::vec2 start = m_VertexStorage[line.startVertex];
+        glm::vec2 end = m_VertexStorage[line.endVertex];
+        glm::vec2 direction = end - start;
+        float length = glm::length(direction);
+        if (length <= 0.0f) {
+            continue;
+        }
+        
+        // Probe just to the left of the line's midpoint
+        glm::vec2 left(-direction.y / length, direction.x / length);
+        glm::vec2 probe = (start + end) * 0.5f + left * std::min(0.01f, length * 0.1f);
+        if (!IsPointInSector(m_SidedefStorage[line.frontSide].sector, probe.x, probe.y)) {
+            std::swap(line.startVertex, line.endVertex);
+        }
+    }
+}
+
+void Map::LinkSectors() {
+    // Collect every sector's portals into one array, then point the sectors at their runs
+    std::vector<int> firstPortal(m_Sectors.size() + 1, 0);
+    m_SectorPortalStorage.clear();
+    for (size_t i = 0; i < m_Sectors.size(); ++i) {
+        firstPortal[i] = static_cast<int>(m_SectorPortalStorage.size());
+        for (size_t w = 0; w < m_Sectors[i].walls.size(); ++w) {
+            if (GetOppositeWall(m_SectorFirstWall[i] + static_cast<int>(w)) >= 0) {
+                m_SectorPortalStorage.push_back(static_cast<int>(w));
+            }
+        }
+    }
+    firstPortal[m_Sectors.size()] = static_cast<int>(m_SectorPortalStorage.size());
+    
+    m_SectorPortals = m_SectorPortalStorage;
+    for (size_t i = 0; i < m_Sectors.size(); ++i) {
+        m_Sectors[i].portals = m_SectorPortals.Slice(firstPortal[i], firstPortal[i + 1] - firstPortal[i]);
+    }
+}
+
+void Map::TriangulateSectors() {
+    auto start = std::chrono::steady_clock::now();
+    
+    // Each sector is independent, so chunks of them fill their own lists
+    std::vector<std::vector<int>> sectorTriangles(m_Sectors.size());
+    std::vector<uint8_t> failed(m_Sectors.size(), 0);
+    auto triangulateRange = [&](size_t begin, size_t end) {
+        std::vector<std::pair<int, int>> edges;
+        for (size_t i = begin; i < end; ++i) {
+            edges.clear();
+            int firstWall = m_SectorFirstWall[i];
+            for (int wall = firstWall; wall < firstWall + static_cast<int>(m_Sectors[i].walls.size()); ++wall) {
+                const Linedef& line = m_Linedefs[m_Sidedefs[wall].linedef];
+                if (line.frontSide == wall) {
+                    edges.emplace_back(line.startVertex, line.endVertex);
+                } else {
+                    edges.emplace_back(line.endVertex, line.startVertex);
+                }
+            }
+            failed[i] = !TriangulateRegion(m_Vertices, edges, sectorTriangles[i]);
+        }
+    };
+    ThreadPool::GetShared().ParallelFor(m_Sectors.size(), 16, triangulateRange);
+    
+    m_SectorTriangleStorage.clear();
+    std::vector<size_t> firstIndex(m_Sectors.size() + 1, 0);
+    for (size_t i = 0; i < m_Sectors.size(); ++i) {
+        firstIndex[i] = m_SectorTriangleStorage.size();
+        m_SectorTriangleStorage.insert(m_SectorTriangleStorage.end(), sectorTriangles[i].begin(), sectorTriangles[i].end());
+        if (failed[i]) {
+            std::cerr << "Sector " << i << " outline is not closed, its floor may have gaps" << std::endl;
+        }
+    }
+    firstIndex[m_Sectors.size()] = m_SectorTriangleStorage.size();
+    
+    m_SectorTriangles = m_SectorTriangleStorage;
+    for (size_t i = 0; i < m_Sectors.size(); ++i) {
+        m_Sectors[i].triangles = m_SectorTriangles.Slice(firstIndex[i], firstIndex[i + 1] - firstIndex[i]);
+    }
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Triangulated " << m_Sectors.size() << " sectors into " << m_SectorTriangles.size() / 3
+              << " triangles in " << elapsed.count() / 1000.0 << " ms" << std::endl;
+}
+
+bool Map::IsPointInSector(int sector, float x, float z) const {
+    // Count crossings of a ray towards +x; holes such as pillars cancel out
+    bool inside = false;
+    for (const auto& wall : m_Sectors[sector].walls) {
+        const glm::vec2& a = wall.start;
+        const glm::vec2& b = wall.end;
+        if ((a.y > z) != (b.y > z)) {
+            float crossX = a.x + (z - a.y) * (b.x - a.x) / (b.y - a.y);
+            if (x < crossX) {
+                inside = !inside;
+            }
+        }
+    }
+    return inside;
+}
+
+void Map::BuildSpatialIndex() {
+    // Walls rise from their sector's floor (openings span the whole sector); sectors span floor to ceiling
+    std::vector<Aabb>& wallBounds = m_WallBoundStorage;
+    std::vector<Aabb>& sectorBounds = m_SectorBoundStorage;
+    wallBounds.clear();
+    sectorBounds.assign(m_Sectors.size(), Aabb());
+    wallBounds.reserve(m_WallCount);
+    for (size_t i = 0; i < m_Sectors.size(); ++i) {
+        const Sector& sector = m_Sectors[i];
+        for (const auto& wall : sector.walls) {
+            float top = wall.backSector >= 0 ? sector.ceilingHeight : sector.floorHeight + wall.height;
+            Aabb box;
+            box.Expand(glm::vec3(wall.start.x, sector.floorHeight, wall.start.y));
+            box.Expand(glm::vec3(wall.end.x, top, wall.end.y));
+            wallBounds.push_back(box);
+            sectorBounds[i].Expand(box);
+        }
+        if (sector.walls.empty()) {
+            continue;
+        }
+        sectorBounds[i].Expand(glm::vec3(sectorBounds[i].min.x, sector.floorHeight, sectorBounds[i].min.z));
+        sectorBounds[i].Expand(glm::vec3(sectorBounds[i].max.x, sector.ceilingHeight, sectorBounds[i].max.z));
+    }
+    
+    m_WallBounds = wallBounds;
+    m_SectorBounds = sectorBounds;
+    m_WallTree.Build(wallBounds);
+    m_SectorTree.Build(sectorBounds);
+    
+    // BSP over all walls, each starting as a single seg
+    std::vector<BspSeg> segs;
+    segs.reserve(m_WallCount);
+    for (size_t i = 0; i < m_Sectors.size(); ++i) {
+        int wallIndex = m_SectorFirstWall[i];
+        for (const auto& wall : m_Sectors[i].walls) {
+            segs.push_back({ wall.start, wall.end, wallIndex++, static_cast<int>(i) });
+        }
+    }
+    m_Bsp.Build(segs);
+}
+
+size_t Map::FindLinesInBox(const glm::vec2& minimum, const glm::vec2& maximum, std::vector<int>& lines) const {
+    size_t first = lines.size();
+    m_Blockmap.QueryBox(minimum, maximum, lines);
+    auto outside = [&](int index) {
+        const Linedef& line = m_Linedefs[index];
+        return !SegmentTouchesBox(m_Vertices[line.startVertex], m_Vertices[line.endVertex], minimum, maximum);
+    };
+    lines.erase(std::remove_if(lines.begin() + first, lines.end(), outside), lines.end());
+    return lines.size() - first;
+}
+
+size_t Map::FindLinesInRadius(const glm::vec2& center, float radius, std::vector<int>& lines) const {
+    size_t first = lines.size();
+    m_Blockmap.QueryRadius(center, radius, lines);
+    auto outside = [&](int index) {
+        const Linedef& line = m_Linedefs[index];
+        return SegmentDistanceSquared(center, m_Vertices[line.startVertex], m_Vertices[line.endVertex]) > radius * radius;
+    };
+    lines.erase(std::remove_if(lines.begin() + first, lines.end(), outside), lines.end());
+    return lines.size() - first;
+}
+
+bool Map::TraceLine(const glm::vec2& start, const glm::vec2& end, LineHit& hit, bool solidOnly) const {
+    // Cells come nearest first, so once the best hit lies in the cell just
+    // searched no later cell can hold a nearer one
+    const BlockmapGrid& grid = m_Blockmap.GetGrid();
+    hit.linedef = -1;
+    hit.fraction = 2.0f;
+    m_Blockmap.ForEachCellOnRay(start, end, [&](int x, int z) {
+        for (int index : m_Blockmap.GetCellLines(x, z)) {
+            const Linedef& line = m_Linedefs[index];
+            float fraction;
+            if ((!solidOnly || line.backSide < 0) && SegmentCrossesLine(start, end, m_Vertices[line.startVertex],
+                                                                        m_Vertices[line.endVertex], fraction) &&
+                fraction < hit.fraction) {
+                hit.linedef = index;
+                hit.fraction = fraction;
+            }
+        }
+        if (hit.linedef < 0) {
+            return true;
+        }
+        glm::vec2 cellMin = grid.origin + glm::vec2(x, z) * grid.cellSize;
+        glm::vec2 point = start + (end - start) * hit.fraction;
+        return glm::any(glm::lessThan(point, cellMin)) || glm::any(glm::greaterThan(point, cellMin + grid.cellSize));
+    });
+    if (hit.linedef < 0) {
+        return false;
+    }
+    hit.point = start + (end - start) * hit.fraction;
+    return true;
+}
+
+bool Map::IsCircleBlocked(const glm::vec2& center, float radius) const {
+    // Lines in several cells may be tested more than once, which is cheaper than tracking them
+    float radiusSquared = radius * radius;
+    return !m_Blockmap.ForEachCellInBox(center - glm::vec2(radius), center + glm::vec2(radius), [&](int x, int z) {
+        for (int index : m_Blockmap.GetCellLines(x, z)) {
+            const Linedef& line = m_Linedefs[index];
+            if (line.backSide < 0 &&
+                SegmentDistanceSquared(center, m_Vertices[line.startVertex], m_Vertices[line.endVertex]) <= radiusSquared) {
+                return false;
+            }
+        }
+        return true;
     });
+}
+
+bool Map::HasLineOfSight(const glm::vec2& from, int fromSector, const glm::vec2& to, int toSector) const {
+    if (!MightSee(fromSector, toSector)) {
+        return false;
+    }
+    LineHit hit;
+    return !TraceLine(from, to, hit);
+}
+
+int Map::GetOppositeWall(int index) const {
+    const Linedef& line = m_Linedefs[m_Sidedefs[index].linedef];
+    return line.frontSide == index ? line.backSide : line.frontSide;
+}
+
+bool Map::IsWallSolid(int index) const {
+    const Wall& wall = GetWall(index);
+    if (wall.backSector < 0) {
+        return true;
+    }
+    const Sector& front = m_Sectors[m_Sidedefs[index].sector];
+    const Sector& back = m_Sectors[wall.backSector];
+    return std::max(front.floorHeight, back.floorHeight) >= std::min(front.ceilingHeight, back.ceilingHeight);
+}
+
+void Map::BuildVisibility(const std::string& cachePath) {
+    // Every two-sided wall is a portal from its sector into the one behind it
+    std::vector<PvsPortal> portals;
+    for (size_t i = 0; i < m_Sectors.size(); ++i) {
+        for (const auto& wall : m_Sectors[i].walls) {
+            if (wall.backSector >= 0) {
+                portals.push_back({ wall.start, wall.end, static_cast<int>(i), wall.backSector });
+            }
+        }
+    }
     
-    m_Sectors.push_back(room);
+    int sectorCount = static_cast<int>(m_Sectors.size());
+    uint64_t checksum = Pvs::ComputeChecksum(sectorCount, portals);
+    if (cachePath.empty() || !m_Pvs.Load(cachePath, checksum)) {
+        auto start = std::chrono::steady_clock::now();
+        m_Pvs.Build(sectorCount, portals, &ThreadPool::GetShared());
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << "Computed PVS for " << sectorCount << " sectors and " << portals.size() << " portals in "
+                  << elapsed.count() << " ms (" << m_Pvs.GetCompressedSize() << " bytes)" << std::endl;
+        
+        if (!cachePath.empty()) {
+            m_Pvs.Save(cachePath, checksum);
+        }
+    }
+    
+    // Sight between sectors needs the same openings as rendering, so reject what the PVS rules out
+    m_Reject.Build(m_Pvs, &ThreadPool::GetShared());
 }
 
-bool Map::IsWallAt(float x, float z) const {
-    // Convert world coordinates to grid coordinates
-    int gridX = static_cast<int>(x);
-    int gridZ = static_cast<int>(z);
+int Map::FindSector(float x, float z) const {
+    // Triangles only miss points outside the map, in gaps left by outlines
+    // that did not close, or exactly between two triangles after rounding
+    int sector = m_SectorGrid.FindSector(glm::vec2(x, z));
+    if (sector >= 0) {
+        return sector;
+    }
+    
+    // The BSP leaf names a candidate; confirm it, since the point may be in a hole or outside the map
+    const BspTree& bsp = m_Bsp;
+    if (!bsp.IsEmpty()) {
+        sector = bsp.GetSubsectors()[bsp.FindSubsector(glm::vec2(x, z))].sector;
+        if (sector >= 0 && IsPointInSector(sector, x, z)) {
+            return sector;
+        }
+    }
     
-    // Check bounds
-    if (gridX < 0 || gridX >= m_Width || gridZ < 0 || gridZ >= m_Height) {
-        return true; // Consider out-of-bounds as walls
+    // With floors to search, a point on none of them is outside the map
+    if (!m_SectorGrid.IsEmpty()) {
+        return -1;
+    }
+    for (size_t i = 0; i < m_Sectors.size(); ++i) {
+        if (IsPointInSector(static_cast<int>(i), x, z)) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void Map::FindSectors(ArrayView<glm::vec2> points, int* sectors) const {
+    m_SectorGrid.FindSectors(points, sectors);
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (sectors[i] < 0) {
+            sectors[i] = FindSector(points[i].x, points[i].y);
+        }
+    }
+}
+
+bool Map::FindOpening(const glm::vec2& center, float radius, float& floorHeight, float& ceilingHeight) const {
+    int sector = FindSector(center.x, center.y);
+    if (sector < 0) {
+        return false;
     }
+    floorHeight = m_Sectors[sector].floorHeight;
+    ceilingHeight = m_Sectors[sector].ceilingHeight;
     
-    return m_CollisionGrid[gridX][gridZ];
+    // One-sided lines block the circle outright, so only openings can narrow the gap
+    float radiusSquared = radius * radius;
+    m_Blockmap.ForEachCellInBox(center - glm::vec2(radius), center + glm::vec2(radius), [&](int x, int z) {
+        for (int index : m_Blockmap.GetCellLines(x, z)) {
+            const Linedef& line = m_Linedefs[index];
+            if (line.backSide < 0 ||
+                SegmentDistanceSquared(center, m_Vertices[line.startVertex], m_Vertices[line.endVertex]) > radiusSquared) {
+                continue;
+            }
+            for (int side : { line.frontSide, line.backSide }) {
+                const Sector& other = m_Sectors[m_Sidedefs[side].sector];
+                floorHeight = std::max(floorHeight, other.floorHeight);
+                ceilingHeight = std::min(ceilingHeight, other.ceilingHeight);
+            }
+        }
+        return true;
+    });
+    return true;
 }
\ No newline at end of file
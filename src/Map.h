@@ -4,42 +4,299 @@
 #include <string>
 #include <glm/glm-master/glm-master/glm/glm.hpp>
 
-// Define a wall segment
+#include "AabbTree.h"
+#include "ArrayView.h"
+#include "Blockmap.h"
+#include "Bsp.h"
+#include "CompiledLevel.h"
+#include "LevelData.h"
+#include "Pvs.h"
+#include "Reject.h"
+#include "SectorGrid.h"
+
+// Edge between two shared vertices. After loading, the front side's sector
+// is on its left when walking from start to end.
+struct Linedef {
+    int startVertex;
+    int endVertex;
+    int frontSide;      // Sidedef index
+    int backSide;       // Sidedef index for two-sided lines (portals), else -1
+};
+
+// One face of a linedef, as seen from its sector. Sidedefs are stored in
+// sector order, so a sidedef's index is also its wall index.
+struct Sidedef {
+    int linedef;
+    int sector;
+    float height;       // Wall height
+    int textureId;      // Texture ID to use
+};
+
+// Define a wall segment: a sidedef with its line's end points, oriented so
+// the wall's sector is on its left side when walking from start to end
 struct Wall {
     glm::vec2 start;    // Start point (x, z)
     glm::vec2 end;      // End point (x, z)
     float height;       // Wall height
     int textureId;      // Texture ID to use
+    int backSector = -1;    // Sector on the right for two-sided walls (portals), else -1
+};
+
+// Where a traced segment first meets a line
+struct LineHit {
+    int linedef;
+    float fraction;     // Along the traced segment, 0 at its start and 1 at its end
+    glm::vec2 point;
+};
+
+// A run of sidedefs, read as Walls assembled on the fly
+class WallView {
+public:
+    class Iterator {
+    public:
+        Iterator(const WallView* view, size_t index) : m_View(view), m_Index(index) {}
+        Wall operator*() const { return (*m_View)[m_Index]; }
+        Iterator& operator++() { ++m_Index; return *this; }
+        bool operator==(const Iterator& other) const { return m_Index == other.m_Index; }
+        bool operator!=(const Iterator& other) const { return m_Index != other.m_Index; }
+    
+    private:
+        const WallView* m_View;
+        size_t m_Index;
+    };
+    
+    WallView() : m_Vertices(nullptr), m_Linedefs(nullptr), m_Sidedefs(nullptr), m_First(0), m_Size(0) {}
+    
+    // Walls [first, first + size) of the level's sidedefs
+    WallView(const glm::vec2* vertices, const Linedef* linedefs, const Sidedef* sidedefs, int first, size_t size)
+        : m_Vertices(vertices), m_Linedefs(linedefs), m_Sidedefs(sidedefs), m_First(first), m_Size(size) {}
+    
+    size_t size() const { return m_Size; }
+    bool empty() const { return m_Size == 0; }
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, m_Size); }
+    
+    // Back sides run the line the other way, so their sector is on the left too
+    Wall operator[](size_t index) const {
+        int sideIndex = m_First + static_cast<int>(index);
+        const Sidedef& side = m_Sidedefs[sideIndex];
+        const Linedef& line = m_Linedefs[side.linedef];
+        Wall wall;
+        wall.height = side.height;
+        wall.textureId = side.textureId;
+        if (line.frontSide == sideIndex) {
+            wall.start = m_Vertices[line.startVertex];
+            wall.end = m_Vertices[line.endVertex];
+            wall.backSector = line.backSide >= 0 ? m_Sidedefs[line.backSide].sector : -1;
+        } else {
+            wall.start = m_Vertices[line.endVertex];
+            wall.end = m_Vertices[line.startVertex];
+            wall.backSector = m_Sidedefs[line.frontSide].sector;
+        }
+        return wall;
+    }
+
+private:
+    const glm::vec2* m_Vertices;
+    const Linedef* m_Linedefs;
+    const Sidedef* m_Sidedefs;
+    int m_First;
+    size_t m_Size;
 };
 
-// Define a sector (room)
+// Define a sector (room). walls and portals view the map's flat arrays.
 struct Sector {
-    std::vector<Wall> walls;
+    WallView walls;
     float floorHeight;
     float ceilingHeight;
     int floorTextureId;
     int ceilingTextureId;
+    int lightLevel;             // 0 (black) to 255 (full bright)
+    ArrayView<int> portals;     // Indices into walls of the two-sided ones
+    ArrayView<int> triangles;   // Floor and ceiling shape: vertex index triples, counterclockwise in (x, z)
 };
 
 class Map {
 public:
+    // Size of a blockmap cell in world units (128 Doom units)
+    static constexpr float BLOCKMAP_CELL_SIZE = 4.0f;
+    
+    // Size of a point location cell in world units
+    static constexpr float SECTOR_GRID_CELL_SIZE = 2.0f;
+    
+    // Loads a compiled level, or a text level. A text level is compiled to
+    // filename + ".lvl" and later loads use that file until the text changes.
+    // Paths starting with "gen:" generate a level instead; see LevelGenerator.
     Map(const std::string& filename);
     
+    // Build from level data already in memory, such as an imported WAD map, without caching anything
+    explicit Map(const LevelData& level);
+    
+    // A room with a pillar and a doorway into a second room; loaded when a level file
+    // cannot be read, and a known shape for tests
+    static LevelData CreateTestMap();
+    
+    // Sectors view arrays owned by the map, so it is not copied
+    Map(const Map&) = delete;
+    Map& operator=(const Map&) = delete;
+    
     // Query methods
     const std::vector<Sector>& GetSectors() const { return m_Sectors; }
-    bool IsWallAt(float x, float z) const;
+    const std::vector<std::string>& GetTextures() const { return m_Textures; }
+    
+    // Exact line queries narrowed by the blockmap. Lines are linedef indices,
+    // one-sided and two-sided alike, each reported once in ascending order;
+    // the functions return how many they appended.
+    size_t FindLinesInBox(const glm::vec2& minimum, const glm::vec2& maximum, std::vector<int>& lines) const;
+    size_t FindLinesInRadius(const glm::vec2& center, float radius, std::vector<int>& lines) const;
+    
+    // Nearest line crossed going from start to end, or only the nearest
+    // one-sided line with solidOnly. Returns false if nothing is hit.
+    bool TraceLine(const glm::vec2& start, const glm::vec2& end, LineHit& hit, bool solidOnly = true) const;
+    
+    // Whether a circle overlaps any one-sided line, for moving bodies
+    bool IsCircleBlocked(const glm::vec2& center, float radius) const;
+    
+    // Walls are numbered 0..GetWallCount()-1 in sector order; a sector's walls
+    // start at GetSectorFirstWall(sector)
+    int GetWallCount() const { return m_WallCount; }
+    int GetSectorFirstWall(int sector) const { return m_SectorFirstWall[sector]; }
+    Wall GetWall(int index) const { return GetWalls()[index]; }
+    int GetWallSector(int index) const { return m_Sidedefs[index].sector; }
     
+    // Every wall in the level, in wall index order
+    WallView GetWalls() const {
+        return WallView(m_Vertices.data(), m_Linedefs.data(), m_Sidedefs.data(), 0, m_Sidedefs.size());
+    }
+    
+    // Normalized geometry: shared corners, lines, and one sidedef per wall
+    ArrayView<glm::vec2> GetVertices() const { return m_Vertices; }
+    ArrayView<Linedef> GetLinedefs() const { return m_Linedefs; }
+    ArrayView<Sidedef> GetSidedefs() const { return m_Sidedefs; }
+    
+    // The wall facing this one across its line, in the sector behind it; -1 for one-sided walls
+    int GetOppositeWall(int index) const;
+    
+    // One-sided walls, and openings closed off by their floors and ceilings, block sight
+    bool IsWallSolid(int index) const;
+    
+    // World-space boxes of single walls and sectors, by index
+    const Aabb& GetWallBounds(int index) const { return m_WallBounds[index]; }
+    const Aabb& GetSectorBounds(int sector) const { return m_SectorBounds[sector]; }
+    
+    // Bounding-volume hierarchies built at load; items are wall and sector indices
+    const AabbTree& GetWallTree() const { return m_WallTree; }
+    const AabbTree& GetSectorTree() const { return m_SectorTree; }
+    
+    // BSP tree over wall segments for front-to-back traversal and point location
+    const BspTree& GetBsp() const { return m_Bsp; }
+    
+    // Grid of the linedefs passing through each cell
+    const Blockmap& GetBlockmap() const { return m_Blockmap; }
+    
+    // Exact even-odd test against the sector's walls (outline and holes)
+    bool IsPointInSector(int sector, float x, float z) const;
+    
+    // Sector containing a point, or -1 if it is outside every sector. The floor
+    // triangles under the point answer first, falling back to the BSP leaf.
+    int FindSector(float x, float z) const;
+    
+    // Locate many points at once, such as every moving body on a tick; sectors receives one sector or -1 per point
+    void FindSectors(ArrayView<glm::vec2> points, int* sectors) const;
+    
+    // Highest floor and lowest ceiling a circle stands under: its center's sector
+    // and the sectors on both sides of two-sided lines it overlaps, as in Doom.
+    // Returns false if the center is outside every sector.
+    bool FindOpening(const glm::vec2& center, float radius, float& floorHeight, float& ceilingHeight) const;
+    
+    // Sector-to-sector visibility through two-sided walls, cached next to the map file
+    const Pvs& GetPvs() const { return m_Pvs; }
+    
+    // Constant-time sight rejection: false means nothing in one sector can see
+    // anything in the other, so no sight trace between them is needed
+    bool MightSee(int fromSector, int toSector) const { return m_Reject.MightSee(fromSector, toSector); }
+    const RejectTable& GetRejectTable() const { return m_Reject; }
+    
+    // Sight check for AI: the reject table first, then a trace against one-sided lines
+    bool HasLineOfSight(const glm::vec2& from, int fromSector, const glm::vec2& to, int toSector) const;
+    
+    // Player start from the level file
+    bool HasStart() const { return m_HasStart; }
+    const LevelStart& GetStart() const { return m_Start; }
+    
+    // Changes whenever the level geometry changes, so cached GPU data can be rebuilt
+    unsigned int GetRevision() const { return m_Revision; }
+    
+    // Write everything derived at load, so the level can be loaded without processing.
+    // sourceHash identifies the text level it came from.
+    bool SaveCompiled(const std::string& path, uint64_t sourceHash) const;
+
 private:
     std::vector<Sector> m_Sectors;
-    int m_Width;
-    int m_Height;
+    ArrayView<glm::vec2> m_Vertices;
+    ArrayView<Linedef> m_Linedefs;
+    ArrayView<Sidedef> m_Sidedefs;
+    ArrayView<int> m_SectorPortals;
+    ArrayView<int> m_SectorTriangles;
+    std::vector<std::string> m_Textures;
+    bool m_HasStart;
+    LevelStart m_Start;
+    unsigned int m_Revision;
+    
+    // Wall numbering and spatial index
+    int m_WallCount;
+    ArrayView<int> m_SectorFirstWall;
+    ArrayView<Aabb> m_WallBounds;
+    ArrayView<Aabb> m_SectorBounds;
+    AabbTree m_WallTree;
+    AabbTree m_SectorTree;
+    BspTree m_Bsp;
+    Blockmap m_Blockmap;
+    Pvs m_Pvs;
+    RejectTable m_Reject;
+    
+    // The arrays above view either these, built from a parsed level, or the compiled level
+    std::vector<glm::vec2> m_VertexStorage;
+    std::vector<Linedef> m_LinedefStorage;
+    std::vector<Sidedef> m_SidedefStorage;
+    std::vector<int> m_SectorPortalStorage;
+    std::vector<int> m_SectorTriangleStorage;
+    std::vector<int> m_SectorFirstWallStorage;
+    std::vector<Aabb> m_WallBoundStorage;
+    std::vector<Aabb> m_SectorBoundStorage;
+    CompiledLevel m_Compiled;
+    
+    // Floor triangles by cell, for point location
+    SectorGrid m_SectorGrid;
+    
+    // Take over a parsed level: one sidedef per wall, and one linedef per
+    // one-sided wall or per pair of walls facing each other across a portal
+    void LoadLevel(const LevelData& level);
+    
+    // Derive everything from a level; the PVS is cached at pvsCachePath unless it is empty
+    void Build(const LevelData& level, const std::string& pvsCachePath);
+    
+    // View the open compiled level's arrays; false if sections are missing or inconsistent
+    bool LoadCompiled();
+    
+    // Flip lines whose front sector is on their right so every sector is on the left
+    void OrientWalls();
+    
+    // List each sector's two-sided walls as its portals
+    void LinkSectors();
+    
+    // Fill each sector's outline, holes included, with triangles; sectors are done in parallel
+    void TriangulateSectors();
+    
+    // List the lines passing through each blockmap cell
+    void BuildBlockmap();
     
-    // For simplified collision detection
-    std::vector<std::vector<bool>> m_CollisionGrid;
+    // File the sectors' floor triangles into cells for FindSector
+    void BuildSectorGrid();
     
-    // Load map from file
-    void LoadMap(const std::string& filename);
+    // Build the bounding-volume hierarchies and BSP tree
+    void BuildSpatialIndex();
     
-    // Create a simple test map (used when file loading fails)
-    void CreateTestMap();
+    // Load the PVS from cachePath, or compute it and write the cache, then derive the reject table
+    void BuildVisibility(const std::string& cachePath);
 };
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The contents stay valid until
+// the object is closed or destroyed.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    // Returns false if the file is missing or cannot be mapped
+    bool Open(const std::string& path);
+    void Close();
+    
+    bool IsOpen() const { return m_Data != nullptr; }
+    const unsigned char* GetData() const { return m_Data; }
+    size_t GetSize() const { return m_Size; }
+
+private:
+    const unsigned char* m_Data = nullptr;
+    size_t m_Size = 0;
+
+#ifdef _WIN32
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#endif
+};
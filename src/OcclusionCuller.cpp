@@ -0,0 +1,391 @@
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // Clip-space w below this is treated as behind the eye
+    const float NEAR_W = 1e-3f;
+    
+    // Rows per parallel band; below this many triangles threading isn't worth it
+    const int BAND_HEIGHT = 16;
+    const size_t PARALLEL_TRIANGLES = 64;
+    
+    float EdgeFunction(const glm::vec3& a, const glm::vec3& b, float x, float y) {
+        return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+    }
+    
+    // Keep the part of a convex polygon where distance(v) >= 0, writing up to count + 1 vertices
+    template<typename Distance>
+    int ClipPolygon(const glm::vec4* input, int count, glm::vec4* output, Distance distance) {
+        int outputCount = 0;
+        for (int i = 0; i < count; ++i) {
+            const glm::vec4& current = input[i];
+            const glm::vec4& next = input[(i + 1) % count];
+            float currentDistance = distance(current);
+            float nextDistance = distance(next);
+            bool currentIn = currentDistance >= 0.0f;
+            bool nextIn = nextDistance >= 0.0f;
+            
+            if (currentIn) {
+                output[outputCount++] = current;
+            }
+            if (currentIn != nextIn) {
+                float t = currentDistance / (currentDistance - nextDistance);
+                output[outputCount++] = current + (next - current) * t;
+            }
+        }
+        return outputCount;
+    }
+    
+    // Edge functions e(x, y) = a * x + b * y + c, non-negative inside a counter-clockwise
+    // triangle, and window depth z(x, y) = za * x + zb * y + zc. Both kernels evaluate
+    // these the same way at every pixel, so they write identical depth.
+    struct TrianglePlanes {
+        float a[3];
+        float b[3];
+        float c[3];
+        float za;
+        float zb;
+        float zc;
+    };
+    
+    TrianglePlanes SetupPlanes(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float area) {
+        TrianglePlanes planes;
+        const glm::vec3* from[3] = { &v1, &v2, &v0 };
+        const glm::vec3* to[3] = { &v2, &v0, &v1 };
+        for (int i = 0; i < 3; ++i) {
+            planes.a[i] = -(to[i]->y - from[i]->y);
+            planes.b[i] = to[i]->x - from[i]->x;
+            planes.c[i] = -(planes.a[i] * from[i]->x + planes.b[i] * from[i]->y);
+        }
+        
+        // Depth is z0 + e1 * (z1 - z0) / area + e2 * (z2 - z0) / area
+        float inverseArea = 1.0f / area;
+        float dz1 = (v1.z - v0.z) * inverseArea;
+        float dz2 = (v2.z - v0.z) * inverseArea;
+        planes.za = planes.a[1] * dz1 + planes.a[2] * dz2;
+        planes.zb = planes.b[1] * dz1 + planes.b[2] * dz2;
+        planes.zc = planes.c[1] * dz1 + planes.c[2] * dz2 + v0.z;
+        return planes;
+    }
+}
+
+OcclusionCuller::OcclusionCuller(ThreadPool* pool)
+    : m_Pool(pool), m_SimdEnabled(IsSimdAvailable()), m_ViewProjection(1.0f) {
+    int width = WIDTH;
+    int height = HEIGHT;
+    for (;;) {
+        m_LevelSizes.push_back(glm::ivec2(width, height));
+        m_Levels.emplace_back(static_cast<size_t>(width) * height, 1.0f);
+        if (width == 1 && height == 1) {
+            break;
+        }
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+}
+
+bool OcclusionCuller::IsSimdAvailable() {
+#ifdef OCCLUSION_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+void OcclusionCuller::Begin(const glm::mat4& viewProjection) {
+    m_ViewProjection = viewProjection;
+    m_Triangles.clear();
+    
+    for (auto& level : m_Levels) {
+        std::fill(level.begin(), level.end(), 1.0f);
+    }
+}
+
+void OcclusionCuller::AddOccluder(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d) {
+    glm::vec4 clipA = m_ViewProjection * glm::vec4(a, 1.0f);
+    glm::vec4 clipB = m_ViewProjection * glm::vec4(b, 1.0f);
+    glm::vec4 clipC = m_ViewProjection * glm::vec4(c, 1.0f);
+    glm::vec4 clipD = m_ViewProjection * glm::vec4(d, 1.0f);
+    
+    AddTriangle(clipA, clipB, clipC);
+    AddTriangle(clipA, clipC, clipD);
+}
+
+void OcclusionCuller::AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+    // Clip against the near plane (w = NEAR_W) and then the far plane (z = w);
+    // each plane adds at most one vertex
+    glm::vec4 input[3] = { a, b, c };
+    glm::vec4 nearClipped[4];
+    glm::vec4 clipped[5];
+    int count = ClipPolygon(input, 3, nearClipped, [](const glm::vec4& v) { return v.w - NEAR_W; });
+    count = ClipPolygon(nearClipped, count, clipped, [](const glm::vec4& v) { return v.w - v.z; });
+    if (count < 3) {
+        return;
+    }
+    
+    // Project to pixels and window depth. Depth can fall below 0 between w = NEAR_W and the
+    // near plane proper, which only makes the occluder nearer and so stays conservative.
+    glm::vec3 screen[5];
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 ndc = glm::vec3(clipped[i]) / clipped[i].w;
+        screen[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * WIDTH,
+                              (ndc.y * 0.5f + 0.5f) * HEIGHT,
+                              ndc.z * 0.5f + 0.5f);
+    }
+    
+    for (int i = 1; i + 1 < count; ++i) {
+        Triangle triangle = { { screen[0], screen[i], screen[i + 1] } };
+        
+        // Make every triangle counter-clockwise so one edge-function sign means inside
+        if (EdgeFunction(triangle.v[0], triangle.v[1], triangle.v[2].x, triangle.v[2].y) < 0.0f) {
+            std::swap(triangle.v[1], triangle.v[2]);
+        }
+        m_Triangles.push_back(triangle);
+    }
+}
+
+void OcclusionCuller::Rasterize() {
+    int bandCount = (HEIGHT + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    auto rasterizeBands = [this](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; ++band) {
+            int firstRow = static_cast<int>(band) * BAND_HEIGHT;
+            RasterizeRows(firstRow, std::min(firstRow + BAND_HEIGHT, HEIGHT));
+        }
+    };
+    
+    // Bands own disjoint rows, so they can be filled concurrently
+    if (m_Pool && m_Triangles.size() >= PARALLEL_TRIANGLES) {
+        m_Pool->ParallelFor(bandCount, 1, rasterizeBands);
+    } else {
+        rasterizeBands(0, bandCount);
+    }
+    
+    BuildPyramid();
+}
+
+void OcclusionCuller::RasterizeRows(int firstRow, int endRow) {
+    for (const auto& triangle : m_Triangles) {
+        if (m_SimdEnabled) {
+            RasterizeTriangleSimd(triangle, firstRow, endRow);
+        } else {
+            RasterizeTriangleScalar(triangle, firstRow, endRow);
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeTriangleScalar(const Triangle& triangle, int firstRow, int endRow) {
+    const glm::vec3& v0 = triangle.v[0];
+    const glm::vec3& v1 = triangle.v[1];
+    const glm::vec3& v2 = triangle.v[2];
+    
+    float area = EdgeFunction(v0, v1, v2.x, v2.y);
+    if (area <= 0.0f) {
+        return;
+    }
+    
+    // Pixel bounds, sampling at pixel centers
+    int minX = std::max(0, static_cast<int>(std::floor(std::min({ v0.x, v1.x, v2.x }))));
+    int maxX = std::min(WIDTH - 1, static_cast<int>(std::ceil(std::max({ v0.x, v1.x, v2.x }))));
+    int minY = std::max(firstRow, static_cast<int>(std::floor(std::min({ v0.y, v1.y, v2.y }))));
+    int maxY = std::min(endRow - 1, static_cast<int>(std::ceil(std::max({ v0.y, v1.y, v2.y }))));
+    
+    TrianglePlanes planes = SetupPlanes(v0, v1, v2, area);
+    float* depth = m_Levels[0].data();
+    for (int y = minY; y <= maxY; ++y) {
+        float py = y + 0.5f;
+        float row0 = planes.b[0] * py + planes.c[0];
+        float row1 = planes.b[1] * py + planes.c[1];
+        float row2 = planes.b[2] * py + planes.c[2];
+        float rowZ = planes.zb * py + planes.zc;
+        for (int x = minX; x <= maxX; ++x) {
+            float px = x + 0.5f;
+            if (planes.a[0] * px + row0 < 0.0f || planes.a[1] * px + row1 < 0.0f || planes.a[2] * px + row2 < 0.0f) {
+                continue;
+            }
+            
+            float z = planes.za * px + rowZ;
+            float& stored = depth[y * WIDTH + x];
+            stored = std::min(stored, z);
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeTriangleSimd(const Triangle& triangle, int firstRow, int endRow) {
+#ifdef OCCLUSION_SSE2
+    const glm::vec3& v0 = triangle.v[0];
+    const glm::vec3& v1 = triangle.v[1];
+    const glm::vec3& v2 = triangle.v[2];
+    
+    float area = EdgeFunction(v0, v1, v2.x, v2.y);
+    if (area <= 0.0f) {
+        return;
+    }
+    
+    // Same bounds as the scalar path; x is walked from a multiple of 4 and masked to them
+    int firstX = std::max(0, static_cast<int>(std::floor(std::min({ v0.x, v1.x, v2.x }))));
+    int minX = firstX & ~3;
+    int maxX = std::min(WIDTH - 1, static_cast<int>(std::ceil(std::max({ v0.x, v1.x, v2.x }))));
+    int minY = std::max(firstRow, static_cast<int>(std::floor(std::min({ v0.y, v1.y, v2.y }))));
+    int maxY = std::min(endRow - 1, static_cast<int>(std::ceil(std::max({ v0.y, v1.y, v2.y }))));
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+    
+    TrianglePlanes planes = SetupPlanes(v0, v1, v2, area);
+    const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 four = _mm_set1_ps(4.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 a0 = _mm_set1_ps(planes.a[0]);
+    const __m128 a1 = _mm_set1_ps(planes.a[1]);
+    const __m128 a2 = _mm_set1_ps(planes.a[2]);
+    const __m128 za = _mm_set1_ps(planes.za);
+    const __m128 columnMin = _mm_set1_ps(firstX + 0.5f);
+    const __m128 columnMax = _mm_set1_ps(maxX + 0.5f);
+    
+    float* depth = m_Levels[0].data();
+    for (int y = minY; y <= maxY; ++y) {
+        float py = y + 0.5f;
+        const __m128 row0 = _mm_set1_ps(planes.b[0] * py + planes.c[0]);
+        const __m128 row1 = _mm_set1_ps(planes.b[1] * py + planes.c[1]);
+        const __m128 row2 = _mm_set1_ps(planes.b[2] * py + planes.c[2]);
+        const __m128 rowZ = _mm_set1_ps(planes.zb * py + planes.zc);
+        __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(minX)), offsets);
+        
+        float* row = depth + y * WIDTH;
+        for (int x = minX; x <= maxX; x += 4) {
+            // Inside where all three edge functions are non-negative, within the scalar path's columns
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), row0);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), row1);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), row2);
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                       _mm_cmpge_ps(e2, zero));
+            inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(px, columnMin), _mm_cmple_ps(px, columnMax)));
+            if (_mm_movemask_ps(inside)) {
+                __m128 z = _mm_add_ps(_mm_mul_ps(za, px), rowZ);
+                __m128 stored = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(stored, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, stored)));
+            }
+            px = _mm_add_ps(px, four);
+        }
+    }
+#else
+    RasterizeTriangleScalar(triangle, firstRow, endRow);
+#endif
+}
+
+void OcclusionCuller::BuildPyramid() {
+    for (size_t level = 1; level < m_Levels.size(); ++level) {
+        if (m_SimdEnabled) {
+            DownsampleSimd(static_cast<int>(level));
+        } else {
+            DownsampleScalar(static_cast<int>(level));
+        }
+    }
+}
+
+void OcclusionCuller::DownsampleScalar(int level) {
+    const glm::ivec2 sourceSize = m_LevelSizes[level - 1];
+    const glm::ivec2 size = m_LevelSizes[level];
+    const float* source = m_Levels[level - 1].data();
+    float* target = m_Levels[level].data();
+    
+    for (int y = 0; y < size.y; ++y) {
+        int y0 = std::min(y * 2, sourceSize.y - 1);
+        int y1 = std::min(y * 2 + 1, sourceSize.y - 1);
+        for (int x = 0; x < size.x; ++x) {
+            int x0 = std::min(x * 2, sourceSize.x - 1);
+            int x1 = std::min(x * 2 + 1, sourceSize.x - 1);
+            target[y * size.x + x] = std::max(std::max(source[y0 * sourceSize.x + x0], source[y0 * sourceSize.x + x1]),
+                                              std::max(source[y1 * sourceSize.x + x0], source[y1 * sourceSize.x + x1]));
+        }
+    }
+}
+
+void OcclusionCuller::DownsampleSimd(int level) {
+#ifdef OCCLUSION_SSE2
+    const glm::ivec2 sourceSize = m_LevelSizes[level - 1];
+    const glm::ivec2 size = m_LevelSizes[level];
+    
+    // The vector loop needs both source rows and 8 source columns per step
+    if (sourceSize.x % 8 != 0 || sourceSize.y % 2 != 0) {
+        DownsampleScalar(level);
+        return;
+    }
+    
+    const float* source = m_Levels[level - 1].data();
+    float* target = m_Levels[level].data();
+    for (int y = 0; y < size.y; ++y) {
+        const float* row0 = source + (y * 2) * sourceSize.x;
+        const float* row1 = row0 + sourceSize.x;
+        for (int x = 0; x < size.x; x += 4) {
+            // Vertical max of the two rows, then max of horizontal pairs
+            __m128 lo = _mm_max_ps(_mm_loadu_ps(row0 + x * 2), _mm_loadu_ps(row1 + x * 2));
+            __m128 hi = _mm_max_ps(_mm_loadu_ps(row0 + x * 2 + 4), _mm_loadu_ps(row1 + x * 2 + 4));
+            __m128 even = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(target + y * size.x + x, _mm_max_ps(even, odd));
+        }
+    }
+#else
+    DownsampleScalar(level);
+#endif
+}
+
+bool OcclusionCuller::IsVisible(const Aabb& box) const {
+    // Screen rectangle and nearest depth of the box's corners
+    glm::vec2 screenMin(std::numeric_limits<float>::max());
+    glm::vec2 screenMax(-std::numeric_limits<float>::max());
+    float nearest = 1.0f;
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner((i & 1) ? box.max.x : box.min.x,
+                         (i & 2) ? box.max.y : box.min.y,
+                         (i & 4) ? box.max.z : box.min.z);
+        glm::vec4 clip = m_ViewProjection * glm::vec4(corner, 1.0f);
+        
+        // Boxes reaching behind the eye are always drawn
+        if (clip.w <= NEAR_W) {
+            return true;
+        }
+        
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 pixel((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT);
+        screenMin = glm::min(screenMin, pixel);
+        screenMax = glm::max(screenMax, pixel);
+        nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+    }
+    
+    int minX = std::max(0, static_cast<int>(std::floor(screenMin.x)));
+    int minY = std::max(0, static_cast<int>(std::floor(screenMin.y)));
+    int maxX = std::min(WIDTH - 1, static_cast<int>(std::floor(screenMax.x)));
+    int maxY = std::min(HEIGHT - 1, static_cast<int>(std::floor(screenMax.y)));
+    if (minX > maxX || minY > maxY) {
+        return false; // Off screen
+    }
+    
+    // Coarsest level where the rectangle spans at most 2x2 texels
+    int level = 0;
+    while (level + 1 < static_cast<int>(m_Levels.size()) &&
+           ((maxX >> level) - (minX >> level) > 1 || (maxY >> level) - (minY >> level) > 1)) {
+        ++level;
+    }
+    
+    const glm::ivec2 size = m_LevelSizes[level];
+    const float* depth = m_Levels[level].data();
+    for (int y = minY >> level; y <= std::min(maxY >> level, size.y - 1); ++y) {
+        for (int x = minX >> level; x <= std::min(maxX >> level, size.x - 1); ++x) {
+            if (nearest <= depth[y * size.x + x]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
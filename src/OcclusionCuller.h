@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+#include <vector>
+
+#include "Bounds.h"
+
+class ThreadPool;
+
+// Software occlusion culler: occluder quads are rasterized into a small
+// depth buffer on the CPU, reduced to a hierarchical-Z pyramid, and bounding
+// boxes are tested against it before anything reaches the GL queue.
+//
+// Depth is window depth in [0, 1]; each texel keeps the nearest occluder and
+// each pyramid level keeps the farthest of its four children, so a box is
+// hidden only if it is behind everything in the texels it covers.
+class OcclusionCuller {
+public:
+    static constexpr int WIDTH = 256;
+    static constexpr int HEIGHT = 128;
+    
+    // Rows are rasterized in parallel bands when a pool is given
+    explicit OcclusionCuller(ThreadPool* pool = nullptr);
+    
+    // Start a frame: clear the depth buffer and drop last frame's occluders
+    void Begin(const glm::mat4& viewProjection);
+    
+    // Queue a planar quad (corners in winding order) as an occluder
+    void AddOccluder(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d);
+    
+    // Rasterize all queued occluders and build the pyramid
+    void Rasterize();
+    
+    // False only if the box is certainly hidden behind occluders
+    bool IsVisible(const Aabb& box) const;
+    
+    // Switch between the SIMD kernels and the scalar reference ones
+    void SetSimdEnabled(bool enabled) { m_SimdEnabled = enabled; }
+    static bool IsSimdAvailable();
+    
+    // Full-resolution depth, row-major from the bottom row up
+    const float* GetDepth() const { return m_Levels[0].data(); }
+    size_t GetOccluderCount() const { return m_Triangles.size() / 2; }
+    
+    // Pyramid levels, level 0 being the full-resolution depth
+    int GetLevelCount() const { return static_cast<int>(m_Levels.size()); }
+    const float* GetLevel(int level) const { return m_Levels[level].data(); }
+    const glm::ivec2& GetLevelSize(int level) const { return m_LevelSizes[level]; }
+
+private:
+    // Screen-space triangle ready for rasterization (x, y in pixels, z = depth)
+    struct Triangle {
+        glm::vec3 v[3];
+    };
+    
+    ThreadPool* m_Pool;
+    bool m_SimdEnabled;
+    glm::mat4 m_ViewProjection;
+    std::vector<Triangle> m_Triangles;
+    
+    // Level 0 is WIDTH x HEIGHT, each next level half the size, down to 1x1
+    std::vector<std::vector<float>> m_Levels;
+    std::vector<glm::ivec2> m_LevelSizes;
+    
+    void AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+    void RasterizeRows(int firstRow, int endRow);
+    void RasterizeTriangleScalar(const Triangle& triangle, int firstRow, int endRow);
+    void RasterizeTriangleSimd(const Triangle& triangle, int firstRow, int endRow);
+    void BuildPyramid();
+    void DownsampleScalar(int level);
+    void DownsampleSimd(int level);
+};
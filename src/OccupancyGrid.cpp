@@ -0,0 +1,50 @@
+#include "OccupancyGrid.h"
+#include "GridWalk.h"
+
+void OccupancyGrid::Build(const glm::vec2& minimum, const glm::vec2& maximum, float cellSize) {
+    m_CellSize = cellSize;
+    m_InverseCellSize = 1.0f / cellSize;
+    
+    // Align the origin to the cell size so cell boundaries fall on whole multiples of it
+    glm::vec2 firstCell = glm::floor(minimum * m_InverseCellSize);
+    glm::vec2 lastCell = glm::floor(maximum * m_InverseCellSize);
+    m_Origin = firstCell * cellSize;
+    m_Width = static_cast<unsigned>(lastCell.x - firstCell.x) + 1;
+    m_Height = static_cast<unsigned>(lastCell.y - firstCell.y) + 1;
+    
+    size_t bits = static_cast<size_t>(m_Width) * m_Height;
+    m_Bits.assign((bits + 63) / 64, 0);
+}
+
+void OccupancyGrid::Clear() {
+    m_Bits.clear();
+    m_Width = 0;
+    m_Height = 0;
+}
+
+void OccupancyGrid::Set(int cellX, int cellZ) {
+    if (static_cast<unsigned>(cellX) >= m_Width || static_cast<unsigned>(cellZ) >= m_Height) {
+        return;
+    }
+    size_t bit = static_cast<size_t>(cellZ) * m_Width + cellX;
+    m_Bits[bit >> 6] |= uint64_t(1) << (bit & 63);
+}
+
+void OccupancyGrid::MarkSegment(const glm::vec2& start, const glm::vec2& end) {
+    WalkGridCells((start - m_Origin) * m_InverseCellSize, (end - m_Origin) * m_InverseCellSize, [this](int x, int z) {
+        Set(x, z);
+        return true;
+    });
+}
+
+size_t OccupancyGrid::Query(ArrayView<glm::vec2> points, uint8_t* occupied) const {
+    size_t count = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        uint8_t hit = IsOccupied(points[i].x, points[i].y) ? 1 : 0;
+        if (occupied) {
+            occupied[i] = hit;
+        }
+        count += hit;
+    }
+    return count;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+
+#include "ArrayView.h"
+
+// Square cells over a rectangle of the map, one bit each, stored row by row
+// in a single array. A point belongs to the cell floor((p - origin) / cellSize);
+// points outside the grid count as occupied.
+class OccupancyGrid {
+public:
+    // Cover [minimum, maximum] with empty cells
+    void Build(const glm::vec2& minimum, const glm::vec2& maximum, float cellSize);
+    void Clear();
+    
+    // Mark every cell the segment passes through, including both cells beside
+    // a corner it crosses exactly, so nothing can slip between diagonal steps
+    void MarkSegment(const glm::vec2& start, const glm::vec2& end);
+    
+    bool IsOccupied(float x, float z) const {
+        int cellX = static_cast<int>(std::floor((x - m_Origin.x) * m_InverseCellSize));
+        int cellZ = static_cast<int>(std::floor((z - m_Origin.y) * m_InverseCellSize));
+        
+        // Negative cells wrap around to large unsigned values
+        if (static_cast<unsigned>(cellX) >= m_Width || static_cast<unsigned>(cellZ) >= m_Height) {
+            return true;
+        }
+        size_t bit = static_cast<size_t>(cellZ) * m_Width + cellX;
+        return (m_Bits[bit >> 6] >> (bit & 63)) & 1;
+    }
+    
+    // Test many points at once. occupied, if given, receives 0 or 1 per point;
+    // returns how many points are occupied.
+    size_t Query(ArrayView<glm::vec2> points, uint8_t* occupied = nullptr) const;
+    
+    unsigned GetWidth() const { return m_Width; }
+    unsigned GetHeight() const { return m_Height; }
+    float GetCellSize() const { return m_CellSize; }
+    const glm::vec2& GetOrigin() const { return m_Origin; }
+    size_t GetMemoryUsage() const { return m_Bits.size() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> m_Bits;
+    glm::vec2 m_Origin = glm::vec2(0.0f);
+    float m_CellSize = 1.0f;
+    float m_InverseCellSize = 1.0f;
+    unsigned m_Width = 0;
+    unsigned m_Height = 0;
+    
+    void Set(int cellX, int cellZ);
+};
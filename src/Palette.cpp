@@ -0,0 +1,187 @@
+#include "Palette.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Colors are binned at 5 bits per channel for both the histogram and the nearest-entry table
+    const int BIN_COUNT = 1 << 15;
+    
+    int BinOf(int r, int g, int b) {
+        return (r >> 3) << 10 | (g >> 3) << 5 | (b >> 3);
+    }
+    
+    // Brightness of the darkened copies of every color, and their weight relative to the original
+    const float SHADES[] = { 0.75f, 0.5f, 0.25f, 0.125f };
+    const double SHADE_WEIGHT = 0.25;
+    
+    struct Bin {
+        double weight = 0.0;
+        double sum[3] = { 0.0, 0.0, 0.0 };  // Channels times weight
+        
+        double Average(int axis) const { return sum[axis] / weight; }
+    };
+    
+    struct Box {
+        std::vector<int> bins;
+        double weight;
+        double extent;      // Along axis, between the extreme bin averages
+        int axis;
+    };
+    
+    Box MakeBox(const std::vector<Bin>& histogram, std::vector<int> bins) {
+        Box box = { std::move(bins), 0.0, 0.0, 0 };
+        double low[3] = { 255.0, 255.0, 255.0 };
+        double high[3] = { 0.0, 0.0, 0.0 };
+        for (int index : box.bins) {
+            const Bin& bin = histogram[index];
+            box.weight += bin.weight;
+            for (int axis = 0; axis < 3; ++axis) {
+                low[axis] = std::min(low[axis], bin.Average(axis));
+                high[axis] = std::max(high[axis], bin.Average(axis));
+            }
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            if (high[axis] - low[axis] > box.extent) {
+                box.extent = high[axis] - low[axis];
+                box.axis = axis;
+            }
+        }
+        return box;
+    }
+}
+
+Palette Palette::Build(const std::vector<ArrayView<unsigned char>>& images) {
+    std::vector<Bin> histogram(BIN_COUNT);
+    auto add = [&](double r, double g, double b, double weight) {
+        Bin& bin = histogram[BinOf(static_cast<int>(r + 0.5), static_cast<int>(g + 0.5), static_cast<int>(b + 0.5))];
+        bin.weight += weight;
+        bin.sum[0] += r * weight;
+        bin.sum[1] += g * weight;
+        bin.sum[2] += b * weight;
+    };
+    for (const ArrayView<unsigned char>& pixels : images) {
+        for (size_t i = 0; i + 4 <= pixels.size(); i += 4) {
+            add(pixels[i], pixels[i + 1], pixels[i + 2], 1.0);
+        }
+    }
+    
+    std::vector<int> used;
+    for (int i = 0; i < BIN_COUNT; ++i) {
+        if (histogram[i].weight > 0.0) {
+            used.push_back(i);
+        }
+    }
+    for (int index : used) {
+        Bin original = histogram[index];
+        for (float shade : SHADES) {
+            add(original.Average(0) * shade, original.Average(1) * shade, original.Average(2) * shade,
+                original.weight * SHADE_WEIGHT);
+        }
+    }
+    used.clear();
+    for (int i = 0; i < BIN_COUNT; ++i) {
+        if (histogram[i].weight > 0.0) {
+            used.push_back(i);
+        }
+    }
+    
+    // Keep splitting the box whose colors spread furthest, scaled by how much of the images it covers
+    std::vector<Box> boxes;
+    if (!used.empty()) {
+        boxes.push_back(MakeBox(histogram, std::move(used)));
+    }
+    while (boxes.size() < COLOR_COUNT) {
+        int widest = -1;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            if (boxes[i].bins.size() > 1 &&
+                (widest < 0 || boxes[i].weight * boxes[i].extent > boxes[widest].weight * boxes[widest].extent)) {
+                widest = static_cast<int>(i);
+            }
+        }
+        if (widest < 0) {
+            break;
+        }
+        
+        // Cut at the weighted median along the widest axis, leaving at least one bin on each side
+        Box& box = boxes[widest];
+        int axis = box.axis;
+        std::sort(box.bins.begin(), box.bins.end(), [&](int a, int b) {
+            return histogram[a].Average(axis) < histogram[b].Average(axis);
+        });
+        size_t cut = 1;
+        double below = histogram[box.bins[0]].weight;
+        while (cut + 1 < box.bins.size() && below + histogram[box.bins[cut]].weight <= box.weight * 0.5) {
+            below += histogram[box.bins[cut++]].weight;
+        }
+        std::vector<int> upper(box.bins.begin() + cut, box.bins.end());
+        box.bins.resize(cut);
+        box = MakeBox(histogram, std::move(box.bins));
+        boxes.push_back(MakeBox(histogram, std::move(upper)));
+    }
+    
+    // Each entry is its box's average color; entries past the last box stay black
+    Palette palette;
+    palette.m_Colors.assign(COLOR_COUNT * 3, 0);
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        double sum[3] = { 0.0, 0.0, 0.0 };
+        for (int index : boxes[i].bins) {
+            for (int axis = 0; axis < 3; ++axis) {
+                sum[axis] += histogram[index].sum[axis];
+            }
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            double average = std::clamp(sum[axis] / boxes[i].weight, 0.0, 255.0);
+            palette.m_Colors[i * 3 + axis] = static_cast<unsigned char>(std::lround(average));
+        }
+    }
+    palette.BuildLookups();
+    return palette;
+}
+
+std::vector<unsigned char> Palette::Index(const unsigned char* pixels, int width, int height) const {
+    std::vector<unsigned char> indices(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        const unsigned char* pixel = pixels + i * 4;
+        indices[i] = m_Nearest[BinOf(pixel[0], pixel[1], pixel[2])];
+    }
+    return indices;
+}
+
+void Palette::BuildLookups() {
+    m_Nearest.resize(BIN_COUNT);
+    for (int i = 0; i < BIN_COUNT; ++i) {
+        int r = (i >> 10) << 3 | 4;
+        int g = ((i >> 5) & 31) << 3 | 4;
+        int b = (i & 31) << 3 | 4;
+        m_Nearest[i] = static_cast<unsigned char>(FindNearest(r, g, b));
+    }
+    
+    // Dimming is linear in the light level, as with Doom's colormaps
+    m_Colormap.resize(LIGHT_LEVELS * COLOR_COUNT);
+    for (int row = 0; row < LIGHT_LEVELS; ++row) {
+        float brightness = 1.0f - static_cast<float>(row) / LIGHT_LEVELS;
+        for (int i = 0; i < COLOR_COUNT; ++i) {
+            const unsigned char* color = &m_Colors[i * 3];
+            int r = static_cast<int>(color[0] * brightness + 0.5f);
+            int g = static_cast<int>(color[1] * brightness + 0.5f);
+            int b = static_cast<int>(color[2] * brightness + 0.5f);
+            m_Colormap[row * COLOR_COUNT + i] = m_Nearest[BinOf(r, g, b)];
+        }
+    }
+}
+
+int Palette::FindNearest(int r, int g, int b) const {
+    int nearest = 0;
+    int nearestDistance = -1;
+    for (int i = 0; i < COLOR_COUNT; ++i) {
+        int dr = m_Colors[i * 3] - r;
+        int dg = m_Colors[i * 3 + 1] - g;
+        int db = m_Colors[i * 3 + 2] - b;
+        int distance = dr * dr + dg * dg + db * db;
+        if (nearestDistance < 0 || distance < nearestDistance) {
+            nearest = i;
+            nearestDistance = distance;
+        }
+    }
+    return nearest;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include "ArrayView.h"
+
+// A 256-color palette and the colormap that shades it, like Doom's PLAYPAL and
+// COLORMAP lumps. Row r of the colormap maps each palette index to the entry
+// closest to that color at brightness 1 - r / LIGHT_LEVELS, so row 0 is full
+// bright and the last row is nearly black.
+class Palette {
+public:
+    static constexpr int COLOR_COUNT = 256;
+    static constexpr int LIGHT_LEVELS = 32;
+    
+    // Median-cut palette for the pixels of a set of RGBA images, weighted by how
+    // often each color occurs. Darkened copies of the colors take part at a lower
+    // weight, so the colormap's dim rows have shades to pick from.
+    static Palette Build(const std::vector<ArrayView<unsigned char>>& images);
+    
+    // Nearest palette entry for every pixel of an RGBA image; alpha is ignored
+    std::vector<unsigned char> Index(const unsigned char* pixels, int width, int height) const;
+    
+    // COLOR_COUNT RGB triples
+    const unsigned char* GetColors() const { return m_Colors.data(); }
+    
+    // LIGHT_LEVELS rows of COLOR_COUNT palette indices
+    const unsigned char* GetColormap() const { return m_Colormap.data(); }
+
+private:
+    std::vector<unsigned char> m_Colors;
+    std::vector<unsigned char> m_Colormap;
+    
+    // Nearest entry for each color with 5 bits per channel
+    std::vector<unsigned char> m_Nearest;
+    
+    void BuildLookups();
+    int FindNearest(int r, int g, int b) const;
+};
@@ -3,11 +3,14 @@
 #include <glm\glm-master\glm-master\glm\gtc\matrix_transform.hpp>
 #include <algorithm>
 
-Player::Player(const glm::vec3& position)
-    : m_Position(position),
+Player::Player(const glm::vec3& position, float yaw)
+    : m_Position(position + glm::vec3(0.0f, EYE_HEIGHT, 0.0f)),
       m_Front(glm::vec3(0.0f, 0.0f, -1.0f)),
       m_WorldUp(glm::vec3(0.0f, 1.0f, 0.0f)),
-      m_Yaw(-90.0f), // Default orientation: looking down -Z
+      m_FeetHeight(position.y),
+      m_FallSpeed(0.0f),
+      m_StepOffset(0.0f),
+      m_Yaw(yaw),
       m_Pitch(0.0f),
       m_MovementSpeed(2.5f),
       m_MouseSensitivity(0.1f) {
@@ -16,20 +19,46 @@ Player::Player(const glm::vec3& position)
 }
 
 void Player::Update(float deltaTime, const Map& map) {
-    // This method would handle any per-frame updates for the player
-    // Currently empty as movement is handled in Move method
+    const float gravity = 30.0f;        // Units per second squared
+    const float stepEaseSpeed = 4.0f;   // Units per second the eye catches up after a step
+    
+    // Outside every sector there is nothing to stand on, so stay put
+    float floorHeight;
+    float ceilingHeight;
+    if (!map.FindOpening(glm::vec2(m_Position.x, m_Position.z), RADIUS, floorHeight, ceilingHeight)) {
+        return;
+    }
+    
+    // Step up onto a higher floor at once, moving the eye smoothly; fall onto a lower one
+    if (m_FeetHeight <= floorHeight) {
+        m_StepOffset -= floorHeight - m_FeetHeight;
+        m_FeetHeight = floorHeight;
+        m_FallSpeed = 0.0f;
+    } else {
+        m_FallSpeed += gravity * deltaTime;
+        m_FeetHeight = std::max(m_FeetHeight - m_FallSpeed * deltaTime, floorHeight);
+    }
+    m_StepOffset = std::min(m_StepOffset + stepEaseSpeed * deltaTime, 0.0f);
+    
+    // Keep the head under the ceiling and the eye a little below it, but never under the floor
+    m_FeetHeight = std::max(std::min(m_FeetHeight, ceilingHeight - HEIGHT), floorHeight);
+    const float ceilingClearance = 0.1f;
+    m_Position.y = std::min(m_FeetHeight + EYE_HEIGHT + m_StepOffset, ceilingHeight - ceilingClearance);
 }
 
 void Player::Move(Direction dir, float deltaTime, const Map& map) {
     float velocity = m_MovementSpeed * deltaTime;
     glm::vec3 newPosition = m_Position;
     
+    // Walk along the ground whatever the pitch; Update follows the floor
+    glm::vec3 forward = glm::normalize(glm::vec3(m_Front.x, 0.0f, m_Front.z));
+    
     switch (dir) {
         case FORWARD:
-            newPosition += m_Front * velocity;
+            newPosition += forward * velocity;
             break;
         case BACKWARD:
-            newPosition -= m_Front * velocity;
+            newPosition -= forward * velocity;
             break;
         case LEFT:
             newPosition -= m_Right * velocity;
@@ -76,28 +105,17 @@ void Player::UpdateCameraVectors() {
 }
 
 bool Player::CheckCollision(const glm::vec3& newPosition, const Map& map) const {
-    // Player collision radius (distance from center to edge)
-    const float playerRadius = 0.3f;
-    
-    // Check if the player's new position would collide with a wall
-    // We check multiple points around the player to simulate a collision cylinder
-    
-    // Check center point
-    if (map.IsWallAt(newPosition.x, newPosition.z)) {
+    glm::vec2 center(newPosition.x, newPosition.z);
+    if (map.IsCircleBlocked(center, RADIUS)) {
         return true;
     }
     
-    // Check points around the player (simulating a collision cylinder)
-    for (int i = 0; i < 8; i++) {
-        float angle = i * glm::pi<float>() / 4.0f; // 8 points around the circle
-        float checkX = newPosition.x + playerRadius * cos(angle);
-        float checkZ = newPosition.z + playerRadius * sin(angle);
-        
-        if (map.IsWallAt(checkX, checkZ)) {
-            return true;
-        }
+    // Everything the circle would overlap must leave room to stand, from a floor no higher than a step
+    float floorHeight;
+    float ceilingHeight;
+    if (!map.FindOpening(center, RADIUS, floorHeight, ceilingHeight)) {
+        return true;
     }
-    
-    // No collision detected
-    return false;
+    return floorHeight - m_FeetHeight > MAX_STEP || ceilingHeight - floorHeight < HEIGHT ||
+           ceilingHeight - m_FeetHeight < HEIGHT;
 }
\ No newline at end of file
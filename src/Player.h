@@ -13,15 +13,23 @@ public:
         LEFT,
         RIGHT
     };
-
-    Player(const glm::vec3& position);
+    
+    // Body size in world units (32 Doom units each)
+    static constexpr float RADIUS = 0.3f;
+    static constexpr float HEIGHT = 1.75f;      // Needs this much room between floor and ceiling
+    static constexpr float EYE_HEIGHT = 1.5f;   // Above the feet
+    static constexpr float MAX_STEP = 0.75f;    // Highest floor that can be walked up onto
+    
+    // position is where the feet are; yaw is in degrees, and -90 looks down -Z
+    Player(const glm::vec3& position, float yaw = -90.0f);
     
     void Update(float deltaTime, const Map& map);
     void Move(Direction dir, float deltaTime, const Map& map);
     void Look(float xoffset, float yoffset);
     
-    // Getters
+    // Getters; the position is the eye's
     glm::vec3 GetPosition() const { return m_Position; }
+    float GetFeetHeight() const { return m_FeetHeight; }
     glm::vec3 GetFront() const { return m_Front; }
     glm::vec3 GetRight() const { return m_Right; }
     glm::vec3 GetUp() const { return m_Up; }
@@ -29,7 +37,7 @@ public:
     float GetPitch() const { return m_Pitch; }
     
     glm::mat4 GetViewMatrix() const;
-    
+
 private:
     // Position and orientation
     glm::vec3 m_Position;
@@ -38,6 +46,12 @@ private:
     glm::vec3 m_Right;
     glm::vec3 m_WorldUp;
     
+    // Vertical movement: the feet fall onto the floor below, and the eye eases
+    // up after a step instead of jumping
+    float m_FeetHeight;
+    float m_FallSpeed;
+    float m_StepOffset;
+    
     // Euler angles
     float m_Yaw;
     float m_Pitch;
@@ -49,6 +63,6 @@ private:
     // Update vectors based on Euler angles
     void UpdateCameraVectors();
     
-    // Collision detection with walls
+    // Collision detection with walls, and with floors too high to step onto or ceilings too low to pass under
     bool CheckCollision(const glm::vec3& newPosition, const Map& map) const;
 };
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "PortalCuller.h"
+#include "Map.h"
+#include <algorithm>
+
+namespace {
+    // Closer than this to an opening the camera may be standing in it, and
+    // near-plane clipping could remove it entirely
+    const float STANDING_IN_PORTAL = 0.25f;
+    
+    float DistanceToSegment(const glm::vec2& point, const glm::vec2& start, const glm::vec2& end) {
+        glm::vec2 direction = end - start;
+        float lengthSquared = glm::dot(direction, direction);
+        float t = lengthSquared > 0.0f ? glm::clamp(glm::dot(point - start, direction) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+        return glm::length(point - (start + direction * t));
+    }
+}
+
+void PortalCuller::Cull(const Map& map, const glm::mat4& viewProjection, const glm::vec3& eye) {
+    size_t sectorCount = map.GetSectors().size();
+    m_ViewProjection = viewProjection;
+    m_Eye = eye;
+    m_PortalsTraversed = 0;
+    m_Reached.assign(sectorCount, 0);
+    m_OnStack.assign(sectorCount, 0);
+    m_Rects.assign(sectorCount, { glm::vec2(1.0f), glm::vec2(-1.0f) });
+    
+    m_CameraSector = map.FindSector(eye.x, eye.z);
+    if (m_CameraSector >= 0) {
+        Flood(map, m_CameraSector, { glm::vec2(-1.0f), glm::vec2(1.0f) }, 0);
+    }
+}
+
+void PortalCuller::Flood(const Map& map, int sector, const ClipRect& rect, int depth) {
+    m_Reached[sector] = 1;
+    ClipRect& reached = m_Rects[sector];
+    reached.min = glm::min(reached.min, rect.min);
+    reached.max = glm::max(reached.max, rect.max);
+    if (depth >= MAX_DEPTH) {
+        return;
+    }
+    
+    m_OnStack[sector] = 1;
+    const Sector& current = map.GetSectors()[sector];
+    glm::vec2 eye(m_Eye.x, m_Eye.z);
+    for (int wallIndex : current.portals) {
+        const Wall& wall = current.walls[wallIndex];
+        if (m_OnStack[wall.backSector]) {
+            continue;
+        }
+        
+        // The sector is on the wall's left, so only openings with the camera on their left face it
+        glm::vec2 direction = wall.end - wall.start;
+        glm::vec2 offset = eye - wall.start;
+        if (direction.x * offset.y - direction.y * offset.x <= 0.0f) {
+            continue;
+        }
+        
+        ClipRect narrowed;
+        if (!ProjectPortal(map, sector, wallIndex, rect, narrowed)) {
+            continue;
+        }
+        m_PortalsTraversed++;
+        Flood(map, wall.backSector, narrowed, depth + 1);
+    }
+    m_OnStack[sector] = 0;
+}
+
+bool PortalCuller::ProjectPortal(const Map& map, int sector, int wallIndex, const ClipRect& rect, ClipRect& result) const {
+    const Sector& front = map.GetSectors()[sector];
+    const Wall& wall = front.walls[wallIndex];
+    const Sector& back = map.GetSectors()[wall.backSector];
+    
+    // The opening is where both sectors are open
+    float bottom = std::max(front.floorHeight, back.floorHeight);
+    float top = std::min(front.ceilingHeight, back.ceilingHeight);
+    if (bottom >= top) {
+        return false;
+    }
+    
+    // Standing in the opening: it covers whatever is visible already
+    if (DistanceToSegment(glm::vec2(m_Eye.x, m_Eye.z), wall.start, wall.end) < STANDING_IN_PORTAL &&
+        m_Eye.y > bottom && m_Eye.y < top) {
+        result = rect;
+        return true;
+    }
+    
+    const glm::vec4 corners[4] = {
+        m_ViewProjection * glm::vec4(wall.start.x, bottom, wall.start.y, 1.0f),
+        m_ViewProjection * glm::vec4(wall.start.x, top, wall.start.y, 1.0f),
+        m_ViewProjection * glm::vec4(wall.end.x, top, wall.end.y, 1.0f),
+        m_ViewProjection * glm::vec4(wall.end.x, bottom, wall.end.y, 1.0f)
+    };
+    
+    // Clip the opening against the near plane (z >= -w) and bound what is left
+    glm::vec2 screenMin(1.0f);
+    glm::vec2 screenMax(-1.0f);
+    bool any = false;
+    auto addPoint = [&](const glm::vec4& clip) {
+        glm::vec2 ndc = glm::vec2(clip) / clip.w;
+        screenMin = glm::min(screenMin, ndc);
+        screenMax = glm::max(screenMax, ndc);
+        any = true;
+    };
+    for (int i = 0; i < 4; ++i) {
+        const glm::vec4& current = corners[i];
+        const glm::vec4& next = corners[(i + 1) % 4];
+        float currentDistance = current.z + current.w;
+        float nextDistance = next.z + next.w;
+        if (currentDistance >= 0.0f) {
+            addPoint(current);
+        }
+        if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+            addPoint(current + (next - current) * (currentDistance / (currentDistance - nextDistance)));
+        }
+    }
+    if (!any) {
+        return false;
+    }
+    
+    result.min = glm::max(rect.min, screenMin);
+    result.max = glm::min(rect.max, screenMax);
+    return !result.IsEmpty();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+#include <vector>
+
+class Map;
+
+// Screen-space rectangle in normalized device coordinates
+struct ClipRect {
+    glm::vec2 min;
+    glm::vec2 max;
+    
+    bool IsEmpty() const { return min.x >= max.x || min.y >= max.y; }
+};
+
+// Runtime visibility through sector adjacency. Starting in the camera's
+// sector, each front-facing portal whose opening projects inside the current
+// clip rectangle is entered with the rectangle narrowed to that opening.
+// Unlike the PVS this follows the current geometry, so doors and moving
+// floors are handled as they are.
+class PortalCuller {
+public:
+    // Flood from the sector containing eye; if eye is outside every sector
+    // all sectors are reported visible
+    void Cull(const Map& map, const glm::mat4& viewProjection, const glm::vec3& eye);
+    
+    bool IsSectorVisible(int sector) const { return m_CameraSector < 0 || m_Reached[sector] != 0; }
+    
+    // Union of the rectangles a sector was reached through
+    const ClipRect& GetSectorRect(int sector) const { return m_Rects[sector]; }
+    
+    int GetCameraSector() const { return m_CameraSector; }
+    unsigned int GetPortalsTraversed() const { return m_PortalsTraversed; }
+    
+private:
+    // Bounds cycles through loops of sectors seen from different angles
+    static constexpr int MAX_DEPTH = 64;
+    
+    glm::mat4 m_ViewProjection;
+    glm::vec3 m_Eye;
+    int m_CameraSector = -1;
+    unsigned int m_PortalsTraversed = 0;
+    std::vector<unsigned char> m_Reached;
+    std::vector<unsigned char> m_OnStack;
+    std::vector<ClipRect> m_Rects;
+    
+    void Flood(const Map& map, int sector, const ClipRect& rect, int depth);
+    
+    // Screen rectangle of a portal's opening; false if it is closed or off screen
+    bool ProjectPortal(const Map& map, int sector, int wallIndex, const ClipRect& rect, ClipRect& result) const;
+};
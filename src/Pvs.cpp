@@ -0,0 +1,509 @@
+#include "Pvs.h"
+#include "Hash.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    const uint32_t PVS_MAGIC = 0x31535650;     // "PVS1"
+    const uint32_t PVS_VERSION = 1;
+    
+    // Distance within which a point counts as on a line; kept so rounding
+    // never hides anything
+    const float ON_LINE_EPSILON = 1e-3f;
+    
+    // Recursion steps allowed per source portal. Wide open areas make the
+    // flow exponential; past this the portal keeps its base visibility.
+    const size_t MAX_FLOW_STEPS = 1 << 11;
+    
+    float Cross(const glm::vec2& a, const glm::vec2& b) {
+        return a.x * b.y - a.y * b.x;
+    }
+    
+    // Signed distance from the line through origin along direction; positive is left
+    float Side(const glm::vec2& origin, const glm::vec2& direction, const glm::vec2& point) {
+        return Cross(direction, point - origin) / glm::length(direction);
+    }
+    
+    struct Window {
+        glm::vec2 start;
+        glm::vec2 end;
+    };
+    
+    // Keep the part of the window where sign * side >= -epsilon; false if nothing is left
+    bool ClipWindow(Window& window, const glm::vec2& origin, const glm::vec2& direction, float sign) {
+        if (glm::length(direction) <= 0.0f) {
+            return true;
+        }
+        float startSide = sign * Side(origin, direction, window.start);
+        float endSide = sign * Side(origin, direction, window.end);
+        if (startSide >= -ON_LINE_EPSILON && endSide >= -ON_LINE_EPSILON) {
+            return true;
+        }
+        if (startSide < -ON_LINE_EPSILON && endSide < -ON_LINE_EPSILON) {
+            return false;
+        }
+        
+        glm::vec2 cut = window.start + (window.end - window.start) * (startSide / (startSide - endSide));
+        if (startSide < -ON_LINE_EPSILON) {
+            window.start = cut;
+        } else {
+            window.end = cut;
+        }
+        return true;
+    }
+    
+    // A line from an endpoint of a to an endpoint of pass that has the rest of
+    // a on one side and the rest of pass on the other bounds every sight line
+    // through both; the target must be on the pass's side of it
+    bool ClipToSeparators(const Window& a, const Window& pass, Window& target) {
+        const glm::vec2 aPoints[2] = { a.start, a.end };
+        const glm::vec2 passPoints[2] = { pass.start, pass.end };
+        for (int i = 0; i < 2; ++i) {
+            for (int j = 0; j < 2; ++j) {
+                glm::vec2 direction = passPoints[j] - aPoints[i];
+                if (glm::length(direction) <= ON_LINE_EPSILON) {
+                    continue;
+                }
+                float aSide = Side(aPoints[i], direction, aPoints[1 - i]);
+                float passSide = Side(aPoints[i], direction, passPoints[1 - j]);
+                if (std::fabs(aSide) <= ON_LINE_EPSILON || std::fabs(passSide) <= ON_LINE_EPSILON ||
+                    (aSide > 0.0f) == (passSide > 0.0f)) {
+                    continue;
+                }
+                if (!ClipWindow(target, aPoints[i], direction, passSide > 0.0f ? 1.0f : -1.0f)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    
+    // Sector sets as 64-bit words
+    using Bits = std::vector<uint64_t>;
+    
+    bool TestBit(const uint64_t* bits, int index) {
+        return (bits[index >> 6] >> (index & 63)) & 1;
+    }
+    
+    void SetBit(uint64_t* bits, int index) {
+        bits[index >> 6] |= uint64_t(1) << (index & 63);
+    }
+    
+    // Portal flow for one source portal: every sector a line through the
+    // source portal and a chain of later portals can reach
+    class PortalFlow {
+    public:
+        // Portals already marked done have their final visibility in
+        // portalVisible, a tighter bound than their base visibility
+        PortalFlow(const std::vector<PvsPortal>& portals, const std::vector<std::vector<int>>& sectorPortals,
+                   const std::vector<Bits>& mightSee, const std::vector<Bits>& portalVisible,
+                   const std::vector<std::atomic<uint8_t>>& done, int source)
+            : m_Portals(portals), m_SectorPortals(sectorPortals), m_MightSee(mightSee),
+              m_PortalVisible(portalVisible), m_Done(done), m_SourceIndex(source), m_Source(portals[source]),
+              m_OnStack(mightSee[source].size() * 64, 0), m_Steps(0) {
+        }
+        
+        // Returns false if the step budget ran out and visible fell back to base visibility
+        bool Run(Bits& visible) {
+            m_Visible = &visible;
+            Window source = { m_Source.start, m_Source.end };
+            SetBit(visible.data(), m_Source.fromSector);
+            Recurse(m_Source.toSector, source, source, true, m_MightSee[m_SourceIndex].data(), 0);
+            
+            if (m_Steps > MAX_FLOW_STEPS) {
+                visible = m_MightSee[m_SourceIndex];
+                SetBit(visible.data(), m_Source.fromSector);
+                return false;
+            }
+            return true;
+        }
+    
+    private:
+        const std::vector<PvsPortal>& m_Portals;
+        const std::vector<std::vector<int>>& m_SectorPortals;
+        const std::vector<Bits>& m_MightSee;
+        const std::vector<Bits>& m_PortalVisible;
+        const std::vector<std::atomic<uint8_t>>& m_Done;
+        int m_SourceIndex;
+        const PvsPortal& m_Source;
+        Bits* m_Visible;
+        std::vector<uint8_t> m_OnStack;
+        size_t m_Steps;
+        
+        // Sectors still possibly visible at each recursion depth
+        std::vector<Bits> m_Might;
+        
+        // source is the part of the source portal that can still see through
+        // pass; might is what every portal on the way could possibly see
+        void Recurse(int sector, const Window& source, const Window& pass, bool passIsSource,
+                     const uint64_t* might, size_t depth) {
+            Bits& visible = *m_Visible;
+            SetBit(visible.data(), sector);
+            if (++m_Steps > MAX_FLOW_STEPS) {
+                return;
+            }
+            m_OnStack[sector] = 1;
+            if (m_Might.size() <= depth) {
+                m_Might.resize(depth + 1, Bits(visible.size()));
+            }
+            
+            glm::vec2 sourceDirection = m_Source.end - m_Source.start;
+            glm::vec2 passDirection = pass.end - pass.start;
+            for (int portalIndex : m_SectorPortals[sector]) {
+                const PvsPortal& portal = m_Portals[portalIndex];
+                if (!TestBit(might, portal.toSector) || m_OnStack[portal.toSector]) {
+                    continue;
+                }
+                
+                // Nothing to gain if everything beyond this portal is already visible
+                uint64_t* next = m_Might[depth].data();
+                const uint64_t* portalMight = m_Done[portalIndex].load(std::memory_order_acquire) ?
+                    m_PortalVisible[portalIndex].data() : m_MightSee[portalIndex].data();
+                uint64_t more = 0;
+                for (size_t i = 0; i < visible.size(); ++i) {
+                    next[i] = might[i] & portalMight[i];
+                    more |= next[i] & ~visible[i];
+                }
+                if (!more) {
+                    continue;
+                }
+                
+                // Beyond the source and the portal we came through (their right sides)
+                Window target = { portal.start, portal.end };
+                if (!ClipWindow(target, m_Source.start, sourceDirection, -1.0f) ||
+                    !ClipWindow(target, pass.start, passDirection, -1.0f)) {
+                    continue;
+                }
+                
+                // Inside the anti-penumbra of the source and the pass, and
+                // narrow the source to the part that can see the target
+                Window narrowed = source;
+                if (!passIsSource &&
+                    (!ClipToSeparators(source, pass, target) || !ClipToSeparators(target, pass, narrowed))) {
+                    continue;
+                }
+                
+                // Only grazing sight lines get through a window this small
+                if (glm::length(target.end - target.start) <= ON_LINE_EPSILON ||
+                    glm::length(narrowed.end - narrowed.start) <= ON_LINE_EPSILON) {
+                    continue;
+                }
+                Recurse(portal.toSector, narrowed, target, false, next, depth + 1);
+            }
+            
+            m_OnStack[sector] = 0;
+        }
+    };
+    
+    void WriteU32(std::ostream& out, uint32_t value) {
+        unsigned char bytes[4];
+        for (int i = 0; i < 4; ++i) {
+            bytes[i] = static_cast<unsigned char>(value >> (i * 8));
+        }
+        out.write(reinterpret_cast<const char*>(bytes), 4);
+    }
+    
+    bool ReadU32(std::istream& in, uint32_t& value) {
+        unsigned char bytes[4];
+        if (!in.read(reinterpret_cast<char*>(bytes), 4)) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(bytes[i]) << (i * 8);
+        }
+        return true;
+    }
+}
+
+void Pvs::Build(int sectorCount, const std::vector<PvsPortal>& portals, ThreadPool* pool) {
+    Clear();
+    m_SectorCount = sectorCount;
+    
+    // Portals leaving each sector, ignoring degenerate ones and ones that point nowhere
+    std::vector<std::vector<int>> sectorPortals(sectorCount);
+    std::vector<uint8_t> usable(portals.size(), 0);
+    for (size_t i = 0; i < portals.size(); ++i) {
+        const PvsPortal& portal = portals[i];
+        if (portal.fromSector < 0 || portal.fromSector >= sectorCount ||
+            portal.toSector < 0 || portal.toSector >= sectorCount || portal.fromSector == portal.toSector ||
+            glm::length(portal.end - portal.start) <= ON_LINE_EPSILON) {
+            continue;
+        }
+        usable[i] = 1;
+        sectorPortals[portal.fromSector].push_back(static_cast<int>(i));
+    }
+    
+    // Base visibility: portal q might be seen through p if part of q is beyond p
+    // and part of p is on q's near side; flood through such pairs
+    auto canSeeThrough = [&](const PvsPortal& p, const PvsPortal& q) {
+        glm::vec2 pDirection = p.end - p.start;
+        glm::vec2 qDirection = q.end - q.start;
+        bool qBeyond = Side(p.start, pDirection, q.start) < -ON_LINE_EPSILON ||
+                       Side(p.start, pDirection, q.end) < -ON_LINE_EPSILON;
+        bool pBefore = Side(q.start, qDirection, p.start) > ON_LINE_EPSILON ||
+                       Side(q.start, qDirection, p.end) > ON_LINE_EPSILON;
+        return qBeyond && pBefore;
+    };
+    
+    // Base visibility for every portal first, as sector sets: the recursive
+    // flow prunes with the sets of the portals it passes through
+    size_t words = (static_cast<size_t>(sectorCount) + 63) / 64;
+    std::vector<Bits> mightSee(portals.size());
+    auto floodPortals = [&](size_t begin, size_t end) {
+        std::vector<uint8_t> reached(portals.size());
+        std::vector<int> stack;
+        for (size_t source = begin; source < end; ++source) {
+            if (!usable[source]) {
+                continue;
+            }
+            const PvsPortal& sourcePortal = portals[source];
+            Bits& sectors = mightSee[source];
+            sectors.assign(words, 0);
+            SetBit(sectors.data(), sourcePortal.toSector);
+            
+            std::fill(reached.begin(), reached.end(), 0);
+            stack.assign(1, sourcePortal.toSector);
+            while (!stack.empty()) {
+                int sector = stack.back();
+                stack.pop_back();
+                for (int portalIndex : sectorPortals[sector]) {
+                    if (!reached[portalIndex] && canSeeThrough(sourcePortal, portals[portalIndex])) {
+                        reached[portalIndex] = 1;
+                        SetBit(sectors.data(), portals[portalIndex].toSector);
+                        stack.push_back(portals[portalIndex].toSector);
+                    }
+                }
+            }
+        }
+    };
+    
+    // Flow portals that might see the least first, so busier ones can prune
+    // with their finished results. Each source is independent, so they run in parallel.
+    std::vector<int> order;
+    for (size_t i = 0; i < portals.size(); ++i) {
+        if (usable[i]) {
+            order.push_back(static_cast<int>(i));
+        }
+    }
+    std::vector<size_t> mightCount(portals.size(), 0);
+    for (int portalIndex : order) {
+        for (uint64_t word : mightSee[portalIndex]) {
+            for (; word; word &= word - 1) {
+                mightCount[portalIndex]++;
+            }
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return mightCount[a] < mightCount[b]; });
+    
+    std::vector<Bits> portalVisible(portals.size(), Bits(words, 0));
+    std::vector<std::atomic<uint8_t>> done(portals.size());
+    std::atomic<size_t> overBudget{ 0 };
+    auto flowPortals = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            int source = order[i];
+            PortalFlow flow(portals, sectorPortals, mightSee, portalVisible, done, source);
+            if (!flow.Run(portalVisible[source])) {
+                overBudget++;
+            }
+            done[source].store(1, std::memory_order_release);
+        }
+    };
+    if (pool) {
+        pool->ParallelFor(portals.size(), 1, floodPortals);
+        pool->ParallelFor(order.size(), 1, flowPortals);
+    } else {
+        floodPortals(0, portals.size());
+        flowPortals(0, order.size());
+    }
+    if (overBudget > 0) {
+        std::cerr << "PVS: " << overBudget << " portals see too much to flow exactly; "
+                  << "kept their base visibility" << std::endl;
+    }
+    
+    // A sector sees itself and whatever its outgoing portals see
+    size_t rowBytes = (static_cast<size_t>(sectorCount) + 7) / 8;
+    Bits row(words);
+    std::vector<uint8_t> bits(rowBytes);
+    m_RowOffsetStorage.reserve(sectorCount + 1);
+    for (int sector = 0; sector < sectorCount; ++sector) {
+        std::fill(row.begin(), row.end(), 0);
+        SetBit(row.data(), sector);
+        for (int portalIndex : sectorPortals[sector]) {
+            for (size_t i = 0; i < words; ++i) {
+                row[i] |= portalVisible[portalIndex][i];
+            }
+        }
+        for (size_t i = 0; i < rowBytes; ++i) {
+            bits[i] = static_cast<uint8_t>(row[i >> 3] >> ((i & 7) * 8));
+        }
+        
+        m_RowOffsetStorage.push_back(static_cast<uint32_t>(m_DataStorage.size()));
+        CompressRow(bits, m_DataStorage);
+    }
+    m_RowOffsetStorage.push_back(static_cast<uint32_t>(m_DataStorage.size()));
+    m_RowOffsets = m_RowOffsetStorage;
+    m_Data = m_DataStorage;
+}
+
+void Pvs::Clear() {
+    m_SectorCount = 0;
+    m_RowOffsets = ArrayView<uint32_t>();
+    m_Data = ArrayView<uint8_t>();
+    m_RowOffsetStorage.clear();
+    m_DataStorage.clear();
+}
+
+bool Pvs::Assign(int sectorCount, ArrayView<uint32_t> rowOffsets, ArrayView<uint8_t> data) {
+    if (sectorCount < 0 || rowOffsets.size() != static_cast<size_t>(sectorCount) + 1 ||
+        rowOffsets.front() != 0 || rowOffsets.back() != data.size() ||
+        !std::is_sorted(rowOffsets.begin(), rowOffsets.end())) {
+        return false;
+    }
+    
+    Clear();
+    m_SectorCount = sectorCount;
+    m_RowOffsets = rowOffsets;
+    m_Data = data;
+    return true;
+}
+
+void Pvs::CompressRow(const std::vector<uint8_t>& bits, std::vector<uint8_t>& out) {
+    // Non-zero bytes are stored as is; a run of zero bytes becomes 0, count
+    for (size_t i = 0; i < bits.size(); ) {
+        if (bits[i] != 0) {
+            out.push_back(bits[i++]);
+            continue;
+        }
+        size_t run = 0;
+        while (i < bits.size() && bits[i] == 0 && run < 255) {
+            ++run;
+            ++i;
+        }
+        out.push_back(0);
+        out.push_back(static_cast<uint8_t>(run));
+    }
+}
+
+void Pvs::DecompressRow(int sector, std::vector<uint8_t>& bits) const {
+    size_t rowBytes = (static_cast<size_t>(m_SectorCount) + 7) / 8;
+    bits.assign(rowBytes, 0);
+    if (sector < 0 || sector >= m_SectorCount) {
+        return;
+    }
+    
+    size_t out = 0;
+    for (uint32_t i = m_RowOffsets[sector]; i < m_RowOffsets[sector + 1] && out < rowBytes; ++i) {
+        if (m_Data[i] != 0) {
+            bits[out++] = m_Data[i];
+        } else if (i + 1 < m_RowOffsets[sector + 1]) {
+            out += m_Data[++i];
+        }
+    }
+}
+
+bool Pvs::IsVisible(int fromSector, int toSector) const {
+    if (toSector < 0 || toSector >= m_SectorCount) {
+        return false;
+    }
+    std::vector<uint8_t> bits;
+    DecompressRow(fromSector, bits);
+    return (bits[toSector >> 3] & (1 << (toSector & 7))) != 0;
+}
+
+uint64_t Pvs::ComputeChecksum(int sectorCount, const std::vector<PvsPortal>& portals) {
+    uint64_t hash = HashBytes(HASH_SEED, &PVS_VERSION, sizeof(PVS_VERSION));
+    hash = HashBytes(hash, &sectorCount, sizeof(sectorCount));
+    for (const auto& portal : portals) {
+        const float coordinates[4] = { portal.start.x, portal.start.y, portal.end.x, portal.end.y };
+        const int sectors[2] = { portal.fromSector, portal.toSector };
+        hash = HashBytes(hash, coordinates, sizeof(coordinates));
+        hash = HashBytes(hash, sectors, sizeof(sectors));
+    }
+    return hash;
+}
+
+bool Pvs::Load(const std::string& path, uint64_t checksum) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    // Header: magic, version, geometry checksum, sector count, data size, data hash
+    uint32_t magic, version, checksumLow, checksumHigh, sectorCount, dataSize, dataHashLow, dataHashHigh;
+    if (!ReadU32(file, magic) || !ReadU32(file, version) ||
+        !ReadU32(file, checksumLow) || !ReadU32(file, checksumHigh) ||
+        !ReadU32(file, sectorCount) || !ReadU32(file, dataSize) ||
+        !ReadU32(file, dataHashLow) || !ReadU32(file, dataHashHigh)) {
+        std::cerr << "PVS cache " << path << " is truncated" << std::endl;
+        return false;
+    }
+    if (magic != PVS_MAGIC || version != PVS_VERSION) {
+        std::cerr << "PVS cache " << path << " has an unknown format" << std::endl;
+        return false;
+    }
+    if ((static_cast<uint64_t>(checksumHigh) << 32 | checksumLow) != checksum) {
+        return false; // Computed for other geometry
+    }
+    
+    std::vector<uint32_t> offsets(sectorCount + 1);
+    for (auto& offset : offsets) {
+        if (!ReadU32(file, offset)) {
+            std::cerr << "PVS cache " << path << " is truncated" << std::endl;
+            return false;
+        }
+    }
+    std::vector<uint8_t> data(dataSize);
+    if (!file.read(reinterpret_cast<char*>(data.data()), dataSize)) {
+        std::cerr << "PVS cache " << path << " is truncated" << std::endl;
+        return false;
+    }
+    
+    uint64_t dataHash = HashBytes(HASH_SEED, data.data(), data.size());
+    bool offsetsValid = offsets.front() == 0 && offsets.back() == dataSize &&
+                        std::is_sorted(offsets.begin(), offsets.end());
+    if ((static_cast<uint64_t>(dataHashHigh) << 32 | dataHashLow) != dataHash || !offsetsValid) {
+        std::cerr << "PVS cache " << path << " is corrupt" << std::endl;
+        return false;
+    }
+    
+    Clear();
+    m_SectorCount = static_cast<int>(sectorCount);
+    m_RowOffsetStorage.swap(offsets);
+    m_DataStorage.swap(data);
+    m_RowOffsets = m_RowOffsetStorage;
+    m_Data = m_DataStorage;
+    return true;
+}
+
+bool Pvs::Save(const std::string& path, uint64_t checksum) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Could not write PVS cache " << path << std::endl;
+        return false;
+    }
+    
+    uint64_t dataHash = HashBytes(HASH_SEED, m_Data.data(), m_Data.size());
+    WriteU32(file, PVS_MAGIC);
+    WriteU32(file, PVS_VERSION);
+    WriteU32(file, static_cast<uint32_t>(checksum));
+    WriteU32(file, static_cast<uint32_t>(checksum >> 32));
+    WriteU32(file, static_cast<uint32_t>(m_SectorCount));
+    WriteU32(file, static_cast<uint32_t>(m_Data.size()));
+    WriteU32(file, static_cast<uint32_t>(dataHash));
+    WriteU32(file, static_cast<uint32_t>(dataHash >> 32));
+    for (uint32_t offset : m_RowOffsets) {
+        WriteU32(file, offset);
+    }
+    file.write(reinterpret_cast<const char*>(m_Data.data()), m_Data.size());
+    
+    if (!file) {
+        std::cerr << "Could not write PVS cache " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ArrayView.h"
+
+class ThreadPool;
+
+// One-way opening between sectors, seen from fromSector (on the left walking
+// start to end) into toSector (on the right)
+struct PvsPortal {
+    glm::vec2 start;
+    glm::vec2 end;
+    int fromSector;
+    int toSector;
+};
+
+// Potentially visible set: for every sector, the sectors that can be seen from
+// anywhere inside it. Computed offline by portal flow and stored as one
+// zero-run-compressed bit row per sector.
+class Pvs {
+public:
+    // Flood through the portals; rows are computed in parallel when a pool is given
+    void Build(int sectorCount, const std::vector<PvsPortal>& portals, ThreadPool* pool = nullptr);
+    void Clear();
+    
+    bool IsEmpty() const { return m_RowOffsets.empty(); }
+    int GetSectorCount() const { return m_SectorCount; }
+    size_t GetCompressedSize() const { return m_Data.size(); }
+    
+    // Expand a sector's row to one bit per sector (bit i of byte i / 8)
+    void DecompressRow(int sector, std::vector<uint8_t>& bits) const;
+    
+    // Convenience for one lookup; decompresses the row every call
+    bool IsVisible(int fromSector, int toSector) const;
+    
+    // Identifies the portal layout a cache was computed from
+    static uint64_t ComputeChecksum(int sectorCount, const std::vector<PvsPortal>& portals);
+    
+    // Sidecar cache. Load returns false if the file is missing, damaged or
+    // was computed for different geometry.
+    bool Load(const std::string& path, uint64_t checksum);
+    bool Save(const std::string& path, uint64_t checksum) const;
+    
+    // Compressed rows, for storing in a compiled level
+    ArrayView<uint32_t> GetRowOffsets() const { return m_RowOffsets; }
+    ArrayView<uint8_t> GetData() const { return m_Data; }
+    
+    // Use rows owned elsewhere, such as a mapped level file, without copying them.
+    // Returns false if the offsets do not describe the data.
+    bool Assign(int sectorCount, ArrayView<uint32_t> rowOffsets, ArrayView<uint8_t> data);
+
+private:
+    int m_SectorCount = 0;
+    ArrayView<uint32_t> m_RowOffsets;       // sectorCount + 1 offsets into m_Data
+    ArrayView<uint8_t> m_Data;
+    
+    // Rows built or loaded here; empty when the rows are assigned
+    std::vector<uint32_t> m_RowOffsetStorage;
+    std::vector<uint8_t> m_DataStorage;
+    
+    static void CompressRow(const std::vector<uint8_t>& bits, std::vector<uint8_t>& out);
+};
@@ -0,0 +1,75 @@
+#include "Reject.h"
+#include "Pvs.h"
+#include "ThreadPool.h"
+#include <cstring>
+
+void RejectTable::Build(const Pvs& pvs, ThreadPool* pool) {
+    Clear();
+    if (pvs.IsEmpty()) {
+        return;
+    }
+    int sectorCount = pvs.GetSectorCount();
+    size_t rowWords = GetRowWords(sectorCount);
+    size_t rowBytes = (static_cast<size_t>(sectorCount) + 7) / 8;
+    
+    // Expand the PVS rows, then or each row with its column. Every chunk writes
+    // only its own rows, and the second pass reads only the first pass's output.
+    std::vector<uint64_t> seen(static_cast<size_t>(sectorCount) * rowWords, 0);
+    auto expandRows = [&](size_t begin, size_t end) {
+        std::vector<uint8_t> row;
+        for (size_t sector = begin; sector < end; ++sector) {
+            pvs.DecompressRow(static_cast<int>(sector), row);
+            
+            // PVS bit i is bit i % 8 of byte i / 8, which is the same layout as
+            // little-endian words; assemble the words byte by byte to stay portable
+            uint64_t* words = &seen[sector * rowWords];
+            for (size_t i = 0; i < rowBytes; ++i) {
+                words[i / 8] |= static_cast<uint64_t>(row[i]) << (8 * (i % 8));
+            }
+        }
+    };
+    
+    m_BitStorage.assign(seen.size(), 0);
+    auto mirrorRows = [&](size_t begin, size_t end) {
+        for (size_t from = begin; from < end; ++from) {
+            uint64_t* words = &m_BitStorage[from * rowWords];
+            std::memcpy(words, &seen[from * rowWords], rowWords * sizeof(uint64_t));
+            for (size_t to = 0; to < static_cast<size_t>(sectorCount); ++to) {
+                uint64_t column = (seen[to * rowWords + (from >> 6)] >> (from & 63)) & 1;
+                words[to >> 6] |= column << (to & 63);
+            }
+        }
+    };
+    
+    const size_t minChunk = 16;
+    if (pool) {
+        pool->ParallelFor(sectorCount, minChunk, expandRows);
+        pool->ParallelFor(sectorCount, minChunk, mirrorRows);
+    } else {
+        expandRows(0, sectorCount);
+        mirrorRows(0, sectorCount);
+    }
+    
+    m_SectorCount = sectorCount;
+    m_RowWords = rowWords;
+    m_Bits = m_BitStorage;
+}
+
+void RejectTable::Clear() {
+    m_SectorCount = 0;
+    m_RowWords = 0;
+    m_Bits = ArrayView<uint64_t>();
+    m_BitStorage.clear();
+}
+
+bool RejectTable::Assign(int sectorCount, ArrayView<uint64_t> bits) {
+    if (sectorCount < 0 || bits.size() != static_cast<size_t>(sectorCount) * GetRowWords(sectorCount)) {
+        return false;
+    }
+    
+    Clear();
+    m_SectorCount = sectorCount;
+    m_RowWords = GetRowWords(sectorCount);
+    m_Bits = bits;
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ArrayView.h"
+
+class Pvs;
+class ThreadPool;
+
+// Sector-pair line-of-sight table, like Doom's REJECT lump: bit (a, b) is
+// clear when no point of sector a can see any point of sector b, so sight
+// checks between them can stop before touching any geometry. The table is
+// symmetric and stored as one row of 64-bit words per sector.
+class RejectTable {
+public:
+    // Take a sector pair as visible if the PVS has it in either direction
+    void Build(const Pvs& pvs, ThreadPool* pool = nullptr);
+    void Clear();
+    
+    // Use rows owned elsewhere, such as a mapped level file. Returns false if
+    // bits is not sectorCount rows long.
+    bool Assign(int sectorCount, ArrayView<uint64_t> bits);
+    
+    bool IsEmpty() const { return m_Bits.empty(); }
+    int GetSectorCount() const { return m_SectorCount; }
+    
+    // Unknown sectors, such as -1 for a point outside the map, are never rejected
+    bool MightSee(int fromSector, int toSector) const {
+        if (static_cast<unsigned>(fromSector) >= static_cast<unsigned>(m_SectorCount) ||
+            static_cast<unsigned>(toSector) >= static_cast<unsigned>(m_SectorCount)) {
+            return true;
+        }
+        uint64_t word = m_Bits[static_cast<size_t>(fromSector) * m_RowWords + (toSector >> 6)];
+        return (word >> (toSector & 63)) & 1;
+    }
+    
+    // The rows, for storing in a compiled level
+    ArrayView<uint64_t> GetBits() const { return m_Bits; }
+    
+    static size_t GetRowWords(int sectorCount) { return (static_cast<size_t>(sectorCount) + 63) / 64; }
+
+private:
+    int m_SectorCount = 0;
+    size_t m_RowWords = 0;
+    ArrayView<uint64_t> m_Bits;
+    
+    // Rows built here; empty when the rows are assigned
+    std::vector<uint64_t> m_BitStorage;
+};
@@ -1,9 +1,22 @@
 #include "Renderer.h"
+#include "Image.h"
+#include "Texture.h"
+#include "TextureCook.h"
+#include "ThreadPool.h"
 #include <glm/glm-master/glm-master/glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 
 Renderer::Renderer(int width, int height)
-    : m_Width(width), m_Height(height) {
+    : m_Width(width), m_Height(height), m_LevelShader(nullptr),
+      m_VirtualShader(nullptr), m_FeedbackShader(nullptr),
+      m_Paletted(false), m_PaletteTint(0.0f), m_PaletteTexture(0), m_ColormapTexture(0), m_VirtualTexturing(false),
+      m_LevelMap(nullptr), m_LevelRevision(0),
+      m_LevelMinY(0.0f), m_LevelMaxY(0.0f), m_FrameNumber(0),
+      m_PvsCulling(true), m_PortalCulling(true), m_OcclusionCulling(true), m_HiZCulling(true), m_HiZReady(false),
+      m_HiZ(&ThreadPool::GetShared()) {
     
     // Create projection matrix
     m_Projection = glm::perspective(glm::radians(45.0f), 
@@ -14,141 +27,1016 @@ Renderer::Renderer(int width, int height)
     m_ShaderManager = std::make_unique<ShaderManager>();
     
     // Load shaders
-    m_ShaderManager->LoadShader("basic", "shaders/basic.vert", "shaders/basic.frag");
+    m_ShaderManager->LoadShader("level", "shaders/level.vert", "shaders/level.frag");
+    m_ShaderManager->LoadShader("virtual", "shaders/virtual.vert", "shaders/virtual.frag");
+    m_ShaderManager->LoadShader("feedback", "shaders/virtual.vert", "shaders/feedback.frag");
     
-    // Initialize rendering
-    InitRendering();
+    // Resolve uniforms once so drawing never looks them up by name
+    m_LevelShader = m_ShaderManager->GetProgram("level");
+    m_LevelUniforms.model = m_LevelShader->GetUniform<glm::mat4>("model");
+    m_LevelUniforms.textureSampler = m_LevelShader->GetUniform<int>("textureSampler");
+    m_LevelUniforms.paletted = m_LevelShader->GetUniform<int>("paletted");
+    m_LevelUniforms.paletteSampler = m_LevelShader->GetUniform<int>("paletteSampler");
+    m_LevelUniforms.colormapSampler = m_LevelShader->GetUniform<int>("colormapSampler");
+    m_LevelUniforms.paletteTint = m_LevelShader->GetUniform<glm::vec4>("paletteTint");
+    m_VirtualShader = m_ShaderManager->GetProgram("virtual");
+    m_FeedbackShader = m_ShaderManager->GetProgram("feedback");
+    for (auto [program, uniforms] : { std::make_pair(m_VirtualShader, &m_VirtualUniforms),
+                                      std::make_pair(m_FeedbackShader, &m_FeedbackUniforms) }) {
+        uniforms->virtualOrigin = program->GetUniform<glm::vec2>("virtualOrigin");
+        uniforms->virtualScale = program->GetUniform<float>("virtualScale");
+        uniforms->virtualOffset = program->GetUniform<glm::vec2>("virtualOffset");
+        uniforms->virtualPages = program->GetUniform<int>("virtualPages");
+        uniforms->virtualLevels = program->GetUniform<int>("virtualLevels");
+        uniforms->atlasSampler = program->GetUniform<int>("atlasSampler");
+        uniforms->indirectionSampler = program->GetUniform<int>("indirectionSampler");
+        uniforms->paletteTint = program->GetUniform<glm::vec4>("paletteTint");
+        uniforms->feedbackBias = program->GetUniform<float>("feedbackBias");
+    }
     
-    // Load textures
-    LoadTextures();
+    // Initialize rendering; textures come with the first map
+    InitRendering();
 }
 
 Renderer::~Renderer() {
     // Clean up OpenGL objects
     glDeleteVertexArrays(1, &m_WallVAO);
     glDeleteBuffers(1, &m_WallVBO);
+    glDeleteBuffers(1, &m_WallEBO);
     glDeleteVertexArrays(1, &m_FloorVAO);
     glDeleteBuffers(1, &m_FloorVBO);
+    glDeleteBuffers(1, &m_CameraUBO);
+    glDeleteTextures(1, &m_PaletteTexture);
+    glDeleteTextures(1, &m_ColormapTexture);
 }
 
 void Renderer::InitRendering() {
     // Create vertex arrays and buffers for walls
     glGenVertexArrays(1, &m_WallVAO);
     glGenBuffers(1, &m_WallVBO);
+    glGenBuffers(1, &m_WallEBO);
     
     // Create vertex arrays and buffers for floor/ceiling
     glGenVertexArrays(1, &m_FloorVAO);
     glGenBuffers(1, &m_FloorVBO);
+    
+    // Create the per-frame camera block and attach it to its shared binding point
+    glGenBuffers(1, &m_CameraUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_CameraUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, m_CameraUBO);
+    
+    // Palette lookups fetch exact texels, so neither table is filtered or mipmapped
+    for (GLuint* texture : { &m_PaletteTexture, &m_ColormapTexture }) {
+        glGenTextures(1, texture);
+        glBindTexture(GL_TEXTURE_2D, *texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void Renderer::LoadTextures() {
-    // Load wall textures
-    m_Textures.push_back(std::make_unique<Texture>("resources/wall1.jpg"));
-    m_Textures.push_back(std::make_unique<Texture>("resources/wall2.png"));
+void Renderer::LoadTextures(const std::vector<std::string>& texturePaths) {
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool& pool = ThreadPool::GetShared();
+    
+    // Compressed formats need an extension; checked here since only this thread has the context.
+    // Paletted textures are indexed from decoded colors, so they never use cooked copies.
+    bool s3tc = Texture::IsFormatSupported(CookedFormat::Bc1);
+    
+    // Open cooked copies, found by hashing each source, and read just the headers of the rest,
+    // so the arrays can be laid out before anything is decoded
+    std::vector<glm::ivec2> sizes(texturePaths.size());
+    std::vector<std::unique_ptr<CookedTexture>> cooked(texturePaths.size());
+    pool.ParallelFor(texturePaths.size(), 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint64_t hash;
+            auto texture = std::make_unique<CookedTexture>();
+            if (!m_Paletted && TextureCook::HashFile(texturePaths[i], hash) &&
+                texture->Open(TextureCook::GetCachePath(hash)) && texture->GetSourceHash() == hash &&
+                (s3tc || texture->GetFormat() == CookedFormat::Rgba8)) {
+                sizes[i] = glm::ivec2(texture->GetWidth(), texture->GetHeight());
+                cooked[i] = std::move(texture);
+            } else {
+                Image::ReadSize(texturePaths[i], sizes[i].x, sizes[i].y);
+            }
+        }
+    });
+    
+    // Decode the rest as RGBA on the workers and build their mips there. A file whose header
+    // read but whose data did not gets a checkerboard of the size it claimed.
+    std::vector<std::future<std::vector<std::vector<unsigned char>>>> decoded(texturePaths.size());
+    size_t cookedCount = 0;
+    for (size_t i = 0; i < texturePaths.size(); ++i) {
+        if (cooked[i]) {
+            ++cookedCount;
+            continue;
+        }
+        std::string path = texturePaths[i];
+        glm::ivec2 size = sizes[i];
+        decoded[i] = pool.Submit([path, size]() {
+            Image image(path, 4);
+            if (image.GetWidth() != size.x || image.GetHeight() != size.y) {
+                image = Image(size.x, size.y, 4);
+            }
+            return TextureCook::BuildMips(image.GetPixels(), size.x, size.y, nullptr);
+        });
+    }
+    
+    // Bucket textures by size, format and level count, one array per bucket. Decoded textures
+    // have a full chain, in RGBA or, when paletted, as indices.
+    auto getFormat = [&](size_t i) {
+        if (m_Paletted) {
+            return CookedFormat::Index8;
+        }
+        return cooked[i] ? cooked[i]->GetFormat() : CookedFormat::Rgba8;
+    };
+    auto getLevels = [&](size_t i) {
+        if (cooked[i]) {
+            return cooked[i]->GetLevelCount();
+        }
+        return static_cast<int>(std::log2(std::max(sizes[i].x, sizes[i].y))) + 1;
+    };
+    std::vector<std::vector<int>> buckets;
+    m_Materials.assign(texturePaths.size(), { -1, -1 });
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        int arrayIndex = -1;
+        for (size_t b = 0; b < buckets.size(); ++b) {
+            size_t first = buckets[b][0];
+            if (sizes[first] == sizes[i] && getFormat(first) == getFormat(i) && getLevels(first) == getLevels(i)) {
+                arrayIndex = static_cast<int>(b);
+                break;
+            }
+        }
+        if (arrayIndex < 0) {
+            arrayIndex = static_cast<int>(buckets.size());
+            buckets.emplace_back();
+        }
+        
+        m_Materials[i] = { arrayIndex, static_cast<int>(buckets[arrayIndex].size()) };
+        buckets[arrayIndex].push_back(static_cast<int>(i));
+    }
+    
+    // Allocate the arrays while the first images decode, holding only their coarse levels.
+    // The streamer lets go of the old arrays first.
+    m_TextureStreamer.Clear();
+    m_TextureArrays.clear();
+    std::vector<std::vector<TextureStreamer::LayerSource>> sources;
+    for (const auto& bucket : buckets) {
+        const glm::ivec2& size = sizes[bucket[0]];
+        int levels = getLevels(bucket[0]);
+        int baseLevel = TextureStreamer::GetResidentLevel(size.x, size.y, levels);
+        m_TextureArrays.push_back(std::make_unique<TextureArray>(size.x, size.y, static_cast<int>(bucket.size()),
+                                                                 getFormat(bucket[0]), levels, baseLevel));
+        sources.emplace_back(bucket.size());
+    }
+    
+    if (m_Paletted) {
+        // The palette comes from every image, so wait for all of them first
+        std::vector<std::vector<std::vector<unsigned char>>> chains(texturePaths.size());
+        std::vector<ArrayView<unsigned char>> images;
+        for (size_t i = 0; i < texturePaths.size(); ++i) {
+            chains[i] = decoded[i].get();
+            images.emplace_back(chains[i][0]);
+        }
+        Palette palette = Palette::Build(images);
+        UploadPalette(palette);
+        
+        // Mips were filtered in color and are indexed afterwards, since indices cannot be averaged
+        pool.ParallelFor(chains.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                for (size_t level = 0; level < chains[i].size(); ++level) {
+                    chains[i][level] = palette.Index(chains[i][level].data(), std::max(sizes[i].x >> level, 1),
+                                                     std::max(sizes[i].y >> level, 1));
+                }
+            }
+        });
+        for (size_t i = 0; i < chains.size(); ++i) {
+            const MaterialSlot& slot = m_Materials[i];
+            m_TextureArrays[slot.arrayIndex]->SetLayer(slot.layer, chains[i]);
+            sources[slot.arrayIndex][slot.layer].levels = std::move(chains[i]);
+        }
+    } else {
+        // Upload in order as each texture arrives, then keep it for the streamer
+        for (size_t i = 0; i < texturePaths.size(); ++i) {
+            const MaterialSlot& slot = m_Materials[i];
+            TextureArray& array = *m_TextureArrays[slot.arrayIndex];
+            TextureStreamer::LayerSource& source = sources[slot.arrayIndex][slot.layer];
+            if (cooked[i]) {
+                array.SetLayer(slot.layer, *cooked[i]);
+                source.cooked = std::move(cooked[i]);
+            } else {
+                source.levels = decoded[i].get();
+                array.SetLayer(slot.layer, source.levels);
+            }
+        }
+    }
     
-    // Load floor texture
-    m_Textures.push_back(std::make_unique<Texture>("resources/floor.jpg"));
+    size_t memoryUsage = 0;
+    size_t fullMemoryUsage = 0;
+    for (size_t arrayIndex = 0; arrayIndex < m_TextureArrays.size(); ++arrayIndex) {
+        memoryUsage += m_TextureArrays[arrayIndex]->GetMemoryUsage();
+        fullMemoryUsage += m_TextureArrays[arrayIndex]->GetMemoryUsage(0);
+        m_TextureStreamer.AddArray(m_TextureArrays[arrayIndex].get(), std::move(sources[arrayIndex]));
+    }
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Loaded " << texturePaths.size() << (m_Paletted ? " paletted" : "") << " textures ("
+              << cookedCount << " cooked) into " << m_TextureArrays.size() << " arrays, "
+              << memoryUsage / 1024 << " KB resident of " << fullMemoryUsage / 1024 << " KB, in "
+              << elapsed.count() << " ms (" << std::max<size_t>(pool.GetThreadCount(), 1) << " decode threads)"
+              << std::endl;
+}
+
+void Renderer::UploadPalette(const Palette& palette) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, m_PaletteTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, Palette::COLOR_COUNT, 1, 0,
+                 GL_RGB, GL_UNSIGNED_BYTE, palette.GetColors());
+    glBindTexture(GL_TEXTURE_2D, m_ColormapTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, Palette::COLOR_COUNT, Palette::LIGHT_LEVELS, 0,
+                 GL_RED, GL_UNSIGNED_BYTE, palette.GetColormap());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 }
 
-void Renderer::Render(const Player& player, const Map& map) {
-    // Get shader
-    GLuint shader = m_ShaderManager->GetShader("basic");
-    glUseProgram(shader);
+void Renderer::SetPaletted(bool enabled) {
+    if (enabled != m_Paletted) {
+        m_Paletted = enabled;
+        
+        // Forget the loaded level so the next frame reloads textures and geometry with the new layout
+        m_LevelMap = nullptr;
+    }
+}
+
+void Renderer::SetVirtualTexturing(bool enabled) {
+    if (enabled != m_VirtualTexturing) {
+        m_VirtualTexturing = enabled;
+        m_LevelMap = nullptr;
+    }
+}
+
+void Renderer::Render(const Player& player, const Map& map, float time) {
+    m_Stats = RenderStats();
+    
+    // Reload the map's textures and rebuild the static level buffers if the map changed since the last frame
+    if (&map != m_LevelMap || map.GetRevision() != m_LevelRevision) {
+        LoadTextures(map.GetTextures());
+        BuildLevelGeometry(map);
+        BuildVirtualTexture(map);
+    }
     
-    // Set view matrix based on player position and orientation
+    // Update the camera block once; every program reads it from the same binding point
     glm::mat4 view = player.GetViewMatrix();
+    glm::mat4 viewProjection = m_Projection * view;
+    UpdateCameraBlock(player, view, viewProjection, time);
     
-    // Set uniforms
-    glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, &view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, &m_Projection[0][0]);
+    // Find the walls and sectors inside the view frustum
+    CullLevel(player, map, viewProjection);
+    CullHiZ(map, viewProjection);
+    
+    // Bring in the mip levels the surfaces that survived culling need, and the virtual pages earlier frames asked for
+    StreamTextures(player, map);
+    if (m_VirtualTexture) {
+        m_VirtualTexture->Update();
+        const VirtualTexture::Stats& stats = m_VirtualTexture->GetStats();
+        m_Stats.virtualPagesResident = stats.residentPages;
+        m_Stats.virtualPagesPending = stats.pendingPages;
+        m_Stats.virtualPagesUploaded = stats.uploadedPages;
+    }
+    
+    // Bind shader
+    m_LevelShader->Use();
+    
+    // Shading inputs shared by walls and flats. The lookup samplers always point at their
+    // own units, since a 2D sampler left on the array's unit would make every draw invalid.
+    m_LevelShader->Set(m_LevelUniforms.paletted, m_Paletted ? 1 : 0);
+    m_LevelShader->Set(m_LevelUniforms.paletteSampler, static_cast<int>(PALETTE_TEXTURE_SLOT));
+    m_LevelShader->Set(m_LevelUniforms.colormapSampler, static_cast<int>(COLORMAP_TEXTURE_SLOT));
+    m_LevelShader->Set(m_LevelUniforms.paletteTint, m_PaletteTint);
+    if (m_Paletted) {
+        glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_SLOT);
+        glBindTexture(GL_TEXTURE_2D, m_PaletteTexture);
+        glActiveTexture(GL_TEXTURE0 + COLORMAP_TEXTURE_SLOT);
+        glBindTexture(GL_TEXTURE_2D, m_ColormapTexture);
+    }
     
     // Render walls
-    RenderWalls(player, map);
+    RenderWalls();
     
-    // Render floor and ceiling
-    RenderFloorAndCeiling(player, map);
+    // Render floor and ceiling, then record which virtual pages they needed
+    if (m_VirtualTexture) {
+        RenderVirtualFlats();
+        RenderFeedback();
+    } else {
+        RenderFloorAndCeiling();
+    }
 }
 
-void Renderer::RenderWalls(const Player& player, const Map& map) {
-    GLuint shader = m_ShaderManager->GetShader("basic");
+void Renderer::UpdateCameraBlock(const Player& player, const glm::mat4& view,
+                                 const glm::mat4& viewProjection, float time) {
+    CameraBlock camera;
+    camera.view = view;
+    camera.projection = m_Projection;
+    camera.viewProjection = viewProjection;
+    camera.cameraPosition = glm::vec4(player.GetPosition(), 1.0f);
+    camera.time = glm::vec4(time, 0.0f, 0.0f, 0.0f);
     
-    // Bind wall VAO
-    glBindVertexArray(m_WallVAO);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_CameraUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &camera);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void Renderer::BuildLevelGeometry(const Map& map) {
+    // Vertical spans to draw for each wall: the whole wall if it is one-sided,
+    // otherwise the step below and the lintel above the opening
+    auto getPieces = [&](const Sector& sector, const Wall& wall, glm::vec2 pieces[2]) {
+        if (wall.backSector < 0) {
+            pieces[0] = glm::vec2(sector.floorHeight, sector.floorHeight + wall.height);
+            return 1;
+        }
+        const Sector& back = map.GetSectors()[wall.backSector];
+        int count = 0;
+        if (back.floorHeight > sector.floorHeight) {
+            pieces[count++] = glm::vec2(sector.floorHeight, std::min(back.floorHeight, sector.ceilingHeight));
+        }
+        if (back.ceilingHeight < sector.ceilingHeight) {
+            pieces[count++] = glm::vec2(std::max(back.ceilingHeight, sector.floorHeight), sector.ceilingHeight);
+        }
+        return count;
+    };
     
-    // For each sector in the map
+    // Count quads per texture array so each array's walls end up contiguous in the index buffer
+    std::vector<size_t> slotsPerArray(m_TextureArrays.size(), 0);
+    size_t slotCount = 0;
     for (const auto& sector : map.GetSectors()) {
-        // For each wall in the sector
         for (const auto& wall : sector.walls) {
-            // Create model matrix for this wall
-            glm::mat4 model = glm::mat4(1.0f);
+            if (wall.textureId < 0 || wall.textureId >= static_cast<int>(m_Materials.size())) {
+                std::cerr << "Wall uses unknown texture " << wall.textureId << ", skipping" << std::endl;
+                continue;
+            }
+            glm::vec2 pieces[2];
+            int pieceCount = getPieces(sector, wall, pieces);
+            slotsPerArray[m_Materials[wall.textureId].arrayIndex] += pieceCount;
+            slotCount += pieceCount;
+        }
+    }
+    
+    // Each array's walls start where the previous array's end
+    std::vector<size_t> nextSlot(m_TextureArrays.size(), 0);
+    size_t firstSlot = 0;
+    for (size_t arrayIndex = 0; arrayIndex < slotsPerArray.size(); ++arrayIndex) {
+        nextSlot[arrayIndex] = firstSlot;
+        firstSlot += slotsPerArray[arrayIndex];
+    }
+    
+    // Build 4 vertices and 6 indices per quad, remembering where each wall's quads went
+    const size_t floatsPerVertex = 7;
+    std::vector<float> vertices(slotCount * 4 * floatsPerVertex);
+    std::vector<GLuint> indices(slotCount * 6);
+    m_WallSlots.assign(map.GetWallCount(), -1);
+    m_WallSlotCounts.assign(map.GetWallCount(), 0);
+    m_WallArrays.assign(map.GetWallCount(), -1);
+    m_WallTexelDensity.assign(map.GetWallCount(), 0.0f);
+    m_WallFrames.assign(map.GetWallCount(), 0);
+    m_LevelMinY = 0.0f;
+    m_LevelMaxY = 0.0f;
+    int wallIndex = 0;
+    for (const auto& sector : map.GetSectors()) {
+        if (!sector.walls.empty()) {
+            m_LevelMinY = std::min(m_LevelMinY, sector.floorHeight);
+            m_LevelMaxY = std::max(m_LevelMaxY, sector.ceilingHeight);
+        }
+        for (const auto& wall : sector.walls) {
+            int index = wallIndex++;
+            if (wall.textureId < 0 || wall.textureId >= static_cast<int>(m_Materials.size())) {
+                continue;
+            }
+            glm::vec2 pieces[2];
+            int pieceCount = getPieces(sector, wall, pieces);
+            if (pieceCount == 0) {
+                continue;
+            }
+            
+            const MaterialSlot& material = m_Materials[wall.textureId];
+            m_WallSlots[index] = static_cast<int>(nextSlot[material.arrayIndex]);
+            m_WallSlotCounts[index] = pieceCount;
+            m_WallArrays[index] = material.arrayIndex;
+            float layer = static_cast<float>(material.layer);
+            float light = sector.lightLevel / 255.0f;
             
-            // Set wall texture
-            m_Textures[wall.textureId]->Bind(0);
-            glUniform1i(glGetUniformLocation(shader, "textureSampler"), 0);
+            // Each piece stretches the whole texture over its length and height
+            const TextureArray& array = *m_TextureArrays[material.arrayIndex];
+            float length = glm::length(wall.end - wall.start);
+            float density = array.GetWidth() / std::max(length, 0.001f);
+            for (int piece = 0; piece < pieceCount; ++piece) {
+                density = std::max(density, array.GetHeight() / std::max(pieces[piece].y - pieces[piece].x, 0.001f));
+            }
+            m_WallTexelDensity[index] = density;
             
-            // Create wall vertices
-            float vertices[] = {
-                // Positions          // Texture coords
-                wall.start.x, 0.0f, wall.start.y,  0.0f, 0.0f,
-                wall.start.x, wall.height, wall.start.y,  0.0f, 1.0f,
-                wall.end.x, wall.height, wall.end.y,  1.0f, 1.0f,
+            for (int piece = 0; piece < pieceCount; ++piece) {
+                size_t slot = nextSlot[material.arrayIndex]++;
+                float bottom = pieces[piece].x;
+                float top = pieces[piece].y;
+                m_LevelMaxY = std::max(m_LevelMaxY, top);
+                
+                const float wallVertices[] = {
+                    // Positions                          // Texture coords  // Layer  // Light
+                    wall.start.x, bottom, wall.start.y,   0.0f, 0.0f,        layer,    light,
+                    wall.start.x, top, wall.start.y,      0.0f, 1.0f,        layer,    light,
+                    wall.end.x, top, wall.end.y,          1.0f, 1.0f,        layer,    light,
+                    wall.end.x, bottom, wall.end.y,       1.0f, 0.0f,        layer,    light
+                };
+                std::copy(std::begin(wallVertices), std::end(wallVertices),
+                          vertices.begin() + slot * 4 * floatsPerVertex);
                 
-                wall.start.x, 0.0f, wall.start.y,  0.0f, 0.0f,
-                wall.end.x, wall.height, wall.end.y,  1.0f, 1.0f,
-                wall.end.x, 0.0f, wall.end.y,  1.0f, 0.0f
+                GLuint base = static_cast<GLuint>(slot * 4);
+                const GLuint wallIndices[] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+                std::copy(std::begin(wallIndices), std::end(wallIndices), indices.begin() + slot * 6);
+            }
+        }
+    }
+    
+    // Upload once; the VAO remembers the buffers and attribute layout
+    glBindVertexArray(m_WallVAO);
+    
+    glBindBuffer(GL_ARRAY_BUFFER, m_WallVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_WallEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    
+    // Position attribute
+    GLsizei stride = static_cast<GLsizei>(floatsPerVertex * sizeof(float));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(0);
+    
+    // Texture coord attribute
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    
+    // Texture array layer attribute
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*)(5 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    
+    // Sector light attribute
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+    
+    glBindVertexArray(0);
+    
+    BuildFlatGeometry(map);
+    
+    m_LevelMap = &map;
+    m_LevelRevision = map.GetRevision();
+}
+
+void Renderer::BuildFlatGeometry(const Map& map) {
+    const std::vector<Sector>& sectors = map.GetSectors();
+    ArrayView<glm::vec2> points = map.GetVertices();
+    auto runTexture = [&](size_t run) {
+        const Sector& sector = sectors[run / 2];
+        return run % 2 == 0 ? sector.floorTextureId : sector.ceilingTextureId;
+    };
+    
+    // Lay out each array's runs contiguously, as for walls
+    std::vector<size_t> verticesPerArray(m_TextureArrays.size(), 0);
+    m_FlatRuns.assign(sectors.size() * 2, { -1, 0, 0, 0.0f });
+    for (size_t run = 0; run < m_FlatRuns.size(); ++run) {
+        int textureId = runTexture(run);
+        if (sectors[run / 2].triangles.empty() || textureId < 0 || textureId >= static_cast<int>(m_Materials.size())) {
+            continue;
+        }
+        m_FlatRuns[run].arrayIndex = m_Materials[textureId].arrayIndex;
+        m_FlatRuns[run].count = static_cast<GLsizei>(sectors[run / 2].triangles.size());
+        const TextureArray& array = *m_TextureArrays[m_FlatRuns[run].arrayIndex];
+        m_FlatRuns[run].texelDensity = std::max(array.GetWidth(), array.GetHeight()) * FLAT_TEXTURE_SCALE;
+        verticesPerArray[m_FlatRuns[run].arrayIndex] += m_FlatRuns[run].count;
+    }
+    std::vector<size_t> nextVertex(m_TextureArrays.size(), 0);
+    size_t vertexCount = 0;
+    for (size_t arrayIndex = 0; arrayIndex < verticesPerArray.size(); ++arrayIndex) {
+        nextVertex[arrayIndex] = vertexCount;
+        vertexCount += verticesPerArray[arrayIndex];
+    }
+    
+    // Floors face up and ceilings down, so ceilings take the triangles in reverse order
+    const size_t floatsPerVertex = 7;
+    std::vector<float> vertices(vertexCount * floatsPerVertex);
+    for (size_t run = 0; run < m_FlatRuns.size(); ++run) {
+        FlatRun& flat = m_FlatRuns[run];
+        if (flat.arrayIndex < 0) {
+            continue;
+        }
+        const Sector& sector = sectors[run / 2];
+        bool ceiling = run % 2 == 1;
+        float height = ceiling ? sector.ceilingHeight : sector.floorHeight;
+        float layer = static_cast<float>(m_Materials[runTexture(run)].layer);
+        float light = sector.lightLevel / 255.0f;
+        flat.first = static_cast<GLint>(nextVertex[flat.arrayIndex]);
+        nextVertex[flat.arrayIndex] += flat.count;
+        
+        float* out = &vertices[static_cast<size_t>(flat.first) * floatsPerVertex];
+        for (GLsizei i = 0; i < flat.count; ++i) {
+            const glm::vec2& point = points[sector.triangles[ceiling ? flat.count - 1 - i : i]];
+            const float flatVertex[] = {
+                point.x, height, point.y,
+                point.x * FLAT_TEXTURE_SCALE, point.y * FLAT_TEXTURE_SCALE,
+                layer, light
             };
+            std::copy(std::begin(flatVertex), std::end(flatVertex), out + i * floatsPerVertex);
+        }
+    }
+    
+    glBindVertexArray(m_FloorVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_FloorVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    
+    // Same layout as the walls: position, texture coord, layer, light
+    GLsizei stride = static_cast<GLsizei>(floatsPerVertex * sizeof(float));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*)(5 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+    
+    glBindVertexArray(0);
+}
+
+void Renderer::BuildVirtualTexture(const Map& map) {
+    // The old texture waits for its pages in flight before the baker they paint with goes
+    m_VirtualTexture.reset();
+    m_FlatBaker.reset();
+    if (!m_VirtualTexturing || m_Paletted) {
+        return;
+    }
+    
+    // Pages are painted from the flats in color, decoded again here since the arrays may hold them compressed
+    auto start = std::chrono::steady_clock::now();
+    const std::vector<std::string>& texturePaths = map.GetTextures();
+    std::vector<FlatBaker::Flat> flats(texturePaths.size());
+    std::vector<uint8_t> used(texturePaths.size(), 0);
+    for (const Sector& sector : map.GetSectors()) {
+        for (int textureId : { sector.floorTextureId, sector.ceilingTextureId }) {
+            if (textureId >= 0 && textureId < static_cast<int>(used.size())) {
+                used[textureId] = 1;
+            }
+        }
+    }
+    ThreadPool& pool = ThreadPool::GetShared();
+    pool.ParallelFor(texturePaths.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (!used[i]) {
+                continue;
+            }
+            Image image(texturePaths[i], 4);
+            flats[i].width = image.GetWidth();
+            flats[i].height = image.GetHeight();
+            flats[i].levels = TextureCook::BuildMips(image.GetPixels(), image.GetWidth(), image.GetHeight(), nullptr);
+        }
+    });
+    
+    m_FlatBaker = std::make_unique<FlatBaker>(map, std::move(flats), FLAT_TEXTURE_SCALE);
+    const FlatBaker* baker = m_FlatBaker.get();
+    m_VirtualTexture = std::make_unique<VirtualTexture>(baker->GetPages(),
+        [baker](int level, int x, int y, unsigned char* pixels) { baker->Paint(level, x, y, pixels); }, &pool);
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Virtual texture for floors and ceilings: " << baker->GetPages() << " pages across, "
+              << m_VirtualTexture->GetLevels() << " levels, in " << elapsed.count() << " ms" << std::endl;
+}
+
+void Renderer::CullLevel(const Player& player, const Map& map, const glm::mat4& viewProjection) {
+    Frustum frustum(viewProjection);
+    glm::vec3 viewpoint = player.GetPosition();
+    
+    // Only sectors in the camera sector's PVS can show; outside the map nothing is skipped
+    int cameraSector = -1;
+    if (m_PvsCulling && !map.GetPvs().IsEmpty()) {
+        cameraSector = map.FindSector(viewpoint.x, viewpoint.z);
+        map.GetPvs().DecompressRow(cameraSector, m_PvsRow);
+    }
+    
+    // Of those, only sectors reachable through openings on screen right now
+    if (m_PortalCulling) {
+        m_Portals.Cull(map, viewProjection, viewpoint);
+        m_Stats.portalsTraversed = m_Portals.GetPortalsTraversed();
+    }
+    
+    // Counts a hidden sector against the stage that removed it
+    auto isHidden = [&](int sector, unsigned int& pvsCulled, unsigned int& portalCulled) {
+        if (cameraSector >= 0 && (m_PvsRow[sector >> 3] & (1 << (sector & 7))) == 0) {
+            pvsCulled++;
+            return true;
+        }
+        if (m_PortalCulling && !m_Portals.IsSectorVisible(sector)) {
+            portalCulled++;
+            return true;
+        }
+        return false;
+    };
+    
+    // Walls inside the frustum, in no particular order
+    m_CulledWalls.clear();
+    map.GetWallTree().Query(frustum, m_CulledWalls);
+    m_Stats.wallsCulled = static_cast<unsigned int>(map.GetWallCount() - m_CulledWalls.size());
+    m_CulledWalls.erase(std::remove_if(m_CulledWalls.begin(), m_CulledWalls.end(), [&](int wall) {
+                            return isHidden(map.GetWallSector(wall), m_Stats.wallsPvsCulled, m_Stats.wallsPortalCulled);
+                        }),
+                        m_CulledWalls.end());
+    m_Stats.wallsVisible = static_cast<unsigned int>(m_CulledWalls.size());
+    
+    m_VisibleSectors.clear();
+    map.GetSectorTree().Query(frustum, m_VisibleSectors);
+    m_Stats.sectorsCulled = static_cast<unsigned int>(map.GetSectors().size() - m_VisibleSectors.size());
+    m_VisibleSectors.erase(std::remove_if(m_VisibleSectors.begin(), m_VisibleSectors.end(), [&](int sector) {
+                               return isHidden(sector, m_Stats.sectorsPvsCulled, m_Stats.sectorsPortalCulled);
+                           }),
+                           m_VisibleSectors.end());
+    m_Stats.sectorsVisible = static_cast<unsigned int>(m_VisibleSectors.size());
+    
+    // Re-emit them nearest-first by walking the BSP, so the depth test rejects hidden pixels early
+    m_VisibleWalls.clear();
+    const BspTree& bsp = map.GetBsp();
+    if (bsp.IsEmpty()) {
+        m_VisibleWalls.swap(m_CulledWalls);
+        return;
+    }
+    
+    m_FrameNumber++;
+    for (int wall : m_CulledWalls) {
+        m_WallFrames[wall] = m_FrameNumber;
+    }
+    
+    // Optionally clip against walls already emitted, since they arrive front to back
+    if (m_OcclusionCulling) {
+        glm::vec3 front = player.GetFront();
+        float viewAngle = std::atan2(front.z, front.x);
+        m_SolidSegs.Begin(glm::vec2(viewpoint.x, viewpoint.z), viewAngle,
+                          OcclusionHalfFov(player, viewProjection, viewAngle));
+    }
+    
+    auto boxVisible = [&](const BspBounds& bounds) {
+        Aabb box;
+        box.min = glm::vec3(bounds.min.x, m_LevelMinY, bounds.min.y);
+        box.max = glm::vec3(bounds.max.x, m_LevelMaxY, bounds.max.y);
+        if (frustum.Test(box) == Frustum::OUTSIDE) {
+            return false;
+        }
+        return !m_OcclusionCulling || m_SolidSegs.IsBoxVisible(bounds);
+    };
+    
+    const auto& segs = bsp.GetSegs();
+    const auto& subsectors = bsp.GetSubsectors();
+    bsp.TraverseFrontToBack(glm::vec2(viewpoint.x, viewpoint.z), m_BspStack, boxVisible, [&](int subsectorIndex) {
+        const BspSubsector& subsector = subsectors[subsectorIndex];
+        for (int i = subsector.firstSeg; i < subsector.firstSeg + subsector.segCount; ++i) {
+            const BspSeg& seg = segs[i];
+            if (m_WallFrames[seg.wall] != m_FrameNumber) {
+                continue;
+            }
+            if (m_OcclusionCulling && !m_SolidSegs.ClipSegment(seg.start, seg.end, map.IsWallSolid(seg.wall))) {
+                continue;
+            }
             
-            // Upload vertices
-            glBindBuffer(GL_ARRAY_BUFFER, m_WallVBO);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-            
-            // Position attribute
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-            glEnableVertexAttribArray(0);
-            
-            // Texture coord attribute
-            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-            glEnableVertexAttribArray(1);
-            
-            // Set model matrix
-            glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, &model[0][0]);
-            
-            // Draw wall
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            // A wall split into several segs is emitted at its nearest visible piece
+            m_WallFrames[seg.wall] = 0;
+            m_VisibleWalls.push_back(seg.wall);
+        }
+        
+        // Once every column is covered nothing further away can show
+        return !(m_OcclusionCulling && m_SolidSegs.IsFull());
+    });
+    
+    m_Stats.wallsOccluded = static_cast<unsigned int>(m_CulledWalls.size() - m_VisibleWalls.size());
+}
+
+void Renderer::CullHiZ(const Map& map, const glm::mat4& viewProjection) {
+    // The nearest walls make the best occluders, and they are drawn anyway
+    const unsigned int maxOccluders = 256;
+    
+    m_HiZReady = false;
+    if (!m_HiZCulling) {
+        return;
+    }
+    
+    // Solid walls only; openings would hide what is behind them
+    m_HiZ.Begin(viewProjection);
+    size_t scanned = 0;
+    unsigned int occluderCount = 0;
+    for (; scanned < m_VisibleWalls.size() && occluderCount < maxOccluders; ++scanned) {
+        int wallIndex = m_VisibleWalls[scanned];
+        if (!map.IsWallSolid(wallIndex)) {
+            continue;
+        }
+        const Wall& wall = map.GetWall(wallIndex);
+        float bottom = map.GetSectors()[map.GetWallSector(wallIndex)].floorHeight;
+        float top = bottom + wall.height;
+        m_HiZ.AddOccluder(glm::vec3(wall.start.x, bottom, wall.start.y),
+                          glm::vec3(wall.start.x, top, wall.start.y),
+                          glm::vec3(wall.end.x, top, wall.end.y),
+                          glm::vec3(wall.end.x, bottom, wall.end.y));
+        occluderCount++;
+    }
+    m_HiZ.Rasterize();
+    m_HiZReady = true;
+    m_Stats.occludersRasterized = occluderCount;
+    
+    // Everything past the occluders is tested; order is kept for the depth test
+    size_t kept = scanned;
+    for (size_t i = scanned; i < m_VisibleWalls.size(); ++i) {
+        int wall = m_VisibleWalls[i];
+        if (IsBoxVisible(map.GetWallBounds(wall))) {
+            m_VisibleWalls[kept++] = wall;
+        } else {
+            m_Stats.wallsHiZCulled++;
+        }
+    }
+    m_VisibleWalls.resize(kept);
+    
+    kept = 0;
+    for (int sector : m_VisibleSectors) {
+        if (IsBoxVisible(map.GetSectorBounds(sector))) {
+            m_VisibleSectors[kept++] = sector;
+        } else {
+            m_Stats.sectorsHiZCulled++;
+        }
+    }
+    m_VisibleSectors.resize(kept);
+}
+
+bool Renderer::IsBoxVisible(const Aabb& box) {
+    if (!m_HiZReady) {
+        return true;
+    }
+    m_Stats.objectsTested++;
+    return m_HiZ.IsVisible(box);
+}
+
+float Renderer::OcclusionHalfFov(const Player& player, const glm::mat4& viewProjection, float viewAngle) const {
+    const float maxHalfFov = glm::pi<float>();
+    
+    // Looking far enough up or down puts the vertical axis in view, and with it every direction
+    float verticalHalfFov = std::atan(1.0f / m_Projection[1][1]);
+    if (std::fabs(glm::radians(player.GetPitch())) + verticalHalfFov >= glm::radians(89.0f)) {
+        return maxHalfFov;
+    }
+    
+    // Widest horizontal angle reached by the frustum's corner rays
+    glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+    glm::vec3 eye = player.GetPosition();
+    float halfFov = 0.0f;
+    for (float x : { -1.0f, 1.0f }) {
+        for (float y : { -1.0f, 1.0f }) {
+            glm::vec4 corner = inverseViewProjection * glm::vec4(x, y, 1.0f, 1.0f);
+            glm::vec3 ray = glm::vec3(corner) / corner.w - eye;
+            float angle = std::atan2(ray.z, ray.x) - viewAngle;
+            angle = std::atan2(std::sin(angle), std::cos(angle));
+            halfFov = std::max(halfFov, std::fabs(angle));
+        }
+    }
+    
+    // Small margin for rounding to columns
+    return std::min(halfFov + glm::radians(1.0f), maxHalfFov);
+}
+
+void Renderer::StreamTextures(const Player& player, const Map& map) {
+    // A texel covers about one pixel at the level where density * distance / focal is 1, with focal
+    // the pixels per world unit at distance 1. The nearest point of each bounding box and the face-on
+    // density both err toward sharper levels.
+    glm::vec3 eye = player.GetPosition();
+    float focal = m_Projection[1][1] * m_Height * 0.5f;
+    auto request = [&](int arrayIndex, float density, float distance) {
+        float texelsPerPixel = density * std::max(distance, 0.001f) / focal;
+        int level = texelsPerPixel > 1.0f ? static_cast<int>(std::floor(std::log2(texelsPerPixel))) : 0;
+        m_TextureStreamer.Request(arrayIndex, std::min(level, m_TextureArrays[arrayIndex]->GetLevels() - 1));
+    };
+    
+    m_TextureStreamer.BeginFrame();
+    for (int wall : m_VisibleWalls) {
+        if (m_WallArrays[wall] >= 0) {
+            request(m_WallArrays[wall], m_WallTexelDensity[wall], map.GetWallBounds(wall).DistanceTo(eye));
+        }
+    }
+    
+    // Flats drawn from the virtual texture need nothing from the arrays
+    if (!m_VirtualTexture) {
+        for (int sector : m_VisibleSectors) {
+            float distance = map.GetSectorBounds(sector).DistanceTo(eye);
+            for (int run = sector * 2; run < sector * 2 + 2; ++run) {
+                if (m_FlatRuns[run].arrayIndex >= 0) {
+                    request(m_FlatRuns[run].arrayIndex, m_FlatRuns[run].texelDensity, distance);
+                }
+            }
+        }
+    }
+    m_TextureStreamer.Update();
+    
+    const TextureStreamer::Stats& stats = m_TextureStreamer.GetStats();
+    m_Stats.textureBytesResident = stats.residentBytes;
+    m_Stats.textureBytesUploaded = stats.uploadedBytes;
+    m_Stats.texturePendingUploads = stats.pendingUploads;
+    m_Stats.textureEvictions = stats.evictions;
+}
+
+void Renderer::BuildWallRanges(const std::vector<int>& slots) {
+    // Merge consecutive walls that are also adjacent in the index buffer into one range
+    m_DrawCounts.clear();
+    m_DrawOffsets.clear();
+    for (size_t i = 0; i < slots.size(); ) {
+        size_t end = i + 1;
+        while (end < slots.size() && slots[end] == slots[end - 1] + 1) {
+            ++end;
+        }
+        m_DrawCounts.push_back(static_cast<GLsizei>((end - i) * 6));
+        m_DrawOffsets.push_back((const void*)(static_cast<size_t>(slots[i]) * 6 * sizeof(GLuint)));
+        i = end;
+    }
+}
+
+void Renderer::RenderWalls() {
+    // Group the visible walls by texture array, keeping their front-to-back order
+    m_ArraySlots.resize(m_TextureArrays.size());
+    for (auto& slots : m_ArraySlots) {
+        slots.clear();
+    }
+    unsigned int wallsSubmitted = 0;
+    for (int wall : m_VisibleWalls) {
+        if (m_WallSlots[wall] < 0) {
+            continue;
+        }
+        for (int piece = 0; piece < m_WallSlotCounts[wall]; ++piece) {
+            m_ArraySlots[m_WallArrays[wall]].push_back(m_WallSlots[wall] + piece);
         }
+        wallsSubmitted++;
     }
     
+    // Bind wall VAO
+    glBindVertexArray(m_WallVAO);
+    
+    // Walls are static, so the model matrix is identity for all of them
+    glm::mat4 model = glm::mat4(1.0f);
+    m_LevelShader->Set(m_LevelUniforms.model, model);
+    m_LevelShader->Set(m_LevelUniforms.textureSampler, 0);
+    
+    // One texture bind and one multi-draw per texture array
+    for (size_t arrayIndex = 0; arrayIndex < m_ArraySlots.size(); ++arrayIndex) {
+        const std::vector<int>& slots = m_ArraySlots[arrayIndex];
+        if (slots.empty()) {
+            continue;
+        }
+        
+        BuildWallRanges(slots);
+        m_TextureArrays[arrayIndex]->Bind(0);
+        m_Stats.textureBinds++;
+        
+        glMultiDrawElements(GL_TRIANGLES, m_DrawCounts.data(), GL_UNSIGNED_INT,
+                            m_DrawOffsets.data(), static_cast<GLsizei>(m_DrawCounts.size()));
+        m_Stats.drawCalls++;
+    }
+    m_Stats.wallsSubmitted = wallsSubmitted;
+    
     // Unbind VAO
     glBindVertexArray(0);
 }
 
-void Renderer::RenderFloorAndCeiling(const Player& player, const Map& map) {
-    // Similar implementation to RenderWalls but for floor and ceiling
-    // This is a simplified version
-    
-    GLuint shader = m_ShaderManager->GetShader("basic");
+void Renderer::RenderFloorAndCeiling() {
+    // Floor and ceiling runs of the visible sectors, grouped by texture array in buffer order
+    m_ArrayFlats.resize(m_TextureArrays.size());
+    for (auto& runs : m_ArrayFlats) {
+        runs.clear();
+    }
+    unsigned int flatsSubmitted = 0;
+    for (int sector : m_VisibleSectors) {
+        for (int run = sector * 2; run < sector * 2 + 2; ++run) {
+            if (m_FlatRuns[run].arrayIndex >= 0) {
+                m_ArrayFlats[m_FlatRuns[run].arrayIndex].push_back(run);
+                flatsSubmitted++;
+            }
+        }
+    }
     
-    // Bind floor VAO
     glBindVertexArray(m_FloorVAO);
     
-    // For each sector in the map
-    for (const auto& sector : map.GetSectors()) {
-        // Set floor texture
-        m_Textures[sector.floorTextureId]->Bind(0);
-        glUniform1i(glGetUniformLocation(shader, "textureSampler"), 0);
+    // Flats are static too, so the model matrix stays identity
+    m_LevelShader->Set(m_LevelUniforms.model, glm::mat4(1.0f));
+    m_LevelShader->Set(m_LevelUniforms.textureSampler, 0);
+    
+    // One texture bind and one multi-draw per texture array
+    for (size_t arrayIndex = 0; arrayIndex < m_ArrayFlats.size(); ++arrayIndex) {
+        std::vector<int>& runs = m_ArrayFlats[arrayIndex];
+        if (runs.empty()) {
+            continue;
+        }
         
-        // Create model matrix for floor
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, sector.floorHeight, 0.0f));
+        // Runs of neighbouring sectors are usually adjacent in the buffer and merge into one range
+        std::sort(runs.begin(), runs.end());
+        m_DrawFirsts.clear();
+        m_DrawCounts.clear();
+        for (int run : runs) {
+            const FlatRun& flat = m_FlatRuns[run];
+            if (!m_DrawFirsts.empty() && m_DrawFirsts.back() + m_DrawCounts.back() == flat.first) {
+                m_DrawCounts.back() += flat.count;
+            } else {
+                m_DrawFirsts.push_back(flat.first);
+                m_DrawCounts.push_back(flat.count);
+            }
+        }
         
-        // Set model matrix
-        glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, &model[0][0]);
+        m_TextureArrays[arrayIndex]->Bind(0);
+        m_Stats.textureBinds++;
         
-        // Draw floor (simplified - in a real game, we would create proper floor geometry)
-        // For now, just a placeholder
+        glMultiDrawArrays(GL_TRIANGLES, m_DrawFirsts.data(), m_DrawCounts.data(),
+                          static_cast<GLsizei>(m_DrawFirsts.size()));
+        m_Stats.drawCalls++;
     }
+    m_Stats.flatsSubmitted = flatsSubmitted;
     
-    // Unbind VAO
+    glBindVertexArray(0);
+}
+
+void Renderer::RenderVirtualFlats() {
+    // Every visible floor in one draw and every ceiling in another; no texture arrays are involved
+    unsigned int flatsSubmitted = 0;
+    for (int half = 0; half < 2; ++half) {
+        m_VirtualRuns.clear();
+        for (int sector : m_VisibleSectors) {
+            const FlatRun& flat = m_FlatRuns[sector * 2 + half];
+            if (flat.arrayIndex >= 0) {
+                m_VirtualRuns.emplace_back(flat.first, flat.count);
+            }
+        }
+        std::sort(m_VirtualRuns.begin(), m_VirtualRuns.end());
+        flatsSubmitted += static_cast<unsigned int>(m_VirtualRuns.size());
+        
+        m_VirtualFirsts[half].clear();
+        m_VirtualCounts[half].clear();
+        for (const auto& [first, count] : m_VirtualRuns) {
+            if (!m_VirtualFirsts[half].empty() && m_VirtualFirsts[half].back() + m_VirtualCounts[half].back() == first) {
+                m_VirtualCounts[half].back() += count;
+            } else {
+                m_VirtualFirsts[half].push_back(first);
+                m_VirtualCounts[half].push_back(count);
+            }
+        }
+    }
+    m_Stats.flatsSubmitted = flatsSubmitted;
+    
+    m_VirtualShader->Use();
+    m_VirtualShader->Set(m_VirtualUniforms.atlasSampler, static_cast<int>(ATLAS_TEXTURE_SLOT));
+    m_VirtualShader->Set(m_VirtualUniforms.indirectionSampler, static_cast<int>(INDIRECTION_TEXTURE_SLOT));
+    m_VirtualShader->Set(m_VirtualUniforms.paletteTint, m_PaletteTint);
+    m_VirtualTexture->Bind(ATLAS_TEXTURE_SLOT, INDIRECTION_TEXTURE_SLOT);
+    m_Stats.textureBinds++;
+    DrawVirtualFlats(*m_VirtualShader, m_VirtualUniforms);
+}
+
+void Renderer::RenderFeedback() {
+    m_VirtualTexture->BeginFeedback(m_Width, m_Height);
+    m_FeedbackShader->Use();
+    m_FeedbackShader->Set(m_FeedbackUniforms.feedbackBias, -std::log2(static_cast<float>(VirtualTexture::FEEDBACK_SCALE)));
+    
+    // Walls only hide the flats behind them, so they go into depth alone
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glBindVertexArray(m_WallVAO);
+    for (const std::vector<int>& slots : m_ArraySlots) {
+        if (slots.empty()) {
+            continue;
+        }
+        BuildWallRanges(slots);
+        glMultiDrawElements(GL_TRIANGLES, m_DrawCounts.data(), GL_UNSIGNED_INT,
+                            m_DrawOffsets.data(), static_cast<GLsizei>(m_DrawCounts.size()));
+        m_Stats.drawCalls++;
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    
+    DrawVirtualFlats(*m_FeedbackShader, m_FeedbackUniforms);
+    m_VirtualTexture->EndFeedback();
+}
+
+void Renderer::DrawVirtualFlats(const ShaderProgram& program, const VirtualUniforms& uniforms) {
+    // Floors fill the left half of the virtual texture and ceilings the right
+    program.Set(uniforms.virtualOrigin, m_FlatBaker->GetOrigin());
+    program.Set(uniforms.virtualScale, m_FlatBaker->GetScale());
+    program.Set(uniforms.virtualPages, m_VirtualTexture->GetPages());
+    program.Set(uniforms.virtualLevels, m_VirtualTexture->GetLevels());
+    
+    glBindVertexArray(m_FloorVAO);
+    for (int half = 0; half < 2; ++half) {
+        if (m_VirtualFirsts[half].empty()) {
+            continue;
+        }
+        program.Set(uniforms.virtualOffset, glm::vec2(half * 0.5f, 0.0f));
+        glMultiDrawArrays(GL_TRIANGLES, m_VirtualFirsts[half].data(), m_VirtualCounts[half].data(),
+                          static_cast<GLsizei>(m_VirtualFirsts[half].size()));
+        m_Stats.drawCalls++;
+    }
     glBindVertexArray(0);
 }
 
@@ -4,42 +4,278 @@
 #include <glm/glm-master/glm-master/glm/glm.hpp>
 #include <vector>
 #include <memory>
+#include <utility>
 
 #include "Player.h"
 #include "Map.h"
+#include "Frustum.h"
+#include "PortalCuller.h"
+#include "SolidSegClipper.h"
+#include "OcclusionCuller.h"
+#include "FlatBaker.h"
+#include "Palette.h"
 #include "ShaderManager.h"
-#include "Texture.h"
+#include "TextureArray.h"
+#include "TextureStreamer.h"
+#include "UniformBlocks.h"
+#include "VirtualTexture.h"
+
+// Counters reset at the start of every frame
+struct RenderStats {
+    unsigned int drawCalls = 0;
+    unsigned int textureBinds = 0;
+    unsigned int wallsSubmitted = 0;
+    unsigned int flatsSubmitted = 0;     // Floors and ceilings
+    
+    // Walls and sectors the camera's sector can never see
+    unsigned int wallsPvsCulled = 0;
+    unsigned int sectorsPvsCulled = 0;
+    
+    // Walls and sectors not reachable through openings on screen
+    unsigned int portalsTraversed = 0;
+    unsigned int wallsPortalCulled = 0;
+    unsigned int sectorsPortalCulled = 0;
+    
+    // Frustum culling
+    unsigned int wallsVisible = 0;
+    unsigned int wallsCulled = 0;
+    unsigned int sectorsVisible = 0;
+    unsigned int sectorsCulled = 0;
+    
+    // Walls inside the frustum but hidden behind nearer solid walls
+    unsigned int wallsOccluded = 0;
+    
+    // Hierarchical-Z test against the nearest walls rasterized on the CPU
+    unsigned int occludersRasterized = 0;
+    unsigned int objectsTested = 0;
+    unsigned int wallsHiZCulled = 0;
+    unsigned int sectorsHiZCulled = 0;
+    
+    // Texture streaming, in bytes of GPU memory; pending arrays are still coarser than requested
+    size_t textureBytesResident = 0;
+    size_t textureBytesUploaded = 0;
+    unsigned int texturePendingUploads = 0;
+    unsigned int textureEvictions = 0;
+    
+    // Virtual texture pages for floors and ceilings
+    unsigned int virtualPagesResident = 0;
+    unsigned int virtualPagesPending = 0;
+    unsigned int virtualPagesUploaded = 0;
+};
 
 class Renderer {
 public:
     Renderer(int width, int height);
     ~Renderer();
     
-    void Render(const Player& player, const Map& map);
+    // time is in seconds and is passed to shaders through the camera block
+    void Render(const Player& player, const Map& map, float time);
     void ResizeViewport(int width, int height);
     
+    // Counters for the most recent frame
+    const RenderStats& GetStats() const { return m_Stats; }
+    
+    // Skip sectors outside the camera sector's potentially visible set
+    void SetPvsCulling(bool enabled) { m_PvsCulling = enabled; }
+    bool GetPvsCulling() const { return m_PvsCulling; }
+    
+    // Only draw sectors reached from the camera's sector through visible openings
+    void SetPortalCulling(bool enabled) { m_PortalCulling = enabled; }
+    bool GetPortalCulling() const { return m_PortalCulling; }
+    
+    // Solid-segment occlusion culling on the CPU before walls are submitted
+    void SetOcclusionCulling(bool enabled) { m_OcclusionCulling = enabled; }
+    bool GetOcclusionCulling() const { return m_OcclusionCulling; }
+    
+    // Depth-buffer occlusion culling on the CPU, for walls, sectors and other objects
+    void SetHiZCulling(bool enabled) { m_HiZCulling = enabled; }
+    bool GetHiZCulling() const { return m_HiZCulling; }
+    
+    // Store level textures as palette indices and shade them through a colormap,
+    // as Doom does. Switching reloads the textures with the next frame.
+    void SetPaletted(bool enabled);
+    bool GetPaletted() const { return m_Paletted; }
+    
+    // Blend every color toward tint.rgb by tint.a, for damage flashes and pickups
+    void SetPaletteTint(const glm::vec4& tint) { m_PaletteTint = tint; }
+    
+    // GPU memory the level textures may take; fine mips of distant or hidden
+    // surfaces are dropped to stay under it. 0 keeps whatever is on screen.
+    void SetTextureBudget(size_t bytes) { m_TextureStreamer.SetBudget(bytes); }
+    size_t GetTextureBudget() const { return m_TextureStreamer.GetBudget(); }
+    
+    // Draw floors and ceilings from one virtual texture with unique detail baked
+    // in, instead of repeating their flats. Ignored while paletted. Switching
+    // rebuilds it with the next frame.
+    void SetVirtualTexturing(bool enabled);
+    bool GetVirtualTexturing() const { return m_VirtualTexturing; }
+    
+    // Test a world-space box against this frame's occluders; call after Render
+    bool IsBoxVisible(const Aabb& box);
+
 private:
     int m_Width;
     int m_Height;
     
     // Shader and texture management
     std::unique_ptr<ShaderManager> m_ShaderManager;
-    std::vector<std::unique_ptr<Texture>> m_Textures;
+    
+    // Level program and its uniforms, resolved once after loading
+    struct LevelUniforms {
+        Uniform<glm::mat4> model;
+        Uniform<int> textureSampler;
+        Uniform<int> paletted;
+        Uniform<int> paletteSampler;
+        Uniform<int> colormapSampler;
+        Uniform<glm::vec4> paletteTint;
+    };
+    const ShaderProgram* m_LevelShader;
+    LevelUniforms m_LevelUniforms;
+    
+    // Virtual texture programs for flats and for the feedback pass; each leaves
+    // the uniforms it does not have invalid
+    struct VirtualUniforms {
+        Uniform<glm::vec2> virtualOrigin;
+        Uniform<float> virtualScale;
+        Uniform<glm::vec2> virtualOffset;
+        Uniform<int> virtualPages;
+        Uniform<int> virtualLevels;
+        Uniform<int> atlasSampler;
+        Uniform<int> indirectionSampler;
+        Uniform<glm::vec4> paletteTint;
+        Uniform<float> feedbackBias;
+    };
+    const ShaderProgram* m_VirtualShader;
+    const ShaderProgram* m_FeedbackShader;
+    VirtualUniforms m_VirtualUniforms;
+    VirtualUniforms m_FeedbackUniforms;
+    
+    // Where a texture id lives: which array and which layer of it
+    struct MaterialSlot {
+        int arrayIndex;
+        int layer;
+    };
+    
+    // Textures are packed into one array per image size
+    std::vector<std::unique_ptr<TextureArray>> m_TextureArrays;
+    std::vector<MaterialSlot> m_Materials;
+    
+    // Keeps each array's fine levels resident only while visible surfaces need them.
+    // Declared after the arrays, which it points to.
+    TextureStreamer m_TextureStreamer;
+    
+    // Paletted mode: the arrays hold indices, looked up through the colormap
+    // (256 x Palette::LIGHT_LEVELS indices) and the palette (256 x 1 colors)
+    static constexpr unsigned int PALETTE_TEXTURE_SLOT = 1;
+    static constexpr unsigned int COLORMAP_TEXTURE_SLOT = 2;
+    bool m_Paletted;
+    glm::vec4 m_PaletteTint;
+    GLuint m_PaletteTexture;
+    GLuint m_ColormapTexture;
+    
+    // Virtual texturing: the baker paints pages for the texture, which is destroyed first
+    static constexpr unsigned int ATLAS_TEXTURE_SLOT = 3;
+    static constexpr unsigned int INDIRECTION_TEXTURE_SLOT = 4;
+    bool m_VirtualTexturing;
+    std::unique_ptr<FlatBaker> m_FlatBaker;
+    std::unique_ptr<VirtualTexture> m_VirtualTexture;
+    std::vector<GLint> m_VirtualFirsts[2];      // Visible floor and ceiling runs
+    std::vector<GLsizei> m_VirtualCounts[2];
+    std::vector<std::pair<GLint, GLsizei>> m_VirtualRuns;  // Scratch for sorting runs before merging them
     
     // OpenGL objects
     GLuint m_WallVAO;
     GLuint m_WallVBO;
+    GLuint m_WallEBO;
     GLuint m_FloorVAO;
     GLuint m_FloorVBO;
+    GLuint m_CameraUBO;
     
     // Projection matrix
     glm::mat4 m_Projection;
     
+    // Static level geometry, rebuilt only when the map revision changes.
+    // A slot is one quad, 6 consecutive indices starting at 6 * slot; each
+    // wall owns m_WallSlotCounts consecutive slots (two for a step and a lintel).
+    std::vector<int> m_WallSlots;
+    std::vector<int> m_WallSlotCounts;
+    std::vector<int> m_WallArrays;
+    
+    // Texels per world unit along each wall's denser axis, to pick the mip level it needs
+    std::vector<float> m_WallTexelDensity;
+    
+    // Floors and ceilings, unindexed triangles: sector i's floor is run 2 * i and
+    // its ceiling run 2 * i + 1. Runs are grouped by texture array, then by sector.
+    struct FlatRun {
+        int arrayIndex;     // -1 if there is nothing to draw
+        GLint first;
+        GLsizei count;
+        float texelDensity; // Texels per world unit
+    };
+    std::vector<FlatRun> m_FlatRuns;
+    
+    // Flats repeat every 2 units, as 64-unit Doom flats do at the importer's scale
+    static constexpr float FLAT_TEXTURE_SCALE = 0.5f;
+    
+    const Map* m_LevelMap;
+    unsigned int m_LevelRevision;
+    float m_LevelMinY;
+    float m_LevelMaxY;
+    
+    // Per-frame culling results and draw lists (kept to avoid reallocating).
+    // m_VisibleWalls is in front-to-back order.
+    unsigned int m_FrameNumber;
+    std::vector<unsigned int> m_WallFrames;
+    std::vector<int> m_CulledWalls;
+    std::vector<int> m_VisibleWalls;
+    std::vector<int> m_VisibleSectors;
+    std::vector<uint32_t> m_BspStack;
+    std::vector<std::vector<int>> m_ArraySlots;
+    std::vector<std::vector<int>> m_ArrayFlats;
+    std::vector<GLsizei> m_DrawCounts;
+    std::vector<GLint> m_DrawFirsts;
+    std::vector<const void*> m_DrawOffsets;
+    
+    // Camera sector's PVS row, one bit per sector
+    bool m_PvsCulling;
+    std::vector<uint8_t> m_PvsRow;
+    
+    // Sector flood through on-screen portals
+    bool m_PortalCulling;
+    PortalCuller m_Portals;
+    
+    // Angular occlusion buffer for the front-to-back wall walk
+    bool m_OcclusionCulling;
+    SolidSegClipper m_SolidSegs;
+    
+    // Depth buffer filled with the nearest visible walls
+    bool m_HiZCulling;
+    bool m_HiZReady;
+    OcclusionCuller m_HiZ;
+    
+    RenderStats m_Stats;
+    
     // Setup
     void InitRendering();
-    void LoadTextures();
+    void LoadTextures(const std::vector<std::string>& texturePaths);
+    void UploadPalette(const Palette& palette);
+    void BuildLevelGeometry(const Map& map);
+    void BuildFlatGeometry(const Map& map);
+    void BuildVirtualTexture(const Map& map);
+    void UpdateCameraBlock(const Player& player, const glm::mat4& view,
+                           const glm::mat4& viewProjection, float time);
+    void CullLevel(const Player& player, const Map& map, const glm::mat4& viewProjection);
+    float OcclusionHalfFov(const Player& player, const glm::mat4& viewProjection, float viewAngle) const;
+    void CullHiZ(const Map& map, const glm::mat4& viewProjection);
+    void StreamTextures(const Player& player, const Map& map);
     
     // Render components
-    void RenderWalls(const Player& player, const Map& map);
-    void RenderFloorAndCeiling(const Player& player, const Map& map);
+    void RenderWalls();
+    void RenderFloorAndCeiling();
+    void RenderVirtualFlats();
+    void RenderFeedback();
+    void DrawVirtualFlats(const ShaderProgram& program, const VirtualUniforms& uniforms);
+    
+    // Turn wall slots into index ranges in m_DrawCounts and m_DrawOffsets, merging consecutive slots
+    void BuildWallRanges(const std::vector<int>& slots);
 };
\ No newline at end of file
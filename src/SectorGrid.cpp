@@ -0,0 +1,85 @@
+#include "SectorGrid.h"
+
+void SectorGrid::Build(const std::vector<SectorTriangle>& triangles, float cellSize) {
+    Clear();
+    if (triangles.empty()) {
+        return;
+    }
+    
+    // Cover every triangle, with cell boundaries on whole multiples of the cell size
+    glm::vec2 minimum = triangles[0].a;
+    glm::vec2 maximum = triangles[0].a;
+    for (const auto& triangle : triangles) {
+        minimum = glm::min(minimum, glm::min(triangle.a, glm::min(triangle.b, triangle.c)));
+        maximum = glm::max(maximum, glm::max(triangle.a, glm::max(triangle.b, triangle.c)));
+    }
+    m_InverseCellSize = 1.0f / cellSize;
+    glm::vec2 firstCell = glm::floor(minimum * m_InverseCellSize);
+    glm::vec2 lastCell = glm::floor(maximum * m_InverseCellSize);
+    m_Origin = firstCell * cellSize;
+    m_Width = static_cast<unsigned>(lastCell.x - firstCell.x) + 1;
+    m_Height = static_cast<unsigned>(lastCell.y - firstCell.y) + 1;
+    size_t cellCount = static_cast<size_t>(m_Width) * m_Height;
+    
+    // Count each cell's triangles, turn the counts into offsets, then fill the cells in triangle order
+    auto forEachCell = [&](const SectorTriangle& triangle, auto&& visit) {
+        glm::vec2 low = glm::min(triangle.a, glm::min(triangle.b, triangle.c));
+        glm::vec2 high = glm::max(triangle.a, glm::max(triangle.b, triangle.c));
+        glm::ivec2 first = glm::ivec2(glm::floor((low - m_Origin) * m_InverseCellSize));
+        glm::ivec2 last = glm::ivec2(glm::floor((high - m_Origin) * m_InverseCellSize));
+        first = glm::max(first, glm::ivec2(0));
+        last = glm::min(last, glm::ivec2(m_Width - 1, m_Height - 1));
+        for (int z = first.y; z <= last.y; ++z) {
+            for (int x = first.x; x <= last.x; ++x) {
+                if (Overlaps(triangle, m_Origin + glm::vec2(x, z) * cellSize, cellSize)) {
+                    visit(static_cast<size_t>(z) * m_Width + x);
+                }
+            }
+        }
+    };
+    m_CellOffsets.assign(cellCount + 1, 0);
+    for (const auto& triangle : triangles) {
+        forEachCell(triangle, [&](size_t cell) { m_CellOffsets[cell + 1]++; });
+    }
+    for (size_t i = 0; i < cellCount; ++i) {
+        m_CellOffsets[i + 1] += m_CellOffsets[i];
+    }
+    
+    m_CellTriangles.resize(m_CellOffsets.back());
+    std::vector<uint32_t> next(m_CellOffsets.begin(), m_CellOffsets.end() - 1);
+    for (const auto& triangle : triangles) {
+        forEachCell(triangle, [&](size_t cell) { m_CellTriangles[next[cell]++] = triangle; });
+    }
+}
+
+bool SectorGrid::Overlaps(const SectorTriangle& triangle, const glm::vec2& corner, float size) {
+    // The boxes are known to overlap, so the square is only clear if it lies wholly outside one edge
+    const glm::vec2 corners[] = { corner, corner + glm::vec2(size, 0.0f), corner + glm::vec2(0.0f, size),
+                                  corner + glm::vec2(size) };
+    const glm::vec2* points[] = { &triangle.a, &triangle.b, &triangle.c };
+    for (int i = 0; i < 3; ++i) {
+        const glm::vec2& start = *points[i];
+        glm::vec2 edge = *points[(i + 1) % 3] - start;
+        bool outside = true;
+        for (const auto& point : corners) {
+            outside = outside && Cross(edge, point - start) < 0.0f;
+        }
+        if (outside) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SectorGrid::Clear() {
+    m_CellOffsets.clear();
+    m_CellTriangles.clear();
+    m_Width = 0;
+    m_Height = 0;
+}
+
+void SectorGrid::FindSectors(ArrayView<glm::vec2> points, int* sectors) const {
+    for (size_t i = 0; i < points.size(); ++i) {
+        sectors[i] = FindSector(points[i]);
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+
+#include "ArrayView.h"
+
+// Floor triangle given to SectorGrid::Build, counterclockwise in (x, z)
+struct SectorTriangle {
+    glm::vec2 a;
+    glm::vec2 b;
+    glm::vec2 c;
+    int sector;
+};
+
+// Point location over the sectors' floor triangles. Each square cell keeps a
+// copy of every triangle whose box overlaps it, so finding the sector under a
+// point reads one cell's triangles from a single run of memory and tests them
+// exactly. Triangles are left out of cells in their box that they miss.
+// Cells are stored row by row like the blockmap's.
+class SectorGrid {
+public:
+    void Build(const std::vector<SectorTriangle>& triangles, float cellSize);
+    void Clear();
+    
+    bool IsEmpty() const { return m_CellOffsets.empty(); }
+    
+    // Sector of the triangle containing the point, or -1 if no triangle does.
+    // Points on an edge shared by two sectors go to either one.
+    int FindSector(const glm::vec2& point) const {
+        int cellX = static_cast<int>(std::floor((point.x - m_Origin.x) * m_InverseCellSize));
+        int cellZ = static_cast<int>(std::floor((point.y - m_Origin.y) * m_InverseCellSize));
+        if (static_cast<unsigned>(cellX) >= m_Width || static_cast<unsigned>(cellZ) >= m_Height) {
+            return -1;
+        }
+        size_t cell = static_cast<size_t>(cellZ) * m_Width + cellX;
+        for (uint32_t i = m_CellOffsets[cell]; i < m_CellOffsets[cell + 1]; ++i) {
+            if (Contains(m_CellTriangles[i], point)) {
+                return m_CellTriangles[i].sector;
+            }
+        }
+        return -1;
+    }
+    
+    // Locate many points at once; sectors receives one sector or -1 per point
+    void FindSectors(ArrayView<glm::vec2> points, int* sectors) const;
+    
+    size_t GetMemoryUsage() const {
+        return m_CellOffsets.size() * sizeof(uint32_t) + m_CellTriangles.size() * sizeof(SectorTriangle);
+    }
+
+private:
+    std::vector<uint32_t> m_CellOffsets;
+    std::vector<SectorTriangle> m_CellTriangles;
+    glm::vec2 m_Origin = glm::vec2(0.0f);
+    float m_InverseCellSize = 1.0f;
+    unsigned m_Width = 0;
+    unsigned m_Height = 0;
+    
+    static float Cross(const glm::vec2& a, const glm::vec2& b) { return a.x * b.y - a.y * b.x; }
+    
+    // Inside or on the edge of a counterclockwise triangle
+    static bool Contains(const SectorTriangle& triangle, const glm::vec2& point) {
+        return Cross(triangle.b - triangle.a, point - triangle.a) >= 0.0f &&
+               Cross(triangle.c - triangle.b, point - triangle.b) >= 0.0f &&
+               Cross(triangle.a - triangle.c, point - triangle.c) >= 0.0f;
+    }
+    
+    // Whether a triangle may touch the square cell with the given lowest corner
+    static bool Overlaps(const SectorTriangle& triangle, const glm::vec2& corner, float size);
+};
@@ -1,14 +1,13 @@
 #include "ShaderManager.h"
+#include "UniformBlocks.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <stdexcept>
 
 ShaderManager::~ShaderManager() {
-    // Delete all shaders
-    for (auto& shader : m_Shaders) {
-        glDeleteProgram(shader.second);
-    }
+    // Delete all shaders (each ShaderProgram deletes its GL program)
+    m_Shaders.clear();
 }
 
 void ShaderManager::LoadShader(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath) {
@@ -33,6 +32,7 @@ void ShaderManager::LoadShader(const std::string& name, const std::string& verte
         if (!success) {
             GLchar infoLog[512];
             glGetProgramInfoLog(program, sizeof(infoLog), nullptr, infoLog);
+            glDeleteProgram(program);
             throw std::runtime_error("Shader program linking failed: " + std::string(infoLog));
         }
         
@@ -40,8 +40,9 @@ void ShaderManager::LoadShader(const std::string& name, const std::string& verte
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
         
-        // Store the shader program
-        m_Shaders[name] = program;
+        // Store the shader program along with its reflected interface
+        m_Shaders[name] = std::make_unique<ShaderProgram>(program);
+        BindSharedBlocks(*m_Shaders[name]);
     }
     catch (const std::exception& e) {
         std::cerr << "Failed to load shader: " << e.what() << std::endl;
@@ -55,12 +56,18 @@ void ShaderManager::LoadShader(const std::string& name, const std::string& verte
                 
                 out vec2 TexCoord;
                 
+                layout (std140) uniform Camera {
+                    mat4 view;
+                    mat4 projection;
+                    mat4 viewProjection;
+                    vec4 cameraPosition;
+                    vec4 time;
+                };
+                
                 uniform mat4 model;
-                uniform mat4 view;
-                uniform mat4 projection;
                 
                 void main() {
-                    gl_Position = projection * view * model * vec4(aPos, 1.0);
+                    gl_Position = viewProjection * model * vec4(aPos, 1.0);
                     TexCoord = aTexCoord;
                 }
             )";
@@ -89,7 +96,8 @@ void ShaderManager::LoadShader(const std::string& name, const std::string& verte
             glLinkProgram(program);
             
             // Store the fallback shader
-            m_Shaders[name] = program;
+            m_Shaders[name] = std::make_unique<ShaderProgram>(program);
+            BindSharedBlocks(*m_Shaders[name]);
             
             // Clean up
             glDeleteShader(vertexShader);
@@ -99,13 +107,23 @@ void ShaderManager::LoadShader(const std::string& name, const std::string& verte
 }
 
 GLuint ShaderManager::GetShader(const std::string& name) const {
+    const ShaderProgram* program = GetProgram(name);
+    return program ? program->GetId() : 0;
+}
+
+const ShaderProgram* ShaderManager::GetProgram(const std::string& name) const {
     auto it = m_Shaders.find(name);
     if (it != m_Shaders.end()) {
-        return it->second;
+        return it->second.get();
     }
     
     std::cerr << "Shader not found: " << name << std::endl;
-    return 0;
+    return nullptr;
+}
+
+void ShaderManager::BindSharedBlocks(const ShaderProgram& program) {
+    // Shared per-frame blocks live at fixed binding points
+    program.BindUniformBlock(CAMERA_BLOCK_NAME, CAMERA_BLOCK_BINDING);
 }
 
 GLuint ShaderManager::CompileShader(GLenum type, const std::string& source) {
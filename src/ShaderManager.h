@@ -1,9 +1,12 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
+#include "ShaderProgram.h"
+
 class ShaderManager {
 public:
     ShaderManager() = default;
@@ -12,9 +15,13 @@ public:
     void LoadShader(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath);
     GLuint GetShader(const std::string& name) const;
     
+    // Reflected program, or nullptr if no shader was loaded under this name
+    const ShaderProgram* GetProgram(const std::string& name) const;
+    
 private:
-    std::unordered_map<std::string, GLuint> m_Shaders;
+    std::unordered_map<std::string, std::unique_ptr<ShaderProgram>> m_Shaders;
     
     GLuint CompileShader(GLenum type, const std::string& source);
+    void BindSharedBlocks(const ShaderProgram& program);
     std::string ReadFile(const std::string& path);
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "ShaderProgram.h"
+#include <algorithm>
+#include <iostream>
+
+ShaderProgram::ShaderProgram(GLuint program)
+    : m_Program(program) {
+    Reflect();
+}
+
+ShaderProgram::~ShaderProgram() {
+    glDeleteProgram(m_Program);
+}
+
+void ShaderProgram::Reflect() {
+    std::vector<GLchar> nameBuffer;
+    
+    // Active uniforms
+    GLint uniformCount = 0;
+    GLint maxUniformName = 0;
+    glGetProgramiv(m_Program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(m_Program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxUniformName);
+    nameBuffer.resize(std::max(maxUniformName, 1));
+    m_Uniforms.reserve(uniformCount);
+    
+    for (GLint i = 0; i < uniformCount; ++i) {
+        GLsizei length = 0;
+        UniformInfo info;
+        glGetActiveUniform(m_Program, i, static_cast<GLsizei>(nameBuffer.size()), &length,
+                           &info.size, &info.type, nameBuffer.data());
+        info.name.assign(nameBuffer.data(), length);
+        
+        // Arrays are reported as "name[0]"; look them up by their base name
+        if (info.name.size() > 3 && info.name.compare(info.name.size() - 3, 3, "[0]") == 0) {
+            info.name.resize(info.name.size() - 3);
+        }
+        
+        GLuint index = static_cast<GLuint>(i);
+        glGetActiveUniformsiv(m_Program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &info.blockIndex);
+        info.location = glGetUniformLocation(m_Program, nameBuffer.data());
+        m_Uniforms.push_back(std::move(info));
+    }
+    
+    // Active vertex attributes
+    GLint attributeCount = 0;
+    GLint maxAttributeName = 0;
+    glGetProgramiv(m_Program, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+    glGetProgramiv(m_Program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxAttributeName);
+    nameBuffer.resize(std::max(maxAttributeName, 1));
+    m_Attributes.reserve(attributeCount);
+    
+    for (GLint i = 0; i < attributeCount; ++i) {
+        GLsizei length = 0;
+        AttributeInfo info;
+        glGetActiveAttrib(m_Program, i, static_cast<GLsizei>(nameBuffer.size()), &length,
+                          &info.size, &info.type, nameBuffer.data());
+        info.name.assign(nameBuffer.data(), length);
+        info.location = glGetAttribLocation(m_Program, nameBuffer.data());
+        m_Attributes.push_back(std::move(info));
+    }
+    
+    // Active uniform blocks
+    GLint blockCount = 0;
+    GLint maxBlockName = 0;
+    glGetProgramiv(m_Program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    glGetProgramiv(m_Program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockName);
+    nameBuffer.resize(std::max(maxBlockName, 1));
+    m_UniformBlocks.reserve(blockCount);
+    
+    for (GLint i = 0; i < blockCount; ++i) {
+        GLsizei length = 0;
+        UniformBlockInfo info;
+        info.index = static_cast<GLuint>(i);
+        glGetActiveUniformBlockName(m_Program, info.index, static_cast<GLsizei>(nameBuffer.size()),
+                                    &length, nameBuffer.data());
+        info.name.assign(nameBuffer.data(), length);
+        glGetActiveUniformBlockiv(m_Program, info.index, GL_UNIFORM_BLOCK_DATA_SIZE, &info.dataSize);
+        m_UniformBlocks.push_back(std::move(info));
+    }
+}
+
+const ShaderProgram::UniformInfo* ShaderProgram::FindUniform(const std::string& name) const {
+    for (const auto& uniform : m_Uniforms) {
+        if (uniform.name == name) {
+            return &uniform;
+        }
+    }
+    
+    // Not an error: the compiler strips uniforms the shader doesn't use
+    return nullptr;
+}
+
+GLint ShaderProgram::GetAttributeLocation(const std::string& name) const {
+    for (const auto& attribute : m_Attributes) {
+        if (attribute.name == name) {
+            return attribute.location;
+        }
+    }
+    return -1;
+}
+
+GLint ShaderProgram::GetUniformBlockIndex(const std::string& name) const {
+    for (const auto& block : m_UniformBlocks) {
+        if (block.name == name) {
+            return static_cast<GLint>(block.index);
+        }
+    }
+    return -1;
+}
+
+bool ShaderProgram::BindUniformBlock(const std::string& name, GLuint binding) const {
+    GLint index = GetUniformBlockIndex(name);
+    if (index < 0) {
+        return false;
+    }
+    
+    glUniformBlockBinding(m_Program, static_cast<GLuint>(index), binding);
+    return true;
+}
+
+bool ShaderProgram::IsTypeCompatible(GLenum requested, GLenum actual) {
+    if (requested == actual) {
+        return true;
+    }
+    
+    // Samplers and bools are set through integer uniforms
+    if (requested == GL_INT) {
+        switch (actual) {
+            case GL_BOOL:
+            case GL_SAMPLER_1D:
+            case GL_SAMPLER_2D:
+            case GL_SAMPLER_3D:
+            case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_2D_ARRAY:
+            case GL_SAMPLER_BUFFER:
+            case GL_INT_SAMPLER_2D:
+            case GL_UNSIGNED_INT_SAMPLER_2D:
+                return true;
+            default:
+                break;
+        }
+    }
+    
+    std::cerr << "Uniform type mismatch: requested 0x" << std::hex << requested
+              << ", shader declares 0x" << actual << std::dec << std::endl;
+    return false;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Typed handle to a uniform location, resolved once after linking
+template<typename T>
+struct Uniform {
+    GLint location = -1;
+    
+    bool IsValid() const { return location >= 0; }
+};
+
+// GL type enum that a uniform must have to be set through Uniform<T>
+template<typename T> struct UniformGLType;
+template<> struct UniformGLType<int> { static constexpr GLenum value = GL_INT; };
+template<> struct UniformGLType<float> { static constexpr GLenum value = GL_FLOAT; };
+template<> struct UniformGLType<glm::vec2> { static constexpr GLenum value = GL_FLOAT_VEC2; };
+template<> struct UniformGLType<glm::vec3> { static constexpr GLenum value = GL_FLOAT_VEC3; };
+template<> struct UniformGLType<glm::vec4> { static constexpr GLenum value = GL_FLOAT_VEC4; };
+template<> struct UniformGLType<glm::mat4> { static constexpr GLenum value = GL_FLOAT_MAT4; };
+
+// A linked shader program with its active uniforms, attributes and uniform
+// blocks reflected into flat tables at link time
+class ShaderProgram {
+public:
+    struct UniformInfo {
+        std::string name;
+        GLint location;     // -1 for uniforms inside a uniform block
+        GLenum type;
+        GLint size;         // Array length, 1 for non-arrays
+        GLint blockIndex;   // -1 for uniforms in the default block
+    };
+    
+    struct AttributeInfo {
+        std::string name;
+        GLint location;
+        GLenum type;
+        GLint size;
+    };
+    
+    struct UniformBlockInfo {
+        std::string name;
+        GLuint index;
+        GLint dataSize;
+    };
+    
+    // Takes ownership of a successfully linked program
+    explicit ShaderProgram(GLuint program);
+    ~ShaderProgram();
+    
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+    
+    void Use() const { glUseProgram(m_Program); }
+    GLuint GetId() const { return m_Program; }
+    
+    // Name lookups scan the reflected tables; call them at load time and keep the result
+    template<typename T>
+    Uniform<T> GetUniform(const std::string& name) const;
+    GLint GetAttributeLocation(const std::string& name) const;
+    GLint GetUniformBlockIndex(const std::string& name) const;
+    
+    // Attach a uniform block to a buffer binding point; false if the program doesn't use it
+    bool BindUniformBlock(const std::string& name, GLuint binding) const;
+    
+    // Setters apply to the currently bound program and never query the driver
+    void Set(Uniform<int> uniform, int value) const { glUniform1i(uniform.location, value); }
+    void Set(Uniform<float> uniform, float value) const { glUniform1f(uniform.location, value); }
+    void Set(Uniform<glm::vec2> uniform, const glm::vec2& value) const { glUniform2fv(uniform.location, 1, &value[0]); }
+    void Set(Uniform<glm::vec3> uniform, const glm::vec3& value) const { glUniform3fv(uniform.location, 1, &value[0]); }
+    void Set(Uniform<glm::vec4> uniform, const glm::vec4& value) const { glUniform4fv(uniform.location, 1, &value[0]); }
+    void Set(Uniform<glm::mat4> uniform, const glm::mat4& value) const { glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &value[0][0]); }
+    
+    const std::vector<UniformInfo>& GetUniforms() const { return m_Uniforms; }
+    const std::vector<AttributeInfo>& GetAttributes() const { return m_Attributes; }
+    const std::vector<UniformBlockInfo>& GetUniformBlocks() const { return m_UniformBlocks; }
+    
+private:
+    GLuint m_Program;
+    std::vector<UniformInfo> m_Uniforms;
+    std::vector<AttributeInfo> m_Attributes;
+    std::vector<UniformBlockInfo> m_UniformBlocks;
+    
+    void Reflect();
+    const UniformInfo* FindUniform(const std::string& name) const;
+    static bool IsTypeCompatible(GLenum requested, GLenum actual);
+};
+
+template<typename T>
+Uniform<T> ShaderProgram::GetUniform(const std::string& name) const {
+    Uniform<T> uniform;
+    const UniformInfo* info = FindUniform(name);
+    if (info && IsTypeCompatible(UniformGLType<T>::value, info->type)) {
+        uniform.location = info->location;
+    }
+    return uniform;
+}
@@ -0,0 +1,196 @@
+#include "SolidSegClipper.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const float PI = 3.14159265358979f;
+    const float TWO_PI = 2.0f * PI;
+    
+    // Wrap an angle into [-pi, pi)
+    float WrapAngle(float angle) {
+        angle = std::fmod(angle + PI, TWO_PI);
+        if (angle < 0.0f) {
+            angle += TWO_PI;
+        }
+        return angle - PI;
+    }
+    
+    float Cross(const glm::vec2& a, const glm::vec2& b) {
+        return a.x * b.y - a.y * b.x;
+    }
+}
+
+SolidSegClipper::SolidSegClipper(int columns)
+    : m_Columns(columns), m_Viewpoint(0.0f), m_ViewAngle(0.0f),
+      m_HalfFov(PI), m_FullCircle(true) {
+}
+
+void SolidSegClipper::Begin(const glm::vec2& viewpoint, float viewAngle, float halfFov) {
+    m_Viewpoint = viewpoint;
+    m_ViewAngle = viewAngle;
+    m_FullCircle = halfFov >= PI;
+    m_HalfFov = m_FullCircle ? PI : halfFov;
+    m_Solid.clear();
+}
+
+bool SolidSegClipper::SegmentSpan(const glm::vec2& start, const glm::vec2& end, float& fromAngle, float& sweep) const {
+    glm::vec2 a = start - m_Viewpoint;
+    glm::vec2 b = end - m_Viewpoint;
+    
+    // Viewer standing on the segment: it covers everything and nothing
+    glm::vec2 edge = b - a;
+    float lengthSquared = glm::dot(edge, edge);
+    float t = lengthSquared > 0.0f ? glm::clamp(-glm::dot(a, edge) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+    glm::vec2 closest = a + edge * t;
+    if (glm::dot(closest, closest) < 1e-8f) {
+        return false;
+    }
+    
+    // Angles relative to the view direction, swept counter-clockwise from the first
+    float angleA = WrapAngle(std::atan2(a.y, a.x) - m_ViewAngle);
+    float angleB = WrapAngle(std::atan2(b.y, b.x) - m_ViewAngle);
+    if (Cross(a, b) >= 0.0f) {
+        fromAngle = angleA;
+        sweep = WrapAngle(angleB - angleA);
+    } else {
+        fromAngle = angleB;
+        sweep = WrapAngle(angleA - angleB);
+    }
+    sweep = std::fabs(sweep);
+    return true;
+}
+
+int SolidSegClipper::ToColumns(float fromAngle, float sweep, Range spans[2], bool inner) const {
+    // Split spans that cross the back of the circle into two pieces
+    float pieces[2][2];
+    int pieceCount = 0;
+    float toAngle = fromAngle + sweep;
+    if (toAngle > PI) {
+        pieces[pieceCount][0] = fromAngle;
+        pieces[pieceCount][1] = PI;
+        pieceCount++;
+        pieces[pieceCount][0] = -PI;
+        pieces[pieceCount][1] = toAngle - TWO_PI;
+        pieceCount++;
+    } else {
+        pieces[pieceCount][0] = fromAngle;
+        pieces[pieceCount][1] = toAngle;
+        pieceCount++;
+    }
+    
+    float scale = m_Columns / (2.0f * m_HalfFov);
+    int spanCount = 0;
+    for (int i = 0; i < pieceCount; ++i) {
+        float lo = std::max(pieces[i][0], -m_HalfFov);
+        float hi = std::min(pieces[i][1], m_HalfFov);
+        if (lo > hi) {
+            continue;
+        }
+        
+        float first = (lo + m_HalfFov) * scale;
+        float last = (hi + m_HalfFov) * scale;
+        Range span;
+        if (inner) {
+            // Round both ends the same way so walls meeting at a vertex leave no gap
+            span.first = static_cast<int>(std::lround(first));
+            span.last = static_cast<int>(std::lround(last)) - 1;
+        } else {
+            span.first = static_cast<int>(std::floor(first));
+            span.last = static_cast<int>(std::floor(last));
+        }
+        span.first = std::max(span.first, 0);
+        span.last = std::min(span.last, m_Columns - 1);
+        if (span.first <= span.last) {
+            spans[spanCount++] = span;
+        }
+    }
+    return spanCount;
+}
+
+bool SolidSegClipper::ClipSegment(const glm::vec2& start, const glm::vec2& end, bool solid) {
+    float fromAngle, sweep;
+    if (!SegmentSpan(start, end, fromAngle, sweep)) {
+        return true;
+    }
+    
+    Range spans[2];
+    int spanCount = ToColumns(fromAngle, sweep, spans, false);
+    bool visible = false;
+    for (int i = 0; i < spanCount; ++i) {
+        if (!IsCovered(spans[i])) {
+            visible = true;
+        }
+    }
+    
+    if (visible && solid) {
+        spanCount = ToColumns(fromAngle, sweep, spans, true);
+        for (int i = 0; i < spanCount; ++i) {
+            AddSolid(spans[i]);
+        }
+    }
+    return visible;
+}
+
+bool SolidSegClipper::IsBoxVisible(const BspBounds& bounds) const {
+    // Viewer inside the box sees it in every direction
+    if (m_Viewpoint.x >= bounds.min.x && m_Viewpoint.x <= bounds.max.x &&
+        m_Viewpoint.y >= bounds.min.y && m_Viewpoint.y <= bounds.max.y) {
+        return true;
+    }
+    
+    // The box spans less than half a turn; measure its corners from the direction to its center
+    glm::vec2 center = (bounds.min + bounds.max) * 0.5f - m_Viewpoint;
+    float centerAngle = std::atan2(center.y, center.x);
+    const glm::vec2 corners[4] = {
+        glm::vec2(bounds.min.x, bounds.min.y), glm::vec2(bounds.max.x, bounds.min.y),
+        glm::vec2(bounds.max.x, bounds.max.y), glm::vec2(bounds.min.x, bounds.max.y)
+    };
+    float lo = 0.0f;
+    float hi = 0.0f;
+    for (const auto& corner : corners) {
+        glm::vec2 offset = corner - m_Viewpoint;
+        float angle = WrapAngle(std::atan2(offset.y, offset.x) - centerAngle);
+        lo = std::min(lo, angle);
+        hi = std::max(hi, angle);
+    }
+    
+    Range spans[2];
+    int spanCount = ToColumns(WrapAngle(centerAngle + lo - m_ViewAngle), hi - lo, spans, false);
+    for (int i = 0; i < spanCount; ++i) {
+        if (!IsCovered(spans[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SolidSegClipper::IsFull() const {
+    return m_Solid.size() == 1 && m_Solid[0].first == 0 && m_Solid[0].last == m_Columns - 1;
+}
+
+bool SolidSegClipper::IsCovered(const Range& span) const {
+    // First solid range that ends at or after the span's start
+    auto it = std::lower_bound(m_Solid.begin(), m_Solid.end(), span.first,
+                               [](const Range& range, int column) { return range.last < column; });
+    return it != m_Solid.end() && it->first <= span.first && it->last >= span.last;
+}
+
+void SolidSegClipper::AddSolid(const Range& span) {
+    // Find the ranges that overlap or touch the new one and merge them
+    auto first = std::lower_bound(m_Solid.begin(), m_Solid.end(), span.first,
+                                  [](const Range& range, int column) { return range.last + 1 < column; });
+    auto last = first;
+    Range merged = span;
+    while (last != m_Solid.end() && last->first <= span.last + 1) {
+        merged.first = std::min(merged.first, last->first);
+        merged.last = std::max(merged.last, last->last);
+        ++last;
+    }
+    
+    if (first == last) {
+        m_Solid.insert(first, merged);
+    } else {
+        *first = merged;
+        m_Solid.erase(first + 1, last);
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+#include <vector>
+
+#include "Bsp.h"
+
+// 1D angular occlusion buffer around the viewer, after Doom's "solidsegs".
+// Feed it walls front to back: each wall is visible if part of its angular
+// span is still open, and solid walls close the span they cover.
+class SolidSegClipper {
+public:
+    explicit SolidSegClipper(int columns = 2048);
+    
+    // Start a frame looking along viewAngle (radians, atan2(z, x) convention).
+    // Only angles within halfFov of the view direction are tracked; pass
+    // halfFov >= pi to track the full circle.
+    void Begin(const glm::vec2& viewpoint, float viewAngle, float halfFov);
+    
+    // True if part of the segment is still open. Solid segments also close
+    // the columns they fully cover.
+    bool ClipSegment(const glm::vec2& start, const glm::vec2& end, bool solid);
+    
+    // True if part of the box might be visible
+    bool IsBoxVisible(const BspBounds& bounds) const;
+    
+    // Every tracked column is covered; nothing further away can be seen
+    bool IsFull() const;
+    
+private:
+    // Inclusive range of covered columns
+    struct Range {
+        int first;
+        int last;
+    };
+    
+    int m_Columns;
+    glm::vec2 m_Viewpoint;
+    float m_ViewAngle;
+    float m_HalfFov;
+    bool m_FullCircle;
+    std::vector<Range> m_Solid;   // Sorted, disjoint and non-adjacent
+    
+    // Split an angular span into tracked column spans. Returns the number of
+    // spans written (0-2). Outer spans include every touched column; inner
+    // spans round to the nearest column boundary.
+    int ToColumns(float fromAngle, float sweep, Range spans[2], bool inner) const;
+    
+    // Angular span of a segment as seen from the viewpoint; false if the
+    // viewpoint is on the segment
+    bool SegmentSpan(const glm::vec2& start, const glm::vec2& end, float& fromAngle, float& sweep) const;
+    
+    bool IsCovered(const Range& span) const;
+    void AddSolid(const Range& span);
+};
@@ -1,13 +1,41 @@
 #include "Texture.h"
+#include "Image.h"
+#include "TextureCook.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb/stb-master/stb-master/stb_image.h>
-
 Texture::Texture(const std::string& path) 
     : m_TextureId(0), m_Width(0), m_Height(0), m_Channels(0) {
     
+    // A cooked copy already has its mips and needs no decoding
+    uint64_t hash;
+    CookedTexture cooked;
+    if (TextureCook::HashFile(path, hash) && cooked.Open(TextureCook::GetCachePath(hash)) &&
+        cooked.GetSourceHash() == hash && IsFormatSupported(cooked.GetFormat())) {
+        UploadCooked(cooked);
+        return;
+    }
+    
+    // Load image (falls back to a checkerboard if the file is missing)
+    Image image(path);
+    
+    GLenum format;
+    if (image.GetChannels() == 1)
+        format = GL_RED;
+    else if (image.GetChannels() == 3)
+        format = GL_RGB;
+    else if (image.GetChannels() == 4)
+        format = GL_RGBA;
+    else {
+        throw std::runtime_error("Unsupported number of channels: " + std::to_string(image.GetChannels()));
+    }
+    
+    m_Width = image.GetWidth();
+    m_Height = image.GetHeight();
+    m_Channels = image.GetChannels();
+    
     // Generate texture
     glGenTextures(1, &m_TextureId);
     glBindTexture(GL_TEXTURE_2D, m_TextureId);
@@ -18,67 +46,12 @@ Texture::Texture(const std::string& path)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     
-    // Load image
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char* data = stbi_load(path.c_str(), &m_Width, &m_Height, &m_Channels, 0);
+    // Rows of 1 and 3 channel images are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     
-    if (data) {
-        GLenum format;
-        if (m_Channels == 1)
-            format = GL_RED;
-        else if (m_Channels == 3)
-            format = GL_RGB;
-        else if (m_Channels == 4)
-            format = GL_RGBA;
-        else {
-            stbi_image_free(data);
-            throw std::runtime_error("Unsupported number of channels: " + std::to_string(m_Channels));
-        }
-        
-        // Create texture
-        glTexImage2D(GL_TEXTURE_2D, 0, format, m_Width, m_Height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        
-        stbi_image_free(data);
-    } else {
-        std::cerr << "Failed to load texture: " << path << std::endl;
-        
-        // Create a default checkerboard pattern as a fallback
-        const int checkerSize = 16;
-        const int size = checkerSize * 8; // 8x8 checker pattern
-        
-        unsigned char* checkerData = new unsigned char[size * size * 3];
-        
-        for (int y = 0; y < size; y++) {
-            for (int x = 0; x < size; x++) {
-                int idx = (y * size + x) * 3;
-                
-                bool isEvenRow = (y / checkerSize) % 2 == 0;
-                bool isEvenCol = (x / checkerSize) % 2 == 0;
-                
-                if (isEvenRow == isEvenCol) {
-                    // White square
-                    checkerData[idx] = 255;     // R
-                    checkerData[idx + 1] = 255; // G
-                    checkerData[idx + 2] = 255; // B
-                } else {
-                    // Magenta square (to make it obvious it's a missing texture)
-                    checkerData[idx] = 255;     // R
-                    checkerData[idx + 1] = 0;   // G
-                    checkerData[idx + 2] = 255; // B
-                }
-            }
-        }
-        
-        // Create fallback texture
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, checkerData);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        
-        delete[] checkerData;
-        m_Width = size;
-        m_Height = size;
-        m_Channels = 3;
-    }
+    // Create texture
+    glTexImage2D(GL_TEXTURE_2D, 0, format, m_Width, m_Height, 0, format, GL_UNSIGNED_BYTE, image.GetPixels());
+    glGenerateMipmap(GL_TEXTURE_2D);
     
     // Unbind texture
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -88,7 +61,71 @@ Texture::~Texture() {
     glDeleteTextures(1, &m_TextureId);
 }
 
+void Texture::UploadCooked(const CookedTexture& cooked) {
+    m_Width = cooked.GetWidth();
+    m_Height = cooked.GetHeight();
+    m_Channels = 4;
+    
+    glGenTextures(1, &m_TextureId);
+    glBindTexture(GL_TEXTURE_2D, m_TextureId);
+    
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, cooked.GetLevelCount() - 1);
+    
+    // Levels go to GL straight from the mapped file
+    GLenum internalFormat = GetInternalFormat(cooked.GetFormat());
+    for (int level = 0; level < cooked.GetLevelCount(); ++level) {
+        ArrayView<unsigned char> data = cooked.GetLevel(level);
+        int width = std::max(m_Width >> level, 1);
+        int height = std::max(m_Height >> level, 1);
+        if (cooked.GetFormat() == CookedFormat::Rgba8) {
+            glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+        } else {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0,
+                                   static_cast<GLsizei>(data.size()), data.data());
+        }
+    }
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool Texture::IsFormatSupported(CookedFormat format) {
+    if (format == CookedFormat::Rgba8 || format == CookedFormat::Index8) {
+        return true;
+    }
+    
+    // Extensions do not change for the life of the context, so look once
+    static const bool s3tc = []() {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+                return true;
+            }
+        }
+        return false;
+    }();
+    return s3tc;
+}
+
+GLenum Texture::GetInternalFormat(CookedFormat format) {
+    switch (format) {
+        case CookedFormat::Bc1:
+            return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case CookedFormat::Bc3:
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case CookedFormat::Index8:
+            return GL_R8;
+        default:
+            return GL_RGBA8;
+    }
+}
+
 void Texture::Bind(unsigned int slot) const {
     glActiveTexture(GL_TEXTURE0 + slot);
     glBindTexture(GL_TEXTURE_2D, m_TextureId);
-}
\ No newline at end of file
+}
@@ -3,8 +3,19 @@
 #include <glad/glad.h>
 #include <string>
 
+#include "CookedTexture.h"
+
+// S3TC is an extension rather than core GL, so the loader header may not name it
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 class Texture {
 public:
+    // Uses the cooked copy of the image from the texture cache if there is one
     Texture(const std::string& path);
     ~Texture();
     
@@ -12,9 +23,18 @@ public:
     
     GLuint GetId() const { return m_TextureId; }
     
+    // Whether the current context can sample textures in this format
+    static bool IsFormatSupported(CookedFormat format);
+    
+    // Internal format matching a cooked format
+    static GLenum GetInternalFormat(CookedFormat format);
+
 private:
     GLuint m_TextureId;
     int m_Width;
     int m_Height;
     int m_Channels;
-};
\ No newline at end of file
+    
+    // Upload every level of a cooked texture to the bound GL_TEXTURE_2D
+    void UploadCooked(const CookedTexture& cooked);
+};
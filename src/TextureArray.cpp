@@ -0,0 +1,157 @@
+#include "TextureArray.h"
+#include "Image.h"
+#include "Texture.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+TextureArray::TextureArray(int width, int height, int layers, CookedFormat format, int levels, int baseLevel)
+    : m_TextureId(0), m_Width(width), m_Height(height), m_Layers(layers), m_Format(format), m_Levels(levels),
+      m_BaseLevel(baseLevel) {
+    Allocate();
+}
+
+TextureArray::~TextureArray() {
+    glDeleteTextures(1, &m_TextureId);
+}
+
+void TextureArray::Allocate() {
+    // Generate texture
+    glGenTextures(1, &m_TextureId);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_TextureId);
+    
+    // Set texture parameters
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    
+    // Palette indices cannot be blended, so they are sampled from the nearest texel of the nearest level
+    bool indexed = m_Format == CookedFormat::Index8;
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                    indexed ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, indexed ? GL_NEAREST : GL_LINEAR);
+    
+    // Allocate storage for all layers, and for the resident levels when they come with the layers.
+    // GL level i holds level m_BaseLevel + i.
+    if (m_Levels == 0) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, m_Width, m_Height, m_Layers, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    } else {
+        GLenum internalFormat = Texture::GetInternalFormat(m_Format);
+        for (int level = m_BaseLevel; level < m_Levels; ++level) {
+            int levelWidth = std::max(m_Width >> level, 1);
+            int levelHeight = std::max(m_Height >> level, 1);
+            if (m_Format == CookedFormat::Rgba8 || indexed) {
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, level - m_BaseLevel, internalFormat, levelWidth, levelHeight,
+                             m_Layers, 0, indexed ? GL_RED : GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            } else {
+                GLsizei size = static_cast<GLsizei>(GetCookedLevelSize(m_Format, levelWidth, levelHeight) * m_Layers);
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level - m_BaseLevel, internalFormat, levelWidth,
+                                       levelHeight, m_Layers, 0, size, nullptr);
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, m_Levels - 1 - m_BaseLevel);
+    }
+    
+    // Unbind texture
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::Reallocate(int baseLevel) {
+    if (m_Levels == 0 || baseLevel < 0 || baseLevel >= m_Levels) {
+        throw std::runtime_error("Texture array cannot hold levels from " + std::to_string(baseLevel));
+    }
+    
+    // A new texture object rather than redefined levels, so the old storage is freed as a whole
+    glDeleteTextures(1, &m_TextureId);
+    m_BaseLevel = baseLevel;
+    Allocate();
+}
+
+void TextureArray::SetLayer(int layer, const Image& image) {
+    if (image.GetWidth() != m_Width || image.GetHeight() != m_Height || image.GetChannels() != 4 || m_Levels != 0) {
+        throw std::runtime_error("Image does not match texture array format");
+    }
+    
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_TextureId);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, m_Width, m_Height, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, image.GetPixels());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::SetLayer(int layer, const CookedTexture& texture) {
+    if (texture.GetWidth() != m_Width || texture.GetHeight() != m_Height || texture.GetFormat() != m_Format ||
+        texture.GetLevelCount() != m_Levels) {
+        throw std::runtime_error("Cooked texture does not match texture array format");
+    }
+    
+    // Levels go to GL straight from the mapped file
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_TextureId);
+    for (int level = m_BaseLevel; level < m_Levels; ++level) {
+        ArrayView<unsigned char> data = texture.GetLevel(level);
+        UploadLevel(layer, level, data.data(), data.size());
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::SetLayer(int layer, const std::vector<std::vector<unsigned char>>& levels) {
+    if (static_cast<int>(levels.size()) != m_Levels) {
+        throw std::runtime_error("Mip chain does not match texture array format");
+    }
+    
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_TextureId);
+    for (int level = m_BaseLevel; level < m_Levels; ++level) {
+        UploadLevel(layer, level, levels[level].data(), levels[level].size());
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::SetLevel(int layer, int level, const unsigned char* data, size_t size) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_TextureId);
+    UploadLevel(layer, level, data, size);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+size_t TextureArray::GetMemoryUsage(int baseLevel) const {
+    // Generated chains are counted like stored ones
+    size_t size = 0;
+    int levels = m_Levels > 0 ? m_Levels : static_cast<int>(std::log2(std::max(m_Width, m_Height))) + 1;
+    for (int level = baseLevel; level < levels; ++level) {
+        size += GetCookedLevelSize(m_Format, std::max(m_Width >> level, 1), std::max(m_Height >> level, 1));
+    }
+    return size * m_Layers;
+}
+
+void TextureArray::UploadLevel(int layer, int level, const unsigned char* data, size_t size) {
+    int levelWidth = std::max(m_Width >> level, 1);
+    int levelHeight = std::max(m_Height >> level, 1);
+    if (level < m_BaseLevel || level >= std::max(m_Levels, 1) ||
+        size != GetCookedLevelSize(m_Format, levelWidth, levelHeight)) {
+        throw std::runtime_error("Level does not match texture array format");
+    }
+    
+    GLint target = level - m_BaseLevel;
+    if (m_Format == CookedFormat::Rgba8) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, target, 0, 0, layer, levelWidth, levelHeight, 1,
+                        GL_RGBA, GL_UNSIGNED_BYTE, data);
+    } else if (m_Format == CookedFormat::Index8) {
+        // Rows of one byte per texel are not 4-byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, target, 0, 0, layer, levelWidth, levelHeight, 1,
+                        GL_RED, GL_UNSIGNED_BYTE, data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    } else {
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, target, 0, 0, layer, levelWidth, levelHeight, 1,
+                                  Texture::GetInternalFormat(m_Format), static_cast<GLsizei>(size), data);
+    }
+}
+
+void TextureArray::GenerateMipmaps() {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_TextureId);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::Bind(unsigned int slot) const {
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_TextureId);
+}
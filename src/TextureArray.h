@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+#include "CookedTexture.h"
+
+class Image;
+
+// A GL_TEXTURE_2D_ARRAY holding same-sized images, one per layer
+class TextureArray {
+public:
+    // levels == 0 allocates only the full-size level, for RGBA images whose
+    // mips GenerateMipmaps builds. Otherwise layers come with this many
+    // levels, of which only [baseLevel, levels) are given GPU storage.
+    TextureArray(int width, int height, int layers, CookedFormat format = CookedFormat::Rgba8, int levels = 0,
+                 int baseLevel = 0);
+    ~TextureArray();
+    
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+    
+    // Copy an RGBA image of this array's size into a layer
+    void SetLayer(int layer, const Image& image);
+    
+    // Copy the resident levels of a cooked texture of this array's size, format and level count into a layer
+    void SetLayer(int layer, const CookedTexture& texture);
+    
+    // Copy the resident levels of a mip chain in this array's format, largest level first, into a layer
+    void SetLayer(int layer, const std::vector<std::vector<unsigned char>>& levels);
+    
+    // Copy one resident level of one layer, in this array's format
+    void SetLevel(int layer, int level, const unsigned char* data, size_t size);
+    
+    // Replace the storage with empty storage for levels [baseLevel, levels).
+    // Texture coordinates are unaffected; the id changes.
+    void Reallocate(int baseLevel);
+    
+    // Rebuild the mip chain after all layers are set
+    void GenerateMipmaps();
+    
+    void Bind(unsigned int slot = 0) const;
+    
+    GLuint GetId() const { return m_TextureId; }
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+    int GetLayers() const { return m_Layers; }
+    CookedFormat GetFormat() const { return m_Format; }
+    int GetLevels() const { return m_Levels; }
+    int GetBaseLevel() const { return m_BaseLevel; }
+    
+    // GPU memory taken by all layers, for the resident levels or from another base level
+    size_t GetMemoryUsage() const { return GetMemoryUsage(m_BaseLevel); }
+    size_t GetMemoryUsage(int baseLevel) const;
+
+private:
+    GLuint m_TextureId;
+    int m_Width;
+    int m_Height;
+    int m_Layers;
+    CookedFormat m_Format;
+    int m_Levels;
+    int m_BaseLevel;
+    
+    void Allocate();
+    
+    // Upload one level of one layer; the array must be bound
+    void UploadLevel(int layer, int level, const unsigned char* data, size_t size);
+};
@@ -0,0 +1,209 @@
+#include "TextureCook.h"
+#include "Hash.h"
+#include "Image.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb/stb-master/stb-master/stb_dxt.h>
+
+// Box filtering works on whole RGBA pixels, one per SSE register
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TEXTURE_COOK_SSE
+#endif
+
+namespace {
+    // Linear values are looked up at this many steps, enough that every sRGB byte survives a round trip
+    const int LINEAR_STEPS = 16384;
+    
+    struct SrgbTables {
+        float toLinear[256];
+        unsigned char fromLinear[LINEAR_STEPS];
+        
+        SrgbTables() {
+            for (int i = 0; i < 256; ++i) {
+                float value = i / 255.0f;
+                toLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < LINEAR_STEPS; ++i) {
+                float value = static_cast<float>(i) / (LINEAR_STEPS - 1);
+                float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                fromLinear[i] = static_cast<unsigned char>(std::lround(std::clamp(encoded, 0.0f, 1.0f) * 255.0f));
+            }
+        }
+    };
+    
+    const SrgbTables& GetSrgbTables() {
+        static const SrgbTables tables;
+        return tables;
+    }
+    
+    // Runs body over [0, count) on the pool, or here if there is none
+    void ForEachRange(ThreadPool* pool, size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& body) {
+        if (pool) {
+            pool->ParallelFor(count, minChunk, body);
+        } else {
+            body(0, count);
+        }
+    }
+    
+    // Average 2x2 boxes of linear RGBA pixels. Odd edges reuse their last row or column.
+    void Downsample(const float* source, int width, int height, float* target, int targetWidth,
+                    size_t rowBegin, size_t rowEnd) {
+        for (size_t y = rowBegin; y < rowEnd; ++y) {
+            const float* row0 = source + static_cast<size_t>(std::min(static_cast<int>(y) * 2, height - 1)) * width * 4;
+            const float* row1 = source + static_cast<size_t>(std::min(static_cast<int>(y) * 2 + 1, height - 1)) * width * 4;
+            float* out = target + y * targetWidth * 4;
+            for (int x = 0; x < targetWidth; ++x) {
+                int x0 = std::min(x * 2, width - 1) * 4;
+                int x1 = std::min(x * 2 + 1, width - 1) * 4;
+#ifdef TEXTURE_COOK_SSE
+                __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+                                        _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+                _mm_storeu_ps(out + x * 4, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+                for (int c = 0; c < 4; ++c) {
+                    out[x * 4 + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+                }
+#endif
+            }
+        }
+    }
+    
+    unsigned char EncodeSrgb(float value) {
+        int index = static_cast<int>(value * (LINEAR_STEPS - 1) + 0.5f);
+        return GetSrgbTables().fromLinear[std::clamp(index, 0, LINEAR_STEPS - 1)];
+    }
+}
+
+std::string TextureCook::GetCachePath(uint64_t sourceHash, const std::string& directory) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.ctex", static_cast<unsigned long long>(sourceHash));
+    return directory + "/" + name;
+}
+
+bool TextureCook::HashFile(const std::string& path, uint64_t& hash) {
+    MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    hash = HashBytes(HASH_SEED, file.GetData(), file.GetSize());
+    return true;
+}
+
+std::vector<std::vector<unsigned char>> TextureCook::BuildMips(const unsigned char* pixels, int width, int height,
+                                                               ThreadPool* pool) {
+    const SrgbTables& tables = GetSrgbTables();
+    std::vector<std::vector<unsigned char>> levels;
+    levels.emplace_back(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    
+    // Filter in linear light; only the results are quantized, so error does not build up down the chain
+    std::vector<float> linear(static_cast<size_t>(width) * height * 4);
+    ForEachRange(pool, linear.size() / 4, 4096, [&](size_t begin, size_t end) {
+        for (size_t i = begin * 4; i < end * 4; i += 4) {
+            linear[i + 0] = tables.toLinear[pixels[i + 0]];
+            linear[i + 1] = tables.toLinear[pixels[i + 1]];
+            linear[i + 2] = tables.toLinear[pixels[i + 2]];
+            linear[i + 3] = pixels[i + 3] / 255.0f;
+        }
+    });
+    
+    std::vector<float> smaller;
+    while (width > 1 || height > 1) {
+        int targetWidth = std::max(width / 2, 1);
+        int targetHeight = std::max(height / 2, 1);
+        smaller.resize(static_cast<size_t>(targetWidth) * targetHeight * 4);
+        ForEachRange(pool, targetHeight, 16, [&](size_t begin, size_t end) {
+            Downsample(linear.data(), width, height, smaller.data(), targetWidth, begin, end);
+        });
+        
+        std::vector<unsigned char> level(smaller.size());
+        for (size_t i = 0; i < smaller.size(); i += 4) {
+            level[i + 0] = EncodeSrgb(smaller[i + 0]);
+            level[i + 1] = EncodeSrgb(smaller[i + 1]);
+            level[i + 2] = EncodeSrgb(smaller[i + 2]);
+            level[i + 3] = static_cast<unsigned char>(std::clamp(smaller[i + 3], 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+        levels.push_back(std::move(level));
+        
+        linear.swap(smaller);
+        width = targetWidth;
+        height = targetHeight;
+    }
+    return levels;
+}
+
+std::vector<unsigned char> TextureCook::Encode(const unsigned char* pixels, int width, int height,
+                                               CookedFormat format, ThreadPool* pool) {
+    if (format == CookedFormat::Rgba8) {
+        return std::vector<unsigned char>(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    }
+    
+    // Blocks past the right or bottom edge repeat the last column or row
+    bool alpha = format == CookedFormat::Bc3;
+    size_t blockSize = alpha ? 16 : 8;
+    int blocksWide = (width + 3) / 4;
+    int blocksHigh = (height + 3) / 4;
+    std::vector<unsigned char> encoded(GetCookedLevelSize(format, width, height));
+    ForEachRange(pool, blocksHigh, 4, [&](size_t begin, size_t end) {
+        unsigned char block[64];
+        for (size_t by = begin; by < end; ++by) {
+            for (int bx = 0; bx < blocksWide; ++bx) {
+                for (int y = 0; y < 4; ++y) {
+                    int sourceY = std::min(static_cast<int>(by) * 4 + y, height - 1);
+                    for (int x = 0; x < 4; ++x) {
+                        int sourceX = std::min(bx * 4 + x, width - 1);
+                        const unsigned char* pixel = pixels + (static_cast<size_t>(sourceY) * width + sourceX) * 4;
+                        std::copy(pixel, pixel + 4, block + (y * 4 + x) * 4);
+                    }
+                }
+                stb_compress_dxt_block(&encoded[(by * blocksWide + bx) * blockSize], block, alpha, STB_DXT_HIGHQUAL);
+            }
+        }
+    });
+    return encoded;
+}
+
+bool TextureCook::HasAlpha(const unsigned char* pixels, int width, int height) {
+    size_t size = static_cast<size_t>(width) * height * 4;
+    for (size_t i = 3; i < size; i += 4) {
+        if (pixels[i] != 255) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TextureCook::Cook(const std::string& sourcePath, const std::string& outputPath,
+                       std::optional<CookedFormat> format, ThreadPool* pool) {
+    uint64_t hash;
+    if (!HashFile(sourcePath, hash)) {
+        std::cerr << "Could not read " << sourcePath << std::endl;
+        return false;
+    }
+    
+    // A checkerboard is only a stand-in at load time; cooking one would hide the broken source
+    Image image(sourcePath, 4);
+    if (image.IsFallback()) {
+        return false;
+    }
+    
+    int width = image.GetWidth();
+    int height = image.GetHeight();
+    if (!format) {
+        format = HasAlpha(image.GetPixels(), width, height) ? CookedFormat::Bc3 : CookedFormat::Bc1;
+    }
+    
+    std::vector<std::vector<unsigned char>> levels = BuildMips(image.GetPixels(), width, height, pool);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        levels[i] = Encode(levels[i].data(), std::max(width >> i, 1), std::max(height >> i, 1), *format, pool);
+    }
+    return CookedTexture::Write(outputPath, *format, width, height, hash, levels);
+}
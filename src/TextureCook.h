@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "CookedTexture.h"
+
+class ThreadPool;
+
+// Offline preparation of textures: decode the source once, build its mip
+// chain, compress it and store the result where the renderer looks for it.
+// Loaders find cooked copies by hashing the source, so an edited image is
+// simply decoded at load again until it is re-cooked.
+class TextureCook {
+public:
+    // Cooked copies live here, named by the source file's content hash
+    static constexpr const char* CACHE_DIRECTORY = "resources/cooked";
+    
+    // Where the cooked copy of a source with this content hash is kept
+    static std::string GetCachePath(uint64_t sourceHash, const std::string& directory = CACHE_DIRECTORY);
+    
+    // Hash of the file's contents. Returns false if it cannot be read.
+    static bool HashFile(const std::string& path, uint64_t& hash);
+    
+    // Mip chain of an RGBA image, from the image itself down to 1x1. Each level
+    // averages 2x2 boxes of the one above in linear light: color channels are
+    // converted from sRGB first and back after, alpha is filtered as it is.
+    static std::vector<std::vector<unsigned char>> BuildMips(const unsigned char* pixels, int width, int height,
+                                                             ThreadPool* pool);
+    
+    // Encode one RGBA level; block compression is split across the pool
+    static std::vector<unsigned char> Encode(const unsigned char* pixels, int width, int height,
+                                             CookedFormat format, ThreadPool* pool);
+    
+    // Whether any pixel is less than fully opaque
+    static bool HasAlpha(const unsigned char* pixels, int width, int height);
+    
+    // Decode sourcePath and write its cooked form to outputPath. Without a
+    // format, images with alpha become BC3 and opaque ones BC1.
+    static bool Cook(const std::string& sourcePath, const std::string& outputPath,
+                     std::optional<CookedFormat> format, ThreadPool* pool);
+};
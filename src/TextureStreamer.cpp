@@ -0,0 +1,135 @@
+#include "TextureStreamer.h"
+#include <climits>
+
+void TextureStreamer::Clear() {
+    m_Entries.clear();
+    m_Stats = Stats();
+}
+
+int TextureStreamer::AddArray(TextureArray* array, std::vector<LayerSource> layers) {
+    int residentLevel = GetResidentLevel(array->GetWidth(), array->GetHeight(), array->GetLevels());
+    Entry entry = { array, std::move(layers), residentLevel, INT_MAX, residentLevel, m_Frame };
+    m_Entries.push_back(std::move(entry));
+    return static_cast<int>(m_Entries.size()) - 1;
+}
+
+int TextureStreamer::GetResidentLevel(int width, int height, int levels) {
+    int level = 0;
+    while (level + 1 < levels && std::max(width >> level, height >> level) > RESIDENT_SIZE) {
+        ++level;
+    }
+    return level;
+}
+
+void TextureStreamer::BeginFrame() {
+    ++m_Frame;
+    for (Entry& entry : m_Entries) {
+        entry.requested = INT_MAX;
+    }
+}
+
+void TextureStreamer::Update() {
+    m_Stats.uploadedBytes = 0;
+    m_Stats.evictions = 0;
+    
+    // Sharper requests take effect at once; coarser ones once the sharper level has gone unused for a while
+    std::vector<int> targets(m_Entries.size());
+    for (size_t i = 0; i < m_Entries.size(); ++i) {
+        Entry& entry = m_Entries[i];
+        int requested = std::min(entry.requested, entry.residentLevel);
+        if (requested <= entry.wanted) {
+            entry.wanted = requested;
+            entry.wantedFrame = m_Frame;
+        } else if (m_Frame - entry.wantedFrame > KEEP_FRAMES) {
+            entry.wanted = requested;
+            entry.wantedFrame = m_Frame;
+        }
+        targets[i] = entry.wanted;
+    }
+    
+    // Over budget, coarsen arrays one level at a time: first those not seen this frame, then those
+    // whose finest level frees the most
+    if (m_Budget > 0) {
+        size_t total = 0;
+        for (size_t i = 0; i < m_Entries.size(); ++i) {
+            total += m_Entries[i].array->GetMemoryUsage(targets[i]);
+        }
+        while (total > m_Budget) {
+            int best = -1;
+            bool bestUnseen = false;
+            size_t bestSaving = 0;
+            for (size_t i = 0; i < m_Entries.size(); ++i) {
+                const Entry& entry = m_Entries[i];
+                if (targets[i] >= entry.residentLevel) {
+                    continue;
+                }
+                bool unseen = entry.requested == INT_MAX;
+                size_t saving = entry.array->GetMemoryUsage(targets[i]) - entry.array->GetMemoryUsage(targets[i] + 1);
+                if (best < 0 || (unseen && !bestUnseen) || (unseen == bestUnseen && saving > bestSaving)) {
+                    best = static_cast<int>(i);
+                    bestUnseen = unseen;
+                    bestSaving = saving;
+                }
+            }
+            if (best < 0) {
+                break;
+            }
+            ++targets[best];
+            total -= bestSaving;
+        }
+        for (size_t i = 0; i < m_Entries.size(); ++i) {
+            m_Entries[i].wanted = std::max(m_Entries[i].wanted, targets[i]);
+        }
+    }
+    
+    // Drop levels first, so the memory is free before anything new is uploaded. Dropping re-uploads
+    // the levels kept, which counts against this frame's upload allowance.
+    std::vector<int> sharpen;
+    for (size_t i = 0; i < m_Entries.size(); ++i) {
+        Entry& entry = m_Entries[i];
+        int base = entry.array->GetBaseLevel();
+        if (targets[i] > base) {
+            m_Stats.uploadedBytes += MakeResident(entry, targets[i]);
+            ++m_Stats.evictions;
+        } else if (targets[i] < base) {
+            sharpen.push_back(static_cast<int>(i));
+        }
+    }
+    
+    // The arrays furthest from what they need go first
+    std::sort(sharpen.begin(), sharpen.end(), [&](int a, int b) {
+        int gapA = m_Entries[a].array->GetBaseLevel() - targets[a];
+        int gapB = m_Entries[b].array->GetBaseLevel() - targets[b];
+        return gapA != gapB ? gapA > gapB : a < b;
+    });
+    m_Stats.pendingUploads = 0;
+    for (int index : sharpen) {
+        if (m_Stats.uploadedBytes >= UPLOAD_BYTES_PER_FRAME) {
+            ++m_Stats.pendingUploads;
+            continue;
+        }
+        m_Stats.uploadedBytes += MakeResident(m_Entries[index], targets[index]);
+    }
+    
+    m_Stats.residentBytes = 0;
+    for (const Entry& entry : m_Entries) {
+        m_Stats.residentBytes += entry.array->GetMemoryUsage();
+    }
+}
+
+size_t TextureStreamer::MakeResident(Entry& entry, int baseLevel) {
+    TextureArray* array = entry.array;
+    if (baseLevel != array->GetBaseLevel()) {
+        array->Reallocate(baseLevel);
+    }
+    
+    size_t uploaded = 0;
+    for (int layer = 0; layer < static_cast<int>(entry.layers.size()); ++layer) {
+        for (int level = baseLevel; level < array->GetLevels(); ++level) {
+            ArrayView<unsigned char> data = entry.layers[layer].GetLevel(level);
+            array->SetLevel(layer, level, data.data(), data.size());
+            uploaded += data.size();
+        }
+    }
+    return uploaded;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "ArrayView.h"
+#include "CookedTexture.h"
+#include "TextureArray.h"
+
+// Keeps the fine mip levels of texture arrays in GPU memory only while
+// something on screen needs them. Every level of every layer stays in CPU
+// memory; an array's GPU storage holds levels [base, levels) and is
+// reallocated when base moves. Residency is per array, since the layers of a
+// GL array share their levels.
+//
+// Each frame, the renderer requests the finest level each array needs, then
+// calls Update. Finer levels are uploaded a few megabytes per frame; levels
+// no longer requested are dropped after a while, or at once if the arrays
+// would not fit the budget otherwise.
+class TextureStreamer {
+public:
+    // Arrays are allocated no finer than this many texels across, and never drop below it
+    static constexpr int RESIDENT_SIZE = 64;
+    
+    // Frames a level is kept after the last request for it
+    static constexpr unsigned int KEEP_FRAMES = 120;
+    
+    // Upload at most this much per frame, including levels re-uploaded when arrays are coarsened.
+    // A frame with nothing else to upload still sharpens one array, however large.
+    static constexpr size_t UPLOAD_BYTES_PER_FRAME = 8 * 1024 * 1024;
+    
+    // One layer's levels, largest first: a cooked texture's mapping, or levels built at load
+    struct LayerSource {
+        std::unique_ptr<CookedTexture> cooked;
+        std::vector<std::vector<unsigned char>> levels;
+        
+        ArrayView<unsigned char> GetLevel(int level) const {
+            return cooked ? cooked->GetLevel(level) : ArrayView<unsigned char>(levels[level]);
+        }
+    };
+    
+    struct Stats {
+        size_t residentBytes = 0;
+        size_t uploadedBytes = 0;           // This frame
+        unsigned int pendingUploads = 0;    // Arrays still coarser than requested
+        unsigned int evictions = 0;         // This frame
+    };
+    
+    // Bytes of GPU memory all arrays may use together; 0 for no limit. The
+    // coarse levels up to RESIDENT_SIZE are always kept, so it is a target
+    // rather than a hard cap.
+    void SetBudget(size_t bytes) { m_Budget = bytes; }
+    size_t GetBudget() const { return m_Budget; }
+    
+    // Forget every array; call before the arrays are destroyed
+    void Clear();
+    
+    // Stream an array with explicit levels, one source per layer, whose current levels are already
+    // uploaded. Returns the index to request levels with.
+    int AddArray(TextureArray* array, std::vector<LayerSource> layers);
+    
+    // Coarsest level of an array that is at most RESIDENT_SIZE texels across
+    static int GetResidentLevel(int width, int height, int levels);
+    
+    // Start a frame; requests made before the next Update count for it
+    void BeginFrame();
+    
+    // Ask for an array's level to be resident this frame
+    void Request(int arrayIndex, int level) {
+        Entry& entry = m_Entries[arrayIndex];
+        entry.requested = std::min(entry.requested, level);
+    }
+    
+    // Apply this frame's requests: drop unneeded levels, then upload needed ones
+    void Update();
+    
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    struct Entry {
+        TextureArray* array;
+        std::vector<LayerSource> layers;
+        int residentLevel;          // Coarse levels from here on are always kept
+        int requested;              // Finest level asked for this frame
+        int wanted;                 // Finest level asked for within KEEP_FRAMES
+        unsigned int wantedFrame;
+    };
+    
+    std::vector<Entry> m_Entries;
+    size_t m_Budget = 0;
+    unsigned int m_Frame = 0;
+    Stats m_Stats;
+    
+    // Reallocate an array to hold levels [baseLevel, levels) and upload them; returns the bytes uploaded
+    size_t MakeResident(Entry& entry, int baseLevel);
+};
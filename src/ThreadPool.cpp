@@ -0,0 +1,121 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(size_t threadCount)
+    : m_Stopping(false) {
+    if (threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+    
+    m_Workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Condition.notify_all();
+    
+    for (auto& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::GetShared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::Enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Tasks.push_back(std::move(task));
+    }
+    m_Condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Condition.wait(lock, [this]() { return m_Stopping || !m_Tasks.empty(); });
+            if (m_Stopping && m_Tasks.empty()) {
+                return;
+            }
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    
+    // Enough chunks to keep every thread busy, but none smaller than minChunk
+    size_t threads = m_Workers.size() + 1;
+    size_t chunk = std::max<size_t>(std::max<size_t>(minChunk, 1), (count + threads * 4 - 1) / (threads * 4));
+    size_t chunkCount = (count + chunk - 1) / chunk;
+    if (chunkCount <= 1 || m_Workers.empty()) {
+        body(0, count);
+        return;
+    }
+    
+    // Workers and the caller pull chunk indices until none are left
+    struct Shared {
+        std::atomic<size_t> nextChunk{ 0 };
+        std::atomic<size_t> doneChunks{ 0 };
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+    auto shared = std::make_shared<Shared>();
+    
+    auto runChunks = [shared, &body, count, chunk, chunkCount]() {
+        for (;;) {
+            size_t index = shared->nextChunk.fetch_add(1);
+            if (index >= chunkCount) {
+                return;
+            }
+            
+            try {
+                size_t begin = index * chunk;
+                body(begin, std::min(begin + chunk, count));
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                if (!shared->error) {
+                    shared->error = std::current_exception();
+                }
+            }
+            
+            if (shared->doneChunks.fetch_add(1) + 1 == chunkCount) {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->done.notify_all();
+            }
+        }
+    };
+    
+    size_t helpers = std::min(m_Workers.size(), chunkCount - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+        Enqueue(runChunks);
+    }
+    runChunks();
+    
+    // body is only referenced until the last chunk finishes
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->done.wait(lock, [&shared, chunkCount]() { return shared->doneChunks.load() == chunkCount; });
+    if (shared->error) {
+        std::rethrow_exception(shared->error);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads fed from a single task queue
+class ThreadPool {
+public:
+    // threadCount == 0 picks one worker per hardware thread, minus the caller's
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    // Pool shared by loaders and per-frame jobs
+    static ThreadPool& GetShared();
+    
+    size_t GetThreadCount() const { return m_Workers.size(); }
+    
+    // Queue a task; the future carries its result or exception
+    template<typename Function>
+    auto Submit(Function&& function) -> std::future<decltype(function())>;
+    
+    // Run body(begin, end) over [0, count) split into chunks of at least
+    // minChunk items, on the workers and the calling thread. Blocks until done;
+    // the first exception thrown by a chunk is rethrown here.
+    void ParallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& body);
+    
+private:
+    std::vector<std::thread> m_Workers;
+    std::deque<std::function<void()>> m_Tasks;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_Stopping;
+    
+    void Enqueue(std::function<void()> task);
+    void WorkerLoop();
+};
+
+template<typename Function>
+auto ThreadPool::Submit(Function&& function) -> std::future<decltype(function())> {
+    using Result = decltype(function());
+    
+    // packaged_task is move-only, std::function needs copyable, so share it
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+    std::future<Result> future = task->get_future();
+    
+    if (m_Workers.empty()) {
+        (*task)();
+    } else {
+        Enqueue([task]() { (*task)(); });
+    }
+    return future;
+}
@@ -0,0 +1,344 @@
+#include "Triangulate.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace {
+    float Cross(const glm::vec2& a, const glm::vec2& b) {
+        return a.x * b.y - a.y * b.x;
+    }
+    
+    // Positive when a -> b -> c turns left
+    float Turn(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c) {
+        return Cross(b - a, c - b);
+    }
+    
+    // Angle swept clockwise from one direction to another, in (0, 2 pi]
+    float ClockwiseAngle(const glm::vec2& from, const glm::vec2& to) {
+        float angle = std::atan2(Cross(to, from), glm::dot(from, to));
+        const float fullTurn = 6.28318531f;
+        return angle <= 0.0f ? angle + fullTurn : angle;
+    }
+    
+    // Inside or on the edge, for either winding
+    bool IsInTriangle(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b, const glm::vec2& c) {
+        float ab = Cross(b - a, p - a);
+        float bc = Cross(c - b, p - b);
+        float ca = Cross(a - c, p - c);
+        bool negative = ab < 0.0f || bc < 0.0f || ca < 0.0f;
+        bool positive = ab > 0.0f || bc > 0.0f || ca > 0.0f;
+        return !(negative && positive);
+    }
+    
+    float SignedArea(ArrayView<glm::vec2> vertices, const std::vector<int>& loop) {
+        float area = 0.0f;
+        for (size_t i = 0; i < loop.size(); ++i) {
+            area += Cross(vertices[loop[i]], vertices[loop[(i + 1) % loop.size()]]);
+        }
+        return area * 0.5f;
+    }
+    
+    bool IsInLoop(ArrayView<glm::vec2> vertices, const std::vector<int>& loop, const glm::vec2& point) {
+        bool inside = false;
+        for (size_t i = 0; i < loop.size(); ++i) {
+            const glm::vec2& a = vertices[loop[i]];
+            const glm::vec2& b = vertices[loop[(i + 1) % loop.size()]];
+            if ((a.y > point.y) != (b.y > point.y) && point.x < a.x + (point.y - a.y) * (b.x - a.x) / (b.y - a.y)) {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+    
+    // Chain edges into closed loops. Where several edges leave a vertex, take
+    // the sharpest left turn, which keeps to the region's own boundary.
+    bool BuildLoops(ArrayView<glm::vec2> vertices, const std::vector<std::pair<int, int>>& edges,
+                    std::vector<std::vector<int>>& loops) {
+        std::vector<std::pair<int, int>> sorted;
+        sorted.reserve(edges.size());
+        for (const auto& edge : edges) {
+            if (edge.first != edge.second && vertices[edge.first] != vertices[edge.second]) {
+                sorted.push_back(edge);
+            }
+        }
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<uint8_t> used(sorted.size(), 0);
+        
+        bool closed = true;
+        for (size_t first = 0; first < sorted.size(); ++first) {
+            if (used[first]) {
+                continue;
+            }
+            used[first] = 1;
+            std::vector<int> loop(1, sorted[first].first);
+            size_t current = first;
+            while (sorted[current].second != sorted[first].first) {
+                int vertex = sorted[current].second;
+                glm::vec2 back = vertices[sorted[current].first] - vertices[vertex];
+                auto range = std::equal_range(sorted.begin(), sorted.end(), std::make_pair(vertex, 0),
+                                              [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+                                                  return a.first < b.first;
+                                              });
+                size_t next = sorted.size();
+                float bestAngle = std::numeric_limits<float>::max();
+                for (auto it = range.first; it != range.second; ++it) {
+                    size_t candidate = static_cast<size_t>(it - sorted.begin());
+                    if (used[candidate]) {
+                        continue;
+                    }
+                    float angle = ClockwiseAngle(back, vertices[it->second] - vertices[vertex]);
+                    if (angle < bestAngle) {
+                        bestAngle = angle;
+                        next = candidate;
+                    }
+                }
+                if (next == sorted.size()) {
+                    break;
+                }
+                used[next] = 1;
+                loop.push_back(vertex);
+                current = next;
+            }
+            
+            if (sorted[current].second != sorted[first].first) {
+                closed = false;
+            } else if (loop.size() >= 3) {
+                loops.push_back(std::move(loop));
+            }
+        }
+        return closed;
+    }
+    
+    // Whether point lies inside the polygon's corner at position
+    bool IsInCorner(ArrayView<glm::vec2> vertices, const std::vector<int>& polygon, size_t position,
+                    const glm::vec2& point) {
+        size_t count = polygon.size();
+        const glm::vec2& previous = vertices[polygon[(position + count - 1) % count]];
+        const glm::vec2& corner = vertices[polygon[position]];
+        const glm::vec2& next = vertices[polygon[(position + 1) % count]];
+        bool leftOfIncoming = Cross(corner - previous, point - corner) >= 0.0f;
+        bool leftOfOutgoing = Cross(next - corner, point - corner) >= 0.0f;
+        return Turn(previous, corner, next) >= 0.0f ? leftOfIncoming && leftOfOutgoing : leftOfIncoming || leftOfOutgoing;
+    }
+    
+    // Join a hole to the polygon around it by a pair of coincident edges from
+    // the hole's rightmost vertex to a polygon vertex it can see (Eberly's method)
+    bool BridgeHole(ArrayView<glm::vec2> vertices, std::vector<int>& polygon, const std::vector<int>& hole) {
+        size_t rightmost = 0;
+        for (size_t i = 1; i < hole.size(); ++i) {
+            const glm::vec2& vertex = vertices[hole[i]];
+            const glm::vec2& best = vertices[hole[rightmost]];
+            if (vertex.x > best.x || (vertex.x == best.x && vertex.y > best.y)) {
+                rightmost = i;
+            }
+        }
+        glm::vec2 m = vertices[hole[rightmost]];
+        
+        // Nearest polygon edge crossed by a ray from m towards +x
+        size_t count = polygon.size();
+        size_t edge = count;
+        float hitX = std::numeric_limits<float>::max();
+        for (size_t i = 0; i < count; ++i) {
+            const glm::vec2& a = vertices[polygon[i]];
+            const glm::vec2& b = vertices[polygon[(i + 1) % count]];
+            if ((a.y > m.y) == (b.y > m.y) && a.y != m.y && b.y != m.y) {
+                continue;
+            }
+            float x;
+            if (a.y == b.y) {
+                x = std::min(a.x, b.x) >= m.x ? std::min(a.x, b.x) : std::max(a.x, b.x);
+            } else {
+                x = a.x + (m.y - a.y) * (b.x - a.x) / (b.y - a.y);
+            }
+            if (x >= m.x && x < hitX) {
+                hitX = x;
+                edge = i;
+            }
+        }
+        if (edge == count) {
+            return false;
+        }
+        
+        // The edge's end farthest along the ray is visible unless other vertices lie
+        // in the triangle between it, m and the hit; then the one nearest the ray is
+        glm::vec2 hit(hitX, m.y);
+        size_t a = edge;
+        size_t b = (edge + 1) % count;
+        size_t bridge = vertices[polygon[a]].x > vertices[polygon[b]].x ? a : b;
+        if (vertices[polygon[a]] == hit) {
+            bridge = a;
+        } else if (vertices[polygon[b]] == hit) {
+            bridge = b;
+        } else {
+            glm::vec2 end = vertices[polygon[bridge]];
+            float bestAngle = std::numeric_limits<float>::max();
+            float bestDistance = std::numeric_limits<float>::max();
+            for (size_t i = 0; i < count; ++i) {
+                const glm::vec2& vertex = vertices[polygon[i]];
+                if (vertex == end || vertex == m || !IsInTriangle(vertex, m, hit, end)) {
+                    continue;
+                }
+                glm::vec2 offset = vertex - m;
+                float angle = std::atan2(std::abs(offset.y), offset.x);
+                float distance = glm::dot(offset, offset);
+                if (angle < bestAngle || (angle == bestAngle && distance < bestDistance)) {
+                    bestAngle = angle;
+                    bestDistance = distance;
+                    bridge = i;
+                }
+            }
+        }
+        
+        // Earlier bridges repeat vertices; use the copy whose corner faces m
+        for (size_t i = 0; i < count; ++i) {
+            if (polygon[i] == polygon[bridge] && IsInCorner(vertices, polygon, i, m)) {
+                bridge = i;
+                break;
+            }
+        }
+        
+        // ... bridge, m, around the hole back to m, bridge, ...
+        std::vector<int> spliced;
+        spliced.reserve(count + hole.size() + 2);
+        spliced.insert(spliced.end(), polygon.begin(), polygon.begin() + bridge + 1);
+        for (size_t i = 0; i <= hole.size(); ++i) {
+            spliced.push_back(hole[(rightmost + i) % hole.size()]);
+        }
+        spliced.insert(spliced.end(), polygon.begin() + bridge, polygon.end());
+        polygon.swap(spliced);
+        return true;
+    }
+    
+    void ClipEars(ArrayView<glm::vec2> vertices, const std::vector<int>& polygon, std::vector<int>& triangles) {
+        size_t count = polygon.size();
+        if (count < 3) {
+            return;
+        }
+        std::vector<size_t> previous(count);
+        std::vector<size_t> next(count);
+        for (size_t i = 0; i < count; ++i) {
+            previous[i] = (i + count - 1) % count;
+            next[i] = (i + 1) % count;
+        }
+        auto position = [&](size_t i) -> const glm::vec2& { return vertices[polygon[i]]; };
+        auto remove = [&](size_t i) {
+            next[previous[i]] = next[i];
+            previous[next[i]] = previous[i];
+            count--;
+        };
+        auto emit = [&](size_t i) {
+            triangles.push_back(polygon[previous[i]]);
+            triangles.push_back(polygon[i]);
+            triangles.push_back(polygon[next[i]]);
+        };
+        
+        // An ear is a convex corner with no other vertex in its triangle; vertices
+        // repeated by hole bridges sit on its corners and do not count
+        auto isEar = [&](size_t i) {
+            const glm::vec2& a = position(previous[i]);
+            const glm::vec2& b = position(i);
+            const glm::vec2& c = position(next[i]);
+            if (Turn(a, b, c) <= 0.0f) {
+                return false;
+            }
+            for (size_t j = next[next[i]]; j != previous[i]; j = next[j]) {
+                const glm::vec2& p = position(j);
+                if (p != a && p != b && p != c && IsInTriangle(p, a, b, c)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        
+        size_t current = 0;
+        size_t stalled = 0;
+        while (count > 3) {
+            float turn = Turn(position(previous[current]), position(current), position(next[current]));
+            if (turn == 0.0f || isEar(current)) {
+                // Straight corners add nothing and are dropped without a triangle
+                if (turn != 0.0f) {
+                    emit(current);
+                }
+                remove(current);
+                current = previous[current];
+                stalled = 0;
+                continue;
+            }
+            if (++stalled > count) {
+                // No ear left, which only happens with self-intersecting input: cut one anyway
+                if (turn > 0.0f) {
+                    emit(current);
+                }
+                remove(current);
+                stalled = 0;
+            }
+            current = next[current];
+        }
+        if (Turn(position(previous[current]), position(current), position(next[current])) > 0.0f) {
+            emit(current);
+        }
+    }
+}
+
+bool TriangulateRegion(ArrayView<glm::vec2> vertices, const std::vector<std::pair<int, int>>& edges,
+                       std::vector<int>& triangles) {
+    std::vector<std::vector<int>> loops;
+    bool complete = BuildLoops(vertices, edges, loops);
+    
+    // Outlines run counterclockwise around the region, holes clockwise
+    std::vector<size_t> outlines;
+    std::vector<size_t> holes;
+    std::vector<float> areas(loops.size());
+    for (size_t i = 0; i < loops.size(); ++i) {
+        areas[i] = SignedArea(vertices, loops[i]);
+        if (areas[i] > 0.0f) {
+            outlines.push_back(i);
+        } else if (areas[i] < 0.0f) {
+            holes.push_back(i);
+        }
+    }
+    
+    // Each hole belongs to the smallest outline around a point just inside it
+    std::vector<std::vector<size_t>> outlineHoles(loops.size());
+    for (size_t hole : holes) {
+        const glm::vec2& start = vertices[loops[hole][0]];
+        const glm::vec2& end = vertices[loops[hole][1]];
+        glm::vec2 direction = end - start;
+        glm::vec2 right = glm::vec2(direction.y, -direction.x) / glm::length(direction);
+        glm::vec2 probe = (start + end) * 0.5f + right * std::min(0.01f, glm::length(direction) * 0.1f);
+        size_t owner = loops.size();
+        for (size_t outline : outlines) {
+            if (IsInLoop(vertices, loops[outline], probe) && (owner == loops.size() || areas[outline] < areas[owner])) {
+                owner = outline;
+            }
+        }
+        if (owner == loops.size()) {
+            complete = false;
+            continue;
+        }
+        outlineHoles[owner].push_back(hole);
+    }
+    
+    for (size_t outline : outlines) {
+        // Bridge holes from right to left so each bridge only crosses holes already joined
+        std::vector<size_t>& ownHoles = outlineHoles[outline];
+        auto maxX = [&](size_t loop) {
+            float x = -std::numeric_limits<float>::max();
+            for (int vertex : loops[loop]) {
+                x = std::max(x, vertices[vertex].x);
+            }
+            return x;
+        };
+        std::sort(ownHoles.begin(), ownHoles.end(), [&](size_t a, size_t b) { return maxX(a) > maxX(b); });
+        
+        std::vector<int> polygon = loops[outline];
+        for (size_t hole : ownHoles) {
+            if (!BridgeHole(vertices, polygon, loops[hole])) {
+                complete = false;
+            }
+        }
+        ClipEars(vertices, polygon, triangles);
+    }
+    return complete;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+
+#include "ArrayView.h"
+
+// Triangulate the region on the left of a set of directed edges between
+// shared vertices, such as a sector's walls. The edges are chained into
+// closed loops: counterclockwise loops are outlines, clockwise loops are holes
+// and are joined to the outline around them before ear clipping.
+//
+// Appends one vertex index triple per triangle, counterclockwise in (x, y),
+// to triangles. Returns false if some edges did not close into loops or some
+// holes lay outside every outline; the rest of the region is still filled.
+bool TriangulateRegion(ArrayView<glm::vec2> vertices, const std::vector<std::pair<int, int>>& edges,
+                       std::vector<int>& triangles);
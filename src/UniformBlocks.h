@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm-master/glm-master/glm/glm.hpp>
+
+// Fixed binding points for uniform blocks shared by all programs.
+// ShaderManager binds any block with a matching name when a program is loaded.
+enum UniformBlockBinding : GLuint {
+    CAMERA_BLOCK_BINDING = 0
+};
+
+// Name of the camera block as declared in the shaders
+constexpr const char* CAMERA_BLOCK_NAME = "Camera";
+
+// CPU mirror of the std140 "Camera" block:
+//
+//     layout (std140) uniform Camera {
+//         mat4 view;
+//         mat4 projection;
+//         mat4 viewProjection;
+//         vec4 cameraPosition;   // xyz = eye position
+//         vec4 time;             // x = seconds since start
+//     };
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 cameraPosition;
+    glm::vec4 time;
+};
+
+static_assert(sizeof(CameraBlock) == 3 * 64 + 2 * 16, "CameraBlock must match the std140 layout");
@@ -0,0 +1,340 @@
+#include "VirtualTexture.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    uint32_t PackEntry(int slot, int level) {
+        int x = slot % VirtualTexture::ATLAS_PAGES;
+        int y = slot / VirtualTexture::ATLAS_PAGES;
+        return static_cast<uint32_t>(x) | static_cast<uint32_t>(y) << 8 | static_cast<uint32_t>(level) << 16 |
+               0xFFu << 24;
+    }
+}
+
+VirtualTexture::VirtualTexture(int pages, PageSource source, ThreadPool* pool)
+    : m_Pages(pages), m_Levels(0), m_Source(std::move(source)), m_Pool(pool),
+      m_AtlasTexture(0), m_IndirectionTexture(0), m_Frame(1), m_IndirectionDirty(true),
+      m_FeedbackFramebuffer(0), m_FeedbackColor(0), m_FeedbackDepth(0), m_FeedbackWidth(0), m_FeedbackHeight(0),
+      m_SavedFramebuffer(0), m_SavedViewport(), m_FeedbackNext(0) {
+    if (pages < 1 || pages > MAX_PAGES || (pages & (pages - 1)) != 0) {
+        throw std::runtime_error("Virtual texture cannot be " + std::to_string(pages) + " pages across");
+    }
+    
+    // Number the pages of every level down to the single page of the coarsest
+    int pageCount = 0;
+    for (int levelPages = pages; levelPages >= 1; levelPages /= 2) {
+        m_LevelFirstPage.push_back(pageCount);
+        m_Indirection.emplace_back(static_cast<size_t>(levelPages) * levelPages, 0);
+        pageCount += levelPages * levelPages;
+        ++m_Levels;
+    }
+    m_PageSlots.assign(pageCount, NOT_RESIDENT);
+    m_PageFrames.assign(pageCount, 0);
+    m_Slots.resize(ATLAS_PAGES * ATLAS_PAGES);
+    
+    // Atlas slots are addressed exactly, so it has a single level
+    glGenTextures(1, &m_AtlasTexture);
+    glBindTexture(GL_TEXTURE_2D, m_AtlasTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ATLAS_SIZE, ATLAS_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    
+    // The indirection texture is fetched per texel and level
+    glGenTextures(1, &m_IndirectionTexture);
+    glBindTexture(GL_TEXTURE_2D, m_IndirectionTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_Levels - 1);
+    for (int level = 0; level < m_Levels; ++level) {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, pages >> level, pages >> level, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    // The coarsest page is what every page falls back to, so it is produced up front and kept
+    std::vector<unsigned char> pixels(static_cast<size_t>(PADDED_PAGE_SIZE) * PADDED_PAGE_SIZE * 4);
+    m_Source(m_Levels - 1, 0, 0, pixels.data());
+    int root = GetPageId(m_Levels - 1, 0, 0);
+    m_Slots[0].pinned = true;
+    Upload(root, 0, pixels.data());
+    UpdateIndirection();
+    
+    glGenFramebuffers(1, &m_FeedbackFramebuffer);
+    glGenTextures(1, &m_FeedbackColor);
+    glGenRenderbuffers(1, &m_FeedbackDepth);
+    for (FeedbackBuffer& feedback : m_FeedbackBuffers) {
+        glGenBuffers(1, &feedback.buffer);
+    }
+}
+
+VirtualTexture::~VirtualTexture() {
+    // Pages in flight call the source, which may refer to things about to go away
+    for (Bake& bake : m_Bakes) {
+        bake.pixels.wait();
+    }
+    
+    for (FeedbackBuffer& feedback : m_FeedbackBuffers) {
+        if (feedback.fence) {
+            glDeleteSync(feedback.fence);
+        }
+        glDeleteBuffers(1, &feedback.buffer);
+    }
+    glDeleteFramebuffers(1, &m_FeedbackFramebuffer);
+    glDeleteTextures(1, &m_FeedbackColor);
+    glDeleteRenderbuffers(1, &m_FeedbackDepth);
+    glDeleteTextures(1, &m_AtlasTexture);
+    glDeleteTextures(1, &m_IndirectionTexture);
+}
+
+void VirtualTexture::BeginFeedback(int viewportWidth, int viewportHeight) {
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_SavedFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, m_SavedViewport);
+    
+    // Resize the attachments with the viewport
+    int width = std::max(viewportWidth / FEEDBACK_SCALE, 1);
+    int height = std::max(viewportHeight / FEEDBACK_SCALE, 1);
+    if (width != m_FeedbackWidth || height != m_FeedbackHeight) {
+        m_FeedbackWidth = width;
+        m_FeedbackHeight = height;
+        
+        glBindTexture(GL_TEXTURE_2D, m_FeedbackColor);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_FeedbackDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        
+        glBindFramebuffer(GL_FRAMEBUFFER, m_FeedbackFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_FeedbackColor, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_FeedbackDepth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("Virtual texture feedback framebuffer is incomplete");
+        }
+    }
+    
+    // Pixels left at zero alpha asked for nothing
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FeedbackFramebuffer);
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexture::EndFeedback() {
+    // Every buffer still waiting for the GPU means this frame's feedback is dropped, not waited for
+    FeedbackBuffer& feedback = m_FeedbackBuffers[m_FeedbackNext];
+    if (!feedback.fence) {
+        size_t size = static_cast<size_t>(m_FeedbackWidth) * m_FeedbackHeight * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback.buffer);
+        if (feedback.width != m_FeedbackWidth || feedback.height != m_FeedbackHeight) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+            feedback.width = m_FeedbackWidth;
+            feedback.height = m_FeedbackHeight;
+        }
+        glReadPixels(0, 0, m_FeedbackWidth, m_FeedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        feedback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_FeedbackNext = (m_FeedbackNext + 1) % FEEDBACK_BUFFERS;
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(m_SavedFramebuffer));
+    glViewport(m_SavedViewport[0], m_SavedViewport[1], m_SavedViewport[2], m_SavedViewport[3]);
+}
+
+void VirtualTexture::Update() {
+    ++m_Frame;
+    m_Stats.requestedPages = 0;
+    m_Stats.uploadedPages = 0;
+    m_Stats.evictedPages = 0;
+    m_Wanted.clear();
+    
+    // Read the finished readbacks, oldest first, stopping at the first the GPU has not reached
+    for (int i = 0; i < FEEDBACK_BUFFERS; ++i) {
+        FeedbackBuffer& feedback = m_FeedbackBuffers[(m_FeedbackNext + i) % FEEDBACK_BUFFERS];
+        if (!feedback.fence) {
+            continue;
+        }
+        GLenum status = glClientWaitSync(feedback.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        glDeleteSync(feedback.fence);
+        feedback.fence = nullptr;
+        
+        size_t size = static_cast<size_t>(feedback.width) * feedback.height * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback.buffer);
+        const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT);
+        if (pixels) {
+            ReadFeedback(static_cast<const unsigned char*>(pixels), feedback.width, feedback.height);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    
+    FinishBakes();
+    StartBakes();
+    if (m_IndirectionDirty) {
+        UpdateIndirection();
+    }
+    
+    m_Stats.residentPages = 0;
+    for (const Slot& slot : m_Slots) {
+        m_Stats.residentPages += slot.page >= 0 ? 1 : 0;
+    }
+    m_Stats.pendingPages = static_cast<unsigned int>(m_Wanted.size() + m_Bakes.size());
+}
+
+void VirtualTexture::Bind(unsigned int atlasSlot, unsigned int indirectionSlot) const {
+    glActiveTexture(GL_TEXTURE0 + atlasSlot);
+    glBindTexture(GL_TEXTURE_2D, m_AtlasTexture);
+    glActiveTexture(GL_TEXTURE0 + indirectionSlot);
+    glBindTexture(GL_TEXTURE_2D, m_IndirectionTexture);
+}
+
+void VirtualTexture::Request(int level, int x, int y) {
+    // A page requested this frame already had its ancestors requested with it
+    for (; level < m_Levels; ++level, x /= 2, y /= 2) {
+        int page = GetPageId(level, x, y);
+        if (m_PageFrames[page] == m_Frame) {
+            return;
+        }
+        m_PageFrames[page] = m_Frame;
+        ++m_Stats.requestedPages;
+        
+        int slot = m_PageSlots[page];
+        if (slot >= 0) {
+            m_Slots[slot].lastUsed = m_Frame;
+        } else if (slot == NOT_RESIDENT) {
+            m_Wanted.push_back(page);
+        }
+    }
+}
+
+void VirtualTexture::ReadFeedback(const unsigned char* pixels, int width, int height) {
+    // Each pixel holds the page x, page y and level it sampled, with alpha set if it drew anything.
+    // Neighbouring pixels mostly repeat the one before, so runs are skipped.
+    uint32_t previous = 0;
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i) {
+        const unsigned char* pixel = pixels + i * 4;
+        uint32_t value = pixel[0] | pixel[1] << 8 | pixel[2] << 16 | static_cast<uint32_t>(pixel[3]) << 24;
+        if (pixel[3] == 0 || value == previous) {
+            continue;
+        }
+        previous = value;
+        
+        int level = pixel[2];
+        if (level < m_Levels && pixel[0] < (m_Pages >> level) && pixel[1] < (m_Pages >> level)) {
+            Request(level, pixel[0], pixel[1]);
+        }
+    }
+}
+
+void VirtualTexture::StartBakes() {
+    // Coarse pages first, since every finer page that is still missing falls back to them
+    std::sort(m_Wanted.begin(), m_Wanted.end(), [](int a, int b) { return a > b; });
+    size_t started = 0;
+    for (int page : m_Wanted) {
+        if (m_Bakes.size() >= MAX_PAGES_IN_FLIGHT) {
+            break;
+        }
+        int level = static_cast<int>(std::upper_bound(m_LevelFirstPage.begin(), m_LevelFirstPage.end(), page) -
+                                     m_LevelFirstPage.begin()) - 1;
+        int index = page - m_LevelFirstPage[level];
+        int x = index % (m_Pages >> level);
+        int y = index / (m_Pages >> level);
+        
+        m_PageSlots[page] = IN_FLIGHT;
+        const PageSource& source = m_Source;
+        m_Bakes.push_back({ page, m_Pool->Submit([&source, level, x, y]() {
+            std::vector<unsigned char> pixels(static_cast<size_t>(PADDED_PAGE_SIZE) * PADDED_PAGE_SIZE * 4);
+            source(level, x, y, pixels.data());
+            return pixels;
+        }) });
+        ++started;
+    }
+    
+    // The rest are asked for again by later feedback
+    m_Wanted.erase(m_Wanted.begin(), m_Wanted.begin() + started);
+}
+
+void VirtualTexture::FinishBakes() {
+    int uploads = 0;
+    for (size_t i = 0; i < m_Bakes.size() && uploads < MAX_UPLOADS_PER_FRAME; ) {
+        Bake& bake = m_Bakes[i];
+        if (bake.pixels.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++i;
+            continue;
+        }
+        std::vector<unsigned char> pixels = bake.pixels.get();
+        int page = bake.page;
+        m_Bakes.erase(m_Bakes.begin() + i);
+        
+        // Replace the least recently used page that the latest feedback did not ask for. If every
+        // slot is in use, the atlas is too small for the view and the page waits to be asked again.
+        int slot = -1;
+        for (int candidate = 0; candidate < static_cast<int>(m_Slots.size()); ++candidate) {
+            const Slot& info = m_Slots[candidate];
+            if (!info.pinned && info.lastUsed < m_Frame && (slot < 0 || info.lastUsed < m_Slots[slot].lastUsed)) {
+                slot = candidate;
+            }
+        }
+        if (slot < 0) {
+            m_PageSlots[page] = NOT_RESIDENT;
+            continue;
+        }
+        if (m_Slots[slot].page >= 0) {
+            m_PageSlots[m_Slots[slot].page] = NOT_RESIDENT;
+            ++m_Stats.evictedPages;
+        }
+        Upload(page, slot, pixels.data());
+        ++uploads;
+    }
+    m_Stats.uploadedPages = static_cast<unsigned int>(uploads);
+}
+
+void VirtualTexture::Upload(int page, int slot, const unsigned char* pixels) {
+    glBindTexture(GL_TEXTURE_2D, m_AtlasTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % ATLAS_PAGES) * PADDED_PAGE_SIZE, (slot / ATLAS_PAGES) * PADDED_PAGE_SIZE,
+                    PADDED_PAGE_SIZE, PADDED_PAGE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    m_Slots[slot].page = page;
+    m_Slots[slot].lastUsed = m_Frame;
+    m_PageSlots[page] = slot;
+    m_IndirectionDirty = true;
+}
+
+void VirtualTexture::UpdateIndirection() {
+    // From the coarsest level down, a page without a slot takes its parent's entry
+    for (int level = m_Levels - 1; level >= 0; --level) {
+        int levelPages = m_Pages >> level;
+        std::vector<uint32_t>& entries = m_Indirection[level];
+        for (int y = 0; y < levelPages; ++y) {
+            for (int x = 0; x < levelPages; ++x) {
+                int slot = m_PageSlots[GetPageId(level, x, y)];
+                if (slot >= 0) {
+                    entries[y * levelPages + x] = PackEntry(slot, level);
+                } else {
+                    entries[y * levelPages + x] = m_Indirection[level + 1][(y / 2) * (levelPages / 2) + x / 2];
+                }
+            }
+        }
+    }
+    
+    glBindTexture(GL_TEXTURE_2D, m_IndirectionTexture);
+    for (int level = 0; level < m_Levels; ++level) {
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, m_Pages >> level, m_Pages >> level,
+                        GL_RGBA, GL_UNSIGNED_BYTE, m_Indirection[level].data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_IndirectionDirty = false;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <vector>
+
+class ThreadPool;
+
+// A texture too large for GPU memory, split into square pages that are
+// produced on demand and cached in a fixed atlas, using nothing beyond GL 3.3.
+//
+// Surfaces drawn with it are also drawn into a small feedback framebuffer that
+// records the page and level each pixel needs. The feedback is read back
+// through pixel buffers a few frames later, so the GPU never waits. Missing
+// pages are produced on the thread pool and uploaded into the least recently
+// used atlas slots. An indirection texture, one texel per page at every level,
+// points each page to the atlas slot of its finest resident ancestor, so a
+// page that has not arrived yet shows a blurrier one instead.
+class VirtualTexture {
+public:
+    // Texels across a page, and the border copied from its neighbours for bilinear filtering
+    static constexpr int PAGE_SIZE = 128;
+    static constexpr int PAGE_BORDER = 1;
+    static constexpr int PADDED_PAGE_SIZE = PAGE_SIZE + 2 * PAGE_BORDER;
+    
+    // Pages across the finest level. Feedback stores page coordinates in 8 bits.
+    static constexpr int MAX_PAGES = 256;
+    
+    // Slots across the square atlas
+    static constexpr int ATLAS_PAGES = 16;
+    static constexpr int ATLAS_SIZE = ATLAS_PAGES * PADDED_PAGE_SIZE;
+    
+    // The feedback framebuffer is this many times smaller than the viewport each way
+    static constexpr int FEEDBACK_SCALE = 8;
+    
+    // Pages being produced at once, and finished pages uploaded per frame
+    static constexpr int MAX_PAGES_IN_FLIGHT = 16;
+    static constexpr int MAX_UPLOADS_PER_FRAME = 8;
+    
+    // Fill a page's PADDED_PAGE_SIZE squared RGBA texels. Padded texel (i, j) is texel
+    // (pageX * PAGE_SIZE + i - PAGE_BORDER, pageY * PAGE_SIZE + j - PAGE_BORDER) of the
+    // level, which may lie outside the texture. Called on worker threads.
+    using PageSource = std::function<void(int level, int pageX, int pageY, unsigned char* pixels)>;
+    
+    struct Stats {
+        unsigned int residentPages = 0;
+        unsigned int requestedPages = 0;    // Pages seen in the feedback read back this frame
+        unsigned int pendingPages = 0;      // Requested but not resident yet
+        unsigned int uploadedPages = 0;     // This frame
+        unsigned int evictedPages = 0;      // This frame
+    };
+    
+    // pages is the number of pages across the finest level, a power of two up to
+    // MAX_PAGES. The single page of the coarsest level is produced now and never evicted.
+    VirtualTexture(int pages, PageSource source, ThreadPool* pool);
+    ~VirtualTexture();
+    
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture& operator=(const VirtualTexture&) = delete;
+    
+    int GetPages() const { return m_Pages; }
+    int GetLevels() const { return m_Levels; }
+    
+    // Draw the surfaces between these with a feedback shader. Begin binds and clears the feedback
+    // framebuffer; End queues its readback and restores the previous framebuffer and viewport.
+    void BeginFeedback(int viewportWidth, int viewportHeight);
+    void EndFeedback();
+    
+    // Apply feedback that has arrived: produce missing pages, upload finished ones
+    // and update the indirection texture. Call once per frame before drawing.
+    void Update();
+    
+    void Bind(unsigned int atlasSlot, unsigned int indirectionSlot) const;
+    
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    static constexpr int FEEDBACK_BUFFERS = 3;
+    
+    // m_PageSlots values for pages without a slot
+    static constexpr int NOT_RESIDENT = -1;
+    static constexpr int IN_FLIGHT = -2;
+    
+    struct Slot {
+        int page = -1;              // Page id, -1 if free
+        unsigned int lastUsed = 0;  // Frame of the last feedback that needed it
+        bool pinned = false;
+    };
+    
+    struct FeedbackBuffer {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;     // Set while a readback is queued
+        int width = 0;
+        int height = 0;
+    };
+    
+    struct Bake {
+        int page;
+        std::future<std::vector<unsigned char>> pixels;
+    };
+    
+    int m_Pages;
+    int m_Levels;
+    PageSource m_Source;
+    ThreadPool* m_Pool;
+    
+    GLuint m_AtlasTexture;
+    GLuint m_IndirectionTexture;
+    
+    // Pages are numbered level by level, finest first, row by row within a level
+    std::vector<int> m_LevelFirstPage;
+    std::vector<int> m_PageSlots;
+    std::vector<unsigned int> m_PageFrames;     // Frame each page was last requested
+    std::vector<Slot> m_Slots;
+    std::vector<Bake> m_Bakes;
+    std::vector<int> m_Wanted;
+    unsigned int m_Frame;
+    
+    // RGBA8 texels of every indirection level: atlas slot x and y, and the level of the page in it
+    std::vector<std::vector<uint32_t>> m_Indirection;
+    bool m_IndirectionDirty;
+    
+    GLuint m_FeedbackFramebuffer;
+    GLuint m_FeedbackColor;
+    GLuint m_FeedbackDepth;
+    int m_FeedbackWidth;
+    int m_FeedbackHeight;
+    GLint m_SavedFramebuffer;
+    GLint m_SavedViewport[4];
+    FeedbackBuffer m_FeedbackBuffers[FEEDBACK_BUFFERS];
+    int m_FeedbackNext;     // Buffer the next readback goes to; older ones follow it in order
+    
+    Stats m_Stats;
+    
+    int GetPageId(int level, int x, int y) const { return m_LevelFirstPage[level] + y * (m_Pages >> level) + x; }
+    
+    // Mark a page and its ancestors as needed this frame
+    void Request(int level, int x, int y);
+    void ReadFeedback(const unsigned char* pixels, int width, int height);
+    void StartBakes();
+    void FinishBakes();
+    void Upload(int page, int slot, const unsigned char* pixels);
+    void UpdateIndirection();
+};
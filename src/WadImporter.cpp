@@ -0,0 +1,264 @@
+#include "WadImporter.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    // Record sizes of the Doom map lumps
+    const size_t DIRECTORY_ENTRY_SIZE = 16;
+    const size_t VERTEX_SIZE = 4;
+    const size_t LINEDEF_SIZE = 14;
+    const size_t SIDEDEF_SIZE = 30;
+    const size_t SECTOR_SIZE = 26;
+    const size_t THING_SIZE = 10;
+    
+    // Lumps that follow a map marker, at most this many of them
+    const size_t MAX_MAP_LUMPS = 11;
+    
+    const uint16_t NO_SIDEDEF = 0xffff;
+    const int PLAYER1_START = 1;
+    
+    // All WAD fields are little-endian
+    uint16_t ReadU16(const unsigned char* data) {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+    
+    int16_t ReadI16(const unsigned char* data) {
+        return static_cast<int16_t>(ReadU16(data));
+    }
+    
+    uint32_t ReadU32(const unsigned char* data) {
+        return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+               (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+    
+    // Names are up to 8 characters, NUL-padded, and compared case-insensitively
+    std::string ReadName(const unsigned char* data) {
+        std::string name;
+        for (int i = 0; i < 8 && data[i] != 0; ++i) {
+            name.push_back(static_cast<char>(std::toupper(data[i])));
+        }
+        return name;
+    }
+}
+
+WadImporter::WadImporter(const std::string& path) : m_Path(path) {
+    if (!m_File.Open(path)) {
+        throw std::runtime_error("Could not open WAD file: " + path);
+    }
+    
+    // Header: "IWAD" or "PWAD", lump count, directory offset
+    const unsigned char* data = m_File.GetData();
+    size_t size = m_File.GetSize();
+    if (size < 12 || (std::memcmp(data, "IWAD", 4) != 0 && std::memcmp(data, "PWAD", 4) != 0)) {
+        throw std::runtime_error(path + " is not a WAD file");
+    }
+    uint32_t lumpCount = ReadU32(data + 4);
+    uint32_t directoryOffset = ReadU32(data + 8);
+    if (directoryOffset > size || lumpCount > (size - directoryOffset) / DIRECTORY_ENTRY_SIZE) {
+        throw std::runtime_error(path + " has a damaged lump directory");
+    }
+    
+    m_Lumps.reserve(lumpCount);
+    for (uint32_t i = 0; i < lumpCount; ++i) {
+        const unsigned char* entry = data + directoryOffset + i * DIRECTORY_ENTRY_SIZE;
+        uint32_t offset = ReadU32(entry);
+        uint32_t lumpSize = ReadU32(entry + 4);
+        if (offset > size || lumpSize > size - offset) {
+            throw std::runtime_error(path + ": lump " + ReadName(entry + 8) + " lies outside the file");
+        }
+        m_Lumps.push_back({ ReadName(entry + 8), ArrayView<unsigned char>(data + offset, lumpSize) });
+    }
+    
+    // A map is a marker lump followed by its THINGS
+    for (size_t i = 0; i + 1 < m_Lumps.size(); ++i) {
+        if (m_Lumps[i + 1].name == "THINGS") {
+            m_MapNames.push_back(m_Lumps[i].name);
+            m_MapLumps.push_back(i);
+        }
+    }
+}
+
+ArrayView<unsigned char> WadImporter::FindLump(const std::string& name, size_t firstLump) const {
+    for (size_t i = firstLump; i < m_Lumps.size(); ++i) {
+        if (m_Lumps[i].name == name) {
+            return m_Lumps[i].data;
+        }
+    }
+    return ArrayView<unsigned char>();
+}
+
+ArrayView<unsigned char> WadImporter::FindMapLump(size_t marker, const char* name) const {
+    for (size_t i = marker + 1; i < m_Lumps.size() && i <= marker + MAX_MAP_LUMPS; ++i) {
+        if (i > marker + 1 && m_Lumps[i].name == "THINGS") {
+            break; // Next map
+        }
+        if (m_Lumps[i].name == name) {
+            return m_Lumps[i].data;
+        }
+    }
+    return ArrayView<unsigned char>();
+}
+
+LevelData WadImporter::ImportMap(const std::string& name) const {
+    auto found = std::find(m_MapNames.begin(), m_MapNames.end(), name);
+    if (found == m_MapNames.end()) {
+        throw std::runtime_error(m_Path + " has no map " + name);
+    }
+    size_t marker = m_MapLumps[found - m_MapNames.begin()];
+    std::string where = m_Path + ":" + name;
+    
+    if (!FindMapLump(marker, "BEHAVIOR").empty()) {
+        throw std::runtime_error(where + ": Hexen-format maps are not supported");
+    }
+    ArrayView<unsigned char> things = FindMapLump(marker, "THINGS");
+    ArrayView<unsigned char> linedefs = FindMapLump(marker, "LINEDEFS");
+    ArrayView<unsigned char> sidedefs = FindMapLump(marker, "SIDEDEFS");
+    ArrayView<unsigned char> vertexes = FindMapLump(marker, "VERTEXES");
+    ArrayView<unsigned char> sectors = FindMapLump(marker, "SECTORS");
+    if (linedefs.empty() || sidedefs.empty() || vertexes.empty() || sectors.empty()) {
+        throw std::runtime_error(where + " is missing LINEDEFS, SIDEDEFS, VERTEXES or SECTORS");
+    }
+    if (things.size() % THING_SIZE != 0 || linedefs.size() % LINEDEF_SIZE != 0 ||
+        sidedefs.size() % SIDEDEF_SIZE != 0 || vertexes.size() % VERTEX_SIZE != 0 ||
+        sectors.size() % SECTOR_SIZE != 0) {
+        throw std::runtime_error(where + " has a lump of the wrong size");
+    }
+    size_t vertexCount = vertexes.size() / VERTEX_SIZE;
+    size_t sidedefCount = sidedefs.size() / SIDEDEF_SIZE;
+    size_t sectorCount = sectors.size() / SECTOR_SIZE;
+    
+    LevelData level;
+    std::unordered_map<std::string, int> textureIds;
+    auto textureId = [&](const std::string& texture) {
+        auto inserted = textureIds.emplace(texture, static_cast<int>(level.textures.size()));
+        if (inserted.second) {
+            level.textures.push_back("textures/" + texture + ".png");
+        }
+        return inserted.first->second;
+    };
+    
+    level.vertices.reserve(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const unsigned char* vertex = vertexes.data() + i * VERTEX_SIZE;
+        level.vertices.emplace_back(ReadI16(vertex) * UNIT_SCALE, -ReadI16(vertex + 2) * UNIT_SCALE);
+    }
+    
+    // Sector: floor, ceiling, floor flat, ceiling flat, light, special, tag
+    level.sectors.resize(sectorCount);
+    std::vector<std::string> floorFlats(sectorCount);
+    for (size_t i = 0; i < sectorCount; ++i) {
+        const unsigned char* sector = sectors.data() + i * SECTOR_SIZE;
+        floorFlats[i] = ReadName(sector + 4);
+        level.sectors[i].floorHeight = ReadI16(sector) * UNIT_SCALE;
+        level.sectors[i].ceilingHeight = ReadI16(sector + 2) * UNIT_SCALE;
+        level.sectors[i].floorTextureId = textureId(floorFlats[i]);
+        level.sectors[i].ceilingTextureId = textureId(ReadName(sector + 12));
+        level.sectors[i].lightLevel = std::clamp<int>(ReadI16(sector + 20), 0, 255);
+    }
+    
+    // Sidedef: x offset, y offset, upper, lower and middle texture, sector
+    auto sideSector = [&](uint16_t side) {
+        int sector = ReadU16(sidedefs.data() + side * SIDEDEF_SIZE + 28);
+        if (static_cast<size_t>(sector) >= sectorCount) {
+            throw std::runtime_error(where + ": sidedef " + std::to_string(side) + " has invalid sector " +
+                                     std::to_string(sector));
+        }
+        return sector;
+    };
+    
+    // Walls have one texture; openings show their lower texture for steps, else the upper one
+    auto sideTexture = [&](uint16_t side, bool twoSided) {
+        const unsigned char* sidedef = sidedefs.data() + side * SIDEDEF_SIZE;
+        std::string upper = ReadName(sidedef + 4);
+        std::string lower = ReadName(sidedef + 12);
+        std::string middle = ReadName(sidedef + 20);
+        const std::string* choices[3] = { &middle, &lower, &upper };
+        if (twoSided) {
+            choices[0] = &lower;
+            choices[1] = &upper;
+            choices[2] = &middle;
+        }
+        for (const std::string* texture : choices) {
+            if (!texture->empty() && *texture != "-") {
+                return textureId(*texture);
+            }
+        }
+        return textureId(floorFlats[sideSector(side)]);
+    };
+    
+    // Linedef: start, end, flags, special, tag, right (front) and left (back) sidedef.
+    // Walls are gathered per sector, since each sector's walls must be contiguous.
+    std::vector<std::vector<LevelWall>> sectorWalls(sectorCount);
+    size_t skipped = 0;
+    for (size_t i = 0; i < linedefs.size() / LINEDEF_SIZE; ++i) {
+        const unsigned char* linedef = linedefs.data() + i * LINEDEF_SIZE;
+        uint16_t start = ReadU16(linedef);
+        uint16_t end = ReadU16(linedef + 2);
+        uint16_t front = ReadU16(linedef + 10);
+        uint16_t back = ReadU16(linedef + 12);
+        if (start >= vertexCount || end >= vertexCount || front == NO_SIDEDEF || front >= sidedefCount ||
+            (back != NO_SIDEDEF && back >= sidedefCount)) {
+            throw std::runtime_error(where + ": linedef " + std::to_string(i) + " has invalid vertices or sides");
+        }
+        
+        // Lines with the same sector on both sides only matter for Doom's own renderer
+        int frontSector = sideSector(front);
+        int backSector = back == NO_SIDEDEF ? -1 : sideSector(back);
+        if (frontSector == backSector) {
+            skipped++;
+            continue;
+        }
+        
+        auto height = [&](int sector) {
+            return std::max(0.0f, level.sectors[sector].ceilingHeight - level.sectors[sector].floorHeight);
+        };
+        bool twoSided = backSector >= 0;
+        sectorWalls[frontSector].push_back({ start, end, height(frontSector), sideTexture(front, twoSided), backSector });
+        if (twoSided) {
+            sectorWalls[backSector].push_back({ end, start, height(backSector), sideTexture(back, true), frontSector });
+        }
+    }
+    if (skipped > 0) {
+        std::cerr << where << ": skipped " << skipped << " lines with the same sector on both sides" << std::endl;
+    }
+    
+    for (size_t i = 0; i < sectorCount; ++i) {
+        level.sectors[i].firstWall = static_cast<int>(level.walls.size());
+        level.sectors[i].wallCount = static_cast<int>(sectorWalls[i].size());
+        level.walls.insert(level.walls.end(), sectorWalls[i].begin(), sectorWalls[i].end());
+    }
+    
+    // Thing: x, y, angle (degrees counterclockwise from east), type, flags
+    for (size_t i = 0; i < things.size() / THING_SIZE; ++i) {
+        const unsigned char* thing = things.data() + i * THING_SIZE;
+        if (ReadI16(thing + 6) == PLAYER1_START) {
+            level.hasStart = true;
+            level.start.position = glm::vec2(ReadI16(thing) * UNIT_SCALE, -ReadI16(thing + 2) * UNIT_SCALE);
+            level.start.yaw = -static_cast<float>(ReadI16(thing + 4));
+            break;
+        }
+    }
+    
+    return level;
+}
+
+std::vector<LevelData> WadImporter::ImportMaps(const std::vector<std::string>& names, ThreadPool* pool) const {
+    std::vector<LevelData> levels(names.size());
+    auto importRange = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            levels[i] = ImportMap(names[i]);
+        }
+    };
+    if (pool) {
+        pool->ParallelFor(names.size(), 1, importRange);
+    } else {
+        importRange(0, names.size());
+    }
+    return levels;
+}
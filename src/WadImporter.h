@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ArrayView.h"
+#include "LevelData.h"
+#include "MappedFile.h"
+
+class ThreadPool;
+
+// Converts the maps in a Doom (IWAD or PWAD) file to LevelData. The file is
+// memory-mapped and lumps are read in place.
+//
+// Doom units are scaled by 1/32 and (x, y) becomes (x, -y), so a 56-unit
+// player is 1.75 tall and Doom's right-hand front sides land on the left of
+// each wall as Map expects. Two-sided lines become a portal wall in each of
+// their sectors. Textures are named "textures/<NAME>.png"; missing images
+// show up as checkerboards. Only player 1's start is taken from THINGS.
+class WadImporter {
+public:
+    static constexpr float UNIT_SCALE = 1.0f / 32.0f;
+    
+    // Throws std::runtime_error if the file cannot be mapped or is not a WAD
+    explicit WadImporter(const std::string& path);
+    
+    // Map marker lumps in directory order, such as "E1M1" or "MAP01"
+    const std::vector<std::string>& GetMapNames() const { return m_MapNames; }
+    
+    // Throws std::runtime_error for unknown maps and malformed lumps
+    LevelData ImportMap(const std::string& name) const;
+    
+    // Convert several maps at once, one per task; results are in the order of names
+    std::vector<LevelData> ImportMaps(const std::vector<std::string>& names, ThreadPool* pool = nullptr) const;
+    
+    // Raw contents of the first lump with this name from firstLump on, or an
+    // empty view if there is none
+    ArrayView<unsigned char> FindLump(const std::string& name, size_t firstLump = 0) const;
+
+private:
+    struct Lump {
+        std::string name;
+        ArrayView<unsigned char> data;
+    };
+    
+    std::string m_Path;
+    MappedFile m_File;
+    std::vector<Lump> m_Lumps;
+    std::vector<std::string> m_MapNames;
+    std::vector<size_t> m_MapLumps;
+    
+    // Lump of a map, searched between its marker and the next map
+    ArrayView<unsigned char> FindMapLump(size_t marker, const char* name) const;
+};
@@ -1,10 +1,11 @@
 #include "Game.h"
 #include <iostream>
 
-int main() {
+int main(int argc, char** argv) {
     try {
-        // Initialize game with window size and title
-        Game game(1024, 768, "Doom-like Game");
+        // Initialize game with window size and title, and the map named on the command line if any
+        std::string mapPath = argc > 1 ? argv[1] : "maps/level1.txt";
+        Game game(1024, 768, "Doom-like Game", mapPath);
         
         // Run game loop
         game.Run();
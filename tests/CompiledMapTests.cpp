@@ -0,0 +1,115 @@
+#include "Test.h"
+#include "Map.h"
+#include "CompiledLevel.h"
+#include "Hash.h"
+#include "TestLevels.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+    std::string TempPath(const std::string& name) {
+        return (std::filesystem::temp_directory_path() / ("CompiledMapTests_" + name)).string();
+    }
+    
+    // Three rooms in a row with two textures, which the fallback test map does not look like
+    LevelData RoomRow() {
+        std::vector<TestLevels::SectorShape> rooms(3);
+        for (int i = 0; i < 3; ++i) {
+            rooms[i].contours = { TestLevels::Rectangle(i * 4.0f, 0.0f, i * 4.0f + 4.0f, 4.0f) };
+        }
+        LevelData level = TestLevels::Build(rooms);
+        level.textures.push_back("floor.png");
+        level.sectors[1].floorTextureId = 1;
+        return level;
+    }
+    
+    // Overwrite an int in a section of a compiled level and fix up the data
+    // hash, as a tool writing bad indices would. The header is four 32-bit
+    // fields, the source hash and the data hash; section table entries are an
+    // id, a record size, an offset and a count.
+    void PatchSection(const std::string& path, LevelSection id, size_t byteOffset, int value) {
+        std::vector<char> bytes;
+        {
+            std::ifstream file(path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        const size_t headerSize = 32;
+        const size_t entrySize = 24;
+        uint32_t sectionCount;
+        std::memcpy(&sectionCount, &bytes[8], sizeof(sectionCount));
+        for (uint32_t i = 0; i < sectionCount; ++i) {
+            uint32_t sectionId;
+            uint64_t offset;
+            std::memcpy(&sectionId, &bytes[headerSize + i * entrySize], sizeof(sectionId));
+            std::memcpy(&offset, &bytes[headerSize + i * entrySize + 8], sizeof(offset));
+            if (sectionId == static_cast<uint32_t>(id)) {
+                std::memcpy(&bytes[offset + byteOffset], &value, sizeof(value));
+            }
+        }
+        uint64_t dataHash = HashBytes(HASH_SEED, bytes.data() + headerSize, bytes.size() - headerSize);
+        std::memcpy(&bytes[24], &dataHash, sizeof(dataHash));
+        
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), bytes.size());
+    }
+    
+    // Whether the compiled level loads as itself rather than falling back to the test map
+    bool LoadsAsSaved(const std::string& path) {
+        Map map(path);
+        std::remove((path + ".pvs").c_str());
+        return map.GetSectors().size() == 3 && map.GetTextures().size() == 2;
+    }
+}
+
+TEST(CompiledMapRoundTrips) {
+    std::string path = TempPath("rooms.lvl");
+    {
+        Map map(RoomRow());
+        CHECK(map.SaveCompiled(path, 1));
+    }
+    Map map(path);
+    CHECK(map.GetSectors().size() == 3);
+    CHECK(map.GetTextures().size() == 2 && map.GetTextures()[1] == "floor.png");
+    CHECK(map.GetSectors()[1].floorTextureId == 1);
+    CHECK(map.GetSectors()[1].portals.size() == 2);
+    std::remove(path.c_str());
+}
+
+TEST(CompiledMapRejectsBadIndices) {
+    std::string path = TempPath("bad.lvl");
+    {
+        Map map(RoomRow());
+        CHECK(map.SaveCompiled(path, 1));
+    }
+    CHECK(LoadsAsSaved(path));
+    
+    // Texture ids past the texture list, and a portal past its sector's walls
+    struct Patch {
+        LevelSection section;
+        size_t byteOffset;
+        int value;
+    };
+    const Patch patches[] = {
+        { LevelSection::Sidedefs, sizeof(Sidedef) * 5 + offsetof(Sidedef, textureId), 2 },
+        { LevelSection::Sidedefs, offsetof(Sidedef, textureId), -1 },
+        { LevelSection::Sectors, sizeof(CompiledSector) + offsetof(CompiledSector, floorTextureId), 2 },
+        { LevelSection::Sectors, offsetof(CompiledSector, ceilingTextureId), -1 },
+        { LevelSection::SectorPortals, sizeof(int), 4 },
+        { LevelSection::SectorPortals, 0, -1 }
+    };
+    for (const Patch& patch : patches) {
+        {
+            Map map(RoomRow());
+            CHECK(map.SaveCompiled(path, 1));
+        }
+        PatchSection(path, patch.section, patch.byteOffset, patch.value);
+        CHECK(!LoadsAsSaved(path));
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,162 @@
+#include "Test.h"
+#include "CookedTexture.h"
+#include "TextureCook.h"
+#include "ThreadPool.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <stb/stb-master/stb-master/stb_image_write.h>
+
+namespace {
+    std::string TempPath(const std::string& name) {
+        return (std::filesystem::temp_directory_path() / ("CookedTextureTests_" + name)).string();
+    }
+    
+    std::vector<unsigned char> Gradient(int width, int height, unsigned char alpha) {
+        std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4);
+        for (size_t i = 0; i < pixels.size(); i += 4) {
+            pixels[i + 0] = static_cast<unsigned char>(i * 7);
+            pixels[i + 1] = static_cast<unsigned char>(i / 3);
+            pixels[i + 2] = static_cast<unsigned char>(255 - i % 256);
+            pixels[i + 3] = alpha;
+        }
+        return pixels;
+    }
+    
+    std::vector<unsigned char> ReadFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    
+    void WriteFile(const std::string& path, const std::vector<unsigned char>& bytes) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+}
+
+TEST(CookedTextureRoundTrips) {
+    const int width = 13;
+    const int height = 7;
+    std::vector<unsigned char> pixels = Gradient(width, height, 255);
+    std::vector<std::vector<unsigned char>> levels = TextureCook::BuildMips(pixels.data(), width, height, nullptr);
+    CHECK(levels.size() == 4);
+    CHECK(levels.back().size() == 4);
+    
+    std::string path = TempPath("roundtrip.ctex");
+    CHECK(CookedTexture::Write(path, CookedFormat::Rgba8, width, height, 0x1234567890abcdefull, levels));
+    
+    CookedTexture texture;
+    CHECK(texture.Open(path));
+    CHECK(texture.GetFormat() == CookedFormat::Rgba8);
+    CHECK(texture.GetWidth() == width && texture.GetHeight() == height);
+    CHECK(texture.GetSourceHash() == 0x1234567890abcdefull);
+    CHECK(texture.GetLevelCount() == static_cast<int>(levels.size()));
+    for (int level = 0; level < texture.GetLevelCount() && level < static_cast<int>(levels.size()); ++level) {
+        ArrayView<unsigned char> data = texture.GetLevel(level);
+        CHECK(data.size() == levels[level].size());
+        CHECK(std::memcmp(data.data(), levels[level].data(), data.size()) == 0);
+        CHECK(reinterpret_cast<uintptr_t>(data.data()) % 16 == 0);
+    }
+    texture.Close();
+    std::remove(path.c_str());
+}
+
+TEST(CookedTextureRejectsDamagedFiles) {
+    std::vector<unsigned char> pixels = Gradient(8, 8, 255);
+    std::vector<std::vector<unsigned char>> levels = TextureCook::BuildMips(pixels.data(), 8, 8, nullptr);
+    std::string path = TempPath("damaged.ctex");
+    CHECK(CookedTexture::Write(path, CookedFormat::Rgba8, 8, 8, 1, levels));
+    std::vector<unsigned char> good = ReadFile(path);
+    
+    CookedTexture texture;
+    CHECK(!texture.Open(TempPath("missing.ctex")));
+    
+    std::vector<unsigned char> truncated(good.begin(), good.end() - 16);
+    WriteFile(path, truncated);
+    CHECK(!texture.Open(path));
+    CHECK(!texture.IsOpen());
+    
+    std::vector<unsigned char> identifier = good;
+    identifier[1] = 'X';
+    WriteFile(path, identifier);
+    CHECK(!texture.Open(path));
+    
+    // Level sizes must match the dimensions: grow the header's width
+    std::vector<unsigned char> width = good;
+    width[20] = 16;
+    WriteFile(path, width);
+    CHECK(!texture.Open(path));
+    
+    std::vector<unsigned char> version = good;
+    version[12] = 99;
+    WriteFile(path, version);
+    CHECK(!texture.Open(path));
+    
+    WriteFile(path, good);
+    CHECK(texture.Open(path));
+    texture.Close();
+    std::remove(path.c_str());
+}
+
+TEST(CookedTextureSurvivesRewriteWhileOpen) {
+    std::vector<unsigned char> pixels = Gradient(4, 4, 255);
+    std::vector<std::vector<unsigned char>> levels = TextureCook::BuildMips(pixels.data(), 4, 4, nullptr);
+    std::string path = TempPath("rewrite.ctex");
+    CHECK(CookedTexture::Write(path, CookedFormat::Rgba8, 4, 4, 1, levels));
+    
+    CookedTexture texture;
+    CHECK(texture.Open(path));
+    std::vector<std::vector<unsigned char>> other = levels;
+    other[0].assign(other[0].size(), 0);
+    CHECK(CookedTexture::Write(path, CookedFormat::Rgba8, 4, 4, 2, other));
+    CHECK(std::memcmp(texture.GetLevel(0).data(), levels[0].data(), levels[0].size()) == 0);
+    texture.Close();
+    std::remove(path.c_str());
+}
+
+TEST(TextureCookCooksBlockCompressed) {
+    const int width = 20;
+    const int height = 12;
+    std::string source = TempPath("source.png");
+    std::string output = TempPath("cooked.ctex");
+    ThreadPool pool(2);
+    
+    // Opaque images pick BC1 and translucent ones BC3
+    for (unsigned char alpha : { 255, 128 }) {
+        std::vector<unsigned char> pixels = Gradient(width, height, alpha);
+        CHECK(stbi_write_png(source.c_str(), width, height, 4, pixels.data(), width * 4) != 0);
+        CHECK(TextureCook::Cook(source, output, std::nullopt, &pool));
+        
+        uint64_t hash = 0;
+        CHECK(TextureCook::HashFile(source, hash));
+        CookedTexture texture;
+        CHECK(texture.Open(output));
+        CookedFormat format = alpha == 255 ? CookedFormat::Bc1 : CookedFormat::Bc3;
+        CHECK(texture.GetFormat() == format);
+        CHECK(texture.GetSourceHash() == hash);
+        CHECK(texture.GetLevelCount() == 5);
+        for (int level = 0; level < texture.GetLevelCount(); ++level) {
+            int levelWidth = std::max(width >> level, 1);
+            int levelHeight = std::max(height >> level, 1);
+            CHECK(texture.GetLevel(level).size() == GetCookedLevelSize(format, levelWidth, levelHeight));
+        }
+    }
+    std::remove(source.c_str());
+    std::remove(output.c_str());
+    
+    // Sources that do not decode are not cooked
+    CHECK(!TextureCook::Cook(TempPath("missing.png"), output, std::nullopt, nullptr));
+}
+
+TEST(TextureCookFiltersInLinearLight) {
+    // Black and white average to middle grey in linear light, which is 188 in sRGB rather than 128
+    std::vector<unsigned char> pixels = { 0, 0, 0, 255, 255, 255, 255, 255, 0, 0, 0, 255, 255, 255, 255, 255 };
+    std::vector<std::vector<unsigned char>> levels = TextureCook::BuildMips(pixels.data(), 2, 2, nullptr);
+    CHECK(levels.size() == 2);
+    CHECK(levels[1][0] >= 186 && levels[1][0] <= 189);
+    CHECK(levels[1][0] == levels[1][1] && levels[1][1] == levels[1][2]);
+    CHECK(levels[1][3] == 255);
+}
@@ -0,0 +1,147 @@
+#include "Test.h"
+#include "GridWalk.h"
+#include "OccupancyGrid.h"
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+    using Cells = std::vector<std::pair<int, int>>;
+    
+    Cells Walk(const glm::vec2& from, const glm::vec2& to) {
+        Cells cells;
+        WalkGridCells(from, to, [&](int x, int z) {
+            cells.emplace_back(x, z);
+            return true;
+        });
+        return cells;
+    }
+}
+
+TEST(GridWalkVisitsBothCellsBesideCorners) {
+    // Exactly through the corners at (1, 1) and (2, 2)
+    CHECK(Walk(glm::vec2(0.5f, 0.5f), glm::vec2(2.5f, 2.5f)) ==
+          Cells({ { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 }, { 1, 2 }, { 2, 2 } }));
+    CHECK(Walk(glm::vec2(2.5f, 2.5f), glm::vec2(0.5f, 0.5f)) ==
+          Cells({ { 2, 2 }, { 1, 2 }, { 2, 1 }, { 1, 1 }, { 0, 1 }, { 1, 0 }, { 0, 0 } }));
+    CHECK(Walk(glm::vec2(0.5f, 1.5f), glm::vec2(1.5f, 0.5f)) ==
+          Cells({ { 0, 1 }, { 1, 1 }, { 0, 0 }, { 1, 0 } }));
+    
+    // Starting on a corner, and through one at negative coordinates
+    CHECK(Walk(glm::vec2(0.0f, 0.0f), glm::vec2(1.5f, 1.5f)) == Cells({ { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } }));
+    CHECK(Walk(glm::vec2(-1.5f, -0.5f), glm::vec2(-0.5f, -1.5f)) ==
+          Cells({ { -2, -1 }, { -1, -1 }, { -2, -2 }, { -1, -2 } }));
+}
+
+TEST(GridWalkFollowsCellEdges) {
+    // A line along a boundary belongs to the cells above or right of it
+    CHECK(Walk(glm::vec2(0.0f, 1.0f), glm::vec2(3.0f, 1.0f)) == Cells({ { 0, 1 }, { 1, 1 }, { 2, 1 }, { 3, 1 } }));
+    CHECK(Walk(glm::vec2(3.0f, 1.0f), glm::vec2(0.0f, 1.0f)) == Cells({ { 3, 1 }, { 2, 1 }, { 1, 1 }, { 0, 1 } }));
+    CHECK(Walk(glm::vec2(2.0f, 3.5f), glm::vec2(2.0f, 0.5f)) == Cells({ { 2, 3 }, { 2, 2 }, { 2, 1 }, { 2, 0 } }));
+    
+    // Ending on a boundary enters the cell beyond it; a point is one cell
+    CHECK(Walk(glm::vec2(0.5f, 0.5f), glm::vec2(2.0f, 0.5f)) == Cells({ { 0, 0 }, { 1, 0 }, { 2, 0 } }));
+    CHECK(Walk(glm::vec2(1.5f, -2.5f), glm::vec2(1.5f, -2.5f)) == Cells({ { 1, -3 } }));
+}
+
+TEST(GridWalkStopsWhenAsked) {
+    int visited = 0;
+    WalkGridCells(glm::vec2(0.5f, 0.5f), glm::vec2(9.5f, 0.5f), [&](int, int) { return ++visited < 3; });
+    CHECK(visited == 3);
+    
+    // Including between the two cells beside a corner
+    Cells cells;
+    WalkGridCells(glm::vec2(0.5f, 0.5f), glm::vec2(2.5f, 2.5f), [&](int x, int z) {
+        cells.emplace_back(x, z);
+        return cells.size() < 2;
+    });
+    CHECK(cells == Cells({ { 0, 0 }, { 1, 0 } }));
+}
+
+TEST(GridWalkCoversSegment) {
+    // Every cell a point of the segment is in gets visited, in order, and each
+    // step moves to a cell sharing an edge or a corner with the last one
+    std::mt19937 random(17);
+    std::uniform_real_distribution<float> position(-6.0f, 6.0f);
+    std::uniform_int_distribution<int> corner(-6, 6);
+    for (int i = 0; i < 2000; ++i) {
+        glm::vec2 from(position(random), position(random));
+        glm::vec2 to(position(random), position(random));
+        if (i % 4 == 0) {
+            // Segments between lattice points cross corners exactly
+            from = glm::vec2(corner(random), corner(random)) + 0.5f;
+            to = from + glm::vec2(1.0f, i % 8 == 0 ? 1.0f : -1.0f) * static_cast<float>(corner(random));
+        }
+        Cells cells = Walk(from, to);
+        CHECK(cells.front() == std::make_pair(int(std::floor(from.x)), int(std::floor(from.y))));
+        CHECK(cells.back() == std::make_pair(int(std::floor(to.x)), int(std::floor(to.y))));
+        for (size_t c = 1; c < cells.size(); ++c) {
+            CHECK(std::abs(cells[c].first - cells[c - 1].first) <= 1 &&
+                  std::abs(cells[c].second - cells[c - 1].second) <= 1);
+            CHECK(cells[c] != cells[c - 1]);
+        }
+        
+        Cells sorted = cells;
+        std::sort(sorted.begin(), sorted.end());
+        for (int s = 0; s <= 200; ++s) {
+            glm::vec2 point = from + (to - from) * (s / 200.0f);
+            std::pair<int, int> cell(int(std::floor(point.x)), int(std::floor(point.y)));
+            CHECK(std::binary_search(sorted.begin(), sorted.end(), cell));
+        }
+    }
+}
+
+TEST(OccupancyGridMarksSegments) {
+    // Cells of 2 over [-3, 5], so the origin snaps down to -4 and there are 5 cells a side
+    OccupancyGrid grid;
+    grid.Build(glm::vec2(-3.0f), glm::vec2(5.0f), 2.0f);
+    CHECK(grid.GetWidth() == 5 && grid.GetHeight() == 5);
+    CHECK(grid.GetOrigin() == glm::vec2(-4.0f));
+    CHECK(!grid.IsOccupied(-3.0f, -3.0f) && !grid.IsOccupied(5.0f, 5.0f));
+    
+    // Diagonally through the grid corner at (0, 0), marking the cells on both sides of it
+    grid.MarkSegment(glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, 1.0f));
+    CHECK(grid.IsOccupied(-1.0f, -1.0f) && grid.IsOccupied(1.0f, 1.0f));
+    CHECK(grid.IsOccupied(1.0f, -1.0f) && grid.IsOccupied(-1.0f, 1.0f));
+    CHECK(!grid.IsOccupied(3.0f, 1.0f) && !grid.IsOccupied(-3.0f, -1.0f));
+    
+    // Along the cell edge z = 2, which marks the row above it
+    grid.MarkSegment(glm::vec2(-4.0f, 2.0f), glm::vec2(6.0f, 2.0f));
+    CHECK(grid.IsOccupied(-3.5f, 3.0f) && grid.IsOccupied(5.5f, 3.0f));
+    CHECK(!grid.IsOccupied(3.0f, 1.9f));
+    
+    std::vector<glm::vec2> points = { { -1.0f, -1.0f }, { 3.0f, -3.0f }, { 3.0f, 3.0f }, { 3.0f, 1.0f } };
+    uint8_t occupied[4];
+    CHECK(grid.Query(points, occupied) == 2);
+    CHECK(occupied[0] == 1 && occupied[1] == 0 && occupied[2] == 1 && occupied[3] == 0);
+    CHECK(grid.Query(points) == 2);
+}
+
+TEST(OccupancyGridClipsOutsideGrid) {
+    OccupancyGrid grid;
+    grid.Build(glm::vec2(0.0f), glm::vec2(7.0f), 1.0f);
+    CHECK(grid.GetWidth() == 8 && grid.GetHeight() == 8);
+    
+    // Points off the grid count as occupied, on every side
+    CHECK(grid.IsOccupied(-0.5f, 4.0f) && grid.IsOccupied(8.5f, 4.0f));
+    CHECK(grid.IsOccupied(4.0f, -0.5f) && grid.IsOccupied(4.0f, 8.5f));
+    
+    // Segments starting and ending off the grid mark only the cells inside it,
+    // and one that misses the grid marks nothing
+    grid.MarkSegment(glm::vec2(-20.0f, 2.5f), glm::vec2(30.0f, 2.5f));
+    grid.MarkSegment(glm::vec2(-3.0f, -3.0f), glm::vec2(11.0f, 11.0f));
+    grid.MarkSegment(glm::vec2(-5.0f, 20.0f), glm::vec2(20.0f, 15.0f));
+    int marked = 0;
+    for (int z = 0; z < 8; ++z) {
+        for (int x = 0; x < 8; ++x) {
+            bool expected = z == 2 || x == z || x == z + 1 || x + 1 == z;
+            CHECK(grid.IsOccupied(x + 0.5f, z + 0.5f) == expected);
+            marked += grid.IsOccupied(x + 0.5f, z + 0.5f);
+        }
+    }
+    CHECK(marked == 8 + 8 + 7 + 7 - 3);
+    
+    grid.Clear();
+    CHECK(grid.GetWidth() == 0 && grid.IsOccupied(1.0f, 1.0f));
+}
@@ -0,0 +1,88 @@
+#include "Test.h"
+#include "Image.h"
+#include "ThreadPool.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <string>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb-master/stb-master/stb_image_write.h>
+
+namespace {
+    std::string TempPath(const std::string& name) {
+        return (std::filesystem::temp_directory_path() / ("ImageTests_" + name)).string();
+    }
+    
+    // RGB image whose top row is red and other rows shade from blue, written as PNG
+    std::string WriteTestImage(const std::string& name, int width, int height) {
+        std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 3);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                unsigned char* pixel = pixels.data() + (static_cast<size_t>(y) * width + x) * 3;
+                pixel[0] = y == 0 ? 255 : 0;
+                pixel[1] = static_cast<unsigned char>(x * 255 / width);
+                pixel[2] = y == 0 ? 0 : static_cast<unsigned char>(255 - y);
+            }
+        }
+        std::string path = TempPath(name + ".png");
+        stbi_write_png(path.c_str(), width, height, 3, pixels.data(), width * 3);
+        return path;
+    }
+}
+
+TEST(ImageDecodesBottomRowFirst) {
+    std::string path = WriteTestImage("flip", 8, 4);
+    Image image(path, 4);
+    CHECK(!image.IsFallback());
+    CHECK(image.GetWidth() == 8 && image.GetHeight() == 4 && image.GetChannels() == 4);
+    
+    // The file's top row is red, and GL expects it last
+    const unsigned char* top = image.GetPixels() + 3 * 8 * 4;
+    CHECK(top[0] == 255 && top[2] == 0 && top[3] == 255);
+    CHECK(image.GetPixels()[0] == 0 && image.GetPixels()[2] == 252);
+    
+    int width = 0;
+    int height = 0;
+    Image::ReadSize(path, width, height);
+    CHECK(width == 8 && height == 4);
+    std::remove(path.c_str());
+}
+
+TEST(ImageFallsBackToCheckerboard) {
+    std::string path = TempPath("missing.png");
+    Image image(path, 4);
+    CHECK(image.IsFallback());
+    CHECK(image.GetChannels() == 4);
+    
+    // ReadSize predicts the fallback's size too, so it lands in the right texture array
+    int width = 0;
+    int height = 0;
+    Image::ReadSize(path, width, height);
+    CHECK(width == image.GetWidth() && height == image.GetHeight());
+}
+
+TEST(ImageDecodesConcurrently) {
+    // Decodes on the pool must match decodes here, flip included
+    const int count = 16;
+    std::vector<std::string> paths;
+    for (int i = 0; i < count; ++i) {
+        paths.push_back(WriteTestImage("concurrent" + std::to_string(i), 16 + i * 4, 8 + i));
+    }
+    
+    ThreadPool pool(4);
+    std::vector<std::future<Image>> decodes;
+    for (const std::string& path : paths) {
+        decodes.push_back(pool.Submit([path]() { return Image(path, 4); }));
+    }
+    for (int i = 0; i < count; ++i) {
+        Image pooled = decodes[i].get();
+        Image serial(paths[i], 4);
+        size_t size = static_cast<size_t>(serial.GetWidth()) * serial.GetHeight() * 4;
+        CHECK(!pooled.IsFallback());
+        CHECK(pooled.GetWidth() == serial.GetWidth() && pooled.GetHeight() == serial.GetHeight());
+        CHECK(std::memcmp(pooled.GetPixels(), serial.GetPixels(), size) == 0);
+        std::remove(paths[i].c_str());
+    }
+}
@@ -0,0 +1,86 @@
+#include "Test.h"
+#include "LevelGenerator.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    template<typename T>
+    bool SameBytes(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+    
+    bool SameLevel(const LevelData& a, const LevelData& b) {
+        return a.textures == b.textures && SameBytes(a.vertices, b.vertices) && SameBytes(a.sectors, b.sectors) &&
+               SameBytes(a.walls, b.walls) && a.hasStart == b.hasStart &&
+               std::memcmp(&a.start, &b.start, sizeof(LevelStart)) == 0;
+    }
+}
+
+TEST(LevelGeneratorIsDeterministic) {
+    LevelGeneratorSettings settings;
+    settings.seed = 7;
+    settings.wallCount = 5000;
+    settings.textureCount = 8;
+    LevelData first = LevelGenerator::Generate(settings);
+    LevelData second = LevelGenerator::Generate(settings);
+    CHECK(SameLevel(first, second));
+    CHECK(first.textures.size() == 8);
+    
+    settings.seed = 8;
+    CHECK(!SameLevel(first, LevelGenerator::Generate(settings)));
+}
+
+TEST(LevelGeneratorHitsItsTargets) {
+    LevelGeneratorSettings settings;
+    settings.wallCount = 20000;
+    settings.sectorCount = 1000;
+    LevelData level = LevelGenerator::Generate(settings);
+    CHECK(level.walls.size() > 18000 && level.walls.size() < 22000);
+    CHECK(level.sectors.size() > 900 && level.sectors.size() < 1100);
+    CHECK(level.hasStart);
+    
+    // Sectors own contiguous walls, and portals point at real sectors
+    int nextWall = 0;
+    for (const LevelSector& sector : level.sectors) {
+        CHECK(sector.firstWall == nextWall);
+        nextWall += sector.wallCount;
+    }
+    CHECK(nextWall == static_cast<int>(level.walls.size()));
+    for (const LevelWall& wall : level.walls) {
+        CHECK(wall.backSector >= -1 && wall.backSector < static_cast<int>(level.sectors.size()));
+        CHECK(wall.startVertex >= 0 && wall.startVertex < static_cast<int>(level.vertices.size()));
+        CHECK(wall.endVertex >= 0 && wall.endVertex < static_cast<int>(level.vertices.size()));
+    }
+}
+
+TEST(LevelGeneratorParsesPaths) {
+    LevelGeneratorSettings settings;
+    CHECK(!LevelGenerator::ParsePath("maps/level1.txt", settings));
+    
+    CHECK(LevelGenerator::ParsePath("gen:", settings));
+    CHECK(settings.seed == LevelGeneratorSettings().seed);
+    CHECK(settings.wallCount == LevelGeneratorSettings().wallCount);
+    
+    CHECK(LevelGenerator::ParsePath("gen:seed=7,walls=100000,sectors=5000,textures=8,pillars=0.25,open=0.5", settings));
+    CHECK(settings.seed == 7);
+    CHECK(settings.wallCount == 100000);
+    CHECK(settings.sectorCount == 5000);
+    CHECK(settings.textureCount == 8);
+    CHECK(settings.pillarShare == 0.25f);
+    CHECK(settings.openShare == 0.5f);
+    
+    // Each path starts over from the defaults
+    CHECK(LevelGenerator::ParsePath("gen:walls=10", settings));
+    CHECK(settings.seed == LevelGeneratorSettings().seed);
+    CHECK(settings.wallCount == 10);
+}
+
+TEST(LevelGeneratorRejectsBadPaths) {
+    LevelGeneratorSettings settings;
+    CHECK_THROWS(LevelGenerator::ParsePath("gen:size=10", settings), std::runtime_error);
+    CHECK_THROWS(LevelGenerator::ParsePath("gen:walls=ten", settings), std::runtime_error);
+    CHECK_THROWS(LevelGenerator::ParsePath("gen:walls=10x", settings), std::runtime_error);
+    CHECK_THROWS(LevelGenerator::ParsePath("gen:walls=", settings), std::runtime_error);
+    CHECK_THROWS(LevelGenerator::ParsePath("gen:seed", settings), std::runtime_error);
+    CHECK_THROWS(LevelGenerator::ParsePath("gen:seed=99999999999999999999", settings), std::runtime_error);
+}
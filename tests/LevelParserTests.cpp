@@ -0,0 +1,117 @@
+#include "Test.h"
+#include "LevelParser.h"
+#include <stdexcept>
+#include <string>
+
+namespace {
+    // Two square rooms joined along x = 2; the second has no light level
+    const char* const TWO_ROOMS =
+        "doomlevel 1\n"
+        "counts 1 6 2 8\n"
+        "texture wall.png\n"
+        "vertex 0 0\n"
+        "vertex 2 0\n"
+        "vertex 2 2\n"
+        "vertex 0 2\n"
+        "vertex 4 0\n"
+        "vertex 4 2\n"
+        "sector 0 3 0 0 4 128\n"
+        "wall 0 1 3 0\n"
+        "wall 1 2 3 0 1\n"
+        "wall 2 3 3 0\n"
+        "wall 3 0 3 0\n"
+        "sector 0.5 3 0 0 4\n"
+        "wall 1 4 3 0\n"
+        "wall 4 5 3 0\n"
+        "wall 5 2 3 0\n"
+        "wall 2 1 3 0 0\n"
+        "start 1 1 -90\n";
+    
+    LevelData Parse(const std::string& text) {
+        return LevelParser::Parse(text.data(), text.data() + text.size(), "test");
+    }
+    
+    // The message Parse throws, or an empty string if it succeeds
+    std::string ParseError(const std::string& text) {
+        try {
+            Parse(text);
+        } catch (const std::runtime_error& error) {
+            return error.what();
+        }
+        return std::string();
+    }
+    
+    std::string Replace(std::string text, const std::string& from, const std::string& to) {
+        size_t position = 0;
+        while ((position = text.find(from, position)) != std::string::npos) {
+            text.replace(position, from.size(), to);
+            position += to.size();
+        }
+        return text;
+    }
+    
+    void CheckTwoRooms(const LevelData& level) {
+        CHECK(level.textures.size() == 1 && level.textures[0] == "wall.png");
+        CHECK(level.vertices.size() == 6 && level.vertices[4] == glm::vec2(4.0f, 0.0f));
+        CHECK(level.sectors.size() == 2 && level.walls.size() == 8);
+        CHECK(level.sectors[0].lightLevel == 128 && level.sectors[1].lightLevel == 255);
+        CHECK(level.sectors[1].floorHeight == 0.5f);
+        CHECK(level.sectors[1].firstWall == 4 && level.sectors[1].wallCount == 4);
+        CHECK(level.walls[0].backSector == -1 && level.walls[1].backSector == 1 && level.walls[7].backSector == 0);
+        CHECK(level.hasStart && level.start.position == glm::vec2(1.0f, 1.0f) && level.start.yaw == -90.0f);
+    }
+}
+
+TEST(LevelParserReadsRecords) {
+    CheckTwoRooms(Parse(TWO_ROOMS));
+}
+
+TEST(LevelParserAcceptsCommentsAndBlanks) {
+    // Optional fields are left out on lines that end in a comment or trailing blanks
+    std::string text = Replace(TWO_ROOMS, "sector 0.5 3 0 0 4\n", "sector 0.5 3 0 0 4   # hall\n");
+    text = Replace(text, "wall 0 1 3 0\n", "wall 0 1 3 0 \t\n");
+    text = Replace(text, "wall 3 0 3 0\n", "wall 3 0 3 0# west\n");
+    text = "# header comment\n\n" + Replace(text, "counts", "  counts");
+    CheckTwoRooms(Parse(text));
+}
+
+TEST(LevelParserAcceptsCrlf) {
+    CheckTwoRooms(Parse(Replace(TWO_ROOMS, "\n", "\r\n")));
+    CheckTwoRooms(Parse(Replace(Replace(TWO_ROOMS, "4\n", "4 # hall\n"), "\n", "\r\n")));
+}
+
+TEST(LevelParserReportsLineAndColumn) {
+    CHECK(ParseError(Replace(TWO_ROOMS, "vertex 4 0\n", "vertex 4 x0\n")) ==
+          "test:8:10: expected z coordinate, found 'x0'");
+    CHECK(ParseError(Replace(TWO_ROOMS, "wall 1 2 3 0 1\n", "wall 1 2 3 0 7\n")) ==
+          "test:12:14: back sector 7 is out of range");
+    CHECK(ParseError(Replace(TWO_ROOMS, "sector 0 3 0 0 4 128\n", "sector 0 3 0 0 4 300\n")) ==
+          "test:10:18: light level 300 is out of range");
+    CHECK(ParseError(Replace(TWO_ROOMS, "start 1 1 -90\n", "start 1 1 -90 extra\n")) ==
+          "test:20:15: unexpected 'extra' at end of line");
+    CHECK(ParseError(Replace(TWO_ROOMS, "wall 1 2 3 0 1\n", "wall 1 2 3\n")) == "test:12:11: expected wall texture");
+    CHECK(ParseError(Replace(TWO_ROOMS, "texture", "texure")) == "test:3:1: unknown record 'texure'");
+    
+    // Columns count from the start of the line, whatever its ending
+    CHECK(ParseError(Replace(Replace(TWO_ROOMS, "vertex 4 0\n", "vertex 4 x0\n"), "\n", "\r\n")) ==
+          "test:8:10: expected z coordinate, found 'x0'");
+}
+
+TEST(LevelParserChecksCounts) {
+    CHECK(ParseError("counts 0 0 0 0\n").find("expected 'doomlevel' header") != std::string::npos);
+    CHECK(ParseError("doomlevel 2\n").find("unsupported format version") != std::string::npos);
+    CHECK(ParseError(Replace(TWO_ROOMS, "counts 1 6 2 8", "counts 1 5 2 8")).find("more vertices") != std::string::npos);
+    CHECK(ParseError(Replace(TWO_ROOMS, "counts 1 6 2 8", "counts 1 7 2 8")).find("file ends before") !=
+          std::string::npos);
+    CHECK(ParseError(Replace(TWO_ROOMS, "sector 0 3 0 0 4 128", "sector 0 3 0 0 3 128")).find("wall does not belong") !=
+          std::string::npos);
+    CHECK(ParseError(Replace(TWO_ROOMS, "sector 0 3 0 0 4 128", "sector 0 3 0 0 5 128")).find("missing walls") !=
+          std::string::npos);
+    CHECK(ParseError(std::string(TWO_ROOMS) + "start 0 0 0\n").find("more than one start") != std::string::npos);
+}
+
+TEST(LevelParserReadsShippedLevel) {
+    LevelData level = LevelParser::ParseFile("maps/level1.txt");
+    CHECK(level.sectors.size() == 3 && level.walls.size() == 20);
+    CHECK(level.sectors[0].lightLevel == 255);
+}
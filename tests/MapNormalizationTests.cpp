@@ -0,0 +1,146 @@
+#include "Test.h"
+#include "Map.h"
+#include "TestLevels.h"
+#include <algorithm>
+
+namespace {
+    // Three rooms 4 x 4 in a row along x, joined by portals at x = 4 and x = 8
+    std::vector<TestLevels::SectorShape> RoomRow() {
+        std::vector<TestLevels::SectorShape> rooms(3);
+        for (int i = 0; i < 3; ++i) {
+            rooms[i].contours = { TestLevels::Rectangle(i * 4.0f, 0.0f, i * 4.0f + 4.0f, 4.0f) };
+        }
+        return rooms;
+    }
+    
+    glm::vec2 LeftOf(const glm::vec2& start, const glm::vec2& end, float distance) {
+        glm::vec2 direction = glm::normalize(end - start);
+        return (start + end) * 0.5f + glm::vec2(-direction.y, direction.x) * distance;
+    }
+    
+    // Every line's front sidedef is on its left and its back sidedef on its
+    // right, each wall runs with its sector on the left, and the two sides of
+    // a line are each other's opposite
+    void CheckSides(const Map& map) {
+        for (size_t i = 0; i < map.GetLinedefs().size(); ++i) {
+            const Linedef& line = map.GetLinedefs()[i];
+            glm::vec2 start = map.GetVertices()[line.startVertex];
+            glm::vec2 end = map.GetVertices()[line.endVertex];
+            if (start == end) {
+                continue;
+            }
+            glm::vec2 left = LeftOf(start, end, 0.1f);
+            glm::vec2 right = LeftOf(start, end, -0.1f);
+            CHECK(map.GetSidedefs()[line.frontSide].linedef == static_cast<int>(i));
+            CHECK(map.FindSector(left.x, left.y) == map.GetSidedefs()[line.frontSide].sector);
+            CHECK(map.GetOppositeWall(line.frontSide) == line.backSide);
+            if (line.backSide >= 0) {
+                CHECK(map.GetSidedefs()[line.backSide].linedef == static_cast<int>(i));
+                CHECK(map.FindSector(right.x, right.y) == map.GetSidedefs()[line.backSide].sector);
+                CHECK(map.GetOppositeWall(line.backSide) == line.frontSide);
+            }
+        }
+        for (int index = 0; index < map.GetWallCount(); ++index) {
+            Wall wall = map.GetWall(index);
+            if (wall.start == wall.end) {
+                continue;
+            }
+            glm::vec2 left = LeftOf(wall.start, wall.end, 0.1f);
+            glm::vec2 right = LeftOf(wall.start, wall.end, -0.1f);
+            CHECK(map.FindSector(left.x, left.y) == map.GetSidedefs()[index].sector);
+            if (wall.backSector >= 0) {
+                CHECK(map.FindSector(right.x, right.y) == wall.backSector);
+            }
+        }
+    }
+    
+    int CountTwoSided(const Map& map) {
+        return static_cast<int>(std::count_if(map.GetLinedefs().begin(), map.GetLinedefs().end(),
+                                              [](const Linedef& line) { return line.backSide >= 0; }));
+    }
+}
+
+TEST(MapSharesLinesBetweenSectors) {
+    Map map(TestLevels::Build(RoomRow()));
+    CHECK(map.GetWallCount() == 12);
+    CHECK(map.GetLinedefs().size() == 10);
+    CHECK(CountTwoSided(map) == 2);
+    CheckSides(map);
+    
+    // The middle room has a portal on either side; the end rooms one each
+    CHECK(map.GetSectors()[0].portals.size() == 1);
+    CHECK(map.GetSectors()[1].portals.size() == 2);
+    CHECK(map.GetSectors()[2].portals.size() == 1);
+    CHECK(!map.IsWallSolid(map.GetSectorFirstWall(0) + 1));
+    CHECK(map.IsWallSolid(map.GetSectorFirstWall(0)));
+}
+
+TEST(MapOrientsClockwiseSectors) {
+    // Outlines given the other way round still end up with each sector on the left
+    std::vector<TestLevels::SectorShape> rooms = RoomRow();
+    for (auto& room : rooms) {
+        std::reverse(room.contours[0].begin(), room.contours[0].end());
+    }
+    Map map(TestLevels::Build(rooms));
+    CHECK(CountTwoSided(map) == 2);
+    CheckSides(map);
+}
+
+TEST(MapTreatsUnmatchedPortalsAsSolid) {
+    LevelData level = TestLevels::Build(RoomRow());
+    
+    // Sector 0's portal names sector 2, which has no wall there; sector 1's
+    // wall facing it is then left without a partner too
+    int portal = level.sectors[0].firstWall + 1;
+    CHECK(level.walls[portal].backSector == 1);
+    level.walls[portal].backSector = 2;
+    
+    // Out of range, and facing its own sector
+    int outer = level.sectors[2].firstWall;
+    level.walls[outer].backSector = 7;
+    level.walls[outer + 2].backSector = 2;
+    
+    Map map(level);
+    CHECK(map.GetWallCount() == 12);
+    CHECK(map.GetLinedefs().size() == 11);
+    CHECK(CountTwoSided(map) == 1);
+    CheckSides(map);
+    CHECK(map.GetSectors()[0].portals.size() == 0);
+    CHECK(map.GetSectors()[1].portals.size() == 1);
+    CHECK(map.GetSectors()[2].portals.size() == 1);
+    for (int wall : { portal, outer, outer + 2 }) {
+        CHECK(map.GetWall(wall).backSector == -1);
+        CHECK(map.GetOppositeWall(wall) == -1);
+        CHECK(map.IsWallSolid(wall));
+    }
+    
+    // The walls that lost their portal block sight and movement both ways
+    LineHit hit;
+    CHECK(map.TraceLine(glm::vec2(2.0f, 2.0f), glm::vec2(6.0f, 2.0f), hit));
+    CHECK(map.TraceLine(glm::vec2(6.0f, 2.0f), glm::vec2(2.0f, 2.0f), hit));
+    CHECK(!map.TraceLine(glm::vec2(6.0f, 2.0f), glm::vec2(10.0f, 2.0f), hit));
+}
+
+TEST(MapKeepsDegenerateWalls) {
+    // A corner listed twice gives a wall of zero length in the middle room
+    std::vector<TestLevels::SectorShape> rooms = RoomRow();
+    std::vector<glm::vec2>& middle = rooms[1].contours[0];
+    glm::vec2 corner = middle[1];
+    middle.insert(middle.begin() + 2, corner);
+    LevelData level = TestLevels::Build(rooms);
+    int degenerate = level.sectors[1].firstWall + 1;
+    CHECK(level.walls[degenerate].startVertex == level.walls[degenerate].endVertex);
+    
+    Map map(level);
+    CHECK(map.GetWallCount() == 13);
+    CHECK(CountTwoSided(map) == 2);
+    CheckSides(map);
+    CHECK(map.GetWall(degenerate).start == map.GetWall(degenerate).end);
+    CHECK(map.FindSector(6.0f, 2.0f) == 1);
+    
+    // It blocks nothing, but a trace still stops at the walls round it
+    LineHit hit;
+    CHECK(!map.TraceLine(glm::vec2(2.0f, 2.0f), glm::vec2(10.0f, 2.0f), hit));
+    CHECK(map.TraceLine(glm::vec2(6.0f, 2.0f), glm::vec2(6.0f, -2.0f), hit));
+    CHECK(hit.linedef == map.GetSidedefs()[level.sectors[1].firstWall].linedef);
+}
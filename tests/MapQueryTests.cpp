@@ -0,0 +1,184 @@
+#include "Test.h"
+#include "Map.h"
+#include "LevelGenerator.h"
+#include "TestLevels.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+    // Two rooms 8 x 4 joined by an open portal at x = 8. The first has a
+    // triangular pillar whose slanted face starts in the first blockmap cell and
+    // is crossed by z = 2 in the second, and a small box wholly in the second
+    // cell just in front of that crossing.
+    LevelData PillarCorridor() {
+        TestLevels::SectorShape first;
+        first.contours = {
+            TestLevels::Rectangle(0.0f, 0.0f, 8.0f, 4.0f),
+            { { 3.0f, 3.5f }, { 7.0f, 3.5f }, { 7.0f, 0.5f } },
+            { { 4.2f, 1.8f }, { 4.2f, 2.2f }, { 4.5f, 2.2f }, { 4.5f, 1.8f } }
+        };
+        TestLevels::SectorShape second;
+        second.contours = { TestLevels::Rectangle(8.0f, 0.0f, 16.0f, 4.0f) };
+        return TestLevels::Build({ first, second });
+    }
+    
+    float Cross(const glm::vec2& a, const glm::vec2& b) {
+        return a.x * b.y - a.y * b.x;
+    }
+    
+    // Nearest crossing by testing every line, for comparison with the blockmap walk
+    bool TraceEveryLine(const Map& map, const glm::vec2& start, const glm::vec2& end, bool solidOnly, float& nearest) {
+        nearest = 2.0f;
+        for (const Linedef& line : map.GetLinedefs()) {
+            if (solidOnly && line.backSide >= 0) {
+                continue;
+            }
+            glm::vec2 lineStart = map.GetVertices()[line.startVertex];
+            glm::vec2 direction = end - start;
+            glm::vec2 lineDirection = map.GetVertices()[line.endVertex] - lineStart;
+            float denominator = Cross(direction, lineDirection);
+            if (denominator == 0.0f) {
+                continue;
+            }
+            float t = Cross(lineStart - start, lineDirection) / denominator;
+            float u = Cross(lineStart - start, direction) / denominator;
+            if (t >= 0.0f && t <= 1.0f && u >= 0.0f && u <= 1.0f) {
+                nearest = std::min(nearest, t);
+            }
+        }
+        return nearest <= 1.0f;
+    }
+    
+    float DistanceToLine(const Map& map, int index, const glm::vec2& point) {
+        const Linedef& line = map.GetLinedefs()[index];
+        glm::vec2 start = map.GetVertices()[line.startVertex];
+        glm::vec2 direction = map.GetVertices()[line.endVertex] - start;
+        float t = glm::clamp(glm::dot(point - start, direction) / glm::dot(direction, direction), 0.0f, 1.0f);
+        return glm::length(point - (start + direction * t));
+    }
+    
+    // The linedef of the wall of a sector running from one corner to another, either way
+    int FindLine(const Map& map, const glm::vec2& a, const glm::vec2& b) {
+        for (size_t i = 0; i < map.GetLinedefs().size(); ++i) {
+            const Linedef& line = map.GetLinedefs()[i];
+            glm::vec2 start = map.GetVertices()[line.startVertex];
+            glm::vec2 end = map.GetVertices()[line.endVertex];
+            if ((start == a && end == b) || (start == b && end == a)) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+}
+
+TEST(MapTraceFindsNearerHitInLaterCell) {
+    Map map(PillarCorridor());
+    CHECK(map.GetBlockmap().GetGrid().cellSize == Map::BLOCKMAP_CELL_SIZE);
+    
+    // The slanted face is listed in the first cell but crossed in the second, behind the box
+    LineHit hit;
+    CHECK(map.TraceLine(glm::vec2(1.0f, 2.0f), glm::vec2(15.0f, 2.0f), hit));
+    CHECK(hit.linedef == FindLine(map, glm::vec2(4.2f, 1.8f), glm::vec2(4.2f, 2.2f)));
+    CHECK(std::abs(hit.point.x - 4.2f) < 1e-4f && std::abs(hit.point.y - 2.0f) < 1e-4f);
+    CHECK(std::abs(hit.fraction - 3.2f / 14.0f) < 1e-5f);
+    
+    // Just above the box, the slanted face is the first thing in the way
+    CHECK(map.TraceLine(glm::vec2(1.0f, 2.5f), glm::vec2(15.0f, 2.5f), hit));
+    CHECK(hit.linedef == FindLine(map, glm::vec2(3.0f, 3.5f), glm::vec2(7.0f, 0.5f)));
+    CHECK(std::abs(hit.point.x - 13.0f / 3.0f) < 1e-4f);
+}
+
+TEST(MapTraceSolidOnlySkipsPortals) {
+    Map map(PillarCorridor());
+    int portal = FindLine(map, glm::vec2(8.0f, 0.0f), glm::vec2(8.0f, 4.0f));
+    CHECK(portal >= 0 && map.GetLinedefs()[portal].backSide >= 0);
+    
+    LineHit hit;
+    CHECK(map.TraceLine(glm::vec2(15.0f, 1.0f), glm::vec2(1.0f, 1.0f), hit, false));
+    CHECK(hit.linedef == portal && std::abs(hit.point.x - 8.0f) < 1e-4f);
+    CHECK(map.TraceLine(glm::vec2(15.0f, 1.0f), glm::vec2(1.0f, 1.0f), hit));
+    CHECK(hit.linedef == FindLine(map, glm::vec2(7.0f, 3.5f), glm::vec2(7.0f, 0.5f)));
+    
+    // Through the portal alone, nothing solid is crossed
+    CHECK(!map.TraceLine(glm::vec2(7.5f, 0.25f), glm::vec2(12.0f, 3.0f), hit));
+    CHECK(map.TraceLine(glm::vec2(7.5f, 0.25f), glm::vec2(12.0f, 3.0f), hit, false) && hit.linedef == portal);
+    
+    int first = map.FindSector(7.5f, 0.25f);
+    int second = map.FindSector(12.0f, 3.0f);
+    CHECK(first == 0 && second == 1);
+    CHECK(map.HasLineOfSight(glm::vec2(7.5f, 0.25f), first, glm::vec2(12.0f, 3.0f), second));
+    CHECK(!map.HasLineOfSight(glm::vec2(1.0f, 2.0f), first, glm::vec2(15.0f, 2.0f), second));
+}
+
+TEST(MapTraceStartsOutsideGrid) {
+    Map map(PillarCorridor());
+    LineHit hit;
+    CHECK(map.TraceLine(glm::vec2(-5.0f, 1.0f), glm::vec2(2.0f, 1.0f), hit));
+    CHECK(hit.linedef == FindLine(map, glm::vec2(0.0f, 0.0f), glm::vec2(0.0f, 4.0f)));
+    CHECK(std::abs(hit.fraction - 5.0f / 7.0f) < 1e-5f);
+    
+    // Both ends outside, passing through the level, and missing it altogether
+    CHECK(map.TraceLine(glm::vec2(20.0f, -3.0f), glm::vec2(10.0f, 7.0f), hit));
+    CHECK(std::abs(hit.point.x - 16.0f) < 1e-4f && std::abs(hit.point.y - 1.0f) < 1e-4f);
+    CHECK(!map.TraceLine(glm::vec2(-5.0f, -5.0f), glm::vec2(-1.0f, 20.0f), hit));
+    CHECK(!map.TraceLine(glm::vec2(-5.0f, -5.0f), glm::vec2(-5.0f, -5.0f), hit));
+}
+
+TEST(MapTraceMatchesEveryLine) {
+    LevelGeneratorSettings settings;
+    settings.seed = 3;
+    settings.wallCount = 3000;
+    Map map(LevelGenerator::Generate(settings));
+    const BlockmapGrid& grid = map.GetBlockmap().GetGrid();
+    glm::vec2 size = glm::vec2(grid.width, grid.height) * grid.cellSize;
+    
+    // Rays of every length, some starting or ending off the grid
+    std::mt19937 random(9);
+    std::uniform_real_distribution<float> unit(-0.1f, 1.1f);
+    std::uniform_real_distribution<float> length(0.5f, 40.0f);
+    int hits = 0;
+    for (int i = 0; i < 2000; ++i) {
+        glm::vec2 start = grid.origin + glm::vec2(unit(random), unit(random)) * size;
+        float angle = unit(random) * 6.2831853f;
+        glm::vec2 end = start + glm::vec2(std::cos(angle), std::sin(angle)) * length(random);
+        for (bool solidOnly : { true, false }) {
+            float expected;
+            bool expectHit = TraceEveryLine(map, start, end, solidOnly, expected);
+            LineHit hit;
+            bool found = map.TraceLine(start, end, hit, solidOnly);
+            CHECK(found == expectHit);
+            if (found && expectHit) {
+                CHECK(std::abs(hit.fraction - expected) < 1e-5f);
+                hits++;
+            }
+        }
+    }
+    CHECK(hits > 1000);
+}
+
+TEST(MapFindLinesInRadiusReportsEachOnce) {
+    Map map(PillarCorridor());
+    
+    // Centered on a cell corner, so the long outer walls are listed in several cells searched
+    glm::vec2 center(8.0f, 4.0f);
+    std::vector<int> lines = { -7 };
+    size_t added = map.FindLinesInRadius(center, 3.0f, lines);
+    CHECK(lines.front() == -7 && added == lines.size() - 1);
+    CHECK(std::is_sorted(lines.begin() + 1, lines.end()));
+    CHECK(std::adjacent_find(lines.begin() + 1, lines.end()) == lines.end());
+    
+    // Exactly the lines within the radius
+    std::vector<int> expected;
+    for (size_t i = 0; i < map.GetLinedefs().size(); ++i) {
+        if (DistanceToLine(map, static_cast<int>(i), center) <= 3.0f) {
+            expected.push_back(static_cast<int>(i));
+        }
+    }
+    CHECK(std::vector<int>(lines.begin() + 1, lines.end()) == expected);
+    CHECK(expected.size() == 5);
+    
+    lines.clear();
+    CHECK(map.FindLinesInBox(glm::vec2(3.9f, 1.9f), glm::vec2(4.3f, 2.1f), lines) == 1);
+    CHECK(lines[0] == FindLine(map, glm::vec2(4.2f, 1.8f), glm::vec2(4.2f, 2.2f)));
+}
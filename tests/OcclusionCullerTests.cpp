@@ -0,0 +1,147 @@
+#include "Test.h"
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+#include <glm/glm-master/glm-master/glm/gtc/matrix_transform.hpp>
+#include <random>
+
+namespace {
+    struct Quad {
+        glm::vec3 corners[4];
+    };
+    
+    glm::mat4 TestViewProjection() {
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 2.0f, 0.1f, 100.0f);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        return projection * view;
+    }
+    
+    // Random quads in front of, around and behind the eye, many crossing the near or far plane
+    std::vector<Quad> RandomQuads(unsigned int seed, int count) {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> lateral(-60.0f, 60.0f);
+        std::uniform_real_distribution<float> depth(-150.0f, 5.0f);
+        std::vector<Quad> quads(count);
+        for (Quad& quad : quads) {
+            for (glm::vec3& corner : quad.corners) {
+                corner = glm::vec3(lateral(random), lateral(random), depth(random));
+            }
+        }
+        return quads;
+    }
+    
+    // Quads that collapse to points, lines, slivers or single pixels, or sit exactly on a clip plane
+    std::vector<Quad> DegenerateQuads() {
+        glm::vec3 a(-3.0f, -2.0f, -10.0f);
+        glm::vec3 b(4.0f, 1.0f, -20.0f);
+        glm::vec3 c(1.0f, 5.0f, -15.0f);
+        return {
+            { { a, a, a, a } },
+            { { a, b, b, a } },
+            { { a, (a + b) * 0.5f, b, a } },
+            { { a, b, b + glm::vec3(0.0f, 1e-4f, 0.0f), a } },
+            { { c, c + glm::vec3(0.01f, 0.0f, 0.0f), c + glm::vec3(0.01f, 0.01f, 0.0f), c + glm::vec3(0.0f, 0.01f, 0.0f) } },
+            { { glm::vec3(-5.0f, -5.0f, -0.1f), glm::vec3(5.0f, -5.0f, -0.1f), glm::vec3(5.0f, 5.0f, -0.1f), glm::vec3(-5.0f, 5.0f, -0.1f) } },
+            { { glm::vec3(-90.0f, -90.0f, -100.0f), glm::vec3(90.0f, -90.0f, -100.0f), glm::vec3(90.0f, 90.0f, -100.0f), glm::vec3(-90.0f, 90.0f, -100.0f) } },
+            { { glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(-1.0f, 1.0f, 0.0f) } },
+            { { glm::vec3(-1e4f, -1.0f, -5.0f), glm::vec3(1e4f, -1.0f, -5.0f), glm::vec3(1e4f, -1.0f, -500.0f), glm::vec3(-1e4f, -1.0f, -500.0f) } },
+        };
+    }
+    
+    void Render(OcclusionCuller& culler, const std::vector<Quad>& quads) {
+        culler.Begin(TestViewProjection());
+        for (const Quad& quad : quads) {
+            culler.AddOccluder(quad.corners[0], quad.corners[1], quad.corners[2], quad.corners[3]);
+        }
+        culler.Rasterize();
+    }
+    
+    bool PyramidsEqual(const OcclusionCuller& a, const OcclusionCuller& b) {
+        if (a.GetLevelCount() != b.GetLevelCount()) {
+            return false;
+        }
+        for (int level = 0; level < a.GetLevelCount(); ++level) {
+            glm::ivec2 size = a.GetLevelSize(level);
+            const float* depthA = a.GetLevel(level);
+            const float* depthB = b.GetLevel(level);
+            for (int i = 0; i < size.x * size.y; ++i) {
+                if (depthA[i] != depthB[i]) {
+                    std::cerr << "level " << level << " texel " << i << ": " << depthA[i] << " != " << depthB[i] << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    
+    // Renders the quads with the SIMD and scalar kernels and compares every level
+    void CheckKernelsAgree(const std::vector<Quad>& quads, ThreadPool* pool) {
+        OcclusionCuller simd(pool);
+        OcclusionCuller scalar(pool);
+        simd.SetSimdEnabled(OcclusionCuller::IsSimdAvailable());
+        scalar.SetSimdEnabled(false);
+        Render(simd, quads);
+        Render(scalar, quads);
+        CHECK(PyramidsEqual(simd, scalar));
+    }
+}
+
+TEST(OcclusionKernelsAgreeOnRandomTriangles) {
+    for (unsigned int seed = 1; seed <= 20; ++seed) {
+        CheckKernelsAgree(RandomQuads(seed, 40), nullptr);
+    }
+}
+
+TEST(OcclusionKernelsAgreeOnDegenerateTriangles) {
+    std::vector<Quad> quads = DegenerateQuads();
+    for (const Quad& quad : quads) {
+        CheckKernelsAgree({ quad }, nullptr);
+    }
+    CheckKernelsAgree(quads, nullptr);
+}
+
+TEST(OcclusionBandsMatchSerialRasterization) {
+    ThreadPool pool(4);
+    std::vector<Quad> quads = RandomQuads(99, 200);
+    CheckKernelsAgree(quads, &pool);
+    
+    OcclusionCuller serial;
+    OcclusionCuller banded(&pool);
+    Render(serial, quads);
+    Render(banded, quads);
+    CHECK(PyramidsEqual(serial, banded));
+}
+
+TEST(OcclusionPyramidKeepsFarthestDepth) {
+    OcclusionCuller culler;
+    Render(culler, RandomQuads(7, 40));
+    for (int level = 1; level < culler.GetLevelCount(); ++level) {
+        glm::ivec2 sourceSize = culler.GetLevelSize(level - 1);
+        glm::ivec2 size = culler.GetLevelSize(level);
+        const float* source = culler.GetLevel(level - 1);
+        const float* depth = culler.GetLevel(level);
+        for (int y = 0; y < sourceSize.y; ++y) {
+            for (int x = 0; x < sourceSize.x; ++x) {
+                CHECK(source[y * sourceSize.x + x] <= depth[std::min(y / 2, size.y - 1) * size.x + std::min(x / 2, size.x - 1)]);
+            }
+        }
+    }
+}
+
+TEST(OcclusionOccluderCrossingFarPlaneStaysConservative) {
+    // A slope receding from 10 to 1000 units away, past the far plane at 100, and a box just in front of it
+    OcclusionCuller culler;
+    Render(culler, { { { glm::vec3(-20.0f, -20.0f, -10.0f), glm::vec3(20.0f, -20.0f, -10.0f),
+                         glm::vec3(20.0f, 20.0f, -1000.0f), glm::vec3(-20.0f, 20.0f, -1000.0f) } } });
+    
+    glm::vec3 onSlope(0.0f, -20.0f + 40.0f * 80.0f / 990.0f, -90.0f);
+    glm::vec3 inFront = onSlope * 0.97f;
+    Aabb box;
+    box.min = inFront - glm::vec3(0.1f);
+    box.max = inFront + glm::vec3(0.1f);
+    CHECK(culler.IsVisible(box));
+    
+    // The same box well behind the slope is hidden
+    box.min = onSlope * 1.2f - glm::vec3(0.1f);
+    box.max = onSlope * 1.2f + glm::vec3(0.1f);
+    CHECK(!culler.IsVisible(box));
+}
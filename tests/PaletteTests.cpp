@@ -0,0 +1,99 @@
+#include "Test.h"
+#include "Palette.h"
+#include <cstdlib>
+#include <random>
+
+namespace {
+    int Distance(const unsigned char* a, const unsigned char* b) {
+        return std::abs(a[0] - b[0]) + std::abs(a[1] - b[1]) + std::abs(a[2] - b[2]);
+    }
+    
+    int Brightness(const unsigned char* color) {
+        return color[0] + color[1] + color[2];
+    }
+}
+
+TEST(PaletteKeepsFewColorsExactly) {
+    const unsigned char colors[][4] = {
+        { 200, 40, 40, 255 }, { 40, 200, 40, 255 }, { 40, 40, 200, 255 }, { 240, 240, 240, 255 }
+    };
+    std::vector<unsigned char> pixels;
+    for (int i = 0; i < 64; ++i) {
+        const unsigned char* color = colors[i % 4];
+        pixels.insert(pixels.end(), color, color + 4);
+    }
+    Palette palette = Palette::Build({ ArrayView<unsigned char>(pixels) });
+    
+    std::vector<unsigned char> indices = palette.Index(pixels.data(), 8, 8);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        CHECK(Distance(palette.GetColors() + indices[i] * 3, &pixels[i * 4]) == 0);
+    }
+    
+    // The darkened copies give the colormap's dim rows real shades of each color
+    const unsigned char* colormap = palette.GetColormap();
+    for (int i = 0; i < 4; ++i) {
+        int entry = indices[i];
+        CHECK(colormap[entry] == entry);
+        const unsigned char* half = palette.GetColors() + colormap[Palette::LIGHT_LEVELS / 2 * Palette::COLOR_COUNT + entry] * 3;
+        unsigned char expected[3] = { static_cast<unsigned char>(colors[i][0] / 2), static_cast<unsigned char>(colors[i][1] / 2),
+                                      static_cast<unsigned char>(colors[i][2] / 2) };
+        CHECK(Distance(half, expected) <= 3);
+    }
+}
+
+TEST(PaletteColormapDarkensByRow) {
+    std::mt19937 random(7);
+    std::vector<unsigned char> pixels(64 * 64 * 4);
+    for (unsigned char& channel : pixels) {
+        channel = static_cast<unsigned char>(random());
+    }
+    Palette palette = Palette::Build({ ArrayView<unsigned char>(pixels) });
+    
+    // Each row is no brighter than the one before, give or take the palette's spacing
+    const unsigned char* colors = palette.GetColors();
+    const unsigned char* colormap = palette.GetColormap();
+    for (int i = 0; i < Palette::COLOR_COUNT; ++i) {
+        int previous = Brightness(colors + colormap[i] * 3);
+        for (int row = 1; row < Palette::LIGHT_LEVELS; ++row) {
+            int brightness = Brightness(colors + colormap[row * Palette::COLOR_COUNT + i] * 3);
+            CHECK(brightness <= previous + 48);
+            previous = std::max(previous, brightness);
+        }
+        CHECK(Brightness(colors + colormap[(Palette::LIGHT_LEVELS - 1) * Palette::COLOR_COUNT + i] * 3) <= 96);
+    }
+}
+
+TEST(PaletteIndexesNoisyImagesClosely) {
+    std::mt19937 random(11);
+    std::vector<unsigned char> pixels(128 * 128 * 4);
+    for (size_t i = 0; i < pixels.size(); i += 4) {
+        // A few base hues with noise, like worn wall textures
+        int hue = static_cast<int>(random() % 3);
+        for (int channel = 0; channel < 3; ++channel) {
+            int base = channel == hue ? 160 : 60;
+            pixels[i + channel] = static_cast<unsigned char>(base + static_cast<int>(random() % 64) - 32);
+        }
+        pixels[i + 3] = 255;
+    }
+    Palette palette = Palette::Build({ ArrayView<unsigned char>(pixels) });
+    std::vector<unsigned char> indices = palette.Index(pixels.data(), 128, 128);
+    
+    long long total = 0;
+    int worst = 0;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        int distance = Distance(palette.GetColors() + indices[i] * 3, &pixels[i * 4]);
+        total += distance;
+        worst = std::max(worst, distance);
+    }
+    CHECK(total / static_cast<long long>(indices.size()) <= 20);
+    CHECK(worst <= 48);
+}
+
+TEST(PaletteOfNothingIsBlack) {
+    Palette palette = Palette::Build({});
+    for (int i = 0; i < Palette::COLOR_COUNT * 3; ++i) {
+        CHECK(palette.GetColors()[i] == 0);
+    }
+    unsigned char pixel[4] = { 255, 128, 0, 255 };
+    CHECK(palette.Index(pixel, 1, 1)[0] == 0);
+}
@@ -0,0 +1,92 @@
+#include "Test.h"
+#include "Map.h"
+#include "PortalCuller.h"
+#include "TestLevels.h"
+#include <glm/glm-master/glm-master/glm/gtc/matrix_transform.hpp>
+
+namespace {
+    // Four rooms 8 x 4 in a row along x, joined by portals; the camera starts
+    // in the second. The last room's floor can be raised to close its opening.
+    LevelData RoomRow(float lastFloor) {
+        std::vector<TestLevels::SectorShape> rooms(4);
+        for (int i = 0; i < 4; ++i) {
+            rooms[i].contours = { TestLevels::Rectangle(i * 8.0f - 8.0f, 0.0f, i * 8.0f, 4.0f) };
+        }
+        rooms[3].floorHeight = lastFloor;
+        rooms[3].ceilingHeight = lastFloor + 3.0f;
+        return TestLevels::Build(rooms);
+    }
+    
+    glm::mat4 ViewProjection(const glm::vec3& eye, const glm::vec3& forward) {
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+        return projection * glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+    
+    bool Contains(const ClipRect& outer, const ClipRect& inner) {
+        return inner.min.x >= outer.min.x && inner.min.y >= outer.min.y &&
+               inner.max.x <= outer.max.x && inner.max.y <= outer.max.y;
+    }
+}
+
+TEST(PortalCullerSeesThroughOpenPortals) {
+    Map map(RoomRow(0.0f));
+    glm::vec3 eye(4.0f, 1.5f, 2.0f);
+    PortalCuller culler;
+    culler.Cull(map, ViewProjection(eye, glm::vec3(1.0f, 0.0f, 0.0f)), eye);
+    CHECK(culler.GetCameraSector() == 1);
+    
+    // Ahead down the row, but not the room behind the camera
+    CHECK(culler.IsSectorVisible(1) && culler.IsSectorVisible(2) && culler.IsSectorVisible(3));
+    CHECK(!culler.IsSectorVisible(0));
+    CHECK(culler.GetPortalsTraversed() == 2);
+    
+    // Each opening is seen through the one before it, so it is no larger on screen
+    ClipRect whole = { glm::vec2(-1.0f), glm::vec2(1.0f) };
+    CHECK(Contains(whole, culler.GetSectorRect(2)) && !culler.GetSectorRect(2).IsEmpty());
+    CHECK(Contains(culler.GetSectorRect(2), culler.GetSectorRect(3)) && !culler.GetSectorRect(3).IsEmpty());
+    CHECK(culler.GetSectorRect(1).min == whole.min && culler.GetSectorRect(1).max == whole.max);
+    
+    // Turning round swaps which end of the row is visible
+    culler.Cull(map, ViewProjection(eye, glm::vec3(-1.0f, 0.0f, 0.0f)), eye);
+    CHECK(culler.IsSectorVisible(0) && !culler.IsSectorVisible(2) && !culler.IsSectorVisible(3));
+    
+    // Facing a side wall, no opening is on screen
+    culler.Cull(map, ViewProjection(eye, glm::vec3(0.0f, 0.0f, 1.0f)), eye);
+    CHECK(culler.IsSectorVisible(1));
+    CHECK(!culler.IsSectorVisible(0) && !culler.IsSectorVisible(2) && !culler.IsSectorVisible(3));
+    CHECK(culler.GetPortalsTraversed() == 0);
+}
+
+TEST(PortalCullerStopsAtClosedOpening) {
+    // The last room's floor is level with the ceiling of the one before it
+    Map map(RoomRow(3.0f));
+    glm::vec3 eye(4.0f, 1.5f, 2.0f);
+    PortalCuller culler;
+    culler.Cull(map, ViewProjection(eye, glm::vec3(1.0f, 0.0f, 0.0f)), eye);
+    CHECK(culler.IsSectorVisible(2));
+    CHECK(!culler.IsSectorVisible(3));
+    CHECK(culler.GetPortalsTraversed() == 1);
+}
+
+TEST(PortalCullerKeepsOpeningCameraStandsIn) {
+    // Just through the portal with the opening at the camera's back, so it
+    // projects behind the near plane; the room left behind is kept visible
+    Map map(RoomRow(0.0f));
+    glm::vec3 eye(8.1f, 1.5f, 2.0f);
+    PortalCuller culler;
+    culler.Cull(map, ViewProjection(eye, glm::vec3(1.0f, 0.0f, 0.0f)), eye);
+    CHECK(culler.GetCameraSector() == 2);
+    CHECK(culler.IsSectorVisible(1));
+}
+
+TEST(PortalCullerShowsEverythingFromOutside) {
+    Map map(RoomRow(0.0f));
+    glm::vec3 eye(4.0f, 1.5f, -10.0f);
+    PortalCuller culler;
+    culler.Cull(map, ViewProjection(eye, glm::vec3(0.0f, 0.0f, -1.0f)), eye);
+    CHECK(culler.GetCameraSector() == -1);
+    for (int sector = 0; sector < 4; ++sector) {
+        CHECK(culler.IsSectorVisible(sector));
+    }
+    CHECK(culler.GetPortalsTraversed() == 0);
+}
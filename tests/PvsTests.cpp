@@ -0,0 +1,158 @@
+#include "Test.h"
+#include "Map.h"
+#include "Pvs.h"
+#include "TestLevels.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace {
+    std::string TempPath(const std::string& name) {
+        return (std::filesystem::temp_directory_path() / ("PvsTests_" + name)).string();
+    }
+    
+    // A room opening onto a long corridor that turns left at its far end and
+    // runs on up through a second sector. No line from the room gets into the
+    // corridor and then round the corner past the turn.
+    LevelData CornerCorridor() {
+        TestLevels::SectorShape room;
+        room.contours = { TestLevels::Rectangle(0.0f, 0.0f, 4.0f, 4.0f) };
+        TestLevels::SectorShape corridor;
+        corridor.contours = { { { 4.0f, 0.0f }, { 20.0f, 0.0f }, { 20.0f, 4.0f }, { 16.0f, 4.0f }, { 4.0f, 4.0f } } };
+        TestLevels::SectorShape turn;
+        turn.contours = { TestLevels::Rectangle(16.0f, 4.0f, 20.0f, 8.0f) };
+        TestLevels::SectorShape beyond;
+        beyond.contours = { TestLevels::Rectangle(16.0f, 8.0f, 20.0f, 24.0f) };
+        return TestLevels::Build({ room, corridor, turn, beyond });
+    }
+    
+    // Sectors in a row joined by portals only at the ends, so rows are long
+    // runs of zero bytes with a bit at either end
+    Pvs BuildSparse(int sectorCount) {
+        std::vector<PvsPortal> portals = {
+            { glm::vec2(0.0f, 0.0f), glm::vec2(0.0f, 1.0f), 0, sectorCount - 1 },
+            { glm::vec2(0.0f, 1.0f), glm::vec2(0.0f, 0.0f), sectorCount - 1, 0 }
+        };
+        Pvs pvs;
+        pvs.Build(sectorCount, portals);
+        return pvs;
+    }
+    
+    bool SameRows(const Pvs& a, const Pvs& b) {
+        if (a.GetSectorCount() != b.GetSectorCount()) {
+            return false;
+        }
+        std::vector<uint8_t> aBits, bBits;
+        for (int sector = 0; sector < a.GetSectorCount(); ++sector) {
+            a.DecompressRow(sector, aBits);
+            b.DecompressRow(sector, bBits);
+            if (aBits != bBits) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST(PvsCullsAroundCorner) {
+    Map map(CornerCorridor());
+    const Pvs& pvs = map.GetPvs();
+    CHECK(pvs.GetSectorCount() == 4);
+    
+    // Every sector sees itself and its neighbors, and the room sees the turn
+    // down the corridor
+    for (int sector = 0; sector < 4; ++sector) {
+        CHECK(pvs.IsVisible(sector, sector));
+        if (sector > 0) {
+            CHECK(pvs.IsVisible(sector, sector - 1) && pvs.IsVisible(sector - 1, sector));
+        }
+    }
+    CHECK(pvs.IsVisible(0, 2) && pvs.IsVisible(2, 0));
+    CHECK(pvs.IsVisible(1, 3) && pvs.IsVisible(3, 1));
+    
+    // But not what is round the corner, from either end
+    CHECK(!pvs.IsVisible(0, 3) && !pvs.IsVisible(3, 0));
+    CHECK(!map.MightSee(0, 3));
+    CHECK(!pvs.IsVisible(0, 4) && !pvs.IsVisible(0, -1));
+}
+
+TEST(PvsCompressesLongZeroRuns) {
+    // Rows of 375 bytes, so the runs between the end bits are over 255 bytes long
+    const int sectorCount = 3000;
+    Pvs pvs = BuildSparse(sectorCount);
+    CHECK(pvs.GetSectorCount() == sectorCount);
+    CHECK(pvs.GetCompressedSize() < static_cast<size_t>(sectorCount) * 10);
+    
+    std::vector<uint8_t> bits;
+    int mismatches = 0;
+    for (int from = 0; from < sectorCount; ++from) {
+        pvs.DecompressRow(from, bits);
+        CHECK(bits.size() == (sectorCount + 7) / 8);
+        bool ends = from == 0 || from == sectorCount - 1;
+        for (int to = 0; to < sectorCount; ++to) {
+            bool expected = to == from || (ends && (to == 0 || to == sectorCount - 1));
+            mismatches += ((bits[to >> 3] >> (to & 7)) & 1) != expected;
+        }
+    }
+    CHECK(mismatches == 0);
+    
+    // Sectors beyond the table decompress to an empty row
+    pvs.DecompressRow(sectorCount, bits);
+    CHECK(bits.size() == (sectorCount + 7) / 8 && bits[0] == 0 && bits.back() == 0);
+}
+
+TEST(PvsSavesAndLoads) {
+    Pvs pvs = BuildSparse(3000);
+    std::string path = TempPath("sparse.pvs");
+    CHECK(pvs.Save(path, 42));
+    
+    Pvs loaded;
+    CHECK(loaded.Load(path, 42));
+    CHECK(SameRows(pvs, loaded));
+    CHECK(loaded.GetCompressedSize() == pvs.GetCompressedSize());
+    
+    // Computed for other geometry, or not there at all
+    Pvs stale;
+    CHECK(!stale.Load(path, 43));
+    CHECK(stale.IsEmpty());
+    CHECK(!stale.Load(TempPath("missing.pvs"), 42));
+    std::remove(path.c_str());
+}
+
+TEST(PvsRejectsDamagedCache) {
+    Pvs pvs = BuildSparse(3000);
+    std::string path = TempPath("damaged.pvs");
+    CHECK(pvs.Save(path, 42));
+    std::vector<char> bytes;
+    {
+        std::ifstream file(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    auto write = [&](const std::vector<char>& contents) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), contents.size());
+    };
+    
+    // A flipped bit in the rows fails the data hash
+    std::vector<char> flipped = bytes;
+    flipped.back() ^= 1;
+    write(flipped);
+    Pvs loaded;
+    CHECK(!loaded.Load(path, 42));
+    
+    // So does a cut off file, and a header from another format
+    write(std::vector<char>(bytes.begin(), bytes.end() - 1));
+    CHECK(!loaded.Load(path, 42));
+    std::vector<char> renamed = bytes;
+    renamed[0] ^= 1;
+    write(renamed);
+    CHECK(!loaded.Load(path, 42));
+    CHECK(loaded.IsEmpty());
+    
+    write(bytes);
+    CHECK(loaded.Load(path, 42));
+    CHECK(SameRows(pvs, loaded));
+    std::remove(path.c_str());
+}
@@ -0,0 +1,94 @@
+#include "Test.h"
+#include "Map.h"
+#include "LevelGenerator.h"
+#include "TestLevels.h"
+#include <cmath>
+#include <random>
+
+namespace {
+    Map& GeneratedMap() {
+        static Map map([] {
+            LevelGeneratorSettings settings;
+            settings.seed = 5;
+            settings.wallCount = 3000;
+            return LevelGenerator::Generate(settings);
+        }());
+        return map;
+    }
+}
+
+TEST(RejectIsSymmetric) {
+    const Map& map = GeneratedMap();
+    int sectorCount = static_cast<int>(map.GetSectors().size());
+    CHECK(map.GetRejectTable().GetSectorCount() == sectorCount);
+    int rejected = 0;
+    for (int a = 0; a < sectorCount; ++a) {
+        CHECK(map.MightSee(a, a));
+        for (int b = 0; b < sectorCount; ++b) {
+            CHECK(map.MightSee(a, b) == map.MightSee(b, a));
+            rejected += !map.MightSee(a, b);
+        }
+    }
+    
+    // A maze of rooms hides most of itself from any one room
+    CHECK(rejected > sectorCount * sectorCount / 2);
+}
+
+TEST(RejectKeepsPortalNeighbors) {
+    const Map& map = GeneratedMap();
+    for (size_t i = 0; i < map.GetSectors().size(); ++i) {
+        for (const Wall& wall : map.GetSectors()[i].walls) {
+            if (wall.backSector >= 0) {
+                CHECK(map.MightSee(static_cast<int>(i), wall.backSector));
+            }
+        }
+    }
+}
+
+TEST(RejectKeepsClearSightLines) {
+    const Map& map = GeneratedMap();
+    const BlockmapGrid& grid = map.GetBlockmap().GetGrid();
+    glm::vec2 size = glm::vec2(grid.width, grid.height) * grid.cellSize;
+    
+    // Any two points with no solid wall between them must not be rejected
+    std::mt19937 random(13);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> length(1.0f, 30.0f);
+    int clear = 0;
+    int crossings = 0;
+    for (int i = 0; i < 100000; ++i) {
+        glm::vec2 from = grid.origin + glm::vec2(unit(random), unit(random)) * size;
+        float angle = unit(random) * 6.2831853f;
+        glm::vec2 to = from + glm::vec2(std::cos(angle), std::sin(angle)) * length(random);
+        int fromSector = map.FindSector(from.x, from.y);
+        int toSector = map.FindSector(to.x, to.y);
+        LineHit hit;
+        if (fromSector < 0 || toSector < 0 || map.TraceLine(from, to, hit)) {
+            continue;
+        }
+        CHECK(map.MightSee(fromSector, toSector));
+        CHECK(map.HasLineOfSight(from, fromSector, to, toSector));
+        clear++;
+        crossings += fromSector != toSector;
+    }
+    CHECK(clear > 2000 && crossings > 400);
+}
+
+TEST(RejectSeparatesDisconnectedRooms) {
+    // Two rooms side by side with no portal, and a third joined to the second
+    TestLevels::SectorShape first;
+    first.contours = { TestLevels::Rectangle(0.0f, 0.0f, 4.0f, 4.0f) };
+    TestLevels::SectorShape second;
+    second.contours = { TestLevels::Rectangle(6.0f, 0.0f, 10.0f, 4.0f) };
+    TestLevels::SectorShape third;
+    third.contours = { TestLevels::Rectangle(10.0f, 0.0f, 14.0f, 4.0f) };
+    Map map(TestLevels::Build({ first, second, third }));
+    
+    CHECK(!map.MightSee(0, 1) && !map.MightSee(1, 0));
+    CHECK(!map.MightSee(0, 2) && !map.MightSee(2, 0));
+    CHECK(map.MightSee(1, 2) && map.MightSee(2, 1));
+    CHECK(!map.HasLineOfSight(glm::vec2(2.0f, 2.0f), 0, glm::vec2(8.0f, 2.0f), 1));
+    
+    // A point outside the map is never rejected
+    CHECK(map.MightSee(-1, 0) && map.MightSee(0, -1) && map.MightSee(0, 3));
+}
@@ -0,0 +1,154 @@
+#include "Test.h"
+#include "AabbTree.h"
+#include "Bsp.h"
+#include <glm/glm-master/glm-master/glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <random>
+
+namespace {
+    std::vector<Aabb> RandomBoxes(int count) {
+        std::mt19937 random(5);
+        std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+        std::vector<Aabb> boxes(count);
+        for (Aabb& box : boxes) {
+            box.min = glm::vec3(position(random), position(random), position(random));
+            box.max = box.min + glm::vec3(1.0f);
+        }
+        return boxes;
+    }
+    
+    // Inner nodes down the right side, each with one item in its left leaf
+    void BuildChain(int depth, std::vector<AabbTree::Node>& nodes, std::vector<int>& items, std::vector<Aabb>& bounds) {
+        Aabb box;
+        box.min = glm::vec3(0.0f);
+        box.max = glm::vec3(1.0f);
+        for (int level = 0; level < depth; ++level) {
+            int index = static_cast<int>(nodes.size());
+            nodes.push_back({ box, level, 0, index + 2 });
+            nodes.push_back({ box, level, 1, -1 });
+        }
+        nodes.push_back({ box, depth, 1, -1 });
+        for (int item = 0; item <= depth; ++item) {
+            items.push_back(item);
+            bounds.push_back(box);
+        }
+    }
+    
+    // Four walls of a square room split by a pillar, giving a tree with several nodes
+    std::vector<BspSeg> RoomSegs() {
+        const glm::vec2 room[4] = { { 0.0f, 0.0f }, { 8.0f, 0.0f }, { 8.0f, 8.0f }, { 0.0f, 8.0f } };
+        const glm::vec2 pillar[4] = { { 3.0f, 3.0f }, { 3.0f, 5.0f }, { 5.0f, 5.0f }, { 5.0f, 3.0f } };
+        std::vector<BspSeg> segs;
+        for (int i = 0; i < 4; ++i) {
+            segs.push_back({ room[i], room[(i + 1) % 4], i, 0 });
+            segs.push_back({ pillar[i], pillar[(i + 1) % 4], 4 + i, 0 });
+        }
+        return segs;
+    }
+}
+
+TEST(AabbTreeAssignAcceptsBuiltTree) {
+    std::vector<Aabb> boxes = RandomBoxes(500);
+    AabbTree built;
+    built.Build(boxes);
+    
+    AabbTree assigned;
+    CHECK(assigned.Assign(built.GetNodes(), built.GetItems(), built.GetItemBounds(), boxes.size()));
+    
+    glm::mat4 viewProjection = glm::perspective(glm::radians(70.0f), 1.5f, 0.1f, 100.0f);
+    Frustum frustum(viewProjection);
+    std::vector<int> expected;
+    std::vector<int> result;
+    built.Query(frustum, expected);
+    assigned.Query(frustum, result);
+    CHECK(!expected.empty());
+    CHECK(result == expected);
+}
+
+TEST(AabbTreeAssignRejectsBadLinks) {
+    std::vector<Aabb> boxes = RandomBoxes(100);
+    AabbTree built;
+    built.Build(boxes);
+    std::vector<AabbTree::Node> nodes(built.GetNodes().begin(), built.GetNodes().end());
+    ArrayView<int> items = built.GetItems();
+    ArrayView<Aabb> bounds = built.GetItemBounds();
+    
+    AabbTree tree;
+    CHECK(!tree.Assign(built.GetNodes(), items, bounds, boxes.size() - 1));
+    
+    std::vector<AabbTree::Node> cycle = nodes;
+    cycle[0].secondChild = 0;
+    CHECK(!tree.Assign(cycle, items, bounds, boxes.size()));
+    CHECK(tree.IsEmpty());
+    
+    std::vector<AabbTree::Node> outOfRange = nodes;
+    outOfRange[0].secondChild = static_cast<int>(nodes.size());
+    CHECK(!tree.Assign(outOfRange, items, bounds, boxes.size()));
+    
+    std::vector<AabbTree::Node> overrun = nodes;
+    overrun.back().count += 1;
+    CHECK(!tree.Assign(overrun, items, bounds, boxes.size()));
+    
+    // Sharing a subtree makes a graph that is not a tree
+    std::vector<AabbTree::Node> shared = nodes;
+    shared[0].secondChild = 1;
+    CHECK(!tree.Assign(shared, items, bounds, boxes.size()));
+}
+
+TEST(AabbTreeAssignLimitsDepth) {
+    std::vector<AabbTree::Node> nodes;
+    std::vector<int> items;
+    std::vector<Aabb> bounds;
+    BuildChain(AabbTree::MAX_DEPTH, nodes, items, bounds);
+    AabbTree tree;
+    CHECK(tree.Assign(nodes, items, bounds, items.size()));
+    
+    // Every leaf is inside this frustum's near half, so the walk reaches the deepest one
+    std::vector<int> result;
+    tree.Query(Frustum(glm::ortho(-2.0f, 2.0f, -2.0f, 2.0f, -2.0f, 2.0f)), result);
+    CHECK(result.size() == items.size());
+    
+    nodes.clear();
+    items.clear();
+    bounds.clear();
+    BuildChain(AabbTree::MAX_DEPTH + 1, nodes, items, bounds);
+    CHECK(!tree.Assign(nodes, items, bounds, items.size()));
+}
+
+TEST(BspAssignAcceptsBuiltTree) {
+    BspTree built;
+    built.Build(RoomSegs());
+    CHECK(built.GetNodes().size() > 0);
+    
+    BspTree assigned;
+    CHECK(assigned.Assign(built.GetNodes(), built.GetSegs(), built.GetSubsectors(), built.GetRoot(), 8, 1));
+    for (float x = 0.5f; x < 8.0f; x += 1.0f) {
+        for (float z = 0.5f; z < 8.0f; z += 1.0f) {
+            CHECK(assigned.FindSubsector(glm::vec2(x, z)) == built.FindSubsector(glm::vec2(x, z)));
+        }
+    }
+}
+
+TEST(BspAssignRejectsBadLinks) {
+    BspTree built;
+    built.Build(RoomSegs());
+    std::vector<BspNode> nodes(built.GetNodes().begin(), built.GetNodes().end());
+    ArrayView<BspSeg> segs = built.GetSegs();
+    ArrayView<BspSubsector> subsectors = built.GetSubsectors();
+    uint32_t root = built.GetRoot();
+    
+    BspTree tree;
+    CHECK(!tree.Assign(nodes, segs, subsectors, root, 7, 1));
+    CHECK(!tree.Assign(nodes, segs, subsectors, root, 8, 0));
+    CHECK(!tree.Assign(nodes, segs, subsectors, static_cast<uint32_t>(nodes.size()), 8, 1));
+    CHECK(!tree.Assign(nodes, segs, subsectors, static_cast<uint32_t>(subsectors.size()) | BspTree::SUBSECTOR_FLAG, 8, 1));
+    
+    std::vector<BspNode> loop = nodes;
+    loop.back().children[0] = 0;
+    CHECK(!tree.Assign(loop, segs, subsectors, root, 8, 1));
+    CHECK(tree.IsEmpty());
+    
+    std::vector<BspSubsector> overrun(subsectors.begin(), subsectors.end());
+    overrun.back().segCount += 1;
+    CHECK(!tree.Assign(nodes, segs, overrun, root, 8, 1));
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+// Minimal test runner. TEST(Name) { ... } defines and registers a test;
+// CHECK(condition) reports a failure and lets the test carry on.
+namespace Test {
+    struct Case {
+        const char* name;
+        void (*function)();
+    };
+    
+    std::vector<Case>& GetCases();
+    void Fail(const char* file, int line, const char* condition);
+    
+    struct Registrar {
+        Registrar(const char* name, void (*function)()) { GetCases().push_back({ name, function }); }
+    };
+}
+
+#define TEST(name) \
+    static void name(); \
+    static Test::Registrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            Test::Fail(__FILE__, __LINE__, #condition); \
+        } \
+    } while (false)
+
+// Runs statement and checks that it throws exceptionType
+#define CHECK_THROWS(statement, exceptionType) \
+    do { \
+        bool thrown = false; \
+        try { \
+            statement; \
+        } catch (const exceptionType&) { \
+            thrown = true; \
+        } \
+        if (!thrown) { \
+            Test::Fail(__FILE__, __LINE__, #statement " throws " #exceptionType); \
+        } \
+    } while (false)
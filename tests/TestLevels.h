@@ -0,0 +1,65 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "LevelData.h"
+
+// Levels built in code for tests. Each sector is an outline plus any holes,
+// given as corner lists; corners at the same position are shared, and a wall
+// becomes a portal where another sector has the same wall the other way round.
+namespace TestLevels {
+    struct SectorShape {
+        std::vector<std::vector<glm::vec2>> contours;
+        float floorHeight = 0.0f;
+        float ceilingHeight = 3.0f;
+    };
+    
+    inline LevelData Build(const std::vector<SectorShape>& shapes) {
+        LevelData level;
+        level.textures = { "wall.png" };
+        auto vertexIndex = [&](const glm::vec2& point) {
+            for (size_t i = 0; i < level.vertices.size(); ++i) {
+                if (level.vertices[i] == point) {
+                    return static_cast<int>(i);
+                }
+            }
+            level.vertices.push_back(point);
+            return static_cast<int>(level.vertices.size()) - 1;
+        };
+        
+        // Every sector's directed edges, to find who is behind each wall
+        std::vector<std::vector<std::pair<int, int>>> edges(shapes.size());
+        for (size_t sector = 0; sector < shapes.size(); ++sector) {
+            for (const std::vector<glm::vec2>& contour : shapes[sector].contours) {
+                for (size_t i = 0; i < contour.size(); ++i) {
+                    edges[sector].emplace_back(vertexIndex(contour[i]), vertexIndex(contour[(i + 1) % contour.size()]));
+                }
+            }
+        }
+        
+        for (size_t sector = 0; sector < shapes.size(); ++sector) {
+            LevelSector levelSector = { shapes[sector].floorHeight, shapes[sector].ceilingHeight, 0, 0,
+                                        static_cast<int>(level.walls.size()), static_cast<int>(edges[sector].size()) };
+            level.sectors.push_back(levelSector);
+            for (const auto& [start, end] : edges[sector]) {
+                int backSector = -1;
+                for (size_t other = 0; other < shapes.size() && backSector < 0; ++other) {
+                    for (const auto& edge : edges[other]) {
+                        if (other != sector && edge.first == end && edge.second == start) {
+                            backSector = static_cast<int>(other);
+                        }
+                    }
+                }
+                float height = shapes[sector].ceilingHeight - shapes[sector].floorHeight;
+                level.walls.push_back({ start, end, height, 0, backSector });
+            }
+        }
+        return level;
+    }
+    
+    // Counterclockwise corners of an axis-aligned rectangle
+    inline std::vector<glm::vec2> Rectangle(float minX, float minZ, float maxX, float maxZ) {
+        return { { minX, minZ }, { maxX, minZ }, { maxX, maxZ }, { minX, maxZ } };
+    }
+}
@@ -0,0 +1,45 @@
+#include "Test.h"
+#include <cstring>
+#include <exception>
+
+namespace {
+    int g_Failures = 0;
+}
+
+std::vector<Test::Case>& Test::GetCases() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+void Test::Fail(const char* file, int line, const char* condition) {
+    std::cerr << file << ":" << line << ": CHECK(" << condition << ") failed" << std::endl;
+    ++g_Failures;
+}
+
+// Runs every test, or only those whose name contains the first argument
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0;
+    int failed = 0;
+    for (const Test::Case& test : Test::GetCases()) {
+        if (filter && !std::strstr(test.name, filter)) {
+            continue;
+        }
+        
+        int failuresBefore = g_Failures;
+        try {
+            test.function();
+        } catch (const std::exception& e) {
+            std::cerr << test.name << ": unexpected exception: " << e.what() << std::endl;
+            ++g_Failures;
+        }
+        ++run;
+        if (g_Failures != failuresBefore) {
+            std::cerr << "FAILED " << test.name << std::endl;
+            ++failed;
+        }
+    }
+    
+    std::cout << run - failed << " of " << run << " tests passed" << std::endl;
+    return failed == 0 && run > 0 ? 0 : 1;
+}
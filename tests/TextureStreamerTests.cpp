@@ -0,0 +1,124 @@
+#include "Test.h"
+#include "TextureStreamer.h"
+#include <glad/glad.h>
+#include <memory>
+
+namespace {
+    const size_t MIB = 1024 * 1024;
+    
+    // RGBA8 arrays of blank layers, registered at their resident level
+    struct Arrays {
+        TextureStreamer streamer;
+        std::vector<std::unique_ptr<TextureArray>> arrays;
+        
+        Arrays(int count, int size, int layers) {
+            GlStub::Reset();
+            int levels = 1;
+            while ((size >> (levels - 1)) > 1) {
+                ++levels;
+            }
+            int residentLevel = TextureStreamer::GetResidentLevel(size, size, levels);
+            for (int i = 0; i < count; ++i) {
+                arrays.push_back(std::make_unique<TextureArray>(size, size, layers, CookedFormat::Rgba8, levels,
+                                                                residentLevel));
+                std::vector<TextureStreamer::LayerSource> sources(layers);
+                for (TextureStreamer::LayerSource& source : sources) {
+                    for (int level = 0; level < levels; ++level) {
+                        int levelSize = std::max(size >> level, 1);
+                        source.levels.emplace_back(static_cast<size_t>(levelSize) * levelSize * 4);
+                    }
+                }
+                streamer.AddArray(arrays.back().get(), std::move(sources));
+            }
+        }
+        
+        ~Arrays() {
+            streamer.Clear();
+        }
+        
+        // Run a frame requesting the finest level of the given arrays
+        void Frame(std::initializer_list<int> requested) {
+            streamer.BeginFrame();
+            for (int index : requested) {
+                streamer.Request(index, 0);
+            }
+            GlStub::Get().uploadedBytes = 0;
+            streamer.Update();
+        }
+        
+        int Base(int index) const {
+            return arrays[index]->GetBaseLevel();
+        }
+    };
+}
+
+TEST(TextureStreamerStartsAtResidentLevel) {
+    CHECK(TextureStreamer::GetResidentLevel(1024, 1024, 11) == 4);
+    CHECK(TextureStreamer::GetResidentLevel(1024, 256, 11) == 4);
+    CHECK(TextureStreamer::GetResidentLevel(32, 32, 6) == 0);
+    CHECK(TextureStreamer::GetResidentLevel(4096, 4096, 3) == 2);
+    
+    // Nothing requested keeps every array as it was allocated
+    Arrays arrays(2, 1024, 1);
+    arrays.Frame({});
+    CHECK(arrays.Base(0) == 4 && arrays.Base(1) == 4);
+    CHECK(arrays.streamer.GetStats().uploadedBytes == 0);
+    CHECK(arrays.streamer.GetStats().residentBytes == 2 * arrays.arrays[0]->GetMemoryUsage(4));
+}
+
+TEST(TextureStreamerEvictsUnseenArraysFirst) {
+    // Two of these at their finest level take more than the budget
+    Arrays arrays(3, 1024, 2);
+    arrays.streamer.SetBudget(12 * MIB);
+    
+    arrays.Frame({ 0, 1 });
+    CHECK(arrays.Base(0) == 1 && arrays.Base(1) == 1 && arrays.Base(2) == 4);
+    CHECK(arrays.streamer.GetStats().residentBytes <= 12 * MIB);
+    CHECK(arrays.streamer.GetStats().uploadedBytes == GlStub::Get().uploadedBytes);
+    
+    // The array in view gets its finest level, and the two out of view make room for it
+    arrays.Frame({ 2 });
+    const TextureStreamer::Stats& stats = arrays.streamer.GetStats();
+    CHECK(arrays.Base(0) == 2 && arrays.Base(1) == 2 && arrays.Base(2) == 0);
+    CHECK(stats.evictions == 2);
+    CHECK(stats.residentBytes <= 12 * MIB);
+    CHECK(stats.uploadedBytes == GlStub::Get().uploadedBytes);
+    
+    // Levels nobody asks for are let go once KEEP_FRAMES have passed since the last request
+    for (unsigned int frame = 1; frame < TextureStreamer::KEEP_FRAMES; ++frame) {
+        arrays.Frame({ 2 });
+    }
+    CHECK(arrays.Base(0) == 2 && arrays.Base(1) == 2);
+    arrays.Frame({ 2 });
+    CHECK(arrays.Base(0) == 4 && arrays.Base(1) == 4 && arrays.Base(2) == 0);
+    CHECK(arrays.streamer.GetStats().evictions == 2);
+}
+
+TEST(TextureStreamerSpreadsUploadsOverFrames) {
+    // Each array's finest level alone is over the per-frame allowance
+    Arrays arrays(3, 2048, 1);
+    CHECK(arrays.arrays[0]->GetMemoryUsage(0) > TextureStreamer::UPLOAD_BYTES_PER_FRAME);
+    
+    arrays.Frame({ 0, 1 });
+    CHECK(arrays.Base(0) == 0 && arrays.Base(1) == 5);
+    CHECK(arrays.streamer.GetStats().pendingUploads == 1);
+    arrays.Frame({ 0, 1 });
+    CHECK(arrays.Base(1) == 0);
+    CHECK(arrays.streamer.GetStats().pendingUploads == 0);
+    
+    // Coarsening re-uploads what it keeps, which here uses up the frame's allowance
+    size_t kept = arrays.arrays[0]->GetMemoryUsage(1);
+    arrays.streamer.SetBudget(3 * kept + MIB);
+    arrays.Frame({ 0, 1, 2 });
+    const TextureStreamer::Stats& stats = arrays.streamer.GetStats();
+    CHECK(arrays.Base(0) == 1 && arrays.Base(1) == 1 && arrays.Base(2) == 5);
+    CHECK(stats.evictions == 2);
+    CHECK(stats.uploadedBytes == 2 * kept);
+    CHECK(stats.uploadedBytes == GlStub::Get().uploadedBytes);
+    CHECK(stats.pendingUploads == 1);
+    
+    arrays.Frame({ 0, 1, 2 });
+    CHECK(arrays.Base(2) == 1);
+    CHECK(arrays.streamer.GetStats().uploadedBytes == kept);
+    CHECK(arrays.streamer.GetStats().residentBytes <= 3 * kept + MIB);
+}
@@ -0,0 +1,78 @@
+#include "Test.h"
+#include "Map.h"
+#include "Triangulate.h"
+#include <cmath>
+
+namespace {
+    float SignedArea(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c) {
+        return 0.5f * ((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x));
+    }
+    
+    // Sum of the triangles' areas; false through allCounterclockwise if any is not positive
+    float TriangleArea(ArrayView<glm::vec2> vertices, ArrayView<int> triangles, bool& allCounterclockwise) {
+        float area = 0.0f;
+        allCounterclockwise = true;
+        for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+            float triangle = SignedArea(vertices[triangles[i]], vertices[triangles[i + 1]], vertices[triangles[i + 2]]);
+            allCounterclockwise = allCounterclockwise && triangle > 0.0f;
+            area += triangle;
+        }
+        return area;
+    }
+    
+    // A sector's walls as directed edges with the sector on their left, as the map triangulates them
+    std::vector<std::pair<int, int>> SectorEdges(const Map& map, int sector) {
+        std::vector<std::pair<int, int>> edges;
+        int firstWall = map.GetSectorFirstWall(sector);
+        for (int wall = firstWall; wall < firstWall + static_cast<int>(map.GetSectors()[sector].walls.size()); ++wall) {
+            const Linedef& line = map.GetLinedefs()[map.GetSidedefs()[wall].linedef];
+            if (line.frontSide == wall) {
+                edges.emplace_back(line.startVertex, line.endVertex);
+            } else {
+                edges.emplace_back(line.endVertex, line.startVertex);
+            }
+        }
+        return edges;
+    }
+}
+
+TEST(TriangulatePillarRoomLeavesHoleOut) {
+    Map map(Map::CreateTestMap());
+    std::vector<int> triangles;
+    CHECK(TriangulateRegion(map.GetVertices(), SectorEdges(map, 0), triangles));
+    
+    // A 10 x 10 room around a 2 x 2 pillar: ten vertices and one hole give ten triangles
+    bool counterclockwise = false;
+    CHECK(triangles.size() == 30);
+    CHECK(std::abs(TriangleArea(map.GetVertices(), triangles, counterclockwise) - 96.0f) < 1e-3f);
+    CHECK(counterclockwise);
+    
+    // No triangle lies over the pillar
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+        glm::vec2 center = (map.GetVertices()[triangles[i]] + map.GetVertices()[triangles[i + 1]] +
+                            map.GetVertices()[triangles[i + 2]]) / 3.0f;
+        CHECK(!(center.x > 4.0f && center.x < 6.0f && center.y > 4.0f && center.y < 6.0f));
+    }
+}
+
+TEST(TriangulateMapSectorsCoverTheirArea) {
+    Map map(Map::CreateTestMap());
+    const float expected[] = { 96.0f, 4.0f, 42.0f };
+    CHECK(map.GetSectors().size() == 3);
+    for (size_t sector = 0; sector < map.GetSectors().size() && sector < 3; ++sector) {
+        bool counterclockwise = false;
+        float area = TriangleArea(map.GetVertices(), map.GetSectors()[sector].triangles, counterclockwise);
+        CHECK(std::abs(area - expected[sector]) < 1e-3f);
+        CHECK(counterclockwise);
+    }
+}
+
+TEST(TriangulateReportsOpenOutlines) {
+    std::vector<glm::vec2> vertices = { { 0.0f, 0.0f }, { 4.0f, 0.0f }, { 4.0f, 4.0f }, { 0.0f, 4.0f } };
+    std::vector<int> triangles;
+    CHECK(TriangulateRegion(vertices, { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 } }, triangles));
+    CHECK(triangles.size() == 6);
+    
+    triangles.clear();
+    CHECK(!TriangulateRegion(vertices, { { 0, 1 }, { 1, 2 }, { 2, 3 } }, triangles));
+}
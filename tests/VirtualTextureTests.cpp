@@ -0,0 +1,165 @@
+#include "Test.h"
+#include "VirtualTexture.h"
+#include "ThreadPool.h"
+#include <glad/glad.h>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    const unsigned int ATLAS_UNIT = 0;
+    const unsigned int INDIRECTION_UNIT = 1;
+    
+    // Every texel of a page holds its level and coordinates, so the atlas shows which page is where
+    void PaintPageId(int level, int pageX, int pageY, unsigned char* pixels) {
+        for (int i = 0; i < VirtualTexture::PADDED_PAGE_SIZE * VirtualTexture::PADDED_PAGE_SIZE; ++i) {
+            pixels[i * 4 + 0] = static_cast<unsigned char>(pageX);
+            pixels[i * 4 + 1] = static_cast<unsigned char>(pageY);
+            pixels[i * 4 + 2] = static_cast<unsigned char>(level);
+            pixels[i * 4 + 3] = 255;
+        }
+    }
+    
+    struct Page {
+        int level;
+        int x;
+        int y;
+    };
+    
+    // The page the indirection texture sends a page's texels to, read back from the atlas
+    Page Lookup(const VirtualTexture& texture, int level, int x, int y) {
+        texture.Bind(ATLAS_UNIT, INDIRECTION_UNIT);
+        const GlStub::Level* indirection = GlStub::GetLevel(INDIRECTION_UNIT, level);
+        const GlStub::Level* atlas = GlStub::GetLevel(ATLAS_UNIT, 0);
+        const unsigned char* entry = &indirection->pixels[(static_cast<size_t>(y) * indirection->width + x) * 4];
+        size_t atlasX = static_cast<size_t>(entry[0]) * VirtualTexture::PADDED_PAGE_SIZE;
+        size_t atlasY = static_cast<size_t>(entry[1]) * VirtualTexture::PADDED_PAGE_SIZE;
+        const unsigned char* texel = &atlas->pixels[(atlasY * atlas->width + atlasX) * 4];
+        CHECK(texel[2] == entry[2]);
+        return { entry[2], texel[0], texel[1] };
+    }
+    
+    bool IsResident(const VirtualTexture& texture, int level, int x, int y) {
+        return Lookup(texture, level, x, y).level == level;
+    }
+    
+    // Resident pages among a rectangle of finest-level pages and their ancestors, short of the coarsest
+    int CountResident(const VirtualTexture& texture, int x, int y, int width, int height) {
+        int resident = 0;
+        for (int level = 0; level + 1 < texture.GetLevels(); ++level) {
+            for (int pageY = y >> level; pageY <= (y + height - 1) >> level; ++pageY) {
+                for (int pageX = x >> level; pageX <= (x + width - 1) >> level; ++pageX) {
+                    resident += IsResident(texture, level, pageX, pageY) ? 1 : 0;
+                }
+            }
+        }
+        return resident;
+    }
+    
+    // Feedback asking for a rectangle of pages at one level, one page per feedback pixel
+    class Feedback {
+    public:
+        void Request(int level, int x, int y, int width, int height) {
+            m_Width = width;
+            m_Height = height;
+            m_Pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+            for (int j = 0; j < height; ++j) {
+                for (int i = 0; i < width; ++i) {
+                    unsigned char* pixel = &m_Pixels[(static_cast<size_t>(j) * width + i) * 4];
+                    pixel[0] = static_cast<unsigned char>(x + i);
+                    pixel[1] = static_cast<unsigned char>(y + j);
+                    pixel[2] = static_cast<unsigned char>(level);
+                    pixel[3] = 255;
+                }
+            }
+        }
+        
+        // Run frames until every requested page is resident
+        bool Settle(VirtualTexture& texture) {
+            GlStub::Get().mappedPixels = m_Pixels.data();
+            for (int frame = 0; frame < 1000; ++frame) {
+                texture.BeginFeedback(m_Width * VirtualTexture::FEEDBACK_SCALE, m_Height * VirtualTexture::FEEDBACK_SCALE);
+                texture.EndFeedback();
+                texture.Update();
+                if (texture.GetStats().requestedPages > 0 && texture.GetStats().pendingPages == 0) {
+                    return true;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return false;
+        }
+    
+    private:
+        std::vector<unsigned char> m_Pixels;
+        int m_Width = 0;
+        int m_Height = 0;
+    };
+}
+
+TEST(VirtualTextureRejectsBadSizes) {
+    GlStub::Reset();
+    ThreadPool pool(1);
+    CHECK_THROWS(VirtualTexture(24, PaintPageId, &pool), std::runtime_error);
+    CHECK_THROWS(VirtualTexture(VirtualTexture::MAX_PAGES * 2, PaintPageId, &pool), std::runtime_error);
+}
+
+TEST(VirtualTextureFallsBackToAncestors) {
+    GlStub::Reset();
+    ThreadPool pool(2);
+    VirtualTexture texture(8, PaintPageId, &pool);
+    CHECK(texture.GetLevels() == 4);
+    
+    // At first every page shows the coarsest one
+    CHECK(texture.GetStats().residentPages == 0);
+    Page root = Lookup(texture, 0, 5, 3);
+    CHECK(root.level == 3 && root.x == 0 && root.y == 0);
+    
+    // One fine page brings its ancestors with it, and pages nearby borrow the finest of those they share
+    Feedback feedback;
+    feedback.Request(0, 5, 3, 1, 1);
+    CHECK(feedback.Settle(texture));
+    CHECK(texture.GetStats().residentPages == 4);
+    Page page = Lookup(texture, 0, 5, 3);
+    CHECK(page.level == 0 && page.x == 5 && page.y == 3);
+    Page sibling = Lookup(texture, 0, 4, 2);
+    CHECK(sibling.level == 1 && sibling.x == 2 && sibling.y == 1);
+    Page cousin = Lookup(texture, 0, 7, 0);
+    CHECK(cousin.level == 2 && cousin.x == 1 && cousin.y == 0);
+    Page distant = Lookup(texture, 0, 0, 7);
+    CHECK(distant.level == 3);
+    Page coarser = Lookup(texture, 1, 3, 0);
+    CHECK(coarser.level == 2 && coarser.x == 1 && coarser.y == 0);
+}
+
+TEST(VirtualTextureEvictsLeastRecentlyUsed) {
+    GlStub::Reset();
+    ThreadPool pool(2);
+    VirtualTexture texture(32, PaintPageId, &pool);
+    const int slots = VirtualTexture::ATLAS_PAGES * VirtualTexture::ATLAS_PAGES;
+    
+    // Each block is 64 fine pages, which with their ancestors take 87 slots; three blocks do not fit
+    // beside the pinned coarsest page
+    Feedback older;
+    older.Request(0, 0, 0, 16, 4);
+    Feedback newer;
+    newer.Request(0, 0, 16, 16, 4);
+    Feedback latest;
+    latest.Request(0, 16, 16, 16, 4);
+    
+    CHECK(older.Settle(texture));
+    CHECK(newer.Settle(texture));
+    CHECK(texture.GetStats().residentPages == 2 * 87 + 1);
+    CHECK(latest.Settle(texture));
+    CHECK(texture.GetStats().residentPages == static_cast<unsigned int>(slots));
+    
+    // Room for the latest block came from the block asked for longest ago
+    CHECK(CountResident(texture, 0, 0, 16, 4) == 87 - 6);
+    CHECK(CountResident(texture, 0, 16, 16, 4) == 87);
+    CHECK(CountResident(texture, 16, 16, 16, 4) == 87);
+    
+    // Pages asked for again come back in place of the next least recently used
+    CHECK(older.Settle(texture));
+    CHECK(CountResident(texture, 0, 0, 16, 4) == 87);
+    CHECK(CountResident(texture, 0, 16, 16, 4) == 87 - 6);
+    CHECK(CountResident(texture, 16, 16, 16, 4) == 87);
+}
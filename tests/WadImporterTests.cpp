@@ -0,0 +1,241 @@
+#include "Test.h"
+#include "WadImporter.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    // Little-endian fields as the WAD format stores them
+    class Lump {
+    public:
+        Lump& I16(int value) {
+            m_Bytes.push_back(static_cast<unsigned char>(value & 0xff));
+            m_Bytes.push_back(static_cast<unsigned char>((value >> 8) & 0xff));
+            return *this;
+        }
+        
+        Lump& U32(uint32_t value) {
+            return I16(static_cast<int>(value & 0xffff)).I16(static_cast<int>(value >> 16));
+        }
+        
+        Lump& Name(const std::string& name) {
+            for (size_t i = 0; i < 8; ++i) {
+                m_Bytes.push_back(i < name.size() ? static_cast<unsigned char>(name[i]) : 0);
+            }
+            return *this;
+        }
+        
+        Lump& Thing(int x, int y, int angle, int type) { return I16(x).I16(y).I16(angle).I16(type).I16(7); }
+        Lump& Linedef(int start, int end, int front, int back) { return I16(start).I16(end).I16(0).I16(0).I16(0).I16(front).I16(back); }
+        Lump& Sidedef(const std::string& upper, const std::string& lower, const std::string& middle, int sector) {
+            return I16(0).I16(0).Name(upper).Name(lower).Name(middle).I16(sector);
+        }
+        Lump& Sector(int floor, int ceiling, const std::string& floorFlat, const std::string& ceilingFlat, int light) {
+            return I16(floor).I16(ceiling).Name(floorFlat).Name(ceilingFlat).I16(light).I16(0).I16(0);
+        }
+        
+        const std::vector<unsigned char>& GetBytes() const { return m_Bytes; }
+    
+    private:
+        std::vector<unsigned char> m_Bytes;
+    };
+    
+    using Lumps = std::vector<std::pair<std::string, Lump>>;
+    
+    const int NO_SIDEDEF = 0xffff;
+    
+    // Two rooms side by side, 128 units square, joined by a two-sided line at x = 128.
+    // Room 0 also holds a line with room 0 on both sides.
+    Lumps TestMap(const std::string& marker) {
+        Lump things;
+        things.Thing(200, 64, 0, 3004).Thing(64, 96, 90, 1).Thing(32, 32, 0, 2);
+        
+        Lump vertexes;
+        vertexes.I16(0).I16(0).I16(128).I16(0).I16(128).I16(128).I16(0).I16(128);
+        vertexes.I16(256).I16(0).I16(256).I16(128).I16(32).I16(32).I16(64).I16(64);
+        
+        Lump sidedefs;
+        sidedefs.Sidedef("-", "-", "STARTAN", 0);
+        sidedefs.Sidedef("-", "-", "BROWN1", 1);
+        sidedefs.Sidedef("-", "STEP1", "-", 0);
+        sidedefs.Sidedef("-", "-", "-", 1);
+        sidedefs.Sidedef("-", "-", "-", 0);
+        sidedefs.Sidedef("-", "-", "-", 0);
+        
+        Lump linedefs;
+        linedefs.Linedef(3, 0, 0, NO_SIDEDEF).Linedef(0, 1, 0, NO_SIDEDEF).Linedef(2, 3, 0, NO_SIDEDEF);
+        linedefs.Linedef(1, 2, 2, 3);
+        linedefs.Linedef(1, 4, 1, NO_SIDEDEF).Linedef(4, 5, 1, NO_SIDEDEF).Linedef(5, 2, 1, NO_SIDEDEF);
+        linedefs.Linedef(6, 7, 4, 5);
+        
+        Lump sectors;
+        sectors.Sector(0, 128, "FLOOR4_8", "CEIL3_5", 160);
+        sectors.Sector(16, 120, "NUKAGE1", "F_SKY1", 300);
+        
+        return { { marker, Lump() }, { "THINGS", things }, { "LINEDEFS", linedefs }, { "SIDEDEFS", sidedefs },
+                 { "VERTEXES", vertexes }, { "SECTORS", sectors } };
+    }
+    
+    Lump& Find(Lumps& lumps, const std::string& name) {
+        for (auto& lump : lumps) {
+            if (lump.first == name) {
+                return lump.second;
+            }
+        }
+        throw std::runtime_error("no lump " + name);
+    }
+    
+    // A PWAD written to a temporary file, removed again when this goes out of scope
+    class TempWad {
+    public:
+        TempWad(const std::string& name, const Lumps& lumps)
+            : m_Path((std::filesystem::temp_directory_path() / ("WadImporterTests_" + name + ".wad")).string()) {
+            std::vector<unsigned char> contents;
+            Lump directory;
+            uint32_t offset = 12;
+            for (const auto& lump : lumps) {
+                const std::vector<unsigned char>& bytes = lump.second.GetBytes();
+                directory.U32(offset).U32(static_cast<uint32_t>(bytes.size())).Name(lump.first);
+                contents.insert(contents.end(), bytes.begin(), bytes.end());
+                offset += static_cast<uint32_t>(bytes.size());
+            }
+            
+            Lump header;
+            header.U32(static_cast<uint32_t>(lumps.size())).U32(offset);
+            std::ofstream file(m_Path, std::ios::binary);
+            file.write("PWAD", 4);
+            file.write(reinterpret_cast<const char*>(header.GetBytes().data()), header.GetBytes().size());
+            file.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+            file.write(reinterpret_cast<const char*>(directory.GetBytes().data()), directory.GetBytes().size());
+        }
+        
+        ~TempWad() { std::remove(m_Path.c_str()); }
+        
+        const std::string& GetPath() const { return m_Path; }
+    
+    private:
+        std::string m_Path;
+    };
+    
+    bool Near(float a, float b) {
+        return std::abs(a - b) < 1e-5f;
+    }
+}
+
+TEST(WadImportScalesAndFlipsCoordinates) {
+    TempWad wad("scale", TestMap("MAP01"));
+    WadImporter importer(wad.GetPath());
+    CHECK(importer.GetMapNames() == std::vector<std::string>{ "MAP01" });
+    
+    LevelData level = importer.ImportMap("MAP01");
+    CHECK(level.vertices.size() == 8);
+    CHECK(level.vertices[2] == glm::vec2(4.0f, -4.0f));
+    CHECK(level.vertices[4] == glm::vec2(8.0f, 0.0f));
+    CHECK(level.vertices[7] == glm::vec2(2.0f, -2.0f));
+    
+    CHECK(level.sectors.size() == 2);
+    CHECK(Near(level.sectors[1].floorHeight, 0.5f));
+    CHECK(Near(level.sectors[1].ceilingHeight, 3.75f));
+    CHECK(level.sectors[0].lightLevel == 160);
+    CHECK(level.sectors[1].lightLevel == 255);
+    CHECK(level.textures[level.sectors[1].floorTextureId] == "textures/NUKAGE1.png");
+    CHECK(level.textures[level.sectors[1].ceilingTextureId] == "textures/F_SKY1.png");
+}
+
+TEST(WadImportMakesPortalWallsInBothSectors) {
+    TempWad wad("portals", TestMap("MAP01"));
+    LevelData level = WadImporter(wad.GetPath()).ImportMap("MAP01");
+    
+    // Three solid walls and the portal in each room; the line inside room 0 is dropped
+    CHECK(level.walls.size() == 8);
+    const LevelSector& room0 = level.sectors[0];
+    const LevelSector& room1 = level.sectors[1];
+    CHECK(room0.firstWall == 0 && room0.wallCount == 4);
+    CHECK(room1.firstWall == 4 && room1.wallCount == 4);
+    
+    int portals = 0;
+    for (int i = 0; i < static_cast<int>(level.walls.size()); ++i) {
+        const LevelWall& wall = level.walls[i];
+        CHECK(!(wall.startVertex == 6 || wall.endVertex == 6));
+        if (wall.backSector < 0) {
+            continue;
+        }
+        ++portals;
+        if (i < room0.wallCount) {
+            CHECK(wall.startVertex == 1 && wall.endVertex == 2 && wall.backSector == 1);
+            CHECK(Near(wall.height, 4.0f));
+            CHECK(level.textures[wall.textureId] == "textures/STEP1.png");
+        } else {
+            CHECK(wall.startVertex == 2 && wall.endVertex == 1 && wall.backSector == 0);
+            CHECK(Near(wall.height, 3.25f));
+            CHECK(wall.textureId == room1.floorTextureId);
+        }
+    }
+    CHECK(portals == 2);
+}
+
+TEST(WadImportTakesPlayerOneStart) {
+    TempWad wad("start", TestMap("MAP01"));
+    LevelData level = WadImporter(wad.GetPath()).ImportMap("MAP01");
+    CHECK(level.hasStart);
+    CHECK(level.start.position == glm::vec2(2.0f, -3.0f));
+    CHECK(level.start.yaw == -90.0f);
+    
+    Lumps noStart = TestMap("MAP01");
+    Find(noStart, "THINGS") = Lump().Thing(64, 96, 90, 2);
+    TempWad noStartWad("nostart", noStart);
+    CHECK(!WadImporter(noStartWad.GetPath()).ImportMap("MAP01").hasStart);
+}
+
+TEST(WadImportRejectsHexenMaps) {
+    Lumps lumps = TestMap("MAP01");
+    Lumps hexen = TestMap("MAP02");
+    hexen.push_back({ "BEHAVIOR", Lump().I16(0) });
+    lumps.insert(lumps.end(), hexen.begin(), hexen.end());
+    TempWad wad("hexen", lumps);
+    
+    WadImporter importer(wad.GetPath());
+    CHECK(importer.GetMapNames() == (std::vector<std::string>{ "MAP01", "MAP02" }));
+    CHECK(importer.ImportMap("MAP01").walls.size() == 8);
+    CHECK_THROWS(importer.ImportMap("MAP02"), std::runtime_error);
+    CHECK_THROWS(importer.ImportMap("MAP03"), std::runtime_error);
+}
+
+TEST(WadImportRejectsMalformedLumps) {
+    Lumps badSize = TestMap("MAP01");
+    Find(badSize, "LINEDEFS").I16(0);
+    TempWad badSizeWad("badsize", badSize);
+    CHECK_THROWS(WadImporter(badSizeWad.GetPath()).ImportMap("MAP01"), std::runtime_error);
+    
+    Lumps badSidedef = TestMap("MAP01");
+    Find(badSidedef, "LINEDEFS").Linedef(0, 2, 99, NO_SIDEDEF);
+    TempWad badSidedefWad("badsidedef", badSidedef);
+    CHECK_THROWS(WadImporter(badSidedefWad.GetPath()).ImportMap("MAP01"), std::runtime_error);
+    
+    Lumps badVertex = TestMap("MAP01");
+    Find(badVertex, "LINEDEFS").Linedef(0, 42, 0, NO_SIDEDEF);
+    TempWad badVertexWad("badvertex", badVertex);
+    CHECK_THROWS(WadImporter(badVertexWad.GetPath()).ImportMap("MAP01"), std::runtime_error);
+    
+    Lumps badSector = TestMap("MAP01");
+    Find(badSector, "SIDEDEFS").Sidedef("-", "-", "STARTAN", 7);
+    Find(badSector, "LINEDEFS").Linedef(0, 2, 6, NO_SIDEDEF);
+    TempWad badSectorWad("badsector", badSector);
+    CHECK_THROWS(WadImporter(badSectorWad.GetPath()).ImportMap("MAP01"), std::runtime_error);
+    
+    Lumps missing = TestMap("MAP01");
+    missing.pop_back();
+    TempWad missingWad("missing", missing);
+    CHECK_THROWS(WadImporter(missingWad.GetPath()).ImportMap("MAP01"), std::runtime_error);
+}
+
+TEST(WadImportRejectsOtherFiles) {
+    std::string path = (std::filesystem::temp_directory_path() / "WadImporterTests_notwad.wad").string();
+    std::ofstream(path, std::ios::binary) << "IMAGE, NOT A WAD";
+    CHECK_THROWS(WadImporter importer(path), std::runtime_error);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+// Stands in for the GL loader in unit tests, which have no context. Only the
+// calls the texture code makes are declared. Texture names are handed out and
+// counted, 2D texture levels keep the texels uploaded to them, and feedback
+// readbacks map whatever GlStub::State::mappedPixels points at.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+typedef unsigned int GLenum;
+typedef unsigned int GLuint;
+typedef int GLint;
+typedef int GLsizei;
+typedef unsigned int GLbitfield;
+typedef unsigned char GLboolean;
+typedef unsigned char GLubyte;
+typedef float GLfloat;
+typedef ptrdiff_t GLsizeiptr;
+typedef ptrdiff_t GLintptr;
+typedef uint64_t GLuint64;
+typedef struct __GLsync* GLsync;
+
+#define GL_COLOR_BUFFER_BIT 0x4000
+#define GL_DEPTH_BUFFER_BIT 0x0100
+#define GL_MAP_READ_BIT 0x0001
+#define GL_UNSIGNED_BYTE 0x1401
+#define GL_RED 0x1903
+#define GL_RGB 0x1907
+#define GL_RGBA 0x1908
+#define GL_R8 0x8229
+#define GL_RGBA8 0x8058
+#define GL_DEPTH_COMPONENT24 0x81A6
+#define GL_TEXTURE_2D 0x0DE1
+#define GL_TEXTURE_2D_ARRAY 0x8C1A
+#define GL_TEXTURE0 0x84C0
+#define GL_TEXTURE_MAG_FILTER 0x2800
+#define GL_TEXTURE_MIN_FILTER 0x2801
+#define GL_TEXTURE_WRAP_S 0x2802
+#define GL_TEXTURE_WRAP_T 0x2803
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#define GL_NEAREST 0x2600
+#define GL_LINEAR 0x2601
+#define GL_NEAREST_MIPMAP_NEAREST 0x2700
+#define GL_LINEAR_MIPMAP_LINEAR 0x2703
+#define GL_REPEAT 0x2901
+#define GL_CLAMP_TO_EDGE 0x812F
+#define GL_UNPACK_ALIGNMENT 0x0CF5
+#define GL_VIEWPORT 0x0BA2
+#define GL_EXTENSIONS 0x1F03
+#define GL_NUM_EXTENSIONS 0x821D
+#define GL_FRAMEBUFFER 0x8D40
+#define GL_RENDERBUFFER 0x8D41
+#define GL_DRAW_FRAMEBUFFER_BINDING 0x8CA6
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#define GL_DEPTH_ATTACHMENT 0x8D00
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#define GL_STREAM_READ 0x88E1
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_ALREADY_SIGNALED 0x911A
+#define GL_TIMEOUT_EXPIRED 0x911B
+#define GL_CONDITION_SATISFIED 0x911C
+
+namespace GlStub {
+    // RGBA8 texels of one level of a 2D texture; only RGBA uploads are kept
+    struct Level {
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> pixels;
+    };
+    
+    struct State {
+        GLuint nextName = 0;
+        std::set<GLuint> textures;
+        std::map<std::pair<GLuint, GLint>, Level> levels;
+        GLuint bound2D[32] = {};
+        GLuint boundArray[32] = {};
+        GLenum activeUnit = 0;
+        size_t uploadedBytes = 0;       // By glTex(Sub)Image and glCompressedTex(Sub)Image calls with data
+        
+        // What a mapped pixel pack buffer reads back, and whether fences have passed
+        const unsigned char* mappedPixels = nullptr;
+        bool fencesSignaled = true;
+    };
+    
+    inline State& Get() {
+        static State state;
+        return state;
+    }
+    
+    inline void Reset() {
+        Get() = State();
+    }
+    
+    inline GLuint& Bound(GLenum target) {
+        State& state = Get();
+        return target == GL_TEXTURE_2D_ARRAY ? state.boundArray[state.activeUnit] : state.bound2D[state.activeUnit];
+    }
+    
+    inline size_t GetChannels(GLenum format) {
+        return format == GL_RED ? 1 : format == GL_RGB ? 3 : 4;
+    }
+    
+    // Texels of a level of the 2D texture bound to a unit, or null if it was never allocated
+    inline const Level* GetLevel(unsigned int unit, GLint level) {
+        auto found = Get().levels.find({ Get().bound2D[unit], level });
+        return found != Get().levels.end() ? &found->second : nullptr;
+    }
+}
+
+inline void glGenTextures(GLsizei count, GLuint* names) {
+    for (GLsizei i = 0; i < count; ++i) {
+        names[i] = ++GlStub::Get().nextName;
+        GlStub::Get().textures.insert(names[i]);
+    }
+}
+
+inline void glDeleteTextures(GLsizei count, const GLuint* names) {
+    for (GLsizei i = 0; i < count; ++i) {
+        GlStub::Get().textures.erase(names[i]);
+        for (auto it = GlStub::Get().levels.begin(); it != GlStub::Get().levels.end(); ) {
+            it = it->first.first == names[i] ? GlStub::Get().levels.erase(it) : std::next(it);
+        }
+    }
+}
+
+inline void glActiveTexture(GLenum unit) { GlStub::Get().activeUnit = unit - GL_TEXTURE0; }
+inline void glBindTexture(GLenum target, GLuint texture) { GlStub::Bound(target) = texture; }
+inline void glTexParameteri(GLenum, GLenum, GLint) {}
+inline void glPixelStorei(GLenum, GLint) {}
+inline void glGenerateMipmap(GLenum) {}
+
+inline void glTexImage2D(GLenum target, GLint level, GLint, GLsizei width, GLsizei height, GLint, GLenum format,
+                         GLenum, const void* data) {
+    GlStub::Level& image = GlStub::Get().levels[{ GlStub::Bound(target), level }];
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+    if (data && format == GL_RGBA) {
+        std::memcpy(image.pixels.data(), data, image.pixels.size());
+    }
+    if (data) {
+        GlStub::Get().uploadedBytes += static_cast<size_t>(width) * height * GlStub::GetChannels(format);
+    }
+}
+
+inline void glTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum,
+                            GLenum, const void* data) {
+    GlStub::Level& image = GlStub::Get().levels[{ GlStub::Bound(target), level }];
+    const unsigned char* source = static_cast<const unsigned char*>(data);
+    for (GLsizei row = 0; row < height; ++row) {
+        std::memcpy(&image.pixels[(static_cast<size_t>(y + row) * image.width + x) * 4],
+                    source + static_cast<size_t>(row) * width * 4, static_cast<size_t>(width) * 4);
+    }
+    GlStub::Get().uploadedBytes += static_cast<size_t>(width) * height * 4;
+}
+
+inline void glCompressedTexImage2D(GLenum, GLint, GLenum, GLsizei, GLsizei, GLint, GLsizei size, const void*) {
+    GlStub::Get().uploadedBytes += static_cast<size_t>(size);
+}
+
+inline void glTexImage3D(GLenum, GLint, GLint, GLsizei, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*) {}
+inline void glCompressedTexImage3D(GLenum, GLint, GLenum, GLsizei, GLsizei, GLsizei, GLint, GLsizei, const void*) {}
+
+inline void glTexSubImage3D(GLenum, GLint, GLint, GLint, GLint, GLsizei width, GLsizei height, GLsizei depth,
+                            GLenum format, GLenum, const void*) {
+    GlStub::Get().uploadedBytes += static_cast<size_t>(width) * height * depth * GlStub::GetChannels(format);
+}
+
+inline void glCompressedTexSubImage3D(GLenum, GLint, GLint, GLint, GLint, GLsizei, GLsizei, GLsizei, GLenum,
+                                      GLsizei size, const void*) {
+    GlStub::Get().uploadedBytes += static_cast<size_t>(size);
+}
+
+inline void glGetIntegerv(GLenum, GLint* values) { values[0] = 0; }
+inline const GLubyte* glGetStringi(GLenum, GLuint) { return nullptr; }
+
+inline void glGenFramebuffers(GLsizei count, GLuint* names) { std::fill(names, names + count, 1u); }
+inline void glDeleteFramebuffers(GLsizei, const GLuint*) {}
+inline void glBindFramebuffer(GLenum, GLuint) {}
+inline void glFramebufferTexture2D(GLenum, GLenum, GLenum, GLuint, GLint) {}
+inline void glFramebufferRenderbuffer(GLenum, GLenum, GLenum, GLuint) {}
+inline GLenum glCheckFramebufferStatus(GLenum) { return GL_FRAMEBUFFER_COMPLETE; }
+inline void glGenRenderbuffers(GLsizei count, GLuint* names) { std::fill(names, names + count, 1u); }
+inline void glDeleteRenderbuffers(GLsizei, const GLuint*) {}
+inline void glBindRenderbuffer(GLenum, GLuint) {}
+inline void glRenderbufferStorage(GLenum, GLenum, GLsizei, GLsizei) {}
+
+inline void glViewport(GLint, GLint, GLsizei, GLsizei) {}
+inline void glClearColor(GLfloat, GLfloat, GLfloat, GLfloat) {}
+inline void glClear(GLbitfield) {}
+inline void glReadPixels(GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, void*) {}
+
+inline void glGenBuffers(GLsizei count, GLuint* names) { std::fill(names, names + count, 1u); }
+inline void glDeleteBuffers(GLsizei, const GLuint*) {}
+inline void glBindBuffer(GLenum, GLuint) {}
+inline void glBufferData(GLenum, GLsizeiptr, const void*, GLenum) {}
+inline void* glMapBufferRange(GLenum, GLintptr, GLsizeiptr, GLbitfield) {
+    return const_cast<unsigned char*>(GlStub::Get().mappedPixels);
+}
+inline GLboolean glUnmapBuffer(GLenum) { return 1; }
+
+inline GLsync glFenceSync(GLenum, GLbitfield) { return reinterpret_cast<GLsync>(static_cast<uintptr_t>(1)); }
+inline void glDeleteSync(GLsync) {}
+inline GLenum glClientWaitSync(GLsync, GLbitfield, GLuint64) {
+    return GlStub::Get().fencesSignaled ? GL_ALREADY_SIGNALED : GL_TIMEOUT_EXPIRED;
+}
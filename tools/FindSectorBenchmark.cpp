@@ -0,0 +1,109 @@
+// Times sector lookups on a level against the BSP leaf and even-odd test
+// that Map::FindSector used before the triangle grid.
+//
+//     FindSectorBenchmark [map] [points]
+//
+// The map defaults to a generated level of 100000 walls; any path Map loads
+// works, including other "gen:" paths. Points are spread uniformly over the
+// level's floors, so every lookup finds a sector. Build with optimizations
+// (CMAKE_BUILD_TYPE=Release) for meaningful numbers.
+
+#include "Map.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    // The lookup Map::FindSector made before the triangle grid
+    int FindSectorByBsp(const Map& map, const glm::vec2& point) {
+        const BspTree& bsp = map.GetBsp();
+        if (!bsp.IsEmpty()) {
+            int sector = bsp.GetSubsectors()[bsp.FindSubsector(point)].sector;
+            if (sector >= 0 && map.IsPointInSector(sector, point.x, point.y)) {
+                return sector;
+            }
+        }
+        for (size_t i = 0; i < map.GetSectors().size(); ++i) {
+            if (map.IsPointInSector(static_cast<int>(i), point.x, point.y)) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+    
+    // Best of a few runs of body over all the points, in nanoseconds per lookup
+    template<typename Body>
+    double Time(size_t pointCount, Body&& body) {
+        const int runs = 3;
+        double best = 0.0;
+        for (int run = 0; run < runs; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            best = run == 0 ? elapsed : std::min(best, elapsed);
+        }
+        return best / static_cast<double>(pointCount);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "gen:seed=1,walls=100000";
+    size_t pointCount = argc > 2 ? std::stoul(argv[2]) : 1000000;
+    
+    Map map(path);
+    if (map.GetSectors().empty()) {
+        std::cerr << "No sectors in " << path << std::endl;
+        return 1;
+    }
+    
+    // Uniform points over the bounds, kept only where they land on a floor
+    Aabb bounds;
+    for (size_t sector = 0; sector < map.GetSectors().size(); ++sector) {
+        bounds.Expand(map.GetSectorBounds(static_cast<int>(sector)));
+    }
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> x(bounds.min.x, bounds.max.x);
+    std::uniform_real_distribution<float> z(bounds.min.z, bounds.max.z);
+    std::vector<glm::vec2> points;
+    points.reserve(pointCount);
+    while (points.size() < pointCount) {
+        glm::vec2 point(x(random), z(random));
+        if (map.FindSector(point.x, point.y) >= 0) {
+            points.push_back(point);
+        }
+    }
+    
+    std::vector<int> grid(pointCount);
+    std::vector<int> batched(pointCount);
+    std::vector<int> baseline(pointCount);
+    double gridTime = Time(pointCount, [&]() {
+        for (size_t i = 0; i < pointCount; ++i) {
+            grid[i] = map.FindSector(points[i].x, points[i].y);
+        }
+    });
+    double batchedTime = Time(pointCount, [&]() {
+        map.FindSectors(ArrayView<glm::vec2>(points), batched.data());
+    });
+    double baselineTime = Time(pointCount, [&]() {
+        for (size_t i = 0; i < pointCount; ++i) {
+            baseline[i] = FindSectorByBsp(map, points[i]);
+        }
+    });
+    
+    // Points exactly on a line between two sectors may go either way
+    size_t differences = 0;
+    for (size_t i = 0; i < pointCount; ++i) {
+        differences += grid[i] != baseline[i] || batched[i] != grid[i];
+    }
+    
+    std::cout << path << ": " << map.GetSectors().size() << " sectors, " << map.GetWallCount() << " walls, "
+              << pointCount << " points" << std::endl;
+    std::cout << "FindSector (triangle grid):  " << gridTime << " ns/lookup" << std::endl;
+    std::cout << "FindSectors (batched):       " << batchedTime << " ns/lookup" << std::endl;
+    std::cout << "BSP leaf + even-odd:         " << baselineTime << " ns/lookup ("
+              << baselineTime / gridTime << "x the grid)" << std::endl;
+    std::cout << "Lookups that differ:         " << differences << std::endl;
+    return 0;
+}
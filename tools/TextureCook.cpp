@@ -0,0 +1,103 @@
+// Cooks images into the texture cache that the renderer loads directly.
+//
+//     TextureCook [--format auto|rgba|bc1|bc3] [--output directory] [--force] <image> ...
+//
+// Each image is written to <directory>/<hash>.ctex, where hash is the hash of
+// the image file's contents. The directory defaults to resources/cooked; run
+// from the same directory as the game so the paths match. Images whose cooked
+// copy is already there in the requested format are skipped unless --force.
+
+#include "TextureCook.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+    void PrintUsage() {
+        std::cerr << "Usage: TextureCook [--format auto|rgba|bc1|bc3] [--output directory] [--force] <image> ..."
+                  << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::optional<CookedFormat> format;
+    std::string outputDirectory = TextureCook::CACHE_DIRECTORY;
+    bool force = false;
+    std::vector<std::string> sources;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--format" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "auto") {
+                format.reset();
+            } else if (name == "rgba") {
+                format = CookedFormat::Rgba8;
+            } else if (name == "bc1") {
+                format = CookedFormat::Bc1;
+            } else if (name == "bc3") {
+                format = CookedFormat::Bc3;
+            } else {
+                PrintUsage();
+                return 1;
+            }
+        } else if (argument == "--output" && i + 1 < argc) {
+            outputDirectory = argv[++i];
+        } else if (argument == "--force") {
+            force = true;
+        } else if (argument.rfind("--", 0) == 0) {
+            PrintUsage();
+            return 1;
+        } else {
+            sources.push_back(argument);
+        }
+    }
+    if (sources.empty()) {
+        PrintUsage();
+        return 1;
+    }
+    
+    std::error_code error;
+    std::filesystem::create_directories(outputDirectory, error);
+    if (error) {
+        std::cerr << "Could not create " << outputDirectory << ": " << error.message() << std::endl;
+        return 1;
+    }
+    
+    // Images are cooked one at a time; filtering and compression use the pool themselves
+    auto start = std::chrono::steady_clock::now();
+    int cooked = 0;
+    int failed = 0;
+    for (const std::string& source : sources) {
+        uint64_t hash;
+        if (!TextureCook::HashFile(source, hash)) {
+            std::cerr << "Could not read " << source << std::endl;
+            ++failed;
+            continue;
+        }
+        
+        std::string output = TextureCook::GetCachePath(hash, outputDirectory);
+        CookedTexture existing;
+        if (!force && existing.Open(output) && existing.GetSourceHash() == hash &&
+            (!format || existing.GetFormat() == *format)) {
+            std::cout << source << ": up to date" << std::endl;
+            continue;
+        }
+        existing.Close();
+        
+        if (!TextureCook::Cook(source, output, format, &ThreadPool::GetShared())) {
+            std::cerr << "Could not cook " << source << std::endl;
+            ++failed;
+            continue;
+        }
+        std::cout << source << " -> " << output << std::endl;
+        ++cooked;
+    }
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Cooked " << cooked << " textures in " << elapsed.count() << " ms" << std::endl;
+    return failed > 0 ? 1 : 0;
+}